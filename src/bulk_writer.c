@@ -0,0 +1,548 @@
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#include "headers/bulk_writer.h"
+
+#include "tests/headers/test_utils.h"
+
+/* Writes a file sequentially from a given offset in large chunks, without
+ * making the caller wait for the disk unless every chunk is in flight.
+ *
+ * The chunks come from one anonymous mapping, so that they are page
+ * aligned as O_DIRECT requires. Data is copied into the current chunk, and
+ * a full chunk is handed either to io_uring, set up through the raw system
+ * calls with the chunks registered as fixed buffers where the memory lock
+ * limit allows, or to a thread that writes it with pwrite. Chunks are
+ * handed over and reused in order.
+ *
+ * With O_DIRECT, every write starts and ends on BULK_WRITER_ALIGNMENT. A
+ * starting offset within a block is handled by reading the start of that
+ * block into the first chunk, and the last chunk is padded with zeros on
+ * closing, after which the file is truncated to the data actually written.
+ */
+struct chunk {
+	unsigned char *data;
+	uint64_t offset;
+	size_t size;
+	size_t done;
+	bool busy;
+};
+
+struct uring {
+	int fd;
+	void *sq_ring;
+	size_t sq_ring_size;
+	void *cq_ring;
+	size_t cq_ring_size;
+	struct io_uring_sqe *sqes;
+	size_t sqes_size;
+	unsigned *sq_tail;
+	unsigned *sq_mask;
+	unsigned *sq_array;
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned *cq_mask;
+	struct io_uring_cqe *cqes;
+};
+
+struct bulk_writer {
+	int fd;
+	unsigned char *buffers;
+	size_t buffers_size;
+	struct chunk *chunks;
+	uint chunk_count;
+	size_t chunk_size;
+	uint current;
+	size_t fill;
+	uint64_t end;
+	bool failed;
+	struct bulk_writer_stats stats;
+
+	struct uring ring;
+
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t submitted;
+	pthread_cond_t completed;
+	uint queue_head;
+	uint queue_count;
+	bool done;
+};
+
+static int uring_setup(unsigned entries, struct io_uring_params *params)
+{
+	return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+	return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int uring_register(int fd, unsigned opcode, const void *arg, unsigned count)
+{
+	return (int)syscall(__NR_io_uring_register, fd, opcode, arg, count);
+}
+
+static void uring_destroy(struct uring *ring)
+{
+	munmap(ring->sqes, ring->sqes_size);
+	if (ring->cq_ring != ring->sq_ring) {
+		munmap(ring->cq_ring, ring->cq_ring_size);
+	}
+	munmap(ring->sq_ring, ring->sq_ring_size);
+	close(ring->fd);
+}
+
+/* Sets up a ring with room for every chunk and registers the chunks as
+ * fixed buffers. Returns false if io_uring cannot be used at all. */
+static bool uring_create(bulk_writer bw)
+{
+	struct uring *ring = &bw->ring;
+	struct io_uring_params params;
+	memset(&params, 0, sizeof params);
+
+	ring->fd = uring_setup(bw->chunk_count, &params);
+	if (ring->fd < 0) {
+		return false;
+	}
+
+	ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof (unsigned);
+	ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof (struct io_uring_cqe);
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		if (ring->cq_ring_size > ring->sq_ring_size) {
+			ring->sq_ring_size = ring->cq_ring_size;
+		}
+		ring->cq_ring_size = ring->sq_ring_size;
+	}
+	ring->sqes_size = params.sq_entries * sizeof (struct io_uring_sqe);
+
+	ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			     ring->fd, IORING_OFF_SQ_RING);
+	if (ring->sq_ring == MAP_FAILED) {
+		close(ring->fd);
+		return false;
+	}
+	ring->cq_ring = ring->sq_ring;
+	if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+		ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+				     ring->fd, IORING_OFF_CQ_RING);
+		if (ring->cq_ring == MAP_FAILED) {
+			munmap(ring->sq_ring, ring->sq_ring_size);
+			close(ring->fd);
+			return false;
+		}
+	}
+	ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			  ring->fd, IORING_OFF_SQES);
+	if (ring->sqes == MAP_FAILED) {
+		if (ring->cq_ring != ring->sq_ring) {
+			munmap(ring->cq_ring, ring->cq_ring_size);
+		}
+		munmap(ring->sq_ring, ring->sq_ring_size);
+		close(ring->fd);
+		return false;
+	}
+
+	unsigned char *sq = ring->sq_ring;
+	unsigned char *cq = ring->cq_ring;
+	ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+	ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+	ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+	ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+	ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+	ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+	/* fixed buffers save the kernel mapping the pages on every write, but
+	 * count against the memory lock limit, so plain writes are the fallback */
+	struct iovec *iovecs = malloc((sizeof *iovecs) * bw->chunk_count);
+	for (uint i = 0; i < bw->chunk_count; i++) {
+		iovecs[i].iov_base = bw->chunks[i].data;
+		iovecs[i].iov_len = bw->chunk_size;
+	}
+	bw->stats.registered_buffers = !uring_register(ring->fd, IORING_REGISTER_BUFFERS, iovecs, bw->chunk_count);
+	free(iovecs);
+
+	return true;
+}
+
+/* Queues the rest of a chunk for writing and submits it. */
+static bool uring_submit(bulk_writer bw, uint index)
+{
+	struct uring *ring = &bw->ring;
+	struct chunk *chunk = &bw->chunks[index];
+
+	unsigned tail = *ring->sq_tail;
+	unsigned slot = tail & *ring->sq_mask;
+	struct io_uring_sqe *sqe = &ring->sqes[slot];
+	memset(sqe, 0, sizeof *sqe);
+	sqe->opcode = bw->stats.registered_buffers ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+	sqe->fd = bw->fd;
+	sqe->off = chunk->offset + chunk->done;
+	sqe->addr = (uint64_t)(uintptr_t)(chunk->data + chunk->done);
+	sqe->len = chunk->size - chunk->done;
+	sqe->buf_index = index;
+	sqe->user_data = index;
+	ring->sq_array[slot] = slot;
+	__atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+	int submitted;
+	while ((submitted = uring_enter(ring->fd, 1, 0, 0)) < 0 && errno == EINTR) {
+	}
+	return submitted == 1;
+}
+
+/* Handles every completion that is ready, resubmitting what is left of a
+ * chunk after a short write. */
+static void uring_reap_ready(bulk_writer bw)
+{
+	struct uring *ring = &bw->ring;
+
+	unsigned head = *ring->cq_head;
+	while (head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+		struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+		uint index = (uint)cqe->user_data;
+		int res = cqe->res;
+		__atomic_store_n(ring->cq_head, ++head, __ATOMIC_RELEASE);
+
+		struct chunk *chunk = &bw->chunks[index];
+		if (res <= 0) {
+			bw->failed = true;
+			chunk->busy = false;
+			continue;
+		}
+		chunk->done += res;
+		if (chunk->done < chunk->size && !uring_submit(bw, index)) {
+			bw->failed = true;
+			chunk->busy = false;
+		}
+		else if (chunk->done == chunk->size) {
+			chunk->busy = false;
+		}
+	}
+}
+
+/* Waits for at least one completion and handles it. */
+static void uring_reap(bulk_writer bw)
+{
+	struct uring *ring = &bw->ring;
+
+	while (*ring->cq_head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+		if (uring_enter(ring->fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+			bw->failed = true;
+			for (uint i = 0; i < bw->chunk_count; i++) {
+				bw->chunks[i].busy = false;
+			}
+			return;
+		}
+	}
+	uring_reap_ready(bw);
+}
+
+static void *writer_main(void *arg)
+{
+	bulk_writer bw = arg;
+
+	pthread_mutex_lock(&bw->lock);
+	for (;;) {
+		while (bw->queue_count == 0 && !bw->done) {
+			pthread_cond_wait(&bw->submitted, &bw->lock);
+		}
+		if (bw->queue_count == 0) {
+			break;
+		}
+
+		struct chunk *chunk = &bw->chunks[bw->queue_head];
+		bool skip = bw->failed;
+		pthread_mutex_unlock(&bw->lock);
+
+		bool ok = true;
+		while (!skip && chunk->done < chunk->size) {
+			ssize_t written = pwrite(bw->fd, chunk->data + chunk->done, chunk->size - chunk->done,
+						 chunk->offset + chunk->done);
+			if (written <= 0 && !(written < 0 && errno == EINTR)) {
+				ok = false;
+				break;
+			}
+			if (written > 0) {
+				chunk->done += written;
+			}
+		}
+
+		pthread_mutex_lock(&bw->lock);
+		if (!ok) {
+			bw->failed = true;
+		}
+		chunk->busy = false;
+		bw->queue_head = (bw->queue_head + 1) % bw->chunk_count;
+		bw->queue_count--;
+		pthread_cond_broadcast(&bw->completed);
+	}
+	pthread_mutex_unlock(&bw->lock);
+
+	return NULL;
+}
+
+/* Hands the first size bytes of the current chunk over for writing. */
+static bool submit_chunk(bulk_writer bw, size_t size)
+{
+	struct chunk *chunk = &bw->chunks[bw->current];
+	chunk->size = size;
+	chunk->done = 0;
+	chunk->busy = true;
+	bw->stats.chunks_submitted++;
+
+	if (bw->stats.backend == BULK_WRITER_URING) {
+		if (!uring_submit(bw, bw->current)) {
+			chunk->busy = false;
+			bw->failed = true;
+		}
+	}
+	else {
+		pthread_mutex_lock(&bw->lock);
+		bw->queue_count++;
+		pthread_cond_signal(&bw->submitted);
+		pthread_mutex_unlock(&bw->lock);
+	}
+	return !bw->failed;
+}
+
+/* Waits until the given chunk is no longer being written. */
+static void wait_chunk(bulk_writer bw, uint index)
+{
+	if (bw->stats.backend == BULK_WRITER_URING) {
+		while (bw->chunks[index].busy) {
+			uring_reap(bw);
+		}
+	}
+	else {
+		pthread_mutex_lock(&bw->lock);
+		while (bw->chunks[index].busy) {
+			pthread_cond_wait(&bw->completed, &bw->lock);
+		}
+		pthread_mutex_unlock(&bw->lock);
+	}
+}
+
+static bool is_busy(bulk_writer bw, uint index)
+{
+	if (bw->stats.backend == BULK_WRITER_URING) {
+		uring_reap_ready(bw);
+		return bw->chunks[index].busy;
+	}
+
+	pthread_mutex_lock(&bw->lock);
+	bool busy = bw->chunks[index].busy;
+	pthread_mutex_unlock(&bw->lock);
+	return busy;
+}
+
+static bool has_failed(bulk_writer bw)
+{
+	if (bw->stats.backend == BULK_WRITER_URING) {
+		return bw->failed;
+	}
+
+	pthread_mutex_lock(&bw->lock);
+	bool failed = bw->failed;
+	pthread_mutex_unlock(&bw->lock);
+	return failed;
+}
+
+/* Opens filename for writing from offset, discarding anything after it.
+ * A BULK_WRITER_URING backend falls back to BULK_WRITER_THREAD where
+ * io_uring is not available, and direct falls back to buffered writes on
+ * file systems that do not support O_DIRECT, which bulk_writer_get_stats
+ * reports. */
+bulk_writer bulk_writer_open(const char *filename, uint64_t offset, const struct bulk_writer_options *options)
+{
+	assert(filename);
+	assert(options);
+	assert("At least two chunks are needed to write while filling." && options->queue_depth >= 2);
+	assert("Chunks must be a multiple of the alignment."
+	       && options->chunk_size > 0 && options->chunk_size % BULK_WRITER_ALIGNMENT == 0);
+
+	int fd = -1;
+	bool direct = options->direct;
+	if (direct) {
+		fd = open(filename, O_RDWR | O_CREAT | O_DIRECT, 0644);
+		direct = fd >= 0;
+	}
+	if (fd < 0) {
+		fd = open(filename, O_RDWR | O_CREAT, 0644);
+	}
+	if (fd < 0) {
+		return NULL;
+	}
+	if (ftruncate(fd, offset)) {
+		close(fd);
+		return NULL;
+	}
+
+	size_t buffers_size = (size_t)options->queue_depth * options->chunk_size;
+	unsigned char *buffers = mmap(NULL, buffers_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buffers == MAP_FAILED) {
+		close(fd);
+		return NULL;
+	}
+
+	bulk_writer result = malloc(sizeof *result);
+	result->fd = fd;
+	result->buffers = buffers;
+	result->buffers_size = buffers_size;
+	result->chunk_count = options->queue_depth;
+	result->chunk_size = options->chunk_size;
+	result->chunks = malloc((sizeof *result->chunks) * result->chunk_count);
+	for (uint i = 0; i < result->chunk_count; i++) {
+		result->chunks[i] = (struct chunk) { .data = buffers + i * options->chunk_size };
+	}
+	result->current = 0;
+	result->fill = 0;
+	result->end = offset;
+	result->failed = false;
+	result->stats = (struct bulk_writer_stats) { .backend = options->backend, .direct = direct };
+	result->queue_head = result->queue_count = 0;
+	result->done = false;
+
+	/* with O_DIRECT, the first chunk starts at the block holding offset */
+	result->chunks[0].offset = offset;
+	size_t prefix = direct ? offset % BULK_WRITER_ALIGNMENT : 0;
+	if (prefix) {
+		result->chunks[0].offset -= prefix;
+		if (pread(fd, buffers, BULK_WRITER_ALIGNMENT, result->chunks[0].offset) < (ssize_t)prefix) {
+			munmap(buffers, buffers_size);
+			free(result->chunks);
+			free(result);
+			close(fd);
+			return NULL;
+		}
+		result->fill = prefix;
+	}
+
+	if (result->stats.backend == BULK_WRITER_URING && !uring_create(result)) {
+		result->stats.backend = BULK_WRITER_THREAD;
+	}
+	if (result->stats.backend == BULK_WRITER_THREAD) {
+		pthread_mutex_init(&result->lock, NULL);
+		pthread_cond_init(&result->submitted, NULL);
+		pthread_cond_init(&result->completed, NULL);
+		if (pthread_create(&result->thread, NULL, &writer_main, result)) {
+			pthread_cond_destroy(&result->completed);
+			pthread_cond_destroy(&result->submitted);
+			pthread_mutex_destroy(&result->lock);
+			munmap(buffers, buffers_size);
+			free(result->chunks);
+			free(result);
+			close(fd);
+			return NULL;
+		}
+	}
+
+	return result;
+}
+
+/* Copies the data into the current chunk, handing over every chunk that
+ * fills up. Only waits if the next chunk is still being written. Returns
+ * false once any write has failed. */
+bool bulk_writer_write(bulk_writer bw, const void *data, size_t size)
+{
+	assert(bw);
+	assert(data || size == 0);
+
+	const unsigned char *bytes = data;
+	while (size > 0) {
+		size_t part = bw->chunk_size - bw->fill;
+		if (part > size) {
+			part = size;
+		}
+		memcpy(bw->chunks[bw->current].data + bw->fill, bytes, part);
+		bw->fill += part;
+		bw->end += part;
+		bw->stats.bytes_written += part;
+		bytes += part;
+		size -= part;
+
+		if (bw->fill == bw->chunk_size) {
+			uint64_t next_offset = bw->chunks[bw->current].offset + bw->chunk_size;
+			if (!submit_chunk(bw, bw->chunk_size)) {
+				return false;
+			}
+			bw->current = (bw->current + 1) % bw->chunk_count;
+			if (is_busy(bw, bw->current)) {
+				bw->stats.stalls++;
+				wait_chunk(bw, bw->current);
+			}
+			bw->chunks[bw->current].offset = next_offset;
+			bw->fill = 0;
+		}
+	}
+
+	return !has_failed(bw);
+}
+
+/* The bytes written are those given to bulk_writer_write so far, whether
+ * or not they have reached the file yet. */
+void bulk_writer_get_stats(bulk_writer bw, struct bulk_writer_stats *stats)
+{
+	assert(bw);
+	assert(stats);
+	*stats = bw->stats;
+}
+
+/* Writes the last, partially filled chunk, waits for every write and
+ * closes the file. Returns false if any of that failed. */
+bool bulk_writer_close(bulk_writer *bw)
+{
+	assert(bw);
+	assert(*bw);
+
+	bulk_writer b = *bw;
+	bool success = true;
+	if (b->fill > 0) {
+		size_t size = b->fill;
+		if (b->stats.direct) {
+			size = (size + BULK_WRITER_ALIGNMENT - 1) & ~(size_t)(BULK_WRITER_ALIGNMENT - 1);
+			memset(b->chunks[b->current].data + b->fill, 0, size - b->fill);
+		}
+		success = submit_chunk(b, size);
+	}
+	for (uint i = 0; i < b->chunk_count; i++) {
+		wait_chunk(b, i);
+	}
+	success = !has_failed(b) && success;
+	if (b->stats.direct && ftruncate(b->fd, b->end)) {
+		success = false;
+	}
+
+	if (b->stats.backend == BULK_WRITER_URING) {
+		uring_destroy(&b->ring);
+	}
+	else {
+		pthread_mutex_lock(&b->lock);
+		b->done = true;
+		pthread_cond_signal(&b->submitted);
+		pthread_mutex_unlock(&b->lock);
+		pthread_join(b->thread, NULL);
+		pthread_cond_destroy(&b->completed);
+		pthread_cond_destroy(&b->submitted);
+		pthread_mutex_destroy(&b->lock);
+	}
+
+	success = !close(b->fd) && success;
+	munmap(b->buffers, b->buffers_size);
+	free(b->chunks);
+	free(b);
+	*bw = NULL;
+	return success;
+}
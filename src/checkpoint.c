@@ -0,0 +1,315 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "headers/checkpoint.h"
+#include "headers/math_utils.h"
+
+#include "tests/headers/test_utils.h"
+
+/* On disk, a checkpoint is the header below followed by the values of the
+ * dynamical system, double[system_size * element_size], starting at the
+ * offset recorded in the header. The coupling graph is not stored, since
+ * the recorded coupling callback and generator state reproduce it. All
+ * fields are stored in the native byte order of the writing machine.
+ */
+struct checkpoint_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t header_size;
+	double time;
+	double time_step;
+	uint32_t system_size;
+	uint32_t grid_width;
+	uint32_t grid_height;
+	uint32_t element_size;
+	uint64_t random_state;
+	uint32_t coupling_constant_is_random;
+	uint32_t reserved;
+	double coupling_constant;
+	double lowest_random_value;
+	double highest_random_value;
+	char model_name[CHECKPOINT_NAME_LENGTH];
+	char parameter_callback_name[CHECKPOINT_NAME_LENGTH];
+	char coupling_callback_name[CHECKPOINT_NAME_LENGTH];
+	char initial_values_callback_name[CHECKPOINT_NAME_LENGTH];
+	uint64_t values_offset;
+	uint64_t file_size;
+};
+
+static const char checkpoint_magic[8] = "NNCKPT";
+
+struct checkpoint {
+	void *mapping;
+	size_t mapping_size;
+	const struct checkpoint_header *header;
+};
+
+static void copy_name(char *dest, const char *src)
+{
+	memset(dest, '\0', CHECKPOINT_NAME_LENGTH);
+	if (src) {
+		strncpy(dest, src, CHECKPOINT_NAME_LENGTH - 1);
+	}
+}
+
+bool checkpoint_write(dynamical_system ds, const struct checkpoint_info *info, const char *filename)
+{
+	assert(ds);
+	assert(info);
+	assert(filename);
+
+	uint system_size = dynamical_system_get_system_size(ds);
+	uint element_size = dynamical_system_get_element_size(ds);
+	uint64_t random_state = math_utils_random_state_get();
+
+	struct checkpoint_header header;
+	memset(&header, 0, sizeof header);
+	memcpy(header.magic, checkpoint_magic, sizeof header.magic);
+	header.version = CHECKPOINT_VERSION;
+	header.header_size = sizeof header;
+	header.time = dynamical_system_get_time(ds);
+	header.time_step = info->time_step;
+	header.system_size = system_size;
+	header.grid_width = dynamical_system_get_grid_width(ds);
+	header.grid_height = dynamical_system_get_grid_height(ds);
+	header.element_size = element_size;
+	header.random_state = random_state;
+	header.coupling_constant_is_random = info->coupling_constant_is_random;
+	header.coupling_constant = info->coupling_constant;
+	header.lowest_random_value = info->lowest_random_value;
+	header.highest_random_value = info->highest_random_value;
+	copy_name(header.model_name, info->model_name);
+	copy_name(header.parameter_callback_name, info->parameter_callback_name);
+	copy_name(header.coupling_callback_name, info->coupling_callback_name);
+	copy_name(header.initial_values_callback_name, info->initial_values_callback_name);
+
+	/* write next to the target and rename once complete, so a crash
+	 * while writing never destroys the previous checkpoint */
+	size_t temp_filename_size = strlen(filename) + strlen(".tmp") + 1;
+	char *temp_filename = malloc(temp_filename_size);
+	snprintf(temp_filename, temp_filename_size, "%s.tmp", filename);
+
+	FILE *fh = fopen(temp_filename, "wb");
+	if (!fh) {
+		free(temp_filename);
+		return false;
+	}
+
+	bool ok = fwrite(&header, sizeof header, 1, fh) == 1;
+
+	header.values_offset = sizeof header;
+	ok = ok && fwrite(dynamical_system_get_values(ds), sizeof (double),
+			  (size_t)system_size * element_size, fh) == (size_t)system_size * element_size;
+	header.file_size = header.values_offset + sizeof (double) * (uint64_t)system_size * element_size;
+
+	ok = ok && fseek(fh, 0, SEEK_SET) == 0;
+	ok = ok && fwrite(&header, sizeof header, 1, fh) == 1;
+	ok = ok && fflush(fh) == 0;
+	ok = ok && fsync(fileno(fh)) == 0;
+	ok = (fclose(fh) == 0) && ok;
+	ok = ok && rename(temp_filename, filename) == 0;
+
+	if (!ok) {
+		remove(temp_filename);
+	}
+	free(temp_filename);
+
+	return ok;
+}
+
+/* Background checkpoints are written by a forked child, which sees a copy
+ * on write snapshot of the whole process as it was at the time of the
+ * fork. The integrator only pays for the fork itself, and pages it dirties
+ * while the child is writing are the only extra memory used. At most one
+ * child exists at a time, which bounds that overhead to a single copy.
+ */
+static pid_t background_pid = 0;
+static bool background_failed = false;
+
+static void reap_background(int options)
+{
+	int status;
+	if (background_pid > 0 && waitpid(background_pid, &status, options) == background_pid) {
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			background_failed = true;
+		}
+		background_pid = 0;
+	}
+}
+
+enum checkpoint_background_status checkpoint_write_background(dynamical_system ds,
+							     const struct checkpoint_info *info,
+							     const char *filename)
+{
+	assert(ds);
+	assert(info);
+	assert(filename);
+
+	reap_background(WNOHANG);
+	if (background_pid > 0) {
+		return CHECKPOINT_BACKGROUND_BUSY;
+	}
+
+	pid_t pid = fork();
+	if (pid == 0) {
+		/* _exit, so that output buffered by the parent is not flushed twice */
+		_exit(checkpoint_write(ds, info, filename) ? 0 : 1);
+	}
+	else if (pid < 0) {
+		/* no process to spare, so fall back to writing in place */
+		return checkpoint_write(ds, info, filename)
+			? CHECKPOINT_BACKGROUND_STARTED : CHECKPOINT_BACKGROUND_FAILED;
+	}
+
+	background_pid = pid;
+	return CHECKPOINT_BACKGROUND_STARTED;
+}
+
+/* Waits for the outstanding background checkpoint, if any. Returns false
+ * if any background checkpoint failed since the previous call. */
+bool checkpoint_wait_background(void)
+{
+	reap_background(0);
+
+	bool result = !background_failed;
+	background_failed = false;
+	return result;
+}
+
+static bool is_header_valid(const struct checkpoint_header *header, size_t file_size)
+{
+	if (file_size < sizeof *header) {
+		return false;
+	}
+	if (memcmp(header->magic, checkpoint_magic, sizeof header->magic)
+	    || header->version != CHECKPOINT_VERSION
+	    || header->header_size != sizeof *header
+	    || header->file_size != file_size) {
+		return false;
+	}
+
+	uint64_t values_size = sizeof (double) * (uint64_t)header->system_size * header->element_size;
+
+	return header->values_offset == sizeof *header
+		&& header->values_offset + values_size == file_size;
+}
+
+checkpoint checkpoint_open(const char *filename)
+{
+	assert(filename);
+
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		return NULL;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) || st.st_size < (off_t)sizeof (struct checkpoint_header)) {
+		close(fd);
+		return NULL;
+	}
+
+	/* the state is copied out of the mapping on restore, so only the
+	 * pages that are actually touched are ever read from disk */
+	void *mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED) {
+		return NULL;
+	}
+
+	if (!is_header_valid(mapping, st.st_size)) {
+		munmap(mapping, st.st_size);
+		return NULL;
+	}
+
+	checkpoint result = malloc(sizeof *result);
+	result->mapping = mapping;
+	result->mapping_size = st.st_size;
+	result->header = mapping;
+
+	return result;
+}
+
+void checkpoint_get_info(checkpoint cp, struct checkpoint_info *info)
+{
+	assert(cp);
+	assert(info);
+
+	info->model_name = cp->header->model_name;
+	info->parameter_callback_name = cp->header->parameter_callback_name;
+	info->coupling_callback_name = cp->header->coupling_callback_name;
+	info->initial_values_callback_name = cp->header->initial_values_callback_name;
+	info->time_step = cp->header->time_step;
+	info->coupling_constant_is_random = cp->header->coupling_constant_is_random;
+	info->coupling_constant = cp->header->coupling_constant;
+	info->lowest_random_value = cp->header->lowest_random_value;
+	info->highest_random_value = cp->header->highest_random_value;
+}
+
+double checkpoint_get_time(checkpoint cp)
+{
+	return cp->header->time;
+}
+
+uint checkpoint_get_system_size(checkpoint cp)
+{
+	return cp->header->system_size;
+}
+
+uint checkpoint_get_grid_width(checkpoint cp)
+{
+	return cp->header->grid_width;
+}
+
+uint checkpoint_get_grid_height(checkpoint cp)
+{
+	return cp->header->grid_height;
+}
+
+uint checkpoint_get_element_size(checkpoint cp)
+{
+	return cp->header->element_size;
+}
+
+const double *checkpoint_get_values(checkpoint cp)
+{
+	return (const double *)((const char *)cp->mapping + cp->header->values_offset);
+}
+
+bool checkpoint_restore(checkpoint cp, dynamical_system ds)
+{
+	assert(cp);
+	assert(ds);
+
+	uint system_size = dynamical_system_get_system_size(ds);
+	uint element_size = dynamical_system_get_element_size(ds);
+	if (system_size != cp->header->system_size || element_size != cp->header->element_size) {
+		return false;
+	}
+
+	memcpy(dynamical_system_get_values(ds), checkpoint_get_values(cp),
+	       sizeof (double) * system_size * element_size);
+	dynamical_system_set_time(ds, cp->header->time);
+	math_utils_random_state_set(cp->header->random_state);
+
+	return true;
+}
+
+void checkpoint_close(checkpoint *cp)
+{
+	assert(cp);
+	assert(*cp);
+
+	munmap((*cp)->mapping, (*cp)->mapping_size);
+	free(*cp);
+	*cp = NULL;
+}
@@ -0,0 +1,129 @@
+#include <stdlib.h>
+#include <assert.h>
+#include "headers/color_map.h"
+
+#include "tests/headers/test_utils.h"
+
+/* Maps values to colors along the straight line between two colors, for
+ * heat maps that are drawn as pixel buffers rather than a rectangle per
+ * cell.
+ *
+ * The colors are computed once into a table of COLOR_MAP_SIZE entries that
+ * evenly cover [low_value, high_value], so that mapping a value costs one
+ * multiplication and one load. Values outside of the range, and NaNs, take
+ * the color of the nearest end. Colors are packed as 32-bit ARGB pixels,
+ * fully opaque, which is the layout of SDL_PIXELFORMAT_ARGB8888.
+ *
+ * Indexed images, which hold at most COLOR_MAP_PALETTE_SIZE colors, map
+ * values to indices into a palette that covers the same range along the
+ * same line instead.
+ */
+struct color_map {
+	double low_value;
+	double scale;
+	double palette_scale;
+	struct color_map_rgb low_color;
+	struct color_map_rgb high_color;
+	uint32_t colors[COLOR_MAP_SIZE];
+};
+
+static uint8_t lerp_channel(double t, uint8_t low, uint8_t high)
+{
+	/* truncated, like the colors of clerp */
+	return (uint8_t)(low + t * (high - low));
+}
+
+color_map color_map_create(double low_value, double high_value,
+			   struct color_map_rgb low_color, struct color_map_rgb high_color)
+{
+	assert("The range of the color map is empty." && high_value > low_value);
+
+	color_map result = malloc(sizeof *result);
+	result->low_value = low_value;
+	result->scale = (COLOR_MAP_SIZE - 1) / (high_value - low_value);
+	result->palette_scale = (COLOR_MAP_PALETTE_SIZE - 1) / (high_value - low_value);
+	result->low_color = low_color;
+	result->high_color = high_color;
+	for (uint i = 0; i < COLOR_MAP_SIZE; i++) {
+		double t = i / (double)(COLOR_MAP_SIZE - 1);
+		result->colors[i] = (uint32_t)0xff << 24
+			| (uint32_t)lerp_channel(t, low_color.r, high_color.r) << 16
+			| (uint32_t)lerp_channel(t, low_color.g, high_color.g) << 8
+			| (uint32_t)lerp_channel(t, low_color.b, high_color.b);
+	}
+
+	return result;
+}
+
+uint32_t color_map_lookup(color_map cm, double value)
+{
+	assert(cm);
+
+	double position = (value - cm->low_value) * cm->scale + 0.5;
+	if (!(position > 0.0)) {
+		return cm->colors[0];
+	}
+	if (position >= COLOR_MAP_SIZE - 1) {
+		return cm->colors[COLOR_MAP_SIZE - 1];
+	}
+	return cm->colors[(uint)position];
+}
+
+/* Maps count values, stride apart, into consecutive pixels. */
+void color_map_fill(color_map cm, const double *values, uint stride, uint count, uint32_t *pixels)
+{
+	assert(cm);
+	assert(values);
+	assert(pixels);
+
+	for (uint i = 0; i < count; i++) {
+		pixels[i] = color_map_lookup(cm, values[(size_t)i * stride]);
+	}
+}
+
+/* Fills palette with the COLOR_MAP_PALETTE_SIZE colors that
+ * color_map_fill_indices maps to. */
+void color_map_get_palette(color_map cm, struct color_map_rgb *palette)
+{
+	assert(cm);
+	assert(palette);
+
+	for (uint i = 0; i < COLOR_MAP_PALETTE_SIZE; i++) {
+		double t = i / (double)(COLOR_MAP_PALETTE_SIZE - 1);
+		palette[i] = (struct color_map_rgb){
+			lerp_channel(t, cm->low_color.r, cm->high_color.r),
+			lerp_channel(t, cm->low_color.g, cm->high_color.g),
+			lerp_channel(t, cm->low_color.b, cm->high_color.b)
+		};
+	}
+}
+
+/* Maps count values, stride apart, into consecutive palette indices. */
+void color_map_fill_indices(color_map cm, const double *values, uint stride, uint count, uint8_t *indices)
+{
+	assert(cm);
+	assert(values);
+	assert(indices);
+
+	for (uint i = 0; i < count; i++) {
+		double position = (values[(size_t)i * stride] - cm->low_value) * cm->palette_scale + 0.5;
+		if (!(position > 0.0)) {
+			indices[i] = 0;
+		}
+		else if (position >= COLOR_MAP_PALETTE_SIZE - 1) {
+			indices[i] = COLOR_MAP_PALETTE_SIZE - 1;
+		}
+		else {
+			indices[i] = (uint8_t)position;
+		}
+	}
+}
+
+void color_map_destroy(color_map *cm)
+{
+	assert(cm);
+	assert(*cm);
+
+	free(*cm);
+	*cm = NULL;
+}
@@ -0,0 +1,397 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "headers/compression.h"
+#include "headers/compressed_file.h"
+
+#include "tests/headers/test_utils.h"
+
+/* A compressed frame file holds the same frames as a frame file, but groups
+ * them into chunks of up to chunk_frames frames that are compressed as a
+ * whole. After the header below, each chunk is a chunk header followed by
+ * stored_size bytes.
+ *
+ * The raw contents of a chunk are the XOR encoded series of its times,
+ * followed by the XOR encoded series of every variable of every system,
+ * variable by variable. Each series follows one value through the frames of
+ * the chunk, which is where the values change the least. The raw contents
+ * are then passed through the LZ stage, unless that does not make them any
+ * smaller, in which case they are stored as they are.
+ *
+ * Chunks are only ever appended, and a chunk that is cut short by a crash
+ * is ignored by the reader.
+ */
+struct compressed_file_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t header_size;
+	uint32_t system_size;
+	uint32_t grid_width;
+	uint32_t grid_height;
+	uint32_t variable_count;
+	uint32_t value_size;
+	uint32_t chunk_frames;
+	double time_step;
+	double print_time;
+	char model_name[FRAME_FILE_NAME_LENGTH];
+	char variable_names[FRAME_FILE_MAX_VARIABLES][FRAME_FILE_VARIABLE_NAME_LENGTH];
+};
+
+#define CHUNK_FLAG_LZ 1u
+
+struct chunk_header {
+	uint32_t frame_count;
+	uint32_t flags;
+	uint64_t raw_size;
+	uint64_t stored_size;
+};
+
+static const char compressed_file_magic[8] = "NNZFRAM";
+
+/* The frames of the chunk being filled or read, and the buffers used to
+ * encode or decode it. Frames are kept in the row-major layout of the
+ * dynamical system. */
+struct chunk {
+	uint frame_count;
+	double *times;
+	double *values;
+	unsigned char *raw;
+	unsigned char *stored;
+	size_t raw_capacity;
+	size_t stored_capacity;
+};
+
+struct compressed_file {
+	FILE *fh;
+	struct compressed_file_header header;
+	struct chunk chunk;
+	uint64_t frame_count;
+	uint64_t stored_bytes;
+};
+
+struct compressed_reader {
+	FILE *fh;
+	struct compressed_file_header header;
+	struct chunk chunk;
+	const char *variable_names[FRAME_FILE_MAX_VARIABLES];
+};
+
+static uint series_length(const struct compressed_file_header *header)
+{
+	return header->system_size * header->variable_count;
+}
+
+static void chunk_init(struct chunk *chunk, const struct compressed_file_header *header)
+{
+	size_t frames = header->chunk_frames;
+	size_t series = series_length(header);
+
+	chunk->frame_count = 0;
+	chunk->times = malloc((sizeof *chunk->times) * frames);
+	chunk->values = malloc((sizeof *chunk->values) * frames * series);
+	chunk->raw_capacity = compression_xor_bound(frames) * (series + 1);
+	chunk->stored_capacity = compression_lz_bound(chunk->raw_capacity);
+	chunk->raw = malloc(chunk->raw_capacity);
+	chunk->stored = malloc(chunk->stored_capacity);
+}
+
+static void chunk_free(struct chunk *chunk)
+{
+	free(chunk->times);
+	free(chunk->values);
+	free(chunk->raw);
+	free(chunk->stored);
+}
+
+static void header_from_layout(struct compressed_file_header *header, const struct frame_file_layout *layout,
+			       uint chunk_frames)
+{
+	memset(header, 0, sizeof *header);
+	memcpy(header->magic, compressed_file_magic, sizeof header->magic);
+	header->version = COMPRESSED_FILE_VERSION;
+	header->header_size = sizeof *header;
+	header->system_size = layout->system_size;
+	header->grid_width = layout->grid_width;
+	header->grid_height = layout->grid_height;
+	header->variable_count = layout->variable_count;
+	header->value_size = layout->value_size;
+	header->chunk_frames = chunk_frames;
+	header->time_step = layout->time_step;
+	header->print_time = layout->print_time;
+	if (layout->model_name) {
+		strncpy(header->model_name, layout->model_name, FRAME_FILE_NAME_LENGTH - 1);
+	}
+	for (uint i = 0; i < layout->variable_count; i++) {
+		strncpy(header->variable_names[i], layout->variable_names[i], FRAME_FILE_VARIABLE_NAME_LENGTH - 1);
+	}
+}
+
+static bool header_is_valid(const struct compressed_file_header *header)
+{
+	return !memcmp(header->magic, compressed_file_magic, sizeof header->magic)
+		&& header->version == COMPRESSED_FILE_VERSION
+		&& header->header_size == sizeof *header
+		&& header->variable_count <= FRAME_FILE_MAX_VARIABLES
+		&& (header->value_size == sizeof (float) || header->value_size == sizeof (double))
+		&& header->chunk_frames > 0;
+}
+
+/* Reads the next chunk header and the stored bytes after it. Returns false
+ * at the end of the file and for a chunk that was not written completely. */
+static bool read_chunk(FILE *fh, const struct compressed_file_header *header, struct chunk *chunk,
+		       struct chunk_header *ch)
+{
+	if (fread(ch, sizeof *ch, 1, fh) != 1
+	    || ch->frame_count == 0 || ch->frame_count > header->chunk_frames
+	    || ch->raw_size > chunk->raw_capacity || ch->stored_size > chunk->stored_capacity) {
+		return false;
+	}
+	return fread(chunk->stored, 1, ch->stored_size, fh) == ch->stored_size;
+}
+
+compressed_file compressed_file_create(const char *filename, const struct frame_file_layout *layout,
+				       uint chunk_frames)
+{
+	assert(filename);
+	assert(layout);
+	assert("Values must be stored as floats or doubles."
+	       && (layout->value_size == sizeof (float) || layout->value_size == sizeof (double)));
+	assert("Chunks must hold at least one frame." && chunk_frames > 0);
+
+	if (layout->variable_count > FRAME_FILE_MAX_VARIABLES) {
+		return NULL;
+	}
+
+	compressed_file result = malloc(sizeof *result);
+	header_from_layout(&result->header, layout, chunk_frames);
+	chunk_init(&result->chunk, &result->header);
+	result->frame_count = 0;
+	result->stored_bytes = sizeof result->header;
+	result->fh = fopen(filename, "w+b");
+	if (!result->fh || fwrite(&result->header, sizeof result->header, 1, result->fh) != 1) {
+		if (result->fh) {
+			fclose(result->fh);
+		}
+		chunk_free(&result->chunk);
+		free(result);
+		return NULL;
+	}
+
+	return result;
+}
+
+/* Takes the values in the row-major layout of the dynamical system. The
+ * frame is compressed and written once its chunk is full. */
+bool compressed_file_write(compressed_file cf, double time, const double *values)
+{
+	assert(cf);
+	assert(values);
+
+	struct chunk *chunk = &cf->chunk;
+	uint series = series_length(&cf->header);
+	double *frame = chunk->values + (size_t)chunk->frame_count * series;
+
+	chunk->times[chunk->frame_count] = time;
+	if (cf->header.value_size == sizeof (float)) {
+		for (uint i = 0; i < series; i++) {
+			frame[i] = (float)values[i];
+		}
+	}
+	else {
+		memcpy(frame, values, (sizeof *frame) * series);
+	}
+	chunk->frame_count++;
+	cf->frame_count++;
+
+	if (chunk->frame_count == cf->header.chunk_frames) {
+		return compressed_file_flush(cf);
+	}
+	return true;
+}
+
+/* Compresses and writes the frames gathered so far as a chunk of its own. */
+bool compressed_file_flush(compressed_file cf)
+{
+	assert(cf);
+
+	struct chunk *chunk = &cf->chunk;
+	if (chunk->frame_count == 0) {
+		return true;
+	}
+
+	uint series = series_length(&cf->header);
+	size_t raw_size = compression_xor_encode(chunk->times, chunk->frame_count, 1, chunk->raw);
+	for (uint variable = 0; variable < cf->header.variable_count; variable++) {
+		for (uint system = 0; system < cf->header.system_size; system++) {
+			raw_size += compression_xor_encode(chunk->values + system * cf->header.variable_count + variable,
+							   chunk->frame_count, series, chunk->raw + raw_size);
+		}
+	}
+
+	struct chunk_header ch = {
+		.frame_count = chunk->frame_count,
+		.flags = CHUNK_FLAG_LZ,
+		.raw_size = raw_size,
+		.stored_size = compression_lz_encode(chunk->raw, raw_size, chunk->stored)
+	};
+	const unsigned char *stored = chunk->stored;
+	if (ch.stored_size >= raw_size) {
+		ch.flags = 0;
+		ch.stored_size = raw_size;
+		stored = chunk->raw;
+	}
+
+	chunk->frame_count = 0;
+	if (fwrite(&ch, sizeof ch, 1, cf->fh) != 1
+	    || fwrite(stored, 1, ch.stored_size, cf->fh) != ch.stored_size) {
+		return false;
+	}
+
+	cf->stored_bytes += sizeof ch + ch.stored_size;
+	return true;
+}
+
+uint64_t compressed_file_get_frame_count(compressed_file cf)
+{
+	return cf->frame_count;
+}
+
+/* Gives the size the frames written so far would take in a frame file of
+ * the same precision, and the size of the compressed file holding them. */
+void compressed_file_get_sizes(compressed_file cf, uint64_t *raw_bytes, uint64_t *stored_bytes)
+{
+	assert(cf);
+	assert(raw_bytes);
+	assert(stored_bytes);
+
+	*raw_bytes = sizeof cf->header
+		+ cf->frame_count * (sizeof (double) + (uint64_t)series_length(&cf->header) * cf->header.value_size);
+	*stored_bytes = cf->stored_bytes;
+}
+
+/* Writes the last, partially filled chunk and closes the file. Returns
+ * false if any of that failed. */
+bool compressed_file_destroy(compressed_file *cf)
+{
+	assert(cf);
+	assert(*cf);
+
+	bool success = compressed_file_flush(*cf);
+	success = !fclose((*cf)->fh) && success;
+	chunk_free(&(*cf)->chunk);
+	free(*cf);
+	*cf = NULL;
+	return success;
+}
+
+compressed_reader compressed_reader_open(const char *filename)
+{
+	assert(filename);
+
+	FILE *fh = fopen(filename, "rb");
+	if (!fh) {
+		return NULL;
+	}
+
+	compressed_reader result = malloc(sizeof *result);
+	if (fread(&result->header, sizeof result->header, 1, fh) != 1 || !header_is_valid(&result->header)) {
+		fclose(fh);
+		free(result);
+		return NULL;
+	}
+
+	result->fh = fh;
+	chunk_init(&result->chunk, &result->header);
+	for (uint i = 0; i < FRAME_FILE_MAX_VARIABLES; i++) {
+		result->variable_names[i] = result->header.variable_names[i];
+	}
+
+	return result;
+}
+
+void compressed_reader_get_layout(compressed_reader cr, struct frame_file_layout *layout)
+{
+	assert(cr);
+	assert(layout);
+
+	layout->model_name = cr->header.model_name;
+	layout->system_size = cr->header.system_size;
+	layout->grid_width = cr->header.grid_width;
+	layout->grid_height = cr->header.grid_height;
+	layout->variable_count = cr->header.variable_count;
+	layout->variable_names = cr->variable_names;
+	layout->value_size = cr->header.value_size;
+	layout->time_step = cr->header.time_step;
+	layout->print_time = cr->header.print_time;
+}
+
+/* Reads and decodes the next chunk, and returns the number of frames in it.
+ * Returns zero once there are no more complete chunks, or if the chunk
+ * cannot be decoded. */
+uint compressed_reader_next_chunk(compressed_reader cr)
+{
+	assert(cr);
+
+	struct chunk *chunk = &cr->chunk;
+	struct chunk_header ch;
+	chunk->frame_count = 0;
+	if (!read_chunk(cr->fh, &cr->header, chunk, &ch)) {
+		return 0;
+	}
+
+	const unsigned char *raw = chunk->stored;
+	if (ch.flags & CHUNK_FLAG_LZ) {
+		if (compression_lz_decode(chunk->stored, ch.stored_size, chunk->raw, ch.raw_size) != ch.raw_size) {
+			return 0;
+		}
+		raw = chunk->raw;
+	}
+	else if (ch.stored_size != ch.raw_size) {
+		return 0;
+	}
+
+	uint series = series_length(&cr->header);
+	size_t used = compression_xor_decode(raw, ch.raw_size, chunk->times, ch.frame_count, 1);
+	for (uint variable = 0; used && variable < cr->header.variable_count; variable++) {
+		for (uint system = 0; used && system < cr->header.system_size; system++) {
+			size_t series_size = compression_xor_decode(raw + used, ch.raw_size - used,
+								    chunk->values + system * cr->header.variable_count + variable,
+								    ch.frame_count, series);
+			used = series_size ? used + series_size : 0;
+		}
+	}
+	if (used != ch.raw_size) {
+		return 0;
+	}
+
+	chunk->frame_count = ch.frame_count;
+	return chunk->frame_count;
+}
+
+double compressed_reader_get_time(compressed_reader cr, uint frame)
+{
+	assert("Given an invalid frame." && frame < cr->chunk.frame_count);
+	return cr->chunk.times[frame];
+}
+
+/* Returns the values of a frame of the current chunk in the row-major
+ * layout of the dynamical system. */
+const double *compressed_reader_get_values(compressed_reader cr, uint frame)
+{
+	assert("Given an invalid frame." && frame < cr->chunk.frame_count);
+	return cr->chunk.values + (size_t)frame * series_length(&cr->header);
+}
+
+void compressed_reader_close(compressed_reader *cr)
+{
+	assert(cr);
+	assert(*cr);
+
+	fclose((*cr)->fh);
+	chunk_free(&(*cr)->chunk);
+	free(*cr);
+	*cr = NULL;
+}
@@ -0,0 +1,377 @@
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include "headers/deftypes.h"
+#include "headers/compression.h"
+
+#include "tests/headers/test_utils.h"
+
+/* Two lossless stages for time series of doubles, both without any
+ * external library.
+ *
+ * The first stage is the XOR encoding of the Gorilla time series database.
+ * Each value is XORed with the previous value of the same series; smooth
+ * traces give results with long runs of leading and trailing zero bits,
+ * and only the bits in between are stored:
+ *
+ *   '0'                              same value as before
+ *   '10' <bits>                      the nonzero bits fit in the previous window
+ *   '11' <5 bit leading> <6 bit length> <bits>   a new window
+ *
+ * The first value of a series is stored in full, and every series ends on
+ * a byte boundary so that identical series give identical bytes.
+ *
+ * The second stage is a small LZ77 byte compressor in the style of LZ4.
+ * It is made of sequences of a token byte, holding the literal count and
+ * match length in its two nibbles, the literals, a two byte offset and any
+ * extension bytes of the match length. The last sequence has no match.
+ */
+
+struct bit_writer {
+	unsigned char *out;
+	size_t pos;
+	uint64_t acc;
+	uint fill;
+};
+
+struct bit_reader {
+	const unsigned char *in;
+	size_t size;
+	size_t pos;
+	uint64_t acc;
+	uint fill;
+	bool overrun;
+};
+
+static uint64_t low_bits_mask(uint count)
+{
+	return count >= 64 ? ~(uint64_t)0 : ((uint64_t)1 << count) - 1;
+}
+
+static void put_bits(struct bit_writer *bw, uint64_t value, uint count)
+{
+	if (count > 32) {
+		put_bits(bw, value >> 32, count - 32);
+		count = 32;
+	}
+
+	bw->acc = (bw->acc << count) | (value & low_bits_mask(count));
+	bw->fill += count;
+	while (bw->fill >= 8) {
+		bw->fill -= 8;
+		bw->out[bw->pos++] = (unsigned char)(bw->acc >> bw->fill);
+	}
+	bw->acc &= low_bits_mask(bw->fill);
+}
+
+static void align_writer(struct bit_writer *bw)
+{
+	if (bw->fill) {
+		bw->out[bw->pos++] = (unsigned char)(bw->acc << (8 - bw->fill));
+		bw->acc = 0;
+		bw->fill = 0;
+	}
+}
+
+static uint64_t get_bits(struct bit_reader *br, uint count)
+{
+	if (count > 32) {
+		uint64_t high = get_bits(br, count - 32);
+		return (high << 32) | get_bits(br, 32);
+	}
+
+	while (br->fill < count) {
+		uint64_t byte = 0;
+		if (br->pos < br->size) {
+			byte = br->in[br->pos++];
+		}
+		else {
+			br->overrun = true;
+		}
+		br->acc = (br->acc << 8) | byte;
+		br->fill += 8;
+	}
+
+	br->fill -= count;
+	uint64_t result = (br->acc >> br->fill) & low_bits_mask(count);
+	br->acc &= low_bits_mask(br->fill);
+	return result;
+}
+
+static void align_reader(struct bit_reader *br)
+{
+	br->acc = 0;
+	br->fill = 0;
+}
+
+static uint64_t double_bits(double value)
+{
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof bits);
+	return bits;
+}
+
+static double bits_double(uint64_t bits)
+{
+	double value;
+	memcpy(&value, &bits, sizeof value);
+	return value;
+}
+
+/* The largest number of bytes compression_xor_encode writes for count values. */
+size_t compression_xor_bound(size_t count)
+{
+	/* at most 77 bits per value, plus the byte alignment at the end */
+	return count * 10 + 1;
+}
+
+/* Encodes count values, taken stride elements apart, and returns the
+ * number of bytes written to out. */
+size_t compression_xor_encode(const double *values, size_t count, size_t stride, unsigned char *out)
+{
+	if (count == 0) {
+		return 0;
+	}
+
+	struct bit_writer bw = { .out = out };
+	uint64_t previous = double_bits(values[0]);
+	uint previous_leading = 64;
+	uint previous_trailing = 0;
+	bool has_window = false;
+
+	put_bits(&bw, previous, 64);
+	for (size_t i = 1; i < count; i++) {
+		uint64_t current = double_bits(values[i * stride]);
+		uint64_t x = current ^ previous;
+		previous = current;
+
+		if (!x) {
+			put_bits(&bw, 0, 1);
+			continue;
+		}
+
+		uint leading = __builtin_clzll(x);
+		uint trailing = __builtin_ctzll(x);
+		if (leading > 31) {
+			leading = 31;
+		}
+
+		if (has_window && leading >= previous_leading && trailing >= previous_trailing) {
+			put_bits(&bw, 2, 2);
+			put_bits(&bw, x >> previous_trailing, 64 - previous_leading - previous_trailing);
+		}
+		else {
+			uint meaningful = 64 - leading - trailing;
+			put_bits(&bw, 3, 2);
+			put_bits(&bw, leading, 5);
+			put_bits(&bw, meaningful & 63, 6);
+			put_bits(&bw, x >> trailing, meaningful);
+			previous_leading = leading;
+			previous_trailing = trailing;
+			has_window = true;
+		}
+	}
+	align_writer(&bw);
+
+	return bw.pos;
+}
+
+/* Decodes count values into values, stride elements apart. Returns the
+ * number of bytes consumed, or zero if the input is malformed. */
+size_t compression_xor_decode(const unsigned char *in, size_t in_size,
+			      double *values, size_t count, size_t stride)
+{
+	if (count == 0) {
+		return 0;
+	}
+
+	struct bit_reader br = { .in = in, .size = in_size };
+	uint64_t previous = get_bits(&br, 64);
+	uint previous_leading = 0;
+	uint previous_trailing = 0;
+	bool has_window = false;
+
+	values[0] = bits_double(previous);
+	for (size_t i = 1; i < count; i++) {
+		if (get_bits(&br, 1)) {
+			uint64_t x;
+			if (!get_bits(&br, 1)) {
+				if (!has_window) {
+					return 0;
+				}
+				x = get_bits(&br, 64 - previous_leading - previous_trailing) << previous_trailing;
+			}
+			else {
+				uint leading = get_bits(&br, 5);
+				uint meaningful = get_bits(&br, 6);
+				if (meaningful == 0) {
+					meaningful = 64;
+				}
+				if (leading + meaningful > 64) {
+					return 0;
+				}
+				uint trailing = 64 - leading - meaningful;
+				x = get_bits(&br, meaningful) << trailing;
+				previous_leading = leading;
+				previous_trailing = trailing;
+				has_window = true;
+			}
+			previous ^= x;
+		}
+		values[i * stride] = bits_double(previous);
+	}
+	align_reader(&br);
+
+	return br.overrun ? 0 : br.pos;
+}
+
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 65535
+#define LZ_HASH_BITS 12
+
+static uint32_t read_u32(const unsigned char *p)
+{
+	uint32_t value;
+	memcpy(&value, p, sizeof value);
+	return value;
+}
+
+static uint lz_hash(uint32_t sequence)
+{
+	return (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+static unsigned char *put_length(unsigned char *out, size_t length)
+{
+	while (length >= 255) {
+		*out++ = 255;
+		length -= 255;
+	}
+	*out++ = (unsigned char)length;
+	return out;
+}
+
+static unsigned char *put_sequence(unsigned char *out, const unsigned char *literals, size_t literal_count,
+				   size_t offset, size_t match_length)
+{
+	unsigned char *token = out++;
+	*token = (literal_count >= 15 ? 15 : literal_count) << 4;
+	if (literal_count >= 15) {
+		out = put_length(out, literal_count - 15);
+	}
+	memcpy(out, literals, literal_count);
+	out += literal_count;
+
+	if (match_length) {
+		size_t length_code = match_length - LZ_MIN_MATCH;
+		*token |= length_code >= 15 ? 15 : length_code;
+		*out++ = offset & 0xff;
+		*out++ = offset >> 8;
+		if (length_code >= 15) {
+			out = put_length(out, length_code - 15);
+		}
+	}
+
+	return out;
+}
+
+/* The largest number of bytes compression_lz_encode writes for size bytes. */
+size_t compression_lz_bound(size_t size)
+{
+	return size + size / 255 + 16;
+}
+
+size_t compression_lz_encode(const unsigned char *in, size_t size, unsigned char *out)
+{
+	uint32_t table[1 << LZ_HASH_BITS];
+	memset(table, 0, sizeof table);
+
+	unsigned char *out_start = out;
+	size_t anchor = 0;
+	size_t i = 0;
+
+	while (size >= LZ_MIN_MATCH && i <= size - LZ_MIN_MATCH) {
+		uint32_t sequence = read_u32(in + i);
+		uint h = lz_hash(sequence);
+		size_t candidate = table[h];
+		table[h] = i + 1;
+
+		if (candidate && i + 1 - candidate <= LZ_MAX_OFFSET
+		    && read_u32(in + candidate - 1) == sequence) {
+			candidate--;
+			size_t length = LZ_MIN_MATCH;
+			while (i + length < size && in[candidate + length] == in[i + length]) {
+				length++;
+			}
+			out = put_sequence(out, in + anchor, i - anchor, i - candidate, length);
+			i += length;
+			anchor = i;
+		}
+		else {
+			i++;
+		}
+	}
+	out = put_sequence(out, in + anchor, size - anchor, 0, 0);
+
+	return out - out_start;
+}
+
+static bool get_length(const unsigned char **in, const unsigned char *end, size_t *length)
+{
+	unsigned char byte;
+	do {
+		if (*in >= end) {
+			return false;
+		}
+		byte = *(*in)++;
+		*length += byte;
+	} while (byte == 255);
+	return true;
+}
+
+/* Returns the number of bytes decoded into out, or zero if the input is
+ * malformed or does not fit into out_size bytes. */
+size_t compression_lz_decode(const unsigned char *in, size_t in_size, unsigned char *out, size_t out_size)
+{
+	const unsigned char *end = in + in_size;
+	size_t pos = 0;
+
+	while (in < end) {
+		unsigned char token = *in++;
+		size_t literal_count = token >> 4;
+		if (literal_count == 15 && !get_length(&in, end, &literal_count)) {
+			return 0;
+		}
+		if (literal_count > (size_t)(end - in) || literal_count > out_size - pos) {
+			return 0;
+		}
+		memcpy(out + pos, in, literal_count);
+		in += literal_count;
+		pos += literal_count;
+
+		if (in == end) {
+			break;
+		}
+
+		if (end - in < 2) {
+			return 0;
+		}
+		size_t offset = in[0] | (in[1] << 8);
+		in += 2;
+		size_t length = token & 15;
+		if (length == 15 && !get_length(&in, end, &length)) {
+			return 0;
+		}
+		length += LZ_MIN_MATCH;
+
+		if (offset == 0 || offset > pos || length > out_size - pos) {
+			return 0;
+		}
+		/* byte by byte, since the match may overlap what it produces */
+		for (size_t j = 0; j < length; j++, pos++) {
+			out[pos] = out[pos - offset];
+		}
+	}
+
+	return pos;
+}
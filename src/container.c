@@ -0,0 +1,594 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "headers/container.h"
+
+#include "tests/headers/test_utils.h"
+
+/* A container holds every variable of a run in a single file. After the
+ * header below, the file is a sequence of records, each made of a record
+ * header and size bytes of contents.
+ *
+ * A chunk record holds frame_count consecutive frames of one variable: the
+ * times of the frames as doubles, then a block of frame_count rows of
+ * system_size floats or doubles, zero padded to a multiple of eight bytes.
+ * Every chunk_frames frames, one chunk per variable is appended.
+ *
+ * An index record lists the chunks written before it, and is followed by
+ * the footer, so that a reader finds it from the end of the file without
+ * reading anything else. A file that was not closed properly has no index
+ * at its end, in which case the reader finds the chunks by walking the
+ * records from the start, stopping at the first one that was not written
+ * completely.
+ */
+struct container_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t header_size;
+	uint32_t system_size;
+	uint32_t grid_width;
+	uint32_t grid_height;
+	uint32_t variable_count;
+	uint32_t value_size;
+	uint32_t chunk_frames;
+	double time_step;
+	double print_time;
+	char model_name[FRAME_FILE_NAME_LENGTH];
+	char variable_names[FRAME_FILE_MAX_VARIABLES][FRAME_FILE_VARIABLE_NAME_LENGTH];
+};
+
+enum record_type {
+	RECORD_CHUNK = 1,
+	RECORD_INDEX = 2
+};
+
+struct record_header {
+	uint32_t type;
+	uint32_t variable;
+	uint32_t frame_count;
+	uint32_t reserved;
+	double first_time;
+	double last_time;
+	uint64_t size;
+};
+
+struct index_entry {
+	uint32_t variable;
+	uint32_t frame_count;
+	double first_time;
+	double last_time;
+	uint64_t offset;
+};
+
+struct footer {
+	uint64_t index_offset;
+	char magic[8];
+};
+
+static const char container_magic[8] = "NNCONT";
+static const char footer_magic[8] = "NNINDEX";
+
+struct index {
+	struct index_entry *entries;
+	uint64_t count;
+	uint64_t capacity;
+};
+
+struct container {
+	FILE *fh;
+	struct container_header header;
+	struct index index;
+	uint64_t end_offset;
+	uint64_t frame_count;
+	uint buffered_frames;
+	double *times;
+	double *values;
+	unsigned char *block;
+};
+
+struct container_reader {
+	void *mapping;
+	size_t mapping_size;
+	const struct container_header *header;
+	bool has_index;
+	/* the chunks of each variable, ordered by time */
+	struct index chunks[FRAME_FILE_MAX_VARIABLES];
+	const char *variable_names[FRAME_FILE_MAX_VARIABLES];
+};
+
+static void index_add(struct index *index, const struct index_entry *entry)
+{
+	if (index->count == index->capacity) {
+		index->capacity = index->capacity ? 2 * index->capacity : 64;
+		index->entries = realloc(index->entries, (sizeof *index->entries) * index->capacity);
+	}
+	index->entries[index->count++] = *entry;
+}
+
+static uint64_t chunk_size_for(const struct container_header *header, uint frame_count)
+{
+	uint64_t size = (uint64_t)frame_count * (sizeof (double) + (uint64_t)header->system_size * header->value_size);
+	return (size + 7) & ~(uint64_t)7;
+}
+
+static void header_from_layout(struct container_header *header, const struct frame_file_layout *layout,
+			       uint chunk_frames)
+{
+	memset(header, 0, sizeof *header);
+	memcpy(header->magic, container_magic, sizeof header->magic);
+	header->version = CONTAINER_VERSION;
+	header->header_size = sizeof *header;
+	header->system_size = layout->system_size;
+	header->grid_width = layout->grid_width;
+	header->grid_height = layout->grid_height;
+	header->variable_count = layout->variable_count;
+	header->value_size = layout->value_size;
+	header->chunk_frames = chunk_frames;
+	header->time_step = layout->time_step;
+	header->print_time = layout->print_time;
+	if (layout->model_name) {
+		strncpy(header->model_name, layout->model_name, FRAME_FILE_NAME_LENGTH - 1);
+	}
+	for (uint i = 0; i < layout->variable_count; i++) {
+		strncpy(header->variable_names[i], layout->variable_names[i], FRAME_FILE_VARIABLE_NAME_LENGTH - 1);
+	}
+}
+
+static bool header_is_valid(const struct container_header *header)
+{
+	return !memcmp(header->magic, container_magic, sizeof header->magic)
+		&& header->version == CONTAINER_VERSION
+		&& header->header_size == sizeof *header
+		&& header->variable_count <= FRAME_FILE_MAX_VARIABLES
+		&& (header->value_size == sizeof (float) || header->value_size == sizeof (double))
+		&& header->chunk_frames > 0;
+}
+
+/* Finds every chunk of a mapped container, from its index if the file ends
+ * with one and by walking its records otherwise. end_offset is set to the
+ * end of the last complete record. Returns whether the index was used. */
+static bool load_index(const unsigned char *mapping, uint64_t size, struct index *index, uint64_t *end_offset)
+{
+	const struct container_header *header = (const struct container_header *)mapping;
+	index->count = 0;
+
+	struct footer footer;
+	if (size >= header->header_size + sizeof (struct record_header) + sizeof footer) {
+		memcpy(&footer, mapping + size - sizeof footer, sizeof footer);
+		struct record_header record;
+		if (!memcmp(footer.magic, footer_magic, sizeof footer.magic)
+		    && footer.index_offset >= header->header_size
+		    && footer.index_offset <= size - sizeof footer - sizeof record) {
+			memcpy(&record, mapping + footer.index_offset, sizeof record);
+			if (record.type == RECORD_INDEX
+			    && record.size == size - sizeof footer - sizeof record - footer.index_offset
+			    && record.size % sizeof (struct index_entry) == 0) {
+				const unsigned char *entries = mapping + footer.index_offset + sizeof record;
+				for (uint64_t i = 0; i < record.size / sizeof (struct index_entry); i++) {
+					struct index_entry entry;
+					memcpy(&entry, entries + i * sizeof entry, sizeof entry);
+					index_add(index, &entry);
+				}
+				*end_offset = size;
+				return true;
+			}
+		}
+	}
+
+	uint64_t offset = header->header_size;
+	while (offset + sizeof (struct record_header) <= size) {
+		struct record_header record;
+		memcpy(&record, mapping + offset, sizeof record);
+		uint64_t contents = offset + sizeof record;
+		if (record.size > size - contents) {
+			break;
+		}
+		if (record.type == RECORD_CHUNK) {
+			if (record.variable >= header->variable_count || record.frame_count == 0
+			    || record.size != chunk_size_for(header, record.frame_count)) {
+				break;
+			}
+			struct index_entry entry = {
+				.variable = record.variable,
+				.frame_count = record.frame_count,
+				.first_time = record.first_time,
+				.last_time = record.last_time,
+				.offset = offset
+			};
+			index_add(index, &entry);
+		}
+		else if (record.type != RECORD_INDEX) {
+			break;
+		}
+		offset = contents + record.size;
+		if (record.type == RECORD_INDEX && offset + sizeof footer <= size
+		    && !memcmp(mapping + offset + sizeof footer.index_offset, footer_magic, sizeof footer_magic)) {
+			/* the footer after an index that a continued run left behind */
+			offset += sizeof footer;
+		}
+	}
+
+	*end_offset = offset;
+	return false;
+}
+
+static bool map_file(const char *filename, void **mapping, size_t *mapping_size)
+{
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) || st.st_size < (off_t)sizeof (struct container_header)) {
+		close(fd);
+		return false;
+	}
+
+	*mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (*mapping == MAP_FAILED) {
+		return false;
+	}
+	*mapping_size = st.st_size;
+	return true;
+}
+
+static void container_free(container c)
+{
+	free(c->index.entries);
+	free(c->times);
+	free(c->values);
+	free(c->block);
+	free(c);
+}
+
+container container_create(const char *filename, const struct frame_file_layout *layout,
+			   uint chunk_frames)
+{
+	assert(filename);
+	assert(layout);
+	assert("Values must be stored as floats or doubles."
+	       && (layout->value_size == sizeof (float) || layout->value_size == sizeof (double)));
+	assert("Chunks must hold at least one frame." && chunk_frames > 0);
+
+	if (layout->variable_count > FRAME_FILE_MAX_VARIABLES) {
+		return NULL;
+	}
+
+	container result = malloc(sizeof *result);
+	header_from_layout(&result->header, layout, chunk_frames);
+	result->index = (struct index){0};
+	result->end_offset = sizeof result->header;
+	result->frame_count = 0;
+	result->buffered_frames = 0;
+	result->times = malloc((sizeof *result->times) * chunk_frames);
+	result->values = malloc((sizeof *result->values) * chunk_frames * layout->system_size * layout->variable_count);
+	result->block = malloc(chunk_size_for(&result->header, chunk_frames));
+	result->fh = fopen(filename, "w+b");
+	if (!result->fh || fwrite(&result->header, sizeof result->header, 1, result->fh) != 1) {
+		if (result->fh) {
+			fclose(result->fh);
+		}
+		container_free(result);
+		return NULL;
+	}
+
+	return result;
+}
+
+/* Takes the values in the row-major layout of the dynamical system. The
+ * frame is written once chunk_frames frames have been gathered. */
+bool container_write(container c, double time, const double *values)
+{
+	assert(c);
+	assert(values);
+
+	size_t frame_size = (size_t)c->header.system_size * c->header.variable_count;
+	c->times[c->buffered_frames] = time;
+	memcpy(c->values + c->buffered_frames * frame_size, values, (sizeof *values) * frame_size);
+	c->buffered_frames++;
+	c->frame_count++;
+
+	if (c->buffered_frames == c->header.chunk_frames) {
+		return container_flush(c);
+	}
+	return true;
+}
+
+/* Writes the frames gathered so far as one chunk per variable. */
+bool container_flush(container c)
+{
+	assert(c);
+
+	uint frame_count = c->buffered_frames;
+	if (frame_count == 0) {
+		return true;
+	}
+	c->buffered_frames = 0;
+
+	uint system_size = c->header.system_size;
+	uint variable_count = c->header.variable_count;
+	uint64_t chunk_size = chunk_size_for(&c->header, frame_count);
+
+	for (uint variable = 0; variable < variable_count; variable++) {
+		memset(c->block, 0, chunk_size);
+		memcpy(c->block, c->times, (sizeof *c->times) * frame_count);
+		void *rows = c->block + (sizeof *c->times) * frame_count;
+		for (uint frame = 0; frame < frame_count; frame++) {
+			const double *frame_values = c->values + (size_t)frame * system_size * variable_count;
+			for (uint system = 0; system < system_size; system++) {
+				double value = frame_values[system * variable_count + variable];
+				if (c->header.value_size == sizeof (double)) {
+					((double *)rows)[(size_t)frame * system_size + system] = value;
+				}
+				else {
+					((float *)rows)[(size_t)frame * system_size + system] = value;
+				}
+			}
+		}
+
+		struct record_header record = {
+			.type = RECORD_CHUNK,
+			.variable = variable,
+			.frame_count = frame_count,
+			.first_time = c->times[0],
+			.last_time = c->times[frame_count - 1],
+			.size = chunk_size
+		};
+		if (fwrite(&record, sizeof record, 1, c->fh) != 1
+		    || fwrite(c->block, chunk_size, 1, c->fh) != 1) {
+			return false;
+		}
+
+		struct index_entry entry = {
+			.variable = variable,
+			.frame_count = frame_count,
+			.first_time = record.first_time,
+			.last_time = record.last_time,
+			.offset = c->end_offset
+		};
+		index_add(&c->index, &entry);
+		c->end_offset += sizeof record + chunk_size;
+	}
+
+	return true;
+}
+
+uint64_t container_get_frame_count(container c)
+{
+	return c->frame_count;
+}
+
+/* Writes the remaining frames, the index and the footer, and closes the
+ * file. Returns false if any of that failed. */
+bool container_destroy(container *c)
+{
+	assert(c);
+	assert(*c);
+
+	container cc = *c;
+	bool success = container_flush(cc);
+
+	struct record_header record = {
+		.type = RECORD_INDEX,
+		.size = (sizeof *cc->index.entries) * cc->index.count
+	};
+	struct footer footer = { .index_offset = cc->end_offset };
+	memcpy(footer.magic, footer_magic, sizeof footer.magic);
+
+	success = success
+		&& fwrite(&record, sizeof record, 1, cc->fh) == 1
+		&& fwrite(cc->index.entries, sizeof *cc->index.entries, cc->index.count, cc->fh) == cc->index.count
+		&& fwrite(&footer, sizeof footer, 1, cc->fh) == 1;
+	success = !fclose(cc->fh) && success;
+
+	container_free(cc);
+	*c = NULL;
+	return success;
+}
+
+static int compare_entries(const void *a, const void *b)
+{
+	const struct index_entry *x = a, *y = b;
+	if (x->first_time != y->first_time) {
+		return x->first_time < y->first_time ? -1 : 1;
+	}
+	return x->offset < y->offset ? -1 : x->offset > y->offset;
+}
+
+container_reader container_reader_open(const char *filename)
+{
+	assert(filename);
+
+	void *mapping;
+	size_t mapping_size;
+	if (!map_file(filename, &mapping, &mapping_size)) {
+		return NULL;
+	}
+	if (!header_is_valid(mapping)) {
+		munmap(mapping, mapping_size);
+		return NULL;
+	}
+
+	container_reader result = malloc(sizeof *result);
+	result->mapping = mapping;
+	result->mapping_size = mapping_size;
+	result->header = mapping;
+
+	struct index all = {0};
+	uint64_t end_offset;
+	result->has_index = load_index(mapping, mapping_size, &all, &end_offset);
+
+	for (uint i = 0; i < FRAME_FILE_MAX_VARIABLES; i++) {
+		result->chunks[i] = (struct index){0};
+		result->variable_names[i] = result->header->variable_names[i];
+	}
+	for (uint64_t i = 0; i < all.count; i++) {
+		const struct index_entry *entry = &all.entries[i];
+		/* an index is only trusted as far as it points at chunks that fit in the file */
+		if (entry->variable < result->header->variable_count
+		    && entry->offset + sizeof (struct record_header) + chunk_size_for(result->header, entry->frame_count)
+		       <= mapping_size) {
+			index_add(&result->chunks[entry->variable], entry);
+		}
+	}
+	free(all.entries);
+
+	for (uint i = 0; i < result->header->variable_count; i++) {
+		qsort(result->chunks[i].entries, result->chunks[i].count,
+		      sizeof *result->chunks[i].entries, &compare_entries);
+	}
+
+	return result;
+}
+
+void container_reader_get_layout(container_reader cr, struct frame_file_layout *layout)
+{
+	assert(cr);
+	assert(layout);
+
+	layout->model_name = cr->header->model_name;
+	layout->system_size = cr->header->system_size;
+	layout->grid_width = cr->header->grid_width;
+	layout->grid_height = cr->header->grid_height;
+	layout->variable_count = cr->header->variable_count;
+	layout->variable_names = cr->variable_names;
+	layout->value_size = cr->header->value_size;
+	layout->time_step = cr->header->time_step;
+	layout->print_time = cr->header->print_time;
+}
+
+/* Returns whether the chunks were found through the index at the end of the
+ * file, rather than by walking a file that was not closed properly. */
+bool container_reader_has_index(container_reader cr)
+{
+	return cr->has_index;
+}
+
+uint64_t container_reader_get_chunk_count(container_reader cr, uint variable)
+{
+	assert("Given an invalid variable." && variable < cr->header->variable_count);
+	return cr->chunks[variable].count;
+}
+
+static const struct index_entry *chunk_entry(container_reader cr, uint variable, uint64_t chunk)
+{
+	assert("Given an invalid variable." && variable < cr->header->variable_count);
+	assert("Given an invalid chunk." && chunk < cr->chunks[variable].count);
+	return &cr->chunks[variable].entries[chunk];
+}
+
+void container_reader_get_chunk(container_reader cr, uint variable, uint64_t chunk,
+				struct container_chunk_info *info)
+{
+	const struct index_entry *entry = chunk_entry(cr, variable, chunk);
+	info->variable = entry->variable;
+	info->frame_count = entry->frame_count;
+	info->first_time = entry->first_time;
+	info->last_time = entry->last_time;
+}
+
+/* Returns the first chunk of the variable that ends at or after the given
+ * time, or the number of chunks if there is none. */
+uint64_t container_reader_find_chunk(container_reader cr, uint variable, double time)
+{
+	assert("Given an invalid variable." && variable < cr->header->variable_count);
+
+	const struct index *chunks = &cr->chunks[variable];
+	uint64_t low = 0, high = chunks->count;
+	while (low < high) {
+		uint64_t middle = low + (high - low) / 2;
+		if (chunks->entries[middle].last_time < time) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+	return low;
+}
+
+static const unsigned char *chunk_contents(container_reader cr, const struct index_entry *entry)
+{
+	return (const unsigned char *)cr->mapping + entry->offset + sizeof (struct record_header);
+}
+
+double container_reader_get_time(container_reader cr, uint variable, uint64_t chunk, uint frame)
+{
+	const struct index_entry *entry = chunk_entry(cr, variable, chunk);
+	assert("Given an invalid frame." && frame < entry->frame_count);
+
+	double time;
+	memcpy(&time, chunk_contents(cr, entry) + frame * sizeof time, sizeof time);
+	return time;
+}
+
+double container_reader_get_value(container_reader cr, uint variable, uint64_t chunk, uint frame, uint system)
+{
+	const struct index_entry *entry = chunk_entry(cr, variable, chunk);
+	assert("Given an invalid frame." && frame < entry->frame_count);
+	assert("Given an invalid system." && system < cr->header->system_size);
+
+	const unsigned char *rows = chunk_contents(cr, entry) + entry->frame_count * sizeof (double);
+	uint64_t position = ((uint64_t)frame * cr->header->system_size + system) * cr->header->value_size;
+	if (cr->header->value_size == sizeof (double)) {
+		double value;
+		memcpy(&value, rows + position, sizeof value);
+		return value;
+	}
+	float value;
+	memcpy(&value, rows + position, sizeof value);
+	return value;
+}
+
+/* Copies the samples of one variable of one system with a time in
+ * [begin_time, end_time] into times and values, up to max_samples of them.
+ * Only the chunks overlapping the time range are read. Returns the number
+ * of samples copied. */
+uint64_t container_reader_read_range(container_reader cr, uint variable, uint system,
+				     double begin_time, double end_time,
+				     double *times, double *values, uint64_t max_samples)
+{
+	assert(times);
+	assert(values);
+
+	uint64_t count = 0;
+	uint64_t chunk_count = container_reader_get_chunk_count(cr, variable);
+	for (uint64_t chunk = container_reader_find_chunk(cr, variable, begin_time);
+	     chunk < chunk_count && count < max_samples; chunk++) {
+		const struct index_entry *entry = chunk_entry(cr, variable, chunk);
+		if (entry->first_time > end_time) {
+			break;
+		}
+		for (uint frame = 0; frame < entry->frame_count && count < max_samples; frame++) {
+			double time = container_reader_get_time(cr, variable, chunk, frame);
+			if (time >= begin_time && time <= end_time) {
+				times[count] = time;
+				values[count] = container_reader_get_value(cr, variable, chunk, frame, system);
+				count++;
+			}
+		}
+	}
+	return count;
+}
+
+void container_reader_close(container_reader *cr)
+{
+	assert(cr);
+	assert(*cr);
+
+	for (uint i = 0; i < FRAME_FILE_MAX_VARIABLES; i++) {
+		free((*cr)->chunks[i].entries);
+	}
+	munmap((*cr)->mapping, (*cr)->mapping_size);
+	free(*cr);
+	*cr = NULL;
+}
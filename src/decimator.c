@@ -0,0 +1,99 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "headers/decimator.h"
+
+#include "tests/headers/test_utils.h"
+
+/* Summarizes one variable of every system over a bucket of integration
+ * steps by its minimum, maximum, mean and last value. Samples are added one
+ * step at a time, so nothing but the running summary is ever stored, and a
+ * spike that rises and falls between two outputs still shows up in the
+ * maximum of its bucket. */
+struct decimator {
+	uint system_size;
+	uint element_size;
+	uint variable;
+	uint sample_count;
+	double *min;
+	double *max;
+	double *sum;
+	double *last;
+};
+
+decimator decimator_create(uint system_size, uint element_size, uint variable)
+{
+	assert("Given an invalid variable." && variable < element_size);
+
+	decimator result = malloc(sizeof *result);
+	result->system_size = system_size;
+	result->element_size = element_size;
+	result->variable = variable;
+	result->sample_count = 0;
+	result->min = malloc((sizeof *result->min) * system_size);
+	result->max = malloc((sizeof *result->max) * system_size);
+	result->sum = malloc((sizeof *result->sum) * system_size);
+	result->last = malloc((sizeof *result->last) * system_size);
+
+	return result;
+}
+
+/* Adds one sample, given as the values of the dynamical system in their
+ * row-major layout, to the current bucket. */
+void decimator_add(decimator d, const double *values)
+{
+	assert(d);
+	assert(values);
+
+	const double *value = values + d->variable;
+	if (d->sample_count == 0) {
+		for (uint i = 0; i < d->system_size; i++, value += d->element_size) {
+			d->min[i] = d->max[i] = d->sum[i] = d->last[i] = *value;
+		}
+	}
+	else {
+		for (uint i = 0; i < d->system_size; i++, value += d->element_size) {
+			double v = *value;
+			d->min[i] = v < d->min[i] ? v : d->min[i];
+			d->max[i] = v > d->max[i] ? v : d->max[i];
+			d->sum[i] += v;
+			d->last[i] = v;
+		}
+	}
+	d->sample_count++;
+}
+
+uint decimator_get_sample_count(decimator d)
+{
+	return d->sample_count;
+}
+
+/* Stores the summary of the current bucket into envelope, as
+ * DECIMATOR_FIELD_COUNT values per system, and starts a new bucket. */
+void decimator_take(decimator d, double *envelope)
+{
+	assert(d);
+	assert(envelope);
+	assert("The bucket holds no samples." && d->sample_count > 0);
+
+	for (uint i = 0; i < d->system_size; i++, envelope += DECIMATOR_FIELD_COUNT) {
+		envelope[DECIMATOR_MIN] = d->min[i];
+		envelope[DECIMATOR_MAX] = d->max[i];
+		envelope[DECIMATOR_MEAN] = d->sum[i] / d->sample_count;
+		envelope[DECIMATOR_LAST] = d->last[i];
+	}
+	d->sample_count = 0;
+}
+
+void decimator_destroy(decimator *d)
+{
+	assert(d);
+	assert(*d);
+
+	free((*d)->min);
+	free((*d)->max);
+	free((*d)->sum);
+	free((*d)->last);
+	free(*d);
+	*d = NULL;
+}
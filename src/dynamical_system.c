@@ -92,6 +92,17 @@ double dynamical_system_get_time(dynamical_system ds)
 	return ds->time;
 }
 
+void dynamical_system_set_time(dynamical_system ds, double time)
+{
+	ds->time = time;
+}
+
+/* The values are stored row-major, with one row of element_size values per system. */
+double *dynamical_system_get_values(dynamical_system ds)
+{
+	return ds->elements;
+}
+
 uint dynamical_system_get_system_size(dynamical_system ds)
 {
 	return ds->system_size;
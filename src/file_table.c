@@ -5,14 +5,27 @@
 #include <stdarg.h>
 #include <string.h>
 #include <assert.h>
+#include <stdbool.h>
 #include "headers/deftypes.h"
 #include "headers/file_table.h"
+#include "headers/text_format.h"
 
 #include "tests/headers/test_utils.h"
 
+/* The buffer size given to each special file, which usually receives a
+ * whole frame at a time. Numbered files receive a line at a time, and
+ * there may be one per neuron, so they share a budget instead, each
+ * getting at most NUMBERED_BUFFER_SIZE and at least BUFSIZ bytes. */
+#define SPECIAL_BUFFER_SIZE (1 << 20)
+#define NUMBERED_BUFFER_SIZE (1 << 16)
+#define NUMBERED_BUFFER_BUDGET (1 << 26)
+
 struct file_table {
 	uint length;
 	uint special_count;
+	/* created by the first matrix written */
+	text_buffer text;
+	char *buffers;
 	struct {
 		char *name;
 		uint index;
@@ -20,35 +33,58 @@ struct file_table {
 	FILE *files[];
 };
 
-file_table file_table_create(const char *dirname, uint length, uint special_count, ...)
-{	
+static size_t numbered_buffer_size(uint length)
+{
+	size_t size = length ? NUMBERED_BUFFER_BUDGET / length : 0;
+	if (size > NUMBERED_BUFFER_SIZE) {
+		size = NUMBERED_BUFFER_SIZE;
+	}
+	return size < BUFSIZ ? BUFSIZ : size;
+}
+
+/* Numbered files are named after their index in the table, or after the
+ * matching entry of numbers if it is given. */
+static file_table create_table(const char *dirname, const uint *numbers, uint length,
+			       uint special_count, va_list vl)
+{
 	file_table result = malloc((sizeof *result) +
 				   (sizeof *(result->files)) * (length + special_count));
 	result->length = length;
 	result->special_count = special_count;
+	result->text = NULL;
+
+	/* the stdio buffers of all files, numbered ones first */
+	size_t numbered_size = numbered_buffer_size(length);
+	result->buffers = malloc(numbered_size * length + (size_t)SPECIAL_BUFFER_SIZE * special_count + 1);
 
-	long long digits = (long long)ceil(log10(length));
+	uint name_limit = length;
+	for (uint i = 0; numbers && i < length; i++) {
+		if (numbers[i] >= name_limit) {
+			name_limit = numbers[i] + 1;
+		}
+	}
+	long long digits = (long long)ceil(log10(name_limit));
 	uint filename_size = strlen(dirname) + strlen("/.dat") + 1 + 1 + digits;
 	char *filename = malloc(filename_size);
 
 	for (uint i = 0; i < length; i++) {
-		snprintf(filename, filename_size, "%s/%d.dat", dirname, i);
+		snprintf(filename, filename_size, "%s/%u.dat", dirname, numbers ? numbers[i] : i);
 		result->files[i] = fopen(filename, "w+");
 		if (!result->files[i]) {
 			free(filename);
-			for (uint j = i; j >= 0; j--) {
+			for (uint j = 0; j < i; j++) {
 				fclose(result->files[j]);
 			}
+			free(result->buffers);
 			free(result);
 			return NULL;
 		}
+		setvbuf(result->files[i], result->buffers + numbered_size * i, _IOFBF, numbered_size);
 	}
 
 	free(filename);
 
 	if (special_count) {
-		va_list vl;
-		va_start(vl, special_count);
 		result->special_names = malloc((sizeof *(result->special_names)) * special_count);
 		uint max_strlen = 0;
 		for (uint i = 0; i < special_count; i++) {
@@ -64,8 +100,6 @@ file_table file_table_create(const char *dirname, uint length, uint special_coun
 			result->special_names[i].index = length + i;
 		}
 
-		va_end(vl);
-
 		filename_size = strlen(dirname) + 1 + 1 + max_strlen;
 		filename = malloc(filename_size);
 		for (uint i = 0; i < special_count; i++) {
@@ -74,15 +108,20 @@ file_table file_table_create(const char *dirname, uint length, uint special_coun
 			snprintf(filename, filename_size, "%s/%s", dirname, curr_name);
 			FILE *fh = fopen(filename, "w+");
 			if (!fh) {
-				for (uint j = i; j >= 0; j--) {
+				free(filename);
+				for (uint j = 0; j < special_count; j++) {
 					free(result->special_names[j].name);
 				}
-				for (uint j = i - 1; j >= 0; j--) {
-					fclose(result->files[result->length + j]);
+				free(result->special_names);
+				for (uint j = 0; j < result->length + i; j++) {
+					fclose(result->files[j]);
 				}
+				free(result->buffers);
 				free(result);
 				return NULL;
 			}
+			setvbuf(fh, result->buffers + numbered_size * length + (size_t)SPECIAL_BUFFER_SIZE * i,
+				_IOFBF, SPECIAL_BUFFER_SIZE);
 			result->files[result->length + i] = fh;
 		}
 		free(filename);
@@ -90,7 +129,31 @@ file_table file_table_create(const char *dirname, uint length, uint special_coun
 	else {
 		result->special_names = NULL;
 	}
-	
+
+	return result;
+}
+
+file_table file_table_create(const char *dirname, uint length, uint special_count, ...)
+{
+	va_list vl;
+	va_start(vl, special_count);
+	file_table result = create_table(dirname, NULL, length, special_count, vl);
+	va_end(vl);
+	return result;
+}
+
+/* Creates a table whose numbered files are named after the given numbers,
+ * such as the indices of a subset of the neurons, rather than 0 to
+ * length - 1. They are still accessed by their position in the table. */
+file_table file_table_create_numbered(const char *dirname, const uint *numbers, uint length,
+				      uint special_count, ...)
+{
+	assert(numbers || length == 0);
+
+	va_list vl;
+	va_start(vl, special_count);
+	file_table result = create_table(dirname, numbers, length, special_count, vl);
+	va_end(vl);
 	return result;
 }
 
@@ -133,15 +196,89 @@ void file_table_special_print(file_table fs, const char *name, const char *fmt,
 	va_end(vl);
 }
 
-void file_table_destroy(file_table *fs)
+/* Returns the handle of the i-th file. */
+file_table_handle file_table_index_handle(file_table fs, uint i)
+{
+	assert(fs);
+	assert("Given an invalid index." && i < fs->length);
+
+	return i;
+}
+
+/* Returns the handle of the named special file, looking the name up once
+ * so that the writes that follow do not have to. */
+file_table_handle file_table_special_handle(file_table fs, const char *name)
+{
+	assert(fs);
+	assert(name);
+
+	for (uint i = 0; i < fs->special_count; i++) {
+		if (!strcmp(name, fs->special_names[i].name)) {
+			return fs->special_names[i].index;
+		}
+	}
+
+	assert("Given an unknown special file." && false);
+	return 0;
+}
+
+/* Writes size bytes of already formatted text. Returns false if they
+ * could not all be written. */
+bool file_table_write(file_table fs, file_table_handle handle, const char *data, size_t size)
+{
+	assert(fs);
+	assert("Given an invalid handle." && handle < fs->length + fs->special_count);
+
+	return fwrite(data, 1, size, fs->files[handle]) == size;
+}
+
+/* Writes a matrix of rows by cols values in the layout of the voltage
+ * matrix file: every value in scientific notation with the given precision
+ * followed by a space, and every row followed by a newline. Consecutive
+ * values are stride doubles apart in values. The whole matrix is formatted
+ * in memory and written at once. */
+bool file_table_write_matrix(file_table fs, file_table_handle handle, const double *values,
+			     uint rows, uint cols, uint stride, uint precision)
+{
+	assert(fs);
+	assert(values);
+
+	if (!fs->text) {
+		/* a sign, a digit, the point, the precision, the exponent and a space */
+		fs->text = text_buffer_create((size_t)rows * cols * (precision + 9) + rows);
+	}
+	text_buffer text = fs->text;
+	text_buffer_clear(text);
+	for (uint row = 0; row < rows; row++) {
+		for (uint col = 0; col < cols; col++, values += stride) {
+			text_buffer_exponent(text, *values, precision);
+			text_buffer_char(text, ' ');
+		}
+		text_buffer_char(text, '\n');
+	}
+	return file_table_write(fs, handle, text_buffer_get_data(text), text_buffer_get_size(text));
+}
+
+/* Returns false if the data still buffered could not all be written. */
+bool file_table_destroy(file_table *fs)
 {
 	assert(fs);
 	assert(*fs);
 
+	bool result = true;
 	for (uint i = 0; i < (*fs)->length + (*fs)->special_count; i++) {
-		fclose((*fs)->files[i]);
+		result = fclose((*fs)->files[i]) == 0 && result;
+	}
+	for (uint i = 0; i < (*fs)->special_count; i++) {
+		free((*fs)->special_names[i].name);
 	}
 	free((*fs)->special_names);
+	if ((*fs)->text) {
+		text_buffer_destroy(&(*fs)->text);
+	}
+	free((*fs)->buffers);
 	free(*fs);
 	*fs = NULL;
+
+	return result;
 }
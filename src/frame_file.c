@@ -0,0 +1,317 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "headers/frame_file.h"
+
+#include "tests/headers/test_utils.h"
+
+/* A frame file is the header below followed by frames of frame_size bytes.
+ * Each frame is the simulation time as a double, then one column per
+ * variable holding that variable for every system, stored as floats or
+ * doubles according to value_size, then zero padding up to a multiple of
+ * eight bytes. Since every frame has the same size, frame i starts at
+ * header_size + i * frame_size, and a partially written last frame left by
+ * a crash is simply not counted.
+ */
+struct frame_file_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t header_size;
+	uint32_t system_size;
+	uint32_t grid_width;
+	uint32_t grid_height;
+	uint32_t variable_count;
+	uint32_t value_size;
+	uint32_t reserved;
+	double time_step;
+	double print_time;
+	uint64_t frame_size;
+	char model_name[FRAME_FILE_NAME_LENGTH];
+	char variable_names[FRAME_FILE_MAX_VARIABLES][FRAME_FILE_VARIABLE_NAME_LENGTH];
+};
+
+static const char frame_file_magic[8] = "NNFRAME";
+
+struct frame_file {
+	FILE *fh;
+	bulk_writer bw;
+	struct frame_file_header header;
+	uint64_t frame_count;
+	unsigned char *frame;
+};
+
+struct frame_reader {
+	void *mapping;
+	size_t mapping_size;
+	const struct frame_file_header *header;
+	uint64_t frame_count;
+	const char *variable_names[FRAME_FILE_MAX_VARIABLES];
+};
+
+static uint64_t frame_size_for(uint system_size, uint variable_count, uint value_size)
+{
+	uint64_t size = sizeof (double) + (uint64_t)system_size * variable_count * value_size;
+	return (size + 7) & ~(uint64_t)7;
+}
+
+static void header_from_layout(struct frame_file_header *header, const struct frame_file_layout *layout)
+{
+	memset(header, 0, sizeof *header);
+	memcpy(header->magic, frame_file_magic, sizeof header->magic);
+	header->version = FRAME_FILE_VERSION;
+	header->header_size = sizeof *header;
+	header->system_size = layout->system_size;
+	header->grid_width = layout->grid_width;
+	header->grid_height = layout->grid_height;
+	header->variable_count = layout->variable_count;
+	header->value_size = layout->value_size;
+	header->time_step = layout->time_step;
+	header->print_time = layout->print_time;
+	header->frame_size = frame_size_for(layout->system_size, layout->variable_count, layout->value_size);
+	if (layout->model_name) {
+		strncpy(header->model_name, layout->model_name, FRAME_FILE_NAME_LENGTH - 1);
+	}
+	for (uint i = 0; i < layout->variable_count; i++) {
+		strncpy(header->variable_names[i], layout->variable_names[i], FRAME_FILE_VARIABLE_NAME_LENGTH - 1);
+	}
+}
+
+frame_file frame_file_create(const char *filename, const struct frame_file_layout *layout)
+{
+	return frame_file_create_bulk(filename, layout, NULL);
+}
+
+/* Creates a frame file whose frames are written through a bulk writer with
+ * the given options, or through stdio if options is NULL. */
+frame_file frame_file_create_bulk(const char *filename, const struct frame_file_layout *layout,
+				  const struct bulk_writer_options *options)
+{
+	assert(filename);
+	assert(layout);
+	assert("Values must be stored as floats or doubles."
+	       && (layout->value_size == sizeof (float) || layout->value_size == sizeof (double)));
+
+	if (layout->variable_count > FRAME_FILE_MAX_VARIABLES) {
+		return NULL;
+	}
+
+	frame_file result = malloc(sizeof *result);
+	header_from_layout(&result->header, layout);
+	result->frame_count = 0;
+	result->fh = fopen(filename, "w+b");
+	if (!result->fh || fwrite(&result->header, sizeof result->header, 1, result->fh) != 1) {
+		if (result->fh) {
+			fclose(result->fh);
+		}
+		free(result);
+		return NULL;
+	}
+
+	result->bw = NULL;
+	if (options) {
+		/* the header is in place, frames follow from where stdio stopped */
+		long offset = ftell(result->fh);
+		bool closed = !fclose(result->fh);
+		result->fh = NULL;
+		result->bw = closed && offset >= 0 ? bulk_writer_open(filename, offset, options) : NULL;
+		if (!result->bw) {
+			free(result);
+			return NULL;
+		}
+	}
+
+	result->frame = calloc(1, result->header.frame_size);
+	return result;
+}
+
+/* Takes the values in the row-major layout of the dynamical system, one row
+ * of variable_count values per system, and stores them column by column. */
+bool frame_file_write(frame_file ff, double time, const double *values)
+{
+	assert(ff);
+	assert(values);
+
+	uint system_size = ff->header.system_size;
+	uint variable_count = ff->header.variable_count;
+
+	memcpy(ff->frame, &time, sizeof time);
+	if (ff->header.value_size == sizeof (double)) {
+		double *columns = (double *)(ff->frame + sizeof time);
+		for (uint variable = 0; variable < variable_count; variable++) {
+			for (uint system = 0; system < system_size; system++) {
+				columns[variable * system_size + system] = values[system * variable_count + variable];
+			}
+		}
+	}
+	else {
+		float *columns = (float *)(ff->frame + sizeof time);
+		for (uint variable = 0; variable < variable_count; variable++) {
+			for (uint system = 0; system < system_size; system++) {
+				columns[variable * system_size + system] = values[system * variable_count + variable];
+			}
+		}
+	}
+
+	if (ff->bw ? !bulk_writer_write(ff->bw, ff->frame, ff->header.frame_size)
+	    : fwrite(ff->frame, ff->header.frame_size, 1, ff->fh) != 1) {
+		return false;
+	}
+
+	ff->frame_count++;
+	return true;
+}
+
+uint64_t frame_file_get_frame_count(frame_file ff)
+{
+	return ff->frame_count;
+}
+
+/* Gives the statistics of the bulk writer of the frame file. Returns false
+ * if the frames are written through stdio. */
+bool frame_file_get_writer_stats(frame_file ff, struct bulk_writer_stats *stats)
+{
+	assert(ff);
+	assert(stats);
+
+	if (!ff->bw) {
+		return false;
+	}
+	bulk_writer_get_stats(ff->bw, stats);
+	return true;
+}
+
+/* Closes the file once every frame has been written. Returns false if any
+ * of them could not be. */
+bool frame_file_destroy(frame_file *ff)
+{
+	assert(ff);
+	assert(*ff);
+
+	bool success = (*ff)->bw ? bulk_writer_close(&(*ff)->bw) : !fclose((*ff)->fh);
+	free((*ff)->frame);
+	free(*ff);
+	*ff = NULL;
+	return success;
+}
+
+frame_reader frame_reader_open(const char *filename)
+{
+	assert(filename);
+
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		return NULL;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) || st.st_size < (off_t)sizeof (struct frame_file_header)) {
+		close(fd);
+		return NULL;
+	}
+
+	void *mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED) {
+		return NULL;
+	}
+
+	const struct frame_file_header *header = mapping;
+	if (memcmp(header->magic, frame_file_magic, sizeof header->magic)
+	    || header->version != FRAME_FILE_VERSION
+	    || header->header_size != sizeof *header
+	    || header->variable_count > FRAME_FILE_MAX_VARIABLES
+	    || (header->value_size != sizeof (float) && header->value_size != sizeof (double))
+	    || header->frame_size != frame_size_for(header->system_size, header->variable_count,
+						      header->value_size)) {
+		munmap(mapping, st.st_size);
+		return NULL;
+	}
+
+	frame_reader result = malloc(sizeof *result);
+	result->mapping = mapping;
+	result->mapping_size = st.st_size;
+	result->header = header;
+	result->frame_count = (st.st_size - header->header_size) / header->frame_size;
+	for (uint i = 0; i < FRAME_FILE_MAX_VARIABLES; i++) {
+		result->variable_names[i] = header->variable_names[i];
+	}
+
+	return result;
+}
+
+void frame_reader_get_layout(frame_reader fr, struct frame_file_layout *layout)
+{
+	assert(fr);
+	assert(layout);
+
+	layout->model_name = fr->header->model_name;
+	layout->system_size = fr->header->system_size;
+	layout->grid_width = fr->header->grid_width;
+	layout->grid_height = fr->header->grid_height;
+	layout->variable_count = fr->header->variable_count;
+	layout->variable_names = fr->variable_names;
+	layout->value_size = fr->header->value_size;
+	layout->time_step = fr->header->time_step;
+	layout->print_time = fr->header->print_time;
+}
+
+uint64_t frame_reader_get_frame_count(frame_reader fr)
+{
+	return fr->frame_count;
+}
+
+/* Returns the distance in bytes between consecutive frames in the mapping. */
+uint64_t frame_reader_get_frame_size(frame_reader fr)
+{
+	return fr->header->frame_size;
+}
+
+static const unsigned char *frame_at(frame_reader fr, uint64_t frame)
+{
+	assert("Given an invalid frame." && frame < fr->frame_count);
+	return (const unsigned char *)fr->mapping + fr->header->header_size + frame * fr->header->frame_size;
+}
+
+double frame_reader_get_time(frame_reader fr, uint64_t frame)
+{
+	double time;
+	memcpy(&time, frame_at(fr, frame), sizeof time);
+	return time;
+}
+
+/* Returns the column of the given variable within the frame, an array of
+ * system_size floats or doubles depending on the value size. */
+const void *frame_reader_get_column(frame_reader fr, uint64_t frame, uint variable)
+{
+	assert("Given an invalid variable." && variable < fr->header->variable_count);
+	return frame_at(fr, frame) + sizeof (double)
+		+ (uint64_t)variable * fr->header->system_size * fr->header->value_size;
+}
+
+double frame_reader_get_value(frame_reader fr, uint64_t frame, uint variable, uint system)
+{
+	assert("Given an invalid system." && system < fr->header->system_size);
+
+	const void *column = frame_reader_get_column(fr, frame, variable);
+	if (fr->header->value_size == sizeof (double)) {
+		return ((const double *)column)[system];
+	}
+	return ((const float *)column)[system];
+}
+
+void frame_reader_close(frame_reader *fr)
+{
+	assert(fr);
+	assert(*fr);
+
+	munmap((*fr)->mapping, (*fr)->mapping_size);
+	free(*fr);
+	*fr = NULL;
+}
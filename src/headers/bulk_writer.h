@@ -0,0 +1,46 @@
+#ifndef BULK_WRITER_H
+#define BULK_WRITER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "deftypes.h"
+
+/* Chunks are aligned to, and with O_DIRECT written in multiples of, this
+ * many bytes, which covers the logical block size of common devices. */
+#define BULK_WRITER_ALIGNMENT 4096
+#define BULK_WRITER_CHUNK_SIZE (1 << 20)
+
+struct bulk_writer;
+typedef struct bulk_writer *bulk_writer;
+
+enum bulk_writer_backend {
+	BULK_WRITER_URING,
+	BULK_WRITER_THREAD
+};
+
+/* queue_depth chunks of chunk_size bytes are allocated, and up to all of
+ * them can be in flight at once. chunk_size must be a multiple of
+ * BULK_WRITER_ALIGNMENT. */
+struct bulk_writer_options {
+	enum bulk_writer_backend backend;
+	uint queue_depth;
+	size_t chunk_size;
+	bool direct;
+};
+
+struct bulk_writer_stats {
+	enum bulk_writer_backend backend;
+	bool direct;
+	bool registered_buffers;
+	uint64_t bytes_written;
+	uint64_t chunks_submitted;
+	uint64_t stalls;
+};
+
+bulk_writer bulk_writer_open(const char *filename, uint64_t offset, const struct bulk_writer_options *options);
+bool bulk_writer_write(bulk_writer bw, const void *data, size_t size);
+void bulk_writer_get_stats(bulk_writer bw, struct bulk_writer_stats *stats);
+bool bulk_writer_close(bulk_writer *bw);
+
+#endif
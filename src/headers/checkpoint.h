@@ -0,0 +1,53 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "deftypes.h"
+#include "dynamical_system.h"
+
+#define CHECKPOINT_VERSION 2
+#define CHECKPOINT_NAME_LENGTH 64
+
+struct checkpoint;
+typedef struct checkpoint *checkpoint;
+
+enum checkpoint_background_status {
+	CHECKPOINT_BACKGROUND_STARTED,
+	CHECKPOINT_BACKGROUND_BUSY,
+	CHECKPOINT_BACKGROUND_FAILED
+};
+
+/* The parts of the simulation setup that cannot be recovered from the
+ * dynamical system itself. Callbacks are recorded by their command line
+ * names, since function pointers are meaningless across runs.
+ */
+struct checkpoint_info {
+	const char *model_name;
+	const char *parameter_callback_name;
+	const char *coupling_callback_name;
+	const char *initial_values_callback_name;
+	double time_step;
+	bool coupling_constant_is_random;
+	double coupling_constant;
+	double lowest_random_value;
+	double highest_random_value;
+};
+
+bool checkpoint_write(dynamical_system ds, const struct checkpoint_info *info, const char *filename);
+enum checkpoint_background_status checkpoint_write_background(dynamical_system ds,
+							     const struct checkpoint_info *info,
+							     const char *filename);
+bool checkpoint_wait_background(void);
+checkpoint checkpoint_open(const char *filename);
+void checkpoint_get_info(checkpoint cp, struct checkpoint_info *info);
+double checkpoint_get_time(checkpoint cp);
+uint checkpoint_get_system_size(checkpoint cp);
+uint checkpoint_get_grid_width(checkpoint cp);
+uint checkpoint_get_grid_height(checkpoint cp);
+uint checkpoint_get_element_size(checkpoint cp);
+const double *checkpoint_get_values(checkpoint cp);
+bool checkpoint_restore(checkpoint cp, dynamical_system ds);
+void checkpoint_close(checkpoint *cp);
+
+#endif
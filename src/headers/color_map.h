@@ -0,0 +1,27 @@
+#ifndef COLOR_MAP_H
+#define COLOR_MAP_H
+
+#include <stdint.h>
+#include "deftypes.h"
+
+/* The number of colors between the lowest and the highest value. */
+#define COLOR_MAP_SIZE 1024
+/* The number of colors of the palette of indexed images. */
+#define COLOR_MAP_PALETTE_SIZE 256
+
+struct color_map;
+typedef struct color_map *color_map;
+
+struct color_map_rgb {
+	uint8_t r, g, b;
+};
+
+color_map color_map_create(double low_value, double high_value,
+			   struct color_map_rgb low_color, struct color_map_rgb high_color);
+uint32_t color_map_lookup(color_map cm, double value);
+void color_map_fill(color_map cm, const double *values, uint stride, uint count, uint32_t *pixels);
+void color_map_get_palette(color_map cm, struct color_map_rgb *palette);
+void color_map_fill_indices(color_map cm, const double *values, uint stride, uint count, uint8_t *indices);
+void color_map_destroy(color_map *cm);
+
+#endif
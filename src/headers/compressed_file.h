@@ -0,0 +1,32 @@
+#ifndef COMPRESSED_FILE_H
+#define COMPRESSED_FILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "deftypes.h"
+#include "frame_file.h"
+
+#define COMPRESSED_FILE_VERSION 1
+
+struct compressed_file;
+typedef struct compressed_file *compressed_file;
+
+struct compressed_reader;
+typedef struct compressed_reader *compressed_reader;
+
+compressed_file compressed_file_create(const char *filename, const struct frame_file_layout *layout,
+				       uint chunk_frames);
+bool compressed_file_write(compressed_file cf, double time, const double *values);
+bool compressed_file_flush(compressed_file cf);
+uint64_t compressed_file_get_frame_count(compressed_file cf);
+void compressed_file_get_sizes(compressed_file cf, uint64_t *raw_bytes, uint64_t *stored_bytes);
+bool compressed_file_destroy(compressed_file *cf);
+
+compressed_reader compressed_reader_open(const char *filename);
+void compressed_reader_get_layout(compressed_reader cr, struct frame_file_layout *layout);
+uint compressed_reader_next_chunk(compressed_reader cr);
+double compressed_reader_get_time(compressed_reader cr, uint frame);
+const double *compressed_reader_get_values(compressed_reader cr, uint frame);
+void compressed_reader_close(compressed_reader *cr);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <stddef.h>
+
+size_t compression_xor_bound(size_t count);
+size_t compression_xor_encode(const double *values, size_t count, size_t stride, unsigned char *out);
+size_t compression_xor_decode(const unsigned char *in, size_t in_size,
+			      double *values, size_t count, size_t stride);
+size_t compression_lz_bound(size_t size);
+size_t compression_lz_encode(const unsigned char *in, size_t size, unsigned char *out);
+size_t compression_lz_decode(const unsigned char *in, size_t in_size, unsigned char *out, size_t out_size);
+
+#endif
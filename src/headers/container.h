@@ -0,0 +1,47 @@
+#ifndef CONTAINER_H
+#define CONTAINER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "deftypes.h"
+#include "frame_file.h"
+
+#define CONTAINER_VERSION 1
+
+struct container;
+typedef struct container *container;
+
+struct container_reader;
+typedef struct container_reader *container_reader;
+
+/* Describes one chunk of a container: frame_count consecutive frames of a
+ * single variable, for every system, from first_time to last_time. */
+struct container_chunk_info {
+	uint variable;
+	uint frame_count;
+	double first_time;
+	double last_time;
+};
+
+container container_create(const char *filename, const struct frame_file_layout *layout,
+			   uint chunk_frames);
+bool container_write(container c, double time, const double *values);
+bool container_flush(container c);
+uint64_t container_get_frame_count(container c);
+bool container_destroy(container *c);
+
+container_reader container_reader_open(const char *filename);
+void container_reader_get_layout(container_reader cr, struct frame_file_layout *layout);
+bool container_reader_has_index(container_reader cr);
+uint64_t container_reader_get_chunk_count(container_reader cr, uint variable);
+void container_reader_get_chunk(container_reader cr, uint variable, uint64_t chunk,
+				struct container_chunk_info *info);
+uint64_t container_reader_find_chunk(container_reader cr, uint variable, double time);
+double container_reader_get_time(container_reader cr, uint variable, uint64_t chunk, uint frame);
+double container_reader_get_value(container_reader cr, uint variable, uint64_t chunk, uint frame, uint system);
+uint64_t container_reader_read_range(container_reader cr, uint variable, uint system,
+				     double begin_time, double end_time,
+				     double *times, double *values, uint64_t max_samples);
+void container_reader_close(container_reader *cr);
+
+#endif
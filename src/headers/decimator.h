@@ -0,0 +1,25 @@
+#ifndef DECIMATOR_H
+#define DECIMATOR_H
+
+#include "deftypes.h"
+
+struct decimator;
+typedef struct decimator *decimator;
+
+/* The summary kept for every system over a bucket, in the order in which
+ * decimator_take stores them. */
+enum decimator_field {
+	DECIMATOR_MIN,
+	DECIMATOR_MAX,
+	DECIMATOR_MEAN,
+	DECIMATOR_LAST,
+	DECIMATOR_FIELD_COUNT
+};
+
+decimator decimator_create(uint system_size, uint element_size, uint variable);
+void decimator_add(decimator d, const double *values);
+uint decimator_get_sample_count(decimator d);
+void decimator_take(decimator d, double *envelope);
+void decimator_destroy(decimator *d);
+
+#endif
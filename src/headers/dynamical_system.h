@@ -27,6 +27,8 @@ void dynamical_system_set_value(dynamical_system ds, uint row, uint column, doub
 void dynamical_system_increment_value(dynamical_system ds, uint row, uint column, double delta);
 double dynamical_system_get_value(dynamical_system ds, uint row, uint column);
 double dynamical_system_get_time(dynamical_system ds);
+void dynamical_system_set_time(dynamical_system ds, double time);
+double *dynamical_system_get_values(dynamical_system ds);
 uint dynamical_system_get_system_size(dynamical_system ds);
 uint dynamical_system_get_element_size(dynamical_system ds);
 double (**dynamical_system_get_derivatives(dynamical_system ds))(dynamical_system ds, uint system);
@@ -2,16 +2,28 @@
 #ifndef FILE_TABLE_H
 #define FILE_TABLE_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include "deftypes.h"
 
 struct file_table;
 typedef struct file_table *file_table;
 
+/* Identifies one file of a file table, numbered or special. */
+typedef uint file_table_handle;
+
 file_table file_table_create(const char *dirname, uint length, uint special_count, ...);
+file_table file_table_create_numbered(const char *dirname, const uint *numbers, uint length,
+				      uint special_count, ...);
 uint file_table_get_length(file_table fs);
 uint file_table_get_special_count(file_table fs);
 void file_table_index_print(file_table fs, uint i, const char *fmt, ...);
 void file_table_special_print(file_table fs, const char *name, const char *fmt, ...);
-void file_table_destroy(file_table *fs);
+file_table_handle file_table_index_handle(file_table fs, uint i);
+file_table_handle file_table_special_handle(file_table fs, const char *name);
+bool file_table_write(file_table fs, file_table_handle handle, const char *data, size_t size);
+bool file_table_write_matrix(file_table fs, file_table_handle handle, const double *values,
+			     uint rows, uint cols, uint stride, uint precision);
+bool file_table_destroy(file_table *fs);
 
 #endif
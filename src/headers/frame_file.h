@@ -0,0 +1,51 @@
+#ifndef FRAME_FILE_H
+#define FRAME_FILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "deftypes.h"
+#include "bulk_writer.h"
+
+#define FRAME_FILE_VERSION 1
+#define FRAME_FILE_NAME_LENGTH 64
+#define FRAME_FILE_VARIABLE_NAME_LENGTH 32
+#define FRAME_FILE_MAX_VARIABLES 16
+
+struct frame_file;
+typedef struct frame_file *frame_file;
+
+struct frame_reader;
+typedef struct frame_reader *frame_reader;
+
+/* Describes what every frame of a frame file holds. value_size is the size
+ * in bytes of a stored value, either sizeof (float) or sizeof (double). */
+struct frame_file_layout {
+	const char *model_name;
+	uint system_size;
+	uint grid_width;
+	uint grid_height;
+	uint variable_count;
+	const char **variable_names;
+	uint value_size;
+	double time_step;
+	double print_time;
+};
+
+frame_file frame_file_create(const char *filename, const struct frame_file_layout *layout);
+frame_file frame_file_create_bulk(const char *filename, const struct frame_file_layout *layout,
+				  const struct bulk_writer_options *options);
+bool frame_file_write(frame_file ff, double time, const double *values);
+uint64_t frame_file_get_frame_count(frame_file ff);
+bool frame_file_get_writer_stats(frame_file ff, struct bulk_writer_stats *stats);
+bool frame_file_destroy(frame_file *ff);
+
+frame_reader frame_reader_open(const char *filename);
+void frame_reader_get_layout(frame_reader fr, struct frame_file_layout *layout);
+uint64_t frame_reader_get_frame_count(frame_reader fr);
+uint64_t frame_reader_get_frame_size(frame_reader fr);
+double frame_reader_get_time(frame_reader fr, uint64_t frame);
+double frame_reader_get_value(frame_reader fr, uint64_t frame, uint variable, uint system);
+const void *frame_reader_get_column(frame_reader fr, uint64_t frame, uint variable);
+void frame_reader_close(frame_reader *fr);
+
+#endif
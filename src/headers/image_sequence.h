@@ -0,0 +1,36 @@
+#ifndef IMAGE_SEQUENCE_H
+#define IMAGE_SEQUENCE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "deftypes.h"
+#include "color_map.h"
+
+struct image_sequence;
+typedef struct image_sequence *image_sequence;
+
+enum image_format {
+	IMAGE_FORMAT_PPM,
+	IMAGE_FORMAT_PNG,
+	IMAGE_FORMAT_GIF
+};
+
+/* Every cell is drawn as a square of scale by scale pixels. Frames are
+ * encoded by thread_count threads. GIF frames are shown for frame_delay
+ * hundredths of a second each. */
+struct image_sequence_options {
+	enum image_format format;
+	uint scale;
+	uint thread_count;
+	uint frame_delay;
+};
+
+image_sequence image_sequence_create(const char *prefix, uint width, uint height,
+				     const struct color_map_rgb *palette,
+				     const struct image_sequence_options *options);
+uint8_t *image_sequence_acquire(image_sequence is);
+void image_sequence_submit(image_sequence is);
+uint64_t image_sequence_get_frame_count(image_sequence is);
+bool image_sequence_destroy(image_sequence *is);
+
+#endif
@@ -4,6 +4,7 @@
 
 #include "deftypes.h"
 #include <stdbool.h>
+#include <stdint.h>
 #include "dynamical_system.h"
 
 int math_utils_wrap_around(int given, int lower, int upper);
@@ -15,6 +16,8 @@ void math_utils_all_neighbors_indices(uint i, uint width, uint height,
 				      uint *top_left, uint *top_right, uint *bottom_right, uint *bottom_left);
 bool math_utils_near_every(double value, float increment, float target_divisor);
 double math_utils_random_number(double lowest, double highest);
+uint64_t math_utils_random_state_get(void);
+void math_utils_random_state_set(uint64_t state);
 double math_utils_lerp(double input,
 		       double low_input, double high_input, double low_output, double high_output);
 bool math_utils_rk4_integrate(dynamical_system ds, double step);
@@ -8,6 +8,7 @@ extern struct dynamical_model fitzhugh_nagumo_model;
 struct dynamical_model {
 	double (**derivatives)(dynamical_system ds, uint index);
 	uint number_of_variables;
+	const char **variable_names;
 };
 
 void neuron_config_coupling_is_random_set(bool value, double lowest, double highest);
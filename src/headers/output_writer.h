@@ -0,0 +1,29 @@
+#ifndef OUTPUT_WRITER_H
+#define OUTPUT_WRITER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "deftypes.h"
+
+struct output_writer;
+typedef struct output_writer *output_writer;
+
+struct output_writer_stats {
+	uint64_t frames_written;
+	uint64_t stalls;
+	double stall_seconds;
+	uint max_queued;
+	uint slot_count;
+};
+
+output_writer output_writer_create(uint slot_count, size_t frame_size,
+				   bool (*write_frame)(void *context, const void *frame),
+				   void *context);
+void *output_writer_acquire(output_writer ow);
+void output_writer_submit(output_writer ow);
+void output_writer_flush(output_writer ow);
+void output_writer_get_stats(output_writer ow, struct output_writer_stats *stats);
+bool output_writer_destroy(output_writer *ow);
+
+#endif
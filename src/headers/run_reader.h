@@ -0,0 +1,37 @@
+#ifndef RUN_READER_H
+#define RUN_READER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "deftypes.h"
+#include "frame_file.h"
+
+struct run_reader;
+typedef struct run_reader *run_reader;
+
+/* A sequence of count values of value_size bytes, either floats or
+ * doubles, that lie stride bytes apart within the mapped output files. */
+struct run_view {
+	const unsigned char *data;
+	uint64_t count;
+	uint64_t stride;
+	uint value_size;
+};
+
+run_reader run_reader_open(const char *dirname);
+bool run_reader_has_frames(run_reader rr);
+bool run_reader_has_spikes(run_reader rr);
+void run_reader_get_layout(run_reader rr, struct frame_file_layout *layout);
+uint64_t run_reader_get_frame_count(run_reader rr);
+bool run_reader_find_frame(run_reader rr, double time, uint64_t *frame);
+bool run_reader_get_frame(run_reader rr, double time, uint variable, double *frame_time, struct run_view *view);
+bool run_reader_get_trace(run_reader rr, uint neuron, uint variable, double begin_time, double end_time,
+			  struct run_view *times, struct run_view *values);
+uint64_t run_reader_get_spike_count(run_reader rr);
+uint64_t run_reader_get_spikes(run_reader rr, double begin_time, double end_time,
+			       const double **times, const uint32_t **neurons);
+void run_reader_close(run_reader *rr);
+
+double run_view_get(const struct run_view *view, uint64_t i);
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef SELECTION_H
+#define SELECTION_H
+
+#include <stdbool.h>
+#include "deftypes.h"
+
+struct selection;
+typedef struct selection *selection;
+
+selection selection_create(const char *neuron_spec, const char *variable_spec,
+			   uint system_size, uint grid_width, uint grid_height,
+			   uint element_size, const char **variable_names);
+uint selection_get_neuron_count(selection s);
+const uint *selection_get_neurons(selection s);
+uint selection_get_variable_count(selection s);
+const uint *selection_get_variables(selection s);
+void selection_gather(selection s, const double *values, double *out);
+void selection_destroy(selection *s);
+
+#endif
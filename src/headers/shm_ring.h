@@ -0,0 +1,41 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "deftypes.h"
+
+#define SHM_RING_VERSION 1
+
+struct shm_ring;
+typedef struct shm_ring *shm_ring;
+
+struct shm_reader;
+typedef struct shm_reader *shm_reader;
+
+/* Describes the frames of a ring: the time, then variable_count values per
+ * system in the row-major layout of the dynamical system. */
+struct shm_ring_layout {
+	uint system_size;
+	uint grid_width;
+	uint grid_height;
+	uint variable_count;
+	uint slot_count;
+	double time_step;
+	double print_time;
+};
+
+shm_ring shm_ring_create(const char *name, const struct shm_ring_layout *layout);
+void shm_ring_publish(shm_ring ring, double time, const double *values);
+void shm_ring_destroy(shm_ring *ring);
+
+shm_reader shm_reader_open(const char *name);
+void shm_reader_get_layout(shm_reader reader, struct shm_ring_layout *layout);
+uint64_t shm_reader_get_published(shm_reader reader);
+bool shm_reader_is_closed(shm_reader reader);
+const double *shm_reader_peek(shm_reader reader, uint64_t frame, double *time, uint64_t *sequence);
+bool shm_reader_validate(shm_reader reader, uint64_t frame, uint64_t sequence);
+bool shm_reader_read(shm_reader reader, uint64_t frame, double *time, double *values);
+void shm_reader_close(shm_reader *reader);
+
+#endif
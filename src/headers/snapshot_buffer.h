@@ -0,0 +1,15 @@
+#ifndef SNAPSHOT_BUFFER_H
+#define SNAPSHOT_BUFFER_H
+
+#include <stddef.h>
+
+struct snapshot_buffer;
+typedef struct snapshot_buffer *snapshot_buffer;
+
+snapshot_buffer snapshot_buffer_create(size_t value_count);
+double *snapshot_buffer_begin(snapshot_buffer sb);
+void snapshot_buffer_publish(snapshot_buffer sb, double time);
+const double *snapshot_buffer_take(snapshot_buffer sb, double *time);
+void snapshot_buffer_destroy(snapshot_buffer *sb);
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef SPECTRUM_H
+#define SPECTRUM_H
+
+#include <stdbool.h>
+#include "deftypes.h"
+
+struct spectrum;
+typedef struct spectrum *spectrum;
+
+/* Segments are window_length samples long, which must be a power of two,
+ * and the given fraction of each, in [0, 1), overlaps the next one. */
+struct spectrum_options {
+	uint window_length;
+	double overlap;
+};
+
+spectrum spectrum_create(uint channel_count, double sample_time, const struct spectrum_options *options);
+void spectrum_add(spectrum sp, const double *samples);
+uint spectrum_get_segment_count(spectrum sp);
+uint spectrum_get_bin_count(spectrum sp);
+double spectrum_get_frequency(spectrum sp, uint bin);
+bool spectrum_get_density(spectrum sp, uint channel, double *density);
+bool spectrum_write(spectrum sp, const char *filename, const uint *neurons, uint precision);
+void spectrum_destroy(spectrum *sp);
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef SPIKE_FILE_H
+#define SPIKE_FILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "deftypes.h"
+
+#define SPIKE_FILE_VERSION 1
+#define SPIKE_FILE_BLOCK_SPIKES 65536
+
+struct spike_file;
+typedef struct spike_file *spike_file;
+
+struct spike_reader;
+typedef struct spike_reader *spike_reader;
+
+/* How the time of a spike is stored: as the double itself, or as the index
+ * of the integration step it happened at, counted in time_step. */
+enum spike_time_format {
+	SPIKE_TIME_FLOAT,
+	SPIKE_TIME_STEP
+};
+
+/* Describes what the spikes of a spike file hold. With delta set, the
+ * times within a block are stored as differences from the previous one. */
+struct spike_file_layout {
+	uint system_size;
+	double time_step;
+	enum spike_time_format time_format;
+	bool delta;
+};
+
+spike_file spike_file_create(const char *filename, const struct spike_file_layout *layout,
+			     uint block_spikes);
+bool spike_file_write(spike_file sf, double time, uint neuron);
+bool spike_file_flush(spike_file sf);
+uint64_t spike_file_get_spike_count(spike_file sf);
+bool spike_file_destroy(spike_file *sf);
+
+spike_reader spike_reader_open(const char *filename);
+void spike_reader_get_layout(spike_reader sr, struct spike_file_layout *layout);
+uint spike_reader_next_block(spike_reader sr);
+double spike_reader_get_time(spike_reader sr, uint spike);
+uint spike_reader_get_neuron(spike_reader sr, uint spike);
+void spike_reader_close(spike_reader *sr);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef SPIKE_STATS_H
+#define SPIKE_STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "deftypes.h"
+
+struct spike_stats;
+typedef struct spike_stats *spike_stats;
+
+/* A spike is an upward crossing of threshold by variable 0. Two spikes at
+ * most burst_isi apart belong to the same burst. The histogram of
+ * interspike intervals has bin_count bins of bin_width, the last of which
+ * also counts every longer interval. Times are in milliseconds. */
+struct spike_stats_options {
+	double threshold;
+	double burst_isi;
+	uint bin_count;
+	double bin_width;
+};
+
+/* The statistics of one neuron. Rates are in spikes per second. */
+struct spike_stats_summary {
+	uint64_t spike_count;
+	double rate;
+	uint64_t isi_count;
+	double isi_mean;
+	double isi_sd;
+	double isi_cv;
+	double isi_min;
+	double isi_max;
+	uint64_t burst_count;
+	uint64_t burst_spikes;
+	double burst_mean_spikes;
+};
+
+spike_stats spike_stats_create(uint system_size, uint element_size, double start_time,
+			       const double *values, const struct spike_stats_options *options);
+void spike_stats_add(spike_stats ss, double time, const double *values);
+void spike_stats_get_summary(spike_stats ss, uint neuron, double time, struct spike_stats_summary *summary);
+const uint32_t *spike_stats_get_histogram(spike_stats ss, uint neuron);
+bool spike_stats_write(spike_stats ss, const char *filename, bool append, double time, uint precision);
+void spike_stats_destroy(spike_stats *ss);
+
+#endif
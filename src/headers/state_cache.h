@@ -0,0 +1,16 @@
+#ifndef STATE_CACHE_H
+#define STATE_CACHE_H
+
+#include <stdint.h>
+#include "deftypes.h"
+#include "checkpoint.h"
+
+uint64_t state_cache_key(const struct checkpoint_info *info,
+			 uint system_size, uint grid_width, uint grid_height, double transient_time);
+char *state_cache_filename(const char *cache_dir, uint64_t key);
+checkpoint state_cache_lookup(const char *cache_dir, uint64_t key);
+bool state_cache_restore(const char *cache_dir, uint64_t key, dynamical_system ds);
+bool state_cache_store(const char *cache_dir, uint64_t key,
+		       dynamical_system ds, const struct checkpoint_info *info);
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef STREAM_SINK_H
+#define STREAM_SINK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "deftypes.h"
+
+#define STREAM_SINK_MAGIC 0x464e4e53u /* "SNNF" in little endian */
+
+struct stream_sink;
+typedef struct stream_sink *stream_sink;
+
+/* Every message starts with this header, followed by size bytes. The
+ * sequence number counts every message given to the sink, so that a
+ * consumer sees from a gap that messages were dropped. */
+struct stream_message_header {
+	uint32_t magic;
+	uint32_t type;
+	uint64_t size;
+	uint64_t sequence;
+};
+
+enum stream_message_type {
+	/* a struct stream_layout, sent once before any frame */
+	STREAM_MESSAGE_LAYOUT = 1,
+	/* the time as a double, then the values of the dynamical system in
+	 * their row-major layout, as floats or doubles */
+	STREAM_MESSAGE_FRAME = 2
+};
+
+struct stream_layout {
+	uint32_t system_size;
+	uint32_t grid_width;
+	uint32_t grid_height;
+	uint32_t variable_count;
+	uint32_t value_size;
+	uint32_t reserved;
+	double time_step;
+	double print_time;
+};
+
+struct stream_sink_stats {
+	uint64_t messages_sent;
+	uint64_t messages_dropped;
+	uint64_t bytes_sent;
+};
+
+stream_sink stream_sink_open(const char *target, size_t queue_size);
+stream_sink stream_sink_create(int fd, size_t queue_size);
+bool stream_sink_send(stream_sink ss, uint32_t type, const void *data, size_t size);
+bool stream_sink_send_raw(stream_sink ss, const void *data, size_t size);
+void stream_sink_get_stats(stream_sink ss, struct stream_sink_stats *stats);
+bool stream_sink_close(stream_sink *ss);
+
+#endif
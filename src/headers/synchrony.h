@@ -0,0 +1,35 @@
+#ifndef SYNCHRONY_H
+#define SYNCHRONY_H
+
+#include "deftypes.h"
+#include "dynamical_system.h"
+
+struct synchrony;
+typedef struct synchrony *synchrony;
+
+/* The measures that are kept, combined as flags. */
+enum synchrony_measure {
+	SYNCHRONY_PHASE = 1 << 0,
+	SYNCHRONY_CHI = 1 << 1,
+	SYNCHRONY_CORRELATION = 1 << 2
+};
+
+/* The measures over one window. Local measures are taken over each neuron
+ * and its neighbours in the coupling graph, then averaged over the
+ * neurons. Measures that are not kept, or are undefined for the window,
+ * are NAN. */
+struct synchrony_sample {
+	double phase_global;
+	double phase_local;
+	double chi_global;
+	double chi_local;
+	double correlation;
+};
+
+synchrony synchrony_create(dynamical_system ds, uint measures);
+void synchrony_add(synchrony sy, double time, const double *values);
+void synchrony_take(synchrony sy, struct synchrony_sample *sample);
+uint synchrony_get_edge_count(synchrony sy);
+void synchrony_destroy(synchrony *sy);
+
+#endif
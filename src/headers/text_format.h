@@ -0,0 +1,31 @@
+#ifndef TEXT_FORMAT_H
+#define TEXT_FORMAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "deftypes.h"
+
+/* The largest precision text_format_exponent formats without falling back
+ * to snprintf, and the number of bytes any single formatted number needs. */
+#define TEXT_FORMAT_MAX_PRECISION 17
+#define TEXT_FORMAT_NUMBER_SIZE 352
+
+struct text_buffer;
+typedef struct text_buffer *text_buffer;
+
+size_t text_format_exponent(char *out, double value, uint precision);
+size_t text_format_fixed(char *out, double value, uint precision);
+size_t text_format_uint(char *out, uint64_t value);
+
+text_buffer text_buffer_create(size_t capacity);
+void text_buffer_exponent(text_buffer tb, double value, uint precision);
+void text_buffer_fixed(text_buffer tb, double value, uint precision);
+void text_buffer_uint(text_buffer tb, uint64_t value);
+void text_buffer_string(text_buffer tb, const char *string);
+void text_buffer_char(text_buffer tb, char c);
+const char *text_buffer_get_data(text_buffer tb);
+size_t text_buffer_get_size(text_buffer tb);
+void text_buffer_clear(text_buffer tb);
+void text_buffer_destroy(text_buffer *tb);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef TRACE_FILE_H
+#define TRACE_FILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "deftypes.h"
+#include "frame_file.h"
+
+#define TRACE_FILE_VERSION 1
+/* the default amount of memory used to buffer frames before transposing */
+#define TRACE_FILE_MEMORY_BUDGET (64 << 20)
+
+struct trace_file;
+typedef struct trace_file *trace_file;
+
+struct trace_reader;
+typedef struct trace_reader *trace_reader;
+
+trace_file trace_file_create(const char *filename, const struct frame_file_layout *layout,
+			     uint64_t frame_capacity, size_t memory_budget);
+bool trace_file_write(trace_file tf, double time, const void *columns);
+uint64_t trace_file_get_frame_count(trace_file tf);
+bool trace_file_destroy(trace_file *tf);
+bool trace_file_transpose(const char *frame_filename, const char *trace_filename, size_t memory_budget);
+
+trace_reader trace_reader_open(const char *filename);
+void trace_reader_get_layout(trace_reader tr, struct frame_file_layout *layout);
+uint64_t trace_reader_get_frame_count(trace_reader tr);
+const double *trace_reader_get_times(trace_reader tr);
+const void *trace_reader_get_trace(trace_reader tr, uint system, uint variable);
+void trace_reader_close(trace_reader *tr);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef WAVEFRONT_H
+#define WAVEFRONT_H
+
+#include "deftypes.h"
+
+struct wavefront;
+typedef struct wavefront *wavefront;
+
+/* A cell activates on an upward crossing of threshold by variable 0. A
+ * phase singularity is matched to one of the previous window if it has the
+ * same charge and is at most track_radius cells away. */
+struct wavefront_options {
+	double threshold;
+	double track_radius;
+};
+
+/* The activation front over one window: the cells that activated during
+ * it, their centroid in grid coordinates, and the mean conduction speed
+ * over them in cells per millisecond. The singularities are those at the
+ * end of the window, born and died counting against the previous one.
+ * Undefined values are NAN. */
+struct wavefront_sample {
+	uint activated;
+	double centroid_x;
+	double centroid_y;
+	double speed;
+	uint singularity_count;
+	uint born;
+	uint died;
+};
+
+/* A phase singularity at (x, y), the centre of a square of four
+ * neighbouring cells. charge is the winding number of the phase around
+ * that square, and birth the end of the window in which it was first
+ * seen. */
+struct wavefront_singularity {
+	uint id;
+	int charge;
+	double x;
+	double y;
+	double birth;
+};
+
+wavefront wavefront_create(uint grid_width, uint grid_height, uint element_size, double start_time,
+			   const double *values, const struct wavefront_options *options);
+void wavefront_add(wavefront wf, double time, const double *values);
+void wavefront_take(wavefront wf, struct wavefront_sample *sample);
+const struct wavefront_singularity *wavefront_get_singularities(wavefront wf, uint *count);
+const double *wavefront_get_activation_map(wavefront wf);
+void wavefront_destroy(wavefront *wf);
+
+#endif
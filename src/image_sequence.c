@@ -0,0 +1,732 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include "headers/image_sequence.h"
+
+#include "tests/headers/test_utils.h"
+
+/* Renders frames of palette indices, one per cell of the grid, into a
+ * numbered sequence of PPM or PNG images, or into the frames of a single
+ * animated GIF, without any window or display.
+ *
+ * Frames go through a ring of slots. The integration fills the next free
+ * slot, and a pool of threads encodes the filled slots, each into its own
+ * preallocated buffer, several frames at a time. A frame is only written
+ * once every frame before it has been, by whichever thread is free to, so
+ * that the files come out in order however the encoding is spread.
+ *
+ * Nothing beyond the C library is needed to encode. PNG images are indexed
+ * and compressed with fixed Huffman codes and runs only, rows that repeat
+ * the one above going through the "up" filter, which suits heat maps made
+ * of flat squares. GIF frames share the palette of the file and are
+ * compressed with LZW as giflib does it.
+ */
+struct slot {
+	bool encoded;
+	uint8_t *indices;
+	uint8_t *row;
+	uint8_t *work;
+	uint32_t *dictionary;
+	uint8_t *bytes;
+	size_t length;
+};
+
+struct image_sequence {
+	enum image_format format;
+	char *prefix;
+	char *filename;
+	size_t filename_size;
+	uint width;
+	uint height;
+	uint scale;
+	uint image_width;
+	uint image_height;
+	uint frame_delay;
+	struct color_map_rgb palette[COLOR_MAP_PALETTE_SIZE];
+	uint32_t crc_table[256];
+	FILE *gif;
+	pthread_mutex_t lock;
+	pthread_cond_t work_available;
+	pthread_cond_t slot_freed;
+	pthread_t *threads;
+	uint thread_count;
+	struct slot *slots;
+	uint slot_count;
+	uint64_t submitted;
+	uint64_t next_encode;
+	uint64_t written;
+	bool writing;
+	bool done;
+	bool failed;
+};
+
+/* The dictionary of the LZW encoder is an open addressed hash table from a
+ * code followed by a byte to the code of that string, packed as
+ * (prefix << 8 | byte) + 1 in the upper 20 bits of an entry and the code
+ * in the lower 12, with 0 for an empty entry. */
+#define LZW_TABLE_BITS 13
+#define LZW_TABLE_SIZE (1u << LZW_TABLE_BITS)
+#define LZW_MAX_CODE 4095
+
+struct bit_writer {
+	uint8_t *bytes;
+	size_t length;
+	uint64_t bits;
+	uint count;
+};
+
+/* Appends the lowest count bits of value, least significant first, as
+ * both deflate and GIF pack them. */
+static void put_bits(struct bit_writer *bw, uint32_t value, uint count)
+{
+	bw->bits |= (uint64_t)value << bw->count;
+	bw->count += count;
+	while (bw->count >= 8) {
+		bw->bytes[bw->length++] = (uint8_t)bw->bits;
+		bw->bits >>= 8;
+		bw->count -= 8;
+	}
+}
+
+static void flush_bits(struct bit_writer *bw)
+{
+	if (bw->count) {
+		bw->bytes[bw->length++] = (uint8_t)bw->bits;
+	}
+	bw->bits = 0;
+	bw->count = 0;
+}
+
+static void put_byte(struct slot *slot, uint8_t value)
+{
+	slot->bytes[slot->length++] = value;
+}
+
+static void put_bytes(struct slot *slot, const void *data, size_t size)
+{
+	memcpy(slot->bytes + slot->length, data, size);
+	slot->length += size;
+}
+
+static void put_u16_le(struct slot *slot, uint value)
+{
+	put_byte(slot, value & 0xff);
+	put_byte(slot, (value >> 8) & 0xff);
+}
+
+static void put_u32_be(struct slot *slot, uint32_t value)
+{
+	put_byte(slot, value >> 24);
+	put_byte(slot, (value >> 16) & 0xff);
+	put_byte(slot, (value >> 8) & 0xff);
+	put_byte(slot, value & 0xff);
+}
+
+/* Spreads one row of cells over a row of pixels. */
+static void expand_row(image_sequence is, const uint8_t *indices, uint y, uint8_t *row)
+{
+	const uint8_t *cells = indices + (size_t)(y / is->scale) * is->width;
+	for (uint x = 0; x < is->width; x++) {
+		memset(row + (size_t)x * is->scale, cells[x], is->scale);
+	}
+}
+
+static void encode_ppm(image_sequence is, struct slot *slot)
+{
+	slot->length = sprintf((char *)slot->bytes, "P6\n%u %u\n255\n", is->image_width, is->image_height);
+	for (uint y = 0; y < is->image_height; y++) {
+		expand_row(is, slot->indices, y, slot->row);
+		for (uint x = 0; x < is->image_width; x++) {
+			const struct color_map_rgb *color = &is->palette[slot->row[x]];
+			put_byte(slot, color->r);
+			put_byte(slot, color->g);
+			put_byte(slot, color->b);
+		}
+	}
+}
+
+static uint32_t crc(image_sequence is, const uint8_t *data, size_t size)
+{
+	uint32_t result = 0xffffffff;
+	for (size_t i = 0; i < size; i++) {
+		result = is->crc_table[(result ^ data[i]) & 0xff] ^ (result >> 8);
+	}
+	return result ^ 0xffffffff;
+}
+
+static uint32_t adler(const uint8_t *data, size_t size)
+{
+	uint32_t a = 1, b = 0;
+	while (size) {
+		/* the largest block whose sums cannot overflow */
+		size_t block = size < 5552 ? size : 5552;
+		size -= block;
+		while (block--) {
+			a += *data++;
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+	}
+	return b << 16 | a;
+}
+
+/* Huffman codes go most significant bit first. */
+static void put_code(struct bit_writer *bw, uint32_t code, uint length)
+{
+	uint32_t reversed = 0;
+	for (uint i = 0; i < length; i++) {
+		reversed |= ((code >> i) & 1) << (length - 1 - i);
+	}
+	put_bits(bw, reversed, length);
+}
+
+/* The fixed literal/length code of deflate. */
+static void put_symbol(struct bit_writer *bw, uint symbol)
+{
+	if (symbol < 144) {
+		put_code(bw, 0x30 + symbol, 8);
+	}
+	else if (symbol < 256) {
+		put_code(bw, 0x190 + symbol - 144, 9);
+	}
+	else if (symbol < 280) {
+		put_code(bw, symbol - 256, 7);
+	}
+	else {
+		put_code(bw, 0xc0 + symbol - 280, 8);
+	}
+}
+
+static const uint16_t length_bases[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t length_extra_bits[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+/* A single fixed Huffman block in which every match is a run of the byte
+ * before it, at a distance of 1. */
+static void deflate(struct bit_writer *bw, const uint8_t *data, size_t size)
+{
+	put_bits(bw, 1, 1);
+	put_bits(bw, 1, 2);
+
+	size_t i = 0;
+	while (i < size) {
+		size_t run = 0;
+		if (i > 0) {
+			while (run < 258 && i + run < size && data[i + run] == data[i - 1]) {
+				run++;
+			}
+		}
+		if (run < 3) {
+			put_symbol(bw, data[i++]);
+			continue;
+		}
+
+		uint code = 28;
+		while (length_bases[code] > run) {
+			code--;
+		}
+		put_symbol(bw, 257 + code);
+		put_bits(bw, run - length_bases[code], length_extra_bits[code]);
+		/* distance code 0 */
+		put_bits(bw, 0, 5);
+		i += run;
+	}
+
+	put_symbol(bw, 256);
+	flush_bits(bw);
+}
+
+static void begin_chunk(struct slot *slot, uint32_t length, const char *type)
+{
+	put_u32_be(slot, length);
+	put_bytes(slot, type, 4);
+}
+
+/* Closes the chunk whose type starts at start, filling in its length if
+ * it was not known in advance. */
+static void end_chunk(image_sequence is, struct slot *slot, size_t start)
+{
+	uint32_t length = slot->length - start - 4;
+	uint8_t *header = slot->bytes + start - 4;
+	header[0] = length >> 24;
+	header[1] = (length >> 16) & 0xff;
+	header[2] = (length >> 8) & 0xff;
+	header[3] = length & 0xff;
+	put_u32_be(slot, crc(is, slot->bytes + start, slot->length - start));
+}
+
+static void encode_png(image_sequence is, struct slot *slot)
+{
+	static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	slot->length = 0;
+	put_bytes(slot, signature, sizeof signature);
+
+	begin_chunk(slot, 13, "IHDR");
+	size_t start = slot->length - 4;
+	put_u32_be(slot, is->image_width);
+	put_u32_be(slot, is->image_height);
+	/* 8 bit palette indices, no interlacing */
+	put_bytes(slot, (uint8_t[]){ 8, 3, 0, 0, 0 }, 5);
+	end_chunk(is, slot, start);
+
+	begin_chunk(slot, 3 * COLOR_MAP_PALETTE_SIZE, "PLTE");
+	start = slot->length - 4;
+	for (uint i = 0; i < COLOR_MAP_PALETTE_SIZE; i++) {
+		put_bytes(slot, (uint8_t[]){ is->palette[i].r, is->palette[i].g, is->palette[i].b }, 3);
+	}
+	end_chunk(is, slot, start);
+
+	size_t line_size = (size_t)is->image_width + 1;
+	for (uint y = 0; y < is->image_height; y++) {
+		uint8_t *line = slot->work + y * line_size;
+		if (y % is->scale) {
+			/* the same cells as the row above */
+			memset(line, 0, line_size);
+			line[0] = 2;
+		}
+		else {
+			line[0] = 0;
+			expand_row(is, slot->indices, y, line + 1);
+		}
+	}
+	size_t size = line_size * is->image_height;
+
+	begin_chunk(slot, 0, "IDAT");
+	start = slot->length - 4;
+	/* a zlib stream: deflate with a 32K window, no preset dictionary */
+	put_byte(slot, 0x78);
+	put_byte(slot, 0x01);
+	struct bit_writer bw = { .bytes = slot->bytes, .length = slot->length };
+	deflate(&bw, slot->work, size);
+	slot->length = bw.length;
+	put_u32_be(slot, adler(slot->work, size));
+	end_chunk(is, slot, start);
+
+	begin_chunk(slot, 0, "IEND");
+	end_chunk(is, slot, slot->length - 4);
+}
+
+static uint32_t *lzw_find(uint32_t *dictionary, uint32_t key)
+{
+	uint32_t position = (key * 2654435761u) >> (32 - LZW_TABLE_BITS);
+	while (dictionary[position] && dictionary[position] >> 12 != key) {
+		position = (position + 1) & (LZW_TABLE_SIZE - 1);
+	}
+	return &dictionary[position];
+}
+
+/* Writes the code, and widens the codes once the next one to be added to
+ * the dictionary no longer fits in them. */
+static void lzw_output(struct bit_writer *bw, uint code, uint next_code, uint *code_size)
+{
+	put_bits(bw, code, *code_size);
+	if (next_code >= 1u << *code_size && *code_size < 12) {
+		(*code_size)++;
+	}
+}
+
+static size_t lzw(image_sequence is, struct slot *slot)
+{
+	const uint clear_code = 256, end_code = 257;
+	struct bit_writer bw = { .bytes = slot->work };
+	uint next_code = end_code + 1, code_size = 9;
+
+	memset(slot->dictionary, 0, (sizeof *slot->dictionary) * LZW_TABLE_SIZE);
+	lzw_output(&bw, clear_code, next_code, &code_size);
+
+	int current = -1;
+	for (uint y = 0; y < is->image_height; y++) {
+		expand_row(is, slot->indices, y, slot->row);
+		for (uint x = 0; x < is->image_width; x++) {
+			uint pixel = slot->row[x];
+			if (current < 0) {
+				current = pixel;
+				continue;
+			}
+
+			uint32_t key = ((uint32_t)current << 8 | pixel) + 1;
+			uint32_t *entry = lzw_find(slot->dictionary, key);
+			if (*entry) {
+				current = *entry & 0xfff;
+				continue;
+			}
+
+			lzw_output(&bw, current, next_code, &code_size);
+			current = pixel;
+			if (next_code >= LZW_MAX_CODE) {
+				/* the dictionary is full, start over */
+				lzw_output(&bw, clear_code, next_code, &code_size);
+				next_code = end_code + 1;
+				code_size = 9;
+				memset(slot->dictionary, 0, (sizeof *slot->dictionary) * LZW_TABLE_SIZE);
+			}
+			else {
+				*entry = key << 12 | next_code++;
+			}
+		}
+	}
+	lzw_output(&bw, current, next_code, &code_size);
+	lzw_output(&bw, end_code, next_code, &code_size);
+	flush_bits(&bw);
+
+	return bw.length;
+}
+
+static void encode_gif(image_sequence is, struct slot *slot)
+{
+	slot->length = 0;
+	/* graphic control extension: keep the frame, show it for frame_delay */
+	put_bytes(slot, (uint8_t[]){ 0x21, 0xf9, 0x04, 0x04 }, 4);
+	put_u16_le(slot, is->frame_delay);
+	put_bytes(slot, (uint8_t[]){ 0x00, 0x00 }, 2);
+
+	/* image descriptor over the whole screen, with the global palette */
+	put_byte(slot, 0x2c);
+	put_u16_le(slot, 0);
+	put_u16_le(slot, 0);
+	put_u16_le(slot, is->image_width);
+	put_u16_le(slot, is->image_height);
+	put_byte(slot, 0x00);
+
+	put_byte(slot, 8);
+	size_t size = lzw(is, slot);
+	for (size_t offset = 0; offset < size; offset += 255) {
+		size_t block = size - offset < 255 ? size - offset : 255;
+		put_byte(slot, block);
+		put_bytes(slot, slot->work + offset, block);
+	}
+	put_byte(slot, 0x00);
+}
+
+static bool write_frame(image_sequence is, struct slot *slot, uint64_t frame)
+{
+	if (is->gif) {
+		return fwrite(slot->bytes, 1, slot->length, is->gif) == slot->length;
+	}
+
+	/* only ever used by the thread that is writing */
+	snprintf(is->filename, is->filename_size, "%s_%06llu.%s", is->prefix, (unsigned long long)frame,
+		 is->format == IMAGE_FORMAT_PPM ? "ppm" : "png");
+	FILE *fh = fopen(is->filename, "wb");
+	if (!fh) {
+		return false;
+	}
+	bool success = fwrite(slot->bytes, 1, slot->length, fh) == slot->length;
+	return !fclose(fh) && success;
+}
+
+/* Writes the frames that are next in order and encoded, unless another
+ * thread already is. Called with the lock held. */
+static void write_ready(image_sequence is)
+{
+	while (!is->writing && is->written < is->next_encode && is->slots[is->written % is->slot_count].encoded) {
+		struct slot *slot = &is->slots[is->written % is->slot_count];
+		uint64_t frame = is->written;
+		bool skip = is->failed;
+		is->writing = true;
+		pthread_mutex_unlock(&is->lock);
+
+		bool ok = skip || write_frame(is, slot, frame);
+
+		pthread_mutex_lock(&is->lock);
+		if (!ok) {
+			is->failed = true;
+		}
+		is->written++;
+		is->writing = false;
+		pthread_cond_broadcast(&is->slot_freed);
+	}
+}
+
+static void *encoder_main(void *arg)
+{
+	image_sequence is = arg;
+
+	pthread_mutex_lock(&is->lock);
+	for (;;) {
+		while (is->next_encode == is->submitted && !is->done) {
+			pthread_cond_wait(&is->work_available, &is->lock);
+		}
+		if (is->next_encode == is->submitted) {
+			break;
+		}
+
+		struct slot *slot = &is->slots[is->next_encode % is->slot_count];
+		is->next_encode++;
+		bool skip = is->failed;
+		pthread_mutex_unlock(&is->lock);
+
+		if (!skip) {
+			switch (is->format) {
+			case IMAGE_FORMAT_PPM:
+				encode_ppm(is, slot);
+				break;
+			case IMAGE_FORMAT_PNG:
+				encode_png(is, slot);
+				break;
+			case IMAGE_FORMAT_GIF:
+				encode_gif(is, slot);
+				break;
+			}
+		}
+
+		pthread_mutex_lock(&is->lock);
+		slot->encoded = true;
+		write_ready(is);
+	}
+	pthread_mutex_unlock(&is->lock);
+
+	return NULL;
+}
+
+/* The header of the GIF file: the screen, the palette, and a loop forever. */
+static bool write_gif_header(image_sequence is)
+{
+	uint8_t header[13 + 3 * COLOR_MAP_PALETTE_SIZE + 19];
+	uint8_t *p = header;
+	memcpy(p, "GIF89a", 6);
+	p += 6;
+	*p++ = is->image_width & 0xff;
+	*p++ = is->image_width >> 8;
+	*p++ = is->image_height & 0xff;
+	*p++ = is->image_height >> 8;
+	/* a global palette of 256 colors of 8 bits */
+	*p++ = 0xf7;
+	*p++ = 0;
+	*p++ = 0;
+	for (uint i = 0; i < COLOR_MAP_PALETTE_SIZE; i++) {
+		*p++ = is->palette[i].r;
+		*p++ = is->palette[i].g;
+		*p++ = is->palette[i].b;
+	}
+	memcpy(p, "\x21\xff\x0bNETSCAPE2.0\x03\x01\x00\x00\x00", 19);
+
+	return fwrite(header, 1, sizeof header, is->gif) == sizeof header;
+}
+
+static void free_slots(image_sequence is)
+{
+	for (uint i = 0; i < is->slot_count; i++) {
+		free(is->slots[i].indices);
+		free(is->slots[i].row);
+		free(is->slots[i].work);
+		free(is->slots[i].dictionary);
+		free(is->slots[i].bytes);
+	}
+	free(is->slots);
+}
+
+/* Renders frames of width by height cells. PPM and PNG images go into
+ * the files prefix_000000.ppm, prefix_000001.ppm, and so on, and GIF
+ * frames into prefix.gif. palette holds COLOR_MAP_PALETTE_SIZE colors.
+ * Returns NULL if the GIF file cannot be created, if its frames would be
+ * too large for the format, or if the threads cannot be started. */
+image_sequence image_sequence_create(const char *prefix, uint width, uint height,
+				     const struct color_map_rgb *palette,
+				     const struct image_sequence_options *options)
+{
+	assert(prefix);
+	assert(width > 0);
+	assert(height > 0);
+	assert(palette);
+	assert(options);
+	assert(options->scale > 0);
+	assert(options->thread_count > 0);
+
+	uint64_t image_width = (uint64_t)width * options->scale;
+	uint64_t image_height = (uint64_t)height * options->scale;
+	uint64_t limit = options->format == IMAGE_FORMAT_GIF ? 0xffff : 0x7fffffff;
+	if (image_width > limit || image_height > limit || image_width * image_height > 0x7fffffff) {
+		return NULL;
+	}
+
+	image_sequence result = malloc(sizeof *result);
+	result->format = options->format;
+	result->prefix = malloc(strlen(prefix) + 1);
+	strcpy(result->prefix, prefix);
+	result->filename_size = strlen(prefix) + 32;
+	result->filename = malloc(result->filename_size);
+	result->width = width;
+	result->height = height;
+	result->scale = options->scale;
+	result->image_width = image_width;
+	result->image_height = image_height;
+	result->frame_delay = options->frame_delay;
+	memcpy(result->palette, palette, sizeof result->palette);
+	for (uint32_t i = 0; i < 256; i++) {
+		uint32_t c = i;
+		for (uint k = 0; k < 8; k++) {
+			c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+		}
+		result->crc_table[i] = c;
+	}
+	result->gif = NULL;
+	result->submitted = result->next_encode = result->written = 0;
+	result->writing = result->done = result->failed = false;
+
+	if (result->format == IMAGE_FORMAT_GIF) {
+		snprintf(result->filename, result->filename_size, "%s.gif", prefix);
+		result->gif = fopen(result->filename, "wb");
+		if (!result->gif || !write_gif_header(result)) {
+			if (result->gif) {
+				fclose(result->gif);
+			}
+			free(result->filename);
+			free(result->prefix);
+			free(result);
+			return NULL;
+		}
+	}
+
+	/* the worst cases of each encoding, so that the threads never allocate */
+	size_t pixels = image_width * image_height;
+	size_t work_size = 0, byte_count = 0;
+	switch (result->format) {
+	case IMAGE_FORMAT_PPM:
+		byte_count = 3 * pixels + 64;
+		break;
+	case IMAGE_FORMAT_PNG:
+		work_size = pixels + image_height;
+		byte_count = work_size + work_size / 8 + 4 * COLOR_MAP_PALETTE_SIZE + 128;
+		break;
+	case IMAGE_FORMAT_GIF:
+		work_size = 2 * pixels + 64;
+		byte_count = work_size + work_size / 255 + 64;
+		break;
+	}
+
+	/* enough frames in flight to keep every thread busy while one writes */
+	result->slot_count = 2 * options->thread_count + 1;
+	result->slots = malloc((sizeof *result->slots) * result->slot_count);
+	for (uint i = 0; i < result->slot_count; i++) {
+		struct slot *slot = &result->slots[i];
+		slot->encoded = false;
+		slot->indices = malloc((size_t)width * height);
+		slot->row = malloc(image_width);
+		slot->work = work_size ? malloc(work_size) : NULL;
+		slot->dictionary = result->format == IMAGE_FORMAT_GIF
+			? malloc((sizeof *slot->dictionary) * LZW_TABLE_SIZE) : NULL;
+		slot->bytes = malloc(byte_count);
+		slot->length = 0;
+	}
+
+	pthread_mutex_init(&result->lock, NULL);
+	pthread_cond_init(&result->work_available, NULL);
+	pthread_cond_init(&result->slot_freed, NULL);
+
+	result->threads = malloc((sizeof *result->threads) * options->thread_count);
+	result->thread_count = 0;
+	while (result->thread_count < options->thread_count) {
+		if (pthread_create(&result->threads[result->thread_count], NULL, &encoder_main, result)) {
+			break;
+		}
+		result->thread_count++;
+	}
+	if (result->thread_count < options->thread_count) {
+		pthread_mutex_lock(&result->lock);
+		result->done = true;
+		pthread_cond_broadcast(&result->work_available);
+		pthread_mutex_unlock(&result->lock);
+		for (uint i = 0; i < result->thread_count; i++) {
+			pthread_join(result->threads[i], NULL);
+		}
+		pthread_cond_destroy(&result->slot_freed);
+		pthread_cond_destroy(&result->work_available);
+		pthread_mutex_destroy(&result->lock);
+		free(result->threads);
+		free_slots(result);
+		if (result->gif) {
+			fclose(result->gif);
+		}
+		free(result->filename);
+		free(result->prefix);
+		free(result);
+		return NULL;
+	}
+
+	return result;
+}
+
+/* Returns the width * height indices of the next frame to fill, in the
+ * row-major layout of the grid, waiting for the encoders to catch up if
+ * every slot is in use. Must be followed by image_sequence_submit. Returns
+ * NULL once a frame has failed to be written. */
+uint8_t *image_sequence_acquire(image_sequence is)
+{
+	assert(is);
+
+	pthread_mutex_lock(&is->lock);
+	while (is->submitted - is->written == is->slot_count) {
+		pthread_cond_wait(&is->slot_freed, &is->lock);
+	}
+	uint8_t *indices = is->failed ? NULL : is->slots[is->submitted % is->slot_count].indices;
+	pthread_mutex_unlock(&is->lock);
+
+	return indices;
+}
+
+void image_sequence_submit(image_sequence is)
+{
+	assert(is);
+
+	pthread_mutex_lock(&is->lock);
+	is->slots[is->submitted % is->slot_count].encoded = false;
+	is->submitted++;
+	pthread_cond_signal(&is->work_available);
+	pthread_mutex_unlock(&is->lock);
+}
+
+/* Returns the number of frames written so far. */
+uint64_t image_sequence_get_frame_count(image_sequence is)
+{
+	assert(is);
+
+	pthread_mutex_lock(&is->lock);
+	uint64_t result = is->failed ? 0 : is->written;
+	pthread_mutex_unlock(&is->lock);
+
+	return result;
+}
+
+/* Writes out every submitted frame, and ends the GIF file, before stopping
+ * the threads. Returns false if any frame could not be written. */
+bool image_sequence_destroy(image_sequence *is)
+{
+	assert(is);
+	assert(*is);
+
+	image_sequence s = *is;
+	pthread_mutex_lock(&s->lock);
+	s->done = true;
+	pthread_cond_broadcast(&s->work_available);
+	pthread_mutex_unlock(&s->lock);
+	for (uint i = 0; i < s->thread_count; i++) {
+		pthread_join(s->threads[i], NULL);
+	}
+
+	bool result = !s->failed;
+	if (s->gif) {
+		result = fputc(0x3b, s->gif) != EOF && result;
+		result = !fclose(s->gif) && result;
+	}
+
+	pthread_cond_destroy(&s->slot_freed);
+	pthread_cond_destroy(&s->work_available);
+	pthread_mutex_destroy(&s->lock);
+	free(s->threads);
+	free_slots(s);
+	free(s->filename);
+	free(s->prefix);
+	free(s);
+	*is = NULL;
+
+	return result;
+}
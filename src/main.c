@@ -6,6 +6,8 @@
 #include <time.h>
 #include <stdbool.h>
 #include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
 #include "headers/deftypes.h"
 #include "headers/timer.h"
 #include "headers/file_table.h"
@@ -13,6 +15,26 @@
 #include "headers/neuron_config.h"
 #include "headers/dynamical_system.h"
 #include "headers/temp_memory.h"
+#include "headers/checkpoint.h"
+#include "headers/state_cache.h"
+#include "headers/frame_file.h"
+#include "headers/compressed_file.h"
+#include "headers/container.h"
+#include "headers/decimator.h"
+#include "headers/text_format.h"
+#include "headers/output_writer.h"
+#include "headers/stream_sink.h"
+#include "headers/shm_ring.h"
+#include "headers/trace_file.h"
+#include "headers/spike_stats.h"
+#include "headers/synchrony.h"
+#include "headers/wavefront.h"
+#include "headers/spectrum.h"
+#include "headers/image_sequence.h"
+#include "headers/color_map.h"
+#include "headers/snapshot_buffer.h"
+#include "headers/spike_file.h"
+#include "headers/selection.h"
 
 /* TODO: Make the file printing for the individual objects depend on
  *       the number of dynamical variables in the model.
@@ -60,7 +82,230 @@
 	"to the simulation time."
 #define output_dir_desc  "The name of the directory to output the files to."
 #define print_neurons_desc "Toggle for printing the neuron data files individually."
+#define record_neurons_desc \
+	"Takes a single additional argument x, a comma separated list of the\n" \
+	"neurons that --print-neurons writes data files for. An item is an\n" \
+	"index I, a range I-J, a grid cell X:Y given by column and row, a\n" \
+	"rectangular grid region X0:Y0-X1:Y1, or * for every neuron. Ranges,\n" \
+	"regions and * may end in /S to take every S-th neuron, row and\n" \
+	"column only. Each data file is named after the index of its neuron.\n" \
+	"Defaults to every neuron."
+#define record_variables_desc \
+	"Takes a single additional argument x, a comma separated list of the\n" \
+	"dynamical variables, by name or index, that --print-neurons writes\n" \
+	"after the time. Defaults to every variable of the model."
 #define print_voltage_matrix_desc  "Toggle for printing the voltage matrix file."
+#define checkpoint_every_desc \
+	"Takes a single additional argument x, where x must be a positive\n" \
+	"real number. A checkpoint of the full simulation state is written\n" \
+	"every time this duration passes, relative to the simulation time."
+#define checkpoint_file_desc \
+	"The file to write checkpoints to. Defaults to checkpoint.bin inside\n" \
+	"the output directory."
+#define restart_desc \
+	"Takes a single additional argument, the path of a checkpoint file.\n" \
+	"The simulation continues from the saved state, using the model,\n" \
+	"callbacks and coupling stored in it. The output directory must not\n" \
+	"hold anything but that checkpoint, since data files are written anew\n" \
+	"from the checkpoint time on."
+#define checkpoint_background_desc \
+	"Toggle for writing checkpoints from a forked copy of the process, so\n" \
+	"that the simulation continues while the checkpoint is written. A\n" \
+	"checkpoint that falls due while the previous one is still being\n" \
+	"written is skipped."
+#define output_format_desc \
+	"One of \"text\", \"binary\", \"compressed\" or \"container\". The binary\n" \
+	"format writes every dynamical variable of every neuron into frames.bin\n" \
+	"in place of the neuron data files and the voltage matrix file. The\n" \
+	"compressed format writes the same frames losslessly compressed into\n" \
+	"frames.nnz. The container format writes them into frames.nnc, in\n" \
+	"chunks per variable with an index by time for direct access to a\n" \
+	"time range. Use neuralnet_convert to turn any of them back into the\n" \
+	"text files."
+#define binary_precision_desc \
+	"Either \"float\" or \"double\". The precision of the values stored in\n" \
+	"the binary, compressed and container output formats."
+#define output_chunk_desc \
+	"Takes a single additional argument x, where x must be a positive\n" \
+	"integer. The compressed and container output formats write samples in\n" \
+	"chunks of x samples; longer chunks compress better and make smaller\n" \
+	"indices, but more samples are lost if the program is interrupted."
+#define output_buffers_desc \
+	"Takes a single additional argument x, where x must be zero or an\n" \
+	"integer of at least two. With x buffers, samples are copied into a\n" \
+	"ring of x buffers and written by a separate thread, so that the\n" \
+	"integration does not wait on formatting and the disk unless all\n" \
+	"buffers are full. With zero, samples are written by the integrating\n" \
+	"thread."
+#define output_io_desc \
+	"One of \"stdio\", \"uring\" or \"thread\". How frames.bin is written.\n" \
+	"With stdio, every frame is written through the C library by the thread\n" \
+	"writing the output. With uring, frames are gathered into aligned 1 MiB\n" \
+	"chunks that are handed to the kernel through io_uring without waiting\n" \
+	"for them; where io_uring is not available, or with thread, the chunks\n" \
+	"are handed to a thread that writes them with pwrite."
+#define output_queue_depth_desc \
+	"Takes a single additional argument x, where x must be an integer of\n" \
+	"at least two. The number of chunks of --output-io uring or thread,\n" \
+	"all of which may be in flight at once."
+#define output_direct_desc \
+	"Toggle for opening frames.bin with O_DIRECT under --output-io uring or\n" \
+	"thread, so that chunks go to the device without passing through the\n" \
+	"page cache. Ignored on file systems that do not support it."
+#define print_envelope_desc \
+	"Toggle for writing envelope.dat, which holds the minimum, maximum,\n" \
+	"mean and last voltage of every neuron over every integration step\n" \
+	"since the previous output, one line per neuron and output. Unlike the\n" \
+	"other data files, it shows every spike however far apart the outputs\n" \
+	"are."
+#define text_precision_desc \
+	"Takes a single additional argument x, where x must be an integer\n" \
+	"from 0 to 17. The number of digits written after the decimal point\n" \
+	"of the values in the text data files, which are written in\n" \
+	"scientific notation."
+#define transient_desc \
+	"Takes a single additional argument x, where x must be a positive\n" \
+	"real number. The system is integrated for x milliseconds before the\n" \
+	"simulation starts, and the clock is then reset to zero."
+#define output_stream_desc \
+	"Takes a single additional argument x. Every output sample is also\n" \
+	"sent to x, which is \"-\" for the standard output, \"unix:PATH\" for a\n" \
+	"Unix domain socket listening at PATH, or the path of a named pipe. The\n" \
+	"program never waits for the reader: samples that do not fit into the\n" \
+	"queue set by --stream-queue-size are dropped."
+#define stream_format_desc \
+	"Either \"text\" or \"binary\". The text format sends the frames of the\n" \
+	"voltage matrix file. The binary format sends messages made of a header\n" \
+	"giving their type, size and sequence number: first the layout of the\n" \
+	"system, then one message per sample with the time and every variable\n" \
+	"of every neuron, in the precision set by --binary-precision."
+#define stream_queue_size_desc \
+	"Takes a single additional argument x, where x must be a positive\n" \
+	"integer. The size in megabytes of the queue of the output stream."
+#define shm_export_desc \
+	"Takes a single additional argument x, a name starting with a slash.\n" \
+	"Every output sample is also published into the POSIX shared memory\n" \
+	"object x, a ring of the most recent samples that other processes can\n" \
+	"read without locks and without ever holding up the simulation. Use\n" \
+	"neuralnet_monitor to watch it."
+#define shm_slots_desc \
+	"Takes a single additional argument x, where x must be an integer\n" \
+	"greater than one. The number of samples kept in the shared memory\n" \
+	"ring of --shm-export."
+#define spike_format_desc \
+	"Either \"text\" or \"aer\". The format of the spikes printed with\n" \
+	"--print-raster-plot. The text format writes lines of time and neuron\n" \
+	"into raster_plot.dat. The aer format writes them as address events\n" \
+	"into spikes.aer, in binary blocks of a time stamp and a 32 bit neuron\n" \
+	"id per spike. Use neuralnet_convert to turn it back into the text file."
+#define spike_time_desc \
+	"Either \"float\" or \"step\". Whether the aer spike format stores\n" \
+	"times as doubles, or as the index of the integration step, from which\n" \
+	"the time is recovered by multiplying with the time step."
+#define spike_delta_desc \
+	"Toggle for storing the times of the aer spike format as differences\n" \
+	"from the previous spike of the block, which shrinks the spikes of a\n" \
+	"sample after the first from twelve bytes to five."
+#define transpose_output_desc \
+	"Toggle for rewriting frames.bin into traces.bin at the end of the\n" \
+	"run, with the whole trace of every variable of every neuron stored\n" \
+	"contiguously, so that reading one neuron is a sequential read instead\n" \
+	"of a scan of the whole frame file. Needs the binary output format."
+#define spike_stats_desc \
+	"Toggle for keeping the spike-train statistics of every neuron during\n" \
+	"the integration: spike count, firing rate, the mean, deviation and\n" \
+	"histogram of the interspike intervals, and bursts. Spikes are found\n" \
+	"at every step, not only at the printed samples, and the statistics\n" \
+	"are written into spike_stats.dat at the end of the run."
+#define spike_stats_every_desc \
+	"Takes a single additional argument x, where x must be a positive\n" \
+	"real number. The spike-train statistics are also written every x\n" \
+	"milliseconds, each time as a new block of spike_stats.dat."
+#define burst_isi_desc \
+	"Takes a single additional argument x, where x must be a positive\n" \
+	"real number. Spikes at most x milliseconds apart are counted as part\n" \
+	"of the same burst by the spike-train statistics."
+#define isi_bins_desc \
+	"Takes a single additional argument x, where x must be a positive\n" \
+	"integer. The number of bins of the interspike interval histograms,\n" \
+	"the last of which also counts every longer interval."
+#define isi_bin_width_desc \
+	"Takes a single additional argument x, where x must be a positive\n" \
+	"real number. The width in milliseconds of the bins of the interspike\n" \
+	"interval histograms."
+#define synchrony_desc \
+	"Takes a single additional argument x, a comma separated list of the\n" \
+	"synchrony measures to keep during the integration, or \"all\" of them:\n" \
+	"\"phase\", the Kuramoto order parameter of phases taken from spike\n" \
+	"times; \"chi\", the deviation of the mean voltage over the mean\n" \
+	"deviation of single voltages; and \"correlation\", the mean correlation\n" \
+	"of the voltages of neurons coupled to each other. Each is written into\n" \
+	"synchrony.dat for the whole network and, but for the correlation,\n" \
+	"averaged over the neighbourhoods of the coupling graph."
+#define synchrony_window_desc \
+	"Takes a single additional argument x, where x must be a positive\n" \
+	"real number. The synchrony measures are taken over windows of x\n" \
+	"milliseconds, and written once per window."
+#define wavefront_desc \
+	"Toggle for following the activation waves over the grid during the\n" \
+	"integration, in place of dumping whole voltage matrices. For every\n" \
+	"window, the cells that activated, their centroid and the mean\n" \
+	"conduction speed of the front are written into wavefront.dat, and\n" \
+	"the phase singularities, the cores of spiral waves, are tracked and\n" \
+	"written into singularities.dat."
+#define wavefront_window_desc \
+	"Takes a single additional argument x, where x must be a positive\n" \
+	"real number. The activation fronts are summarized over windows of x\n" \
+	"milliseconds, and the phase singularities found at the end of each."
+#define activation_map_every_desc \
+	"Takes a single additional argument x, where x must be a positive\n" \
+	"real number. The map of the last activation time of every cell of the\n" \
+	"grid is also written into activation_map.dat every x milliseconds."
+#define spectrum_desc \
+	"Takes a single additional argument x, either \"mean\" or a list of\n" \
+	"neurons as for --record-neurons. The power spectral density of the\n" \
+	"mean voltage of the network, or of the voltage of every listed neuron,\n" \
+	"is estimated with Welch's method from every step of the integration,\n" \
+	"and written into spectrum.dat at the end of the run."
+#define spectrum_window_desc \
+	"Takes a single additional argument x, where x must be a power of two\n" \
+	"of at least 4. The number of integration steps in each segment of the\n" \
+	"power spectral density, which sets its resolution to the inverse of x\n" \
+	"times the time step."
+#define spectrum_overlap_desc \
+	"Takes a single additional argument x, where x must be a real number\n" \
+	"in [0.0, 1.0). The fraction of each segment of the power spectral\n" \
+	"density that overlaps the next one."
+#define render_desc \
+	"Either \"ppm\", \"png\" or \"gif\". The voltages of the grid are\n" \
+	"also rendered as heat maps, with the colors of the visualization set\n" \
+	"by --visualize-matrix-range and --visualize-color-range, and without\n" \
+	"any window or display. Each frame goes into its own image\n" \
+	"heat_map_000000.ppm or .png, and so on, or all of them into the\n" \
+	"animated heat_map.gif, shown at 25 frames per second."
+#define render_every_desc \
+	"Takes a single additional argument x, where x must be a positive\n" \
+	"real number. A heat map is rendered every x milliseconds."
+#define render_scale_desc \
+	"Takes a single additional argument x, where x must be a positive\n" \
+	"integer. Every cell of the grid is rendered as a square of x by x\n" \
+	"pixels."
+#define render_threads_desc \
+	"Takes a single additional argument x, where x must be a positive\n" \
+	"integer. The number of threads encoding the rendered images while\n" \
+	"the simulation goes on."
+#define free_run_desc \
+	"Toggle for starting the visualization with the simulation running on\n" \
+	"its own, rather than advancing on the right arrow key only. The space\n" \
+	"key pauses and resumes it."
+#define sim_speed_desc \
+	"Takes a single additional argument x, where x must be a non-negative\n" \
+	"real number. The simulated milliseconds per second of the running\n" \
+	"visualization, or 0 to simulate as fast as possible."
+#define state_cache_desc \
+	"The directory used to cache the settled states left after the\n" \
+	"transient. A run whose configuration matches a cached state starts\n" \
+	"from it directly instead of integrating through the transient again."
 
 struct data_entry {
 	const char *name, *desc;
@@ -161,6 +406,28 @@ bool is_entry_empty(const struct data_entry *e)
 #define for_entries(entry, entries) \
 	for (const struct data_entry *entry = entries; !is_entry_empty(entry); entry++)
 
+const char *entry_name(const struct data_entry *entries, const void *data)
+{
+	for_entries(entry, entries) {
+		if (entry->data == data) {
+			return entry->name;
+		}
+	}
+
+	return NULL;
+}
+
+void *entry_data(const struct data_entry *entries, const char *name)
+{
+	for_entries(entry, entries) {
+		if (!strcmp(entry->name, name)) {
+			return entry->data;
+		}
+	}
+
+	return NULL;
+}
+
 struct run_state {
 	enum RunStateType {
 		RUN_STATE_VISUALIZE,
@@ -184,14 +451,60 @@ struct run_state {
 		uint (*coupling_callback)(dynamical_system, uint);
 		void (*initial_values_callback)(uint, uint, double *);
 		struct dynamical_model *model;
+		const char *restart_file;
+		double transient_time;
+		const char *state_cache_dir;
 	} simopts;
 	struct print_options {
 		double final_time;
 		double print_time;
 		const char *output_dir;
 		bool print_neurons;
+		const char *record_neurons;
+		const char *record_variables;
 		bool print_voltage_matrix;
 		bool print_raster_plot;
+		bool print_envelope;
+		double checkpoint_every;
+		const char *checkpoint_file;
+		bool checkpoint_background;
+		enum OutputFormat {
+			OUTPUT_FORMAT_TEXT,
+			OUTPUT_FORMAT_BINARY,
+			OUTPUT_FORMAT_COMPRESSED,
+			OUTPUT_FORMAT_CONTAINER
+		} output_format;
+		uint binary_value_size;
+		uint output_chunk;
+		uint output_buffers;
+		bool output_bulk;
+		enum bulk_writer_backend output_backend;
+		uint output_queue_depth;
+		bool output_direct;
+		uint text_precision;
+		const char *output_stream;
+		bool stream_binary;
+		uint stream_queue_size;
+		const char *shm_export;
+		uint shm_slots;
+		bool spike_aer;
+		enum spike_time_format spike_time_format;
+		bool spike_delta;
+		bool transpose_output;
+		bool spike_stats;
+		double spike_stats_every;
+		struct spike_stats_options spike_stats_options;
+		uint synchrony_measures;
+		double synchrony_window;
+		bool wavefront;
+		double wavefront_window;
+		double activation_map_every;
+		struct wavefront_options wavefront_options;
+		const char *spectrum;
+		struct spectrum_options spectrum_options;
+		bool render;
+		double render_every;
+		struct image_sequence_options render_options;
 	} popts;
 	struct visual_options {
 		uint screen_width;
@@ -202,6 +515,8 @@ struct run_state {
 		struct color {
 			uint r, g, b;
 		} high_color, low_color;
+		bool free_run;
+		double sim_speed;
 	} vopts;
 };
 
@@ -608,6 +923,46 @@ bool parse_fontpath(const char ***args, struct run_state *rs)
 	return true;
 }
 
+bool parse_free_run(const char ***args, struct run_state *rs)
+{
+	/* parse one boolean value */
+	const char *free_run_str = (*args)[1];
+	if (!free_run_str) {
+		return false;
+	}
+
+	if (!strcmp(free_run_str, "true")) {
+		rs->vopts.free_run = true;
+	}
+	else if (!strcmp(free_run_str, "false")) {
+		rs->vopts.free_run = false;
+	}
+	else {
+		return false;
+	}
+
+	*args += 2;
+	return true;
+}
+
+bool parse_sim_speed(const char ***args, struct run_state *rs)
+{
+	/* parse one non-negative real number */
+	const char *sim_speed_str = (*args)[1];
+	if (!sim_speed_str) {
+		return false;
+	}
+	char *end;
+	double sim_speed = strtod(sim_speed_str, &end);
+	if (*end != '\0' || sim_speed < 0.0) {
+		return false;
+	}
+
+	rs->vopts.sim_speed = sim_speed;
+	*args += 2;
+	return true;
+}
+
 bool parse_final_time(const char ***args, struct run_state *rs)
 {
 	/* parse one positive real number */
@@ -733,195 +1088,1313 @@ bool parse_print_raster_plot(const char ***args, struct run_state *rs) {
 	return true;
 }
 
-struct command_line_option {
-	const char *option;
-	const char *desc;
-	bool (*parser)(const char ***args, struct run_state *rs);
-};
+bool parse_print_envelope(const char ***args, struct run_state *rs)
+{
+	/* parse one boolean */
+	const char *print_envelope_str = (*args)[1];
+	if (!print_envelope_str) {
+		return false;
+	}
 
-bool is_option_empty(const struct command_line_option *e) {
-	return e->option == (void *)0 && e->desc == (void *)0 && e->parser == (void *)0;
+	bool print_envelope;
+	if (!strcmp(print_envelope_str, "true")) {
+		print_envelope = true;
+	}
+	else if (!strcmp(print_envelope_str, "false")) {
+		print_envelope = false;
+	}
+	else {
+		return false;
+	}
+
+	rs->popts.print_envelope = print_envelope;
+	*args += 2;
+	return true;
 }
 
-#define for_options(option, options) \
-	for(const struct command_line_option *option = options; !is_option_empty(option); option++)
+bool parse_checkpoint_every(const char ***args, struct run_state *rs)
+{
+	/* parse one positive real number */
+	const char *checkpoint_every_str = (*args)[1];
+	if (!checkpoint_every_str) {
+		return false;
+	}
+	char *end;
+	double checkpoint_every = strtod(checkpoint_every_str, &end);
+	if (*end != '\0') {
+		return false;
+	}
 
-const struct command_line_option command_line_options[] = {
-	(struct command_line_option) {
-		.option = "-h",
-		.parser = &parse_help,
-		.desc = help_desc
-	},
-	(struct command_line_option) {
-		.option = "--help",
-		.parser = &parse_help,
-		.desc = help_desc
-	},
-	(struct command_line_option) {
-		.option = "-v",
-		.parser = &parse_version,
-		.desc = version_desc
-	},
-	(struct command_line_option) {
-		.option = "--version",
-		.parser = &parse_version,
-		.desc = version_desc
-	},
-	(struct command_line_option) {
-		.option = "--visualize",
-		.parser = &parse_visualize,
-		.desc = visualize_desc
-	},
-	(struct command_line_option) {
-		.option = "--output-data",
-		.parser = &parse_output_data,
-		.desc = output_data_desc
-	},
-	(struct command_line_option) {
-		.option = "--random-coupling",
-		.parser = &parse_random_coupling,
-		.desc = random_coupling_desc
-	},
-	(struct command_line_option) {
-		.option = "--coupling-constant",
-		.parser = &parse_coupling_constant,
-		.desc = coupling_constant_desc
-	},
-	(struct command_line_option) {
-		.option = "--neuron-count",
-		.parser = &parse_neuron_count,
-		.desc = neuron_count_desc
-	},
-	(struct command_line_option) {
-		.option = "--grid-width",
-		.parser = &parse_grid_width,
-		.desc = "TODO: Add description."
-	},
-	(struct command_line_option) {
-		.option = "--grid-height",
-		.parser = &parse_grid_height,
-		.desc = "TODO: Add description."
-	},	
-	(struct command_line_option) {
-		.option = "--time-step",
-		.parser = &parse_time_step,
-		.desc = time_step_desc
-	},
-	(struct command_line_option) {
-		.option = "--parameter-callback",
-		.parser = &parse_parameter_callback,
-		.desc = "TODO: Add description."
-	},
-	(struct command_line_option) {
-		.option = "--coupling-callback",
-		.parser = &parse_coupling_callback,
-		.desc = "TODO: Add description."
-	},
-	(struct command_line_option) {
-		.option = "--initial-values-callback",
-		.parser = &parse_initial_values_callback,
-		.desc = "TODO: Add description."
-	},
-	(struct command_line_option) {
-		.option = "--model",
-		.parser = &parse_model,
-		.desc = "TODO: Add description."
-	},
-	(struct command_line_option) {
-		.option = "--screen-width",
-		.parser = &parse_screen_width,
-		.desc = screen_width_desc
-	},
-	(struct command_line_option) {
-		.option = "--screen-height",
-		.parser = &parse_screen_height,
-		.desc = screen_height_desc
-	},
-	(struct command_line_option) {
-		.option = "--font",
-		.parser = &parse_fontpath,
-		.desc = fontpath_desc
-	},
-	(struct command_line_option) {
-		.option = "--final-time",
-		.parser = &parse_final_time,
-		.desc = final_time_desc
-	},
-	(struct command_line_option) {
-		.option = "--print-time",
-		.parser = &parse_print_time,
-		.desc = print_time_desc
-	},
-	(struct command_line_option) {
-		.option = "--output-dir",
-		.parser = &parse_output_dir,
-		.desc = output_dir_desc
-	},
-	(struct command_line_option) {
-		.option = "--print-neurons",
-		.parser = &parse_print_neurons,
-		.desc = print_neurons_desc
-	},
-	(struct command_line_option) {
-		.option = "--print-voltage-matrix",
-		.parser = &parse_print_voltage_matrix,
-		.desc = print_voltage_matrix_desc
-	},
-	(struct command_line_option) {
-		.option = "--print-raster-plot",
-		.parser = &parse_print_raster_plot,
-		.desc = "TODO: Add description."
-	},
-	(struct command_line_option) {
-		.option = "--visualize-matrix-range",
-		.parser = &parse_visualize_matrix_range,
-		.desc = "TODO: Add description."
-	},
-	(struct command_line_option) {
-		.option = "--visualize-color-range",
-		.parser = &parse_visualize_color_range,
-		.desc = "TODO: Add description."
-	},
-	(struct command_line_option) {0}
-};
+	if (checkpoint_every <= 0.0) {
+		return false;
+	}
 
-static const struct run_state default_run_state = (const struct run_state) {
-	.type = RUN_STATE_ERROR,
-	.simopts.coupling_constant_is_random = false,
-	.simopts.coupling_constant = 0.1,
-	.simopts.random_value_interval.highest = 0.0,
-	.simopts.random_value_interval.lowest = 0.0,
-	.simopts.neuron_count = 225,
-	.simopts.grid_width = 15,
-	.simopts.grid_height = 15,
-	.simopts.time_step = 0.1,
-	.simopts.parameter_callback = &huber_braun_parameter_callback_single_center,
-	.simopts.coupling_callback = &coupling_callback_lattice,
-	.simopts.initial_values_callback = &initial_values_callback_zero,
-	.simopts.model = &huber_braun_model,
-	.popts.final_time = 10000,
-	.popts.print_time = 1,
-	.popts.output_dir = "output",
-	.popts.print_neurons = false,
-	.popts.print_voltage_matrix = true,
-	.popts.print_raster_plot = false,
-	.vopts.screen_width = 800,
-	.vopts.screen_height = 800,
-	.vopts.low_matrix_value = -80.0,
-	.vopts.high_matrix_value = 30.0,
-	.vopts.low_color.r = 122,
-	.vopts.low_color.g = 31,
-	.vopts.low_color.b = 110,
-	.vopts.high_color.r = 184,
-	.vopts.high_color.g = 172,
-	.vopts.high_color.b = 9,
-	.vopts.fontpath = "res/Monoid-Regular-NoCalt.ttf"
-};
+	rs->popts.checkpoint_every = checkpoint_every;
+	*args += 2;
+	return true;
+}
 
-int print_help(void);
-int print_version(void);
+bool parse_checkpoint_file(const char ***args, struct run_state *rs)
+{
+	/* parse one string */
+	const char *checkpoint_file = (*args)[1];
+	if (!checkpoint_file) {
+		return false;
+	}
+
+	rs->popts.checkpoint_file = checkpoint_file;
+	*args += 2;
+	return true;
+}
+
+bool parse_checkpoint_background(const char ***args, struct run_state *rs)
+{
+	/* parse one boolean */
+	const char *checkpoint_background_str = (*args)[1];
+	if (!checkpoint_background_str) {
+		return false;
+	}
+
+	bool checkpoint_background;
+	if (!strcmp(checkpoint_background_str, "true")) {
+		checkpoint_background = true;
+	}
+	else if (!strcmp(checkpoint_background_str, "false")) {
+		checkpoint_background = false;
+	}
+	else {
+		return false;
+	}
+
+	rs->popts.checkpoint_background = checkpoint_background;
+	*args += 2;
+	return true;
+}
+
+bool parse_restart(const char ***args, struct run_state *rs)
+{
+	/* parse one string */
+	const char *restart_file = (*args)[1];
+	if (!restart_file) {
+		return false;
+	}
+
+	rs->simopts.restart_file = restart_file;
+	*args += 2;
+	return true;
+}
+
+bool parse_output_format(const char ***args, struct run_state *rs)
+{
+	/* parse one of "text", "binary", "compressed" or "container" */
+	const char *output_format_str = (*args)[1];
+	if (!output_format_str) {
+		return false;
+	}
+
+	if (!strcmp(output_format_str, "text")) {
+		rs->popts.output_format = OUTPUT_FORMAT_TEXT;
+	}
+	else if (!strcmp(output_format_str, "binary")) {
+		rs->popts.output_format = OUTPUT_FORMAT_BINARY;
+	}
+	else if (!strcmp(output_format_str, "compressed")) {
+		rs->popts.output_format = OUTPUT_FORMAT_COMPRESSED;
+	}
+	else if (!strcmp(output_format_str, "container")) {
+		rs->popts.output_format = OUTPUT_FORMAT_CONTAINER;
+	}
+	else {
+		return false;
+	}
+
+	*args += 2;
+	return true;
+}
+
+bool parse_binary_precision(const char ***args, struct run_state *rs)
+{
+	/* parse one of "float" or "double" */
+	const char *binary_precision_str = (*args)[1];
+	if (!binary_precision_str) {
+		return false;
+	}
+
+	if (!strcmp(binary_precision_str, "float")) {
+		rs->popts.binary_value_size = sizeof (float);
+	}
+	else if (!strcmp(binary_precision_str, "double")) {
+		rs->popts.binary_value_size = sizeof (double);
+	}
+	else {
+		return false;
+	}
+
+	*args += 2;
+	return true;
+}
+
+bool parse_output_chunk(const char ***args, struct run_state *rs)
+{
+	/* parse one positive integer */
+	const char *output_chunk_str = (*args)[1];
+	if (!output_chunk_str) {
+		return false;
+	}
+	char *end;
+	long output_chunk = strtol(output_chunk_str, &end, 10);
+	if (*end != '\0' || output_chunk <= 0 || output_chunk > UINT32_MAX) {
+		return false;
+	}
+
+	rs->popts.output_chunk = (uint)output_chunk;
+	*args += 2;
+	return true;
+}
+
+bool parse_text_precision(const char ***args, struct run_state *rs)
+{
+	/* parse one integer from 0 to TEXT_FORMAT_MAX_PRECISION */
+	const char *text_precision_str = (*args)[1];
+	if (!text_precision_str) {
+		return false;
+	}
+	char *end;
+	long text_precision = strtol(text_precision_str, &end, 10);
+	if (*end != '\0' || text_precision < 0 || text_precision > TEXT_FORMAT_MAX_PRECISION) {
+		return false;
+	}
+
+	rs->popts.text_precision = (uint)text_precision;
+	*args += 2;
+	return true;
+}
+
+bool parse_output_buffers(const char ***args, struct run_state *rs)
+{
+	/* parse one integer that is either zero or at least two */
+	const char *output_buffers_str = (*args)[1];
+	if (!output_buffers_str) {
+		return false;
+	}
+	char *end;
+	long output_buffers = strtol(output_buffers_str, &end, 10);
+	if (*end != '\0') {
+		return false;
+	}
+
+	if (output_buffers < 0 || output_buffers == 1) {
+		return false;
+	}
+
+	rs->popts.output_buffers = (uint)output_buffers;
+	*args += 2;
+	return true;
+}
+
+bool parse_output_io(const char ***args, struct run_state *rs)
+{
+	/* parse one of "stdio", "uring" or "thread" */
+	const char *output_io_str = (*args)[1];
+	if (!output_io_str) {
+		return false;
+	}
+
+	if (!strcmp(output_io_str, "stdio")) {
+		rs->popts.output_bulk = false;
+	}
+	else if (!strcmp(output_io_str, "uring")) {
+		rs->popts.output_bulk = true;
+		rs->popts.output_backend = BULK_WRITER_URING;
+	}
+	else if (!strcmp(output_io_str, "thread")) {
+		rs->popts.output_bulk = true;
+		rs->popts.output_backend = BULK_WRITER_THREAD;
+	}
+	else {
+		return false;
+	}
+
+	*args += 2;
+	return true;
+}
+
+bool parse_output_queue_depth(const char ***args, struct run_state *rs)
+{
+	/* parse one integer of at least two */
+	const char *output_queue_depth_str = (*args)[1];
+	if (!output_queue_depth_str) {
+		return false;
+	}
+	char *end;
+	long output_queue_depth = strtol(output_queue_depth_str, &end, 10);
+	if (*end != '\0' || output_queue_depth < 2 || output_queue_depth > 4096) {
+		return false;
+	}
+
+	rs->popts.output_queue_depth = (uint)output_queue_depth;
+	*args += 2;
+	return true;
+}
+
+bool parse_output_direct(const char ***args, struct run_state *rs)
+{
+	/* parse one boolean value */
+	const char *output_direct_str = (*args)[1];
+	if (!output_direct_str) {
+		return false;
+	}
+
+	if (!strcmp(output_direct_str, "true")) {
+		rs->popts.output_direct = true;
+	}
+	else if (!strcmp(output_direct_str, "false")) {
+		rs->popts.output_direct = false;
+	}
+	else {
+		return false;
+	}
+
+	*args += 2;
+	return true;
+}
+
+bool parse_transient(const char ***args, struct run_state *rs)
+{
+	/* parse one positive real number */
+	const char *transient_str = (*args)[1];
+	if (!transient_str) {
+		return false;
+	}
+	char *end;
+	double transient_time = strtod(transient_str, &end);
+	if (*end != '\0') {
+		return false;
+	}
+
+	if (transient_time < 0.0) {
+		return false;
+	}
+
+	rs->simopts.transient_time = transient_time;
+	*args += 2;
+	return true;
+}
+
+bool parse_state_cache(const char ***args, struct run_state *rs)
+{
+	/* parse one string */
+	const char *state_cache_dir = (*args)[1];
+	if (!state_cache_dir) {
+		return false;
+	}
+
+	rs->simopts.state_cache_dir = state_cache_dir;
+	*args += 2;
+	return true;
+}
+
+bool parse_record_neurons(const char ***args, struct run_state *rs)
+{
+	/* parse one string, checked once the size of the system is known */
+	const char *record_neurons = (*args)[1];
+	if (!record_neurons) {
+		return false;
+	}
+
+	rs->popts.record_neurons = record_neurons;
+	*args += 2;
+	return true;
+}
+
+bool parse_record_variables(const char ***args, struct run_state *rs)
+{
+	/* parse one string, checked once the model is known */
+	const char *record_variables = (*args)[1];
+	if (!record_variables) {
+		return false;
+	}
+
+	rs->popts.record_variables = record_variables;
+	*args += 2;
+	return true;
+}
+
+bool parse_output_stream(const char ***args, struct run_state *rs)
+{
+	/* parse one string */
+	const char *output_stream = (*args)[1];
+	if (!output_stream) {
+		return false;
+	}
+
+	rs->popts.output_stream = output_stream;
+	*args += 2;
+	return true;
+}
+
+bool parse_stream_format(const char ***args, struct run_state *rs)
+{
+	/* parse one of "text" or "binary" */
+	const char *stream_format_str = (*args)[1];
+	if (!stream_format_str) {
+		return false;
+	}
+
+	if (!strcmp(stream_format_str, "text")) {
+		rs->popts.stream_binary = false;
+	}
+	else if (!strcmp(stream_format_str, "binary")) {
+		rs->popts.stream_binary = true;
+	}
+	else {
+		return false;
+	}
+
+	*args += 2;
+	return true;
+}
+
+bool parse_stream_queue_size(const char ***args, struct run_state *rs)
+{
+	/* parse one positive integer */
+	const char *stream_queue_size_str = (*args)[1];
+	if (!stream_queue_size_str) {
+		return false;
+	}
+	char *end;
+	long stream_queue_size = strtol(stream_queue_size_str, &end, 10);
+	if (*end != '\0' || stream_queue_size <= 0 || stream_queue_size > 1 << 20) {
+		return false;
+	}
+
+	rs->popts.stream_queue_size = (uint)stream_queue_size;
+	*args += 2;
+	return true;
+}
+
+bool parse_shm_export(const char ***args, struct run_state *rs)
+{
+	/* parse one string */
+	const char *shm_export = (*args)[1];
+	if (!shm_export || shm_export[0] != '/') {
+		return false;
+	}
+
+	rs->popts.shm_export = shm_export;
+	*args += 2;
+	return true;
+}
+
+bool parse_shm_slots(const char ***args, struct run_state *rs)
+{
+	/* parse one integer greater than one */
+	const char *shm_slots_str = (*args)[1];
+	if (!shm_slots_str) {
+		return false;
+	}
+	char *end;
+	long shm_slots = strtol(shm_slots_str, &end, 10);
+	if (*end != '\0' || shm_slots < 2 || shm_slots > 1 << 20) {
+		return false;
+	}
+
+	rs->popts.shm_slots = (uint)shm_slots;
+	*args += 2;
+	return true;
+}
+
+bool parse_spike_format(const char ***args, struct run_state *rs)
+{
+	/* parse one of "text" or "aer" */
+	const char *spike_format_str = (*args)[1];
+	if (!spike_format_str) {
+		return false;
+	}
+
+	if (!strcmp(spike_format_str, "text")) {
+		rs->popts.spike_aer = false;
+	}
+	else if (!strcmp(spike_format_str, "aer")) {
+		rs->popts.spike_aer = true;
+	}
+	else {
+		return false;
+	}
+
+	*args += 2;
+	return true;
+}
+
+bool parse_spike_time(const char ***args, struct run_state *rs)
+{
+	/* parse one of "float" or "step" */
+	const char *spike_time_str = (*args)[1];
+	if (!spike_time_str) {
+		return false;
+	}
+
+	if (!strcmp(spike_time_str, "float")) {
+		rs->popts.spike_time_format = SPIKE_TIME_FLOAT;
+	}
+	else if (!strcmp(spike_time_str, "step")) {
+		rs->popts.spike_time_format = SPIKE_TIME_STEP;
+	}
+	else {
+		return false;
+	}
+
+	*args += 2;
+	return true;
+}
+
+bool parse_spike_delta(const char ***args, struct run_state *rs)
+{
+	/* parse one boolean value */
+	const char *spike_delta_str = (*args)[1];
+	if (!spike_delta_str) {
+		return false;
+	}
+
+	if (!strcmp(spike_delta_str, "true")) {
+		rs->popts.spike_delta = true;
+	}
+	else if (!strcmp(spike_delta_str, "false")) {
+		rs->popts.spike_delta = false;
+	}
+	else {
+		return false;
+	}
+
+	*args += 2;
+	return true;
+}
+
+bool parse_transpose_output(const char ***args, struct run_state *rs)
+{
+	/* parse one boolean value */
+	const char *transpose_output_str = (*args)[1];
+	if (!transpose_output_str) {
+		return false;
+	}
+
+	if (!strcmp(transpose_output_str, "true")) {
+		rs->popts.transpose_output = true;
+	}
+	else if (!strcmp(transpose_output_str, "false")) {
+		rs->popts.transpose_output = false;
+	}
+	else {
+		return false;
+	}
+
+	*args += 2;
+	return true;
+}
+
+bool parse_spike_stats(const char ***args, struct run_state *rs)
+{
+	/* parse one boolean value */
+	const char *spike_stats_str = (*args)[1];
+	if (!spike_stats_str) {
+		return false;
+	}
+
+	if (!strcmp(spike_stats_str, "true")) {
+		rs->popts.spike_stats = true;
+	}
+	else if (!strcmp(spike_stats_str, "false")) {
+		rs->popts.spike_stats = false;
+	}
+	else {
+		return false;
+	}
+
+	*args += 2;
+	return true;
+}
+
+bool parse_spike_stats_every(const char ***args, struct run_state *rs)
+{
+	/* parse one positive real number */
+	const char *spike_stats_every_str = (*args)[1];
+	if (!spike_stats_every_str) {
+		return false;
+	}
+	char *end;
+	double spike_stats_every = strtod(spike_stats_every_str, &end);
+	if (*end != '\0' || spike_stats_every <= 0.0) {
+		return false;
+	}
+
+	rs->popts.spike_stats_every = spike_stats_every;
+	*args += 2;
+	return true;
+}
+
+bool parse_burst_isi(const char ***args, struct run_state *rs)
+{
+	/* parse one positive real number */
+	const char *burst_isi_str = (*args)[1];
+	if (!burst_isi_str) {
+		return false;
+	}
+	char *end;
+	double burst_isi = strtod(burst_isi_str, &end);
+	if (*end != '\0' || burst_isi <= 0.0) {
+		return false;
+	}
+
+	rs->popts.spike_stats_options.burst_isi = burst_isi;
+	*args += 2;
+	return true;
+}
+
+bool parse_isi_bins(const char ***args, struct run_state *rs)
+{
+	/* parse one positive integer */
+	const char *isi_bins_str = (*args)[1];
+	if (!isi_bins_str) {
+		return false;
+	}
+	char *end;
+	long isi_bins = strtol(isi_bins_str, &end, 10);
+	if (*end != '\0' || isi_bins <= 0 || isi_bins > 1 << 16) {
+		return false;
+	}
+
+	rs->popts.spike_stats_options.bin_count = (uint)isi_bins;
+	*args += 2;
+	return true;
+}
+
+bool parse_isi_bin_width(const char ***args, struct run_state *rs)
+{
+	/* parse one positive real number */
+	const char *isi_bin_width_str = (*args)[1];
+	if (!isi_bin_width_str) {
+		return false;
+	}
+	char *end;
+	double isi_bin_width = strtod(isi_bin_width_str, &end);
+	if (*end != '\0' || isi_bin_width <= 0.0) {
+		return false;
+	}
+
+	rs->popts.spike_stats_options.bin_width = isi_bin_width;
+	*args += 2;
+	return true;
+}
+
+bool parse_synchrony(const char ***args, struct run_state *rs)
+{
+	/* parse a comma separated list of measures */
+	const char *synchrony_str = (*args)[1];
+	if (!synchrony_str) {
+		return false;
+	}
+
+	uint measures = 0;
+	const char *item = synchrony_str;
+	while (true) {
+		size_t length = strcspn(item, ",");
+		if (length == 3 && !strncmp(item, "all", length)) {
+			measures |= SYNCHRONY_PHASE | SYNCHRONY_CHI | SYNCHRONY_CORRELATION;
+		}
+		else if (length == 5 && !strncmp(item, "phase", length)) {
+			measures |= SYNCHRONY_PHASE;
+		}
+		else if (length == 3 && !strncmp(item, "chi", length)) {
+			measures |= SYNCHRONY_CHI;
+		}
+		else if (length == 11 && !strncmp(item, "correlation", length)) {
+			measures |= SYNCHRONY_CORRELATION;
+		}
+		else {
+			return false;
+		}
+		if (item[length] == '\0') {
+			break;
+		}
+		item += length + 1;
+	}
+
+	rs->popts.synchrony_measures = measures;
+	*args += 2;
+	return true;
+}
+
+bool parse_synchrony_window(const char ***args, struct run_state *rs)
+{
+	/* parse one positive real number */
+	const char *synchrony_window_str = (*args)[1];
+	if (!synchrony_window_str) {
+		return false;
+	}
+	char *end;
+	double synchrony_window = strtod(synchrony_window_str, &end);
+	if (*end != '\0' || synchrony_window <= 0.0) {
+		return false;
+	}
+
+	rs->popts.synchrony_window = synchrony_window;
+	*args += 2;
+	return true;
+}
+
+bool parse_wavefront(const char ***args, struct run_state *rs)
+{
+	/* parse one boolean value */
+	const char *wavefront_str = (*args)[1];
+	if (!wavefront_str) {
+		return false;
+	}
+
+	if (!strcmp(wavefront_str, "true")) {
+		rs->popts.wavefront = true;
+	}
+	else if (!strcmp(wavefront_str, "false")) {
+		rs->popts.wavefront = false;
+	}
+	else {
+		return false;
+	}
+
+	*args += 2;
+	return true;
+}
+
+bool parse_wavefront_window(const char ***args, struct run_state *rs)
+{
+	/* parse one positive real number */
+	const char *wavefront_window_str = (*args)[1];
+	if (!wavefront_window_str) {
+		return false;
+	}
+	char *end;
+	double wavefront_window = strtod(wavefront_window_str, &end);
+	if (*end != '\0' || wavefront_window <= 0.0) {
+		return false;
+	}
+
+	rs->popts.wavefront_window = wavefront_window;
+	*args += 2;
+	return true;
+}
+
+bool parse_activation_map_every(const char ***args, struct run_state *rs)
+{
+	/* parse one positive real number */
+	const char *activation_map_every_str = (*args)[1];
+	if (!activation_map_every_str) {
+		return false;
+	}
+	char *end;
+	double activation_map_every = strtod(activation_map_every_str, &end);
+	if (*end != '\0' || activation_map_every <= 0.0) {
+		return false;
+	}
+
+	rs->popts.activation_map_every = activation_map_every;
+	*args += 2;
+	return true;
+}
+
+bool parse_spectrum(const char ***args, struct run_state *rs)
+{
+	/* the neurons are only checked against the system once it exists */
+	const char *spectrum_str = (*args)[1];
+	if (!spectrum_str) {
+		return false;
+	}
+
+	rs->popts.spectrum = spectrum_str;
+	*args += 2;
+	return true;
+}
+
+bool parse_spectrum_window(const char ***args, struct run_state *rs)
+{
+	/* parse one power of two */
+	const char *spectrum_window_str = (*args)[1];
+	if (!spectrum_window_str) {
+		return false;
+	}
+	char *end;
+	long spectrum_window = strtol(spectrum_window_str, &end, 10);
+	if (*end != '\0' || spectrum_window < 4 || spectrum_window > (1L << 24)
+	    || (spectrum_window & (spectrum_window - 1))) {
+		return false;
+	}
+
+	rs->popts.spectrum_options.window_length = (uint)spectrum_window;
+	*args += 2;
+	return true;
+}
+
+bool parse_spectrum_overlap(const char ***args, struct run_state *rs)
+{
+	/* parse one real number in [0.0, 1.0) */
+	const char *spectrum_overlap_str = (*args)[1];
+	if (!spectrum_overlap_str) {
+		return false;
+	}
+	char *end;
+	double spectrum_overlap = strtod(spectrum_overlap_str, &end);
+	if (*end != '\0' || spectrum_overlap < 0.0 || spectrum_overlap >= 1.0) {
+		return false;
+	}
+
+	rs->popts.spectrum_options.overlap = spectrum_overlap;
+	*args += 2;
+	return true;
+}
+
+bool parse_render(const char ***args, struct run_state *rs)
+{
+	/* parse one of "ppm", "png" or "gif" */
+	const char *render_str = (*args)[1];
+	if (!render_str) {
+		return false;
+	}
+
+	if (!strcmp(render_str, "ppm")) {
+		rs->popts.render_options.format = IMAGE_FORMAT_PPM;
+	}
+	else if (!strcmp(render_str, "png")) {
+		rs->popts.render_options.format = IMAGE_FORMAT_PNG;
+	}
+	else if (!strcmp(render_str, "gif")) {
+		rs->popts.render_options.format = IMAGE_FORMAT_GIF;
+	}
+	else {
+		return false;
+	}
+
+	rs->popts.render = true;
+	*args += 2;
+	return true;
+}
+
+bool parse_render_every(const char ***args, struct run_state *rs)
+{
+	/* parse one positive real number */
+	const char *render_every_str = (*args)[1];
+	if (!render_every_str) {
+		return false;
+	}
+	char *end;
+	double render_every = strtod(render_every_str, &end);
+	if (*end != '\0' || render_every <= 0.0) {
+		return false;
+	}
+
+	rs->popts.render_every = render_every;
+	*args += 2;
+	return true;
+}
+
+bool parse_render_scale(const char ***args, struct run_state *rs)
+{
+	/* parse one positive integer */
+	const char *render_scale_str = (*args)[1];
+	if (!render_scale_str) {
+		return false;
+	}
+	char *end;
+	long render_scale = strtol(render_scale_str, &end, 10);
+	if (*end != '\0' || render_scale < 1 || render_scale > 1 << 10) {
+		return false;
+	}
+
+	rs->popts.render_options.scale = (uint)render_scale;
+	*args += 2;
+	return true;
+}
+
+bool parse_render_threads(const char ***args, struct run_state *rs)
+{
+	/* parse one positive integer */
+	const char *render_threads_str = (*args)[1];
+	if (!render_threads_str) {
+		return false;
+	}
+	char *end;
+	long render_threads = strtol(render_threads_str, &end, 10);
+	if (*end != '\0' || render_threads < 1 || render_threads > 256) {
+		return false;
+	}
+
+	rs->popts.render_options.thread_count = (uint)render_threads;
+	*args += 2;
+	return true;
+}
+
+struct command_line_option {
+	const char *option;
+	const char *desc;
+	bool (*parser)(const char ***args, struct run_state *rs);
+};
+
+bool is_option_empty(const struct command_line_option *e) {
+	return e->option == (void *)0 && e->desc == (void *)0 && e->parser == (void *)0;
+}
+
+#define for_options(option, options) \
+	for(const struct command_line_option *option = options; !is_option_empty(option); option++)
+
+const struct command_line_option command_line_options[] = {
+	(struct command_line_option) {
+		.option = "-h",
+		.parser = &parse_help,
+		.desc = help_desc
+	},
+	(struct command_line_option) {
+		.option = "--help",
+		.parser = &parse_help,
+		.desc = help_desc
+	},
+	(struct command_line_option) {
+		.option = "-v",
+		.parser = &parse_version,
+		.desc = version_desc
+	},
+	(struct command_line_option) {
+		.option = "--version",
+		.parser = &parse_version,
+		.desc = version_desc
+	},
+	(struct command_line_option) {
+		.option = "--visualize",
+		.parser = &parse_visualize,
+		.desc = visualize_desc
+	},
+	(struct command_line_option) {
+		.option = "--output-data",
+		.parser = &parse_output_data,
+		.desc = output_data_desc
+	},
+	(struct command_line_option) {
+		.option = "--random-coupling",
+		.parser = &parse_random_coupling,
+		.desc = random_coupling_desc
+	},
+	(struct command_line_option) {
+		.option = "--coupling-constant",
+		.parser = &parse_coupling_constant,
+		.desc = coupling_constant_desc
+	},
+	(struct command_line_option) {
+		.option = "--neuron-count",
+		.parser = &parse_neuron_count,
+		.desc = neuron_count_desc
+	},
+	(struct command_line_option) {
+		.option = "--grid-width",
+		.parser = &parse_grid_width,
+		.desc = "TODO: Add description."
+	},
+	(struct command_line_option) {
+		.option = "--grid-height",
+		.parser = &parse_grid_height,
+		.desc = "TODO: Add description."
+	},	
+	(struct command_line_option) {
+		.option = "--time-step",
+		.parser = &parse_time_step,
+		.desc = time_step_desc
+	},
+	(struct command_line_option) {
+		.option = "--parameter-callback",
+		.parser = &parse_parameter_callback,
+		.desc = "TODO: Add description."
+	},
+	(struct command_line_option) {
+		.option = "--coupling-callback",
+		.parser = &parse_coupling_callback,
+		.desc = "TODO: Add description."
+	},
+	(struct command_line_option) {
+		.option = "--initial-values-callback",
+		.parser = &parse_initial_values_callback,
+		.desc = "TODO: Add description."
+	},
+	(struct command_line_option) {
+		.option = "--model",
+		.parser = &parse_model,
+		.desc = "TODO: Add description."
+	},
+	(struct command_line_option) {
+		.option = "--screen-width",
+		.parser = &parse_screen_width,
+		.desc = screen_width_desc
+	},
+	(struct command_line_option) {
+		.option = "--screen-height",
+		.parser = &parse_screen_height,
+		.desc = screen_height_desc
+	},
+	(struct command_line_option) {
+		.option = "--font",
+		.parser = &parse_fontpath,
+		.desc = fontpath_desc
+	},
+	(struct command_line_option) {
+		.option = "--free-run",
+		.parser = &parse_free_run,
+		.desc = free_run_desc
+	},
+	(struct command_line_option) {
+		.option = "--sim-speed",
+		.parser = &parse_sim_speed,
+		.desc = sim_speed_desc
+	},
+	(struct command_line_option) {
+		.option = "--final-time",
+		.parser = &parse_final_time,
+		.desc = final_time_desc
+	},
+	(struct command_line_option) {
+		.option = "--print-time",
+		.parser = &parse_print_time,
+		.desc = print_time_desc
+	},
+	(struct command_line_option) {
+		.option = "--output-dir",
+		.parser = &parse_output_dir,
+		.desc = output_dir_desc
+	},
+	(struct command_line_option) {
+		.option = "--print-neurons",
+		.parser = &parse_print_neurons,
+		.desc = print_neurons_desc
+	},
+	(struct command_line_option) {
+		.option = "--record-neurons",
+		.parser = &parse_record_neurons,
+		.desc = record_neurons_desc
+	},
+	(struct command_line_option) {
+		.option = "--record-variables",
+		.parser = &parse_record_variables,
+		.desc = record_variables_desc
+	},
+	(struct command_line_option) {
+		.option = "--print-voltage-matrix",
+		.parser = &parse_print_voltage_matrix,
+		.desc = print_voltage_matrix_desc
+	},
+	(struct command_line_option) {
+		.option = "--print-raster-plot",
+		.parser = &parse_print_raster_plot,
+		.desc = "TODO: Add description."
+	},
+	(struct command_line_option) {
+		.option = "--print-envelope",
+		.parser = &parse_print_envelope,
+		.desc = print_envelope_desc
+	},
+	(struct command_line_option) {
+		.option = "--visualize-matrix-range",
+		.parser = &parse_visualize_matrix_range,
+		.desc = "TODO: Add description."
+	},
+	(struct command_line_option) {
+		.option = "--visualize-color-range",
+		.parser = &parse_visualize_color_range,
+		.desc = "TODO: Add description."
+	},
+	(struct command_line_option) {
+		.option = "--checkpoint-every",
+		.parser = &parse_checkpoint_every,
+		.desc = checkpoint_every_desc
+	},
+	(struct command_line_option) {
+		.option = "--checkpoint-file",
+		.parser = &parse_checkpoint_file,
+		.desc = checkpoint_file_desc
+	},
+	(struct command_line_option) {
+		.option = "--checkpoint-background",
+		.parser = &parse_checkpoint_background,
+		.desc = checkpoint_background_desc
+	},
+	(struct command_line_option) {
+		.option = "--restart",
+		.parser = &parse_restart,
+		.desc = restart_desc
+	},
+	(struct command_line_option) {
+		.option = "--output-format",
+		.parser = &parse_output_format,
+		.desc = output_format_desc
+	},
+	(struct command_line_option) {
+		.option = "--binary-precision",
+		.parser = &parse_binary_precision,
+		.desc = binary_precision_desc
+	},
+	(struct command_line_option) {
+		.option = "--output-chunk",
+		.parser = &parse_output_chunk,
+		.desc = output_chunk_desc
+	},
+	(struct command_line_option) {
+		.option = "--text-precision",
+		.parser = &parse_text_precision,
+		.desc = text_precision_desc
+	},
+	(struct command_line_option) {
+		.option = "--output-buffers",
+		.parser = &parse_output_buffers,
+		.desc = output_buffers_desc
+	},
+	(struct command_line_option) {
+		.option = "--output-io",
+		.parser = &parse_output_io,
+		.desc = output_io_desc
+	},
+	(struct command_line_option) {
+		.option = "--output-queue-depth",
+		.parser = &parse_output_queue_depth,
+		.desc = output_queue_depth_desc
+	},
+	(struct command_line_option) {
+		.option = "--output-direct",
+		.parser = &parse_output_direct,
+		.desc = output_direct_desc
+	},
+	(struct command_line_option) {
+		.option = "--transient",
+		.parser = &parse_transient,
+		.desc = transient_desc
+	},
+	(struct command_line_option) {
+		.option = "--state-cache",
+		.parser = &parse_state_cache,
+		.desc = state_cache_desc
+	},
+	(struct command_line_option) {
+		.option = "--output-stream",
+		.parser = &parse_output_stream,
+		.desc = output_stream_desc
+	},
+	(struct command_line_option) {
+		.option = "--stream-format",
+		.parser = &parse_stream_format,
+		.desc = stream_format_desc
+	},
+	(struct command_line_option) {
+		.option = "--stream-queue-size",
+		.parser = &parse_stream_queue_size,
+		.desc = stream_queue_size_desc
+	},
+	(struct command_line_option) {
+		.option = "--shm-export",
+		.parser = &parse_shm_export,
+		.desc = shm_export_desc
+	},
+	(struct command_line_option) {
+		.option = "--shm-slots",
+		.parser = &parse_shm_slots,
+		.desc = shm_slots_desc
+	},
+	(struct command_line_option) {
+		.option = "--spike-format",
+		.parser = &parse_spike_format,
+		.desc = spike_format_desc
+	},
+	(struct command_line_option) {
+		.option = "--spike-time",
+		.parser = &parse_spike_time,
+		.desc = spike_time_desc
+	},
+	(struct command_line_option) {
+		.option = "--spike-delta",
+		.parser = &parse_spike_delta,
+		.desc = spike_delta_desc
+	},
+	(struct command_line_option) {
+		.option = "--transpose-output",
+		.parser = &parse_transpose_output,
+		.desc = transpose_output_desc
+	},
+	(struct command_line_option) {
+		.option = "--spike-stats",
+		.parser = &parse_spike_stats,
+		.desc = spike_stats_desc
+	},
+	(struct command_line_option) {
+		.option = "--spike-stats-every",
+		.parser = &parse_spike_stats_every,
+		.desc = spike_stats_every_desc
+	},
+	(struct command_line_option) {
+		.option = "--burst-isi",
+		.parser = &parse_burst_isi,
+		.desc = burst_isi_desc
+	},
+	(struct command_line_option) {
+		.option = "--isi-bins",
+		.parser = &parse_isi_bins,
+		.desc = isi_bins_desc
+	},
+	(struct command_line_option) {
+		.option = "--isi-bin-width",
+		.parser = &parse_isi_bin_width,
+		.desc = isi_bin_width_desc
+	},
+	(struct command_line_option) {
+		.option = "--synchrony",
+		.parser = &parse_synchrony,
+		.desc = synchrony_desc
+	},
+	(struct command_line_option) {
+		.option = "--synchrony-window",
+		.parser = &parse_synchrony_window,
+		.desc = synchrony_window_desc
+	},
+	(struct command_line_option) {
+		.option = "--wavefront",
+		.parser = &parse_wavefront,
+		.desc = wavefront_desc
+	},
+	(struct command_line_option) {
+		.option = "--wavefront-window",
+		.parser = &parse_wavefront_window,
+		.desc = wavefront_window_desc
+	},
+	(struct command_line_option) {
+		.option = "--activation-map-every",
+		.parser = &parse_activation_map_every,
+		.desc = activation_map_every_desc
+	},
+	(struct command_line_option) {
+		.option = "--spectrum",
+		.parser = &parse_spectrum,
+		.desc = spectrum_desc
+	},
+	(struct command_line_option) {
+		.option = "--spectrum-window",
+		.parser = &parse_spectrum_window,
+		.desc = spectrum_window_desc
+	},
+	(struct command_line_option) {
+		.option = "--spectrum-overlap",
+		.parser = &parse_spectrum_overlap,
+		.desc = spectrum_overlap_desc
+	},
+	(struct command_line_option) {
+		.option = "--render",
+		.parser = &parse_render,
+		.desc = render_desc
+	},
+	(struct command_line_option) {
+		.option = "--render-every",
+		.parser = &parse_render_every,
+		.desc = render_every_desc
+	},
+	(struct command_line_option) {
+		.option = "--render-scale",
+		.parser = &parse_render_scale,
+		.desc = render_scale_desc
+	},
+	(struct command_line_option) {
+		.option = "--render-threads",
+		.parser = &parse_render_threads,
+		.desc = render_threads_desc
+	},
+	(struct command_line_option) {0}
+};
+
+static const struct run_state default_run_state = (const struct run_state) {
+	.type = RUN_STATE_ERROR,
+	.simopts.coupling_constant_is_random = false,
+	.simopts.coupling_constant = 0.1,
+	.simopts.random_value_interval.highest = 0.0,
+	.simopts.random_value_interval.lowest = 0.0,
+	.simopts.neuron_count = 225,
+	.simopts.grid_width = 15,
+	.simopts.grid_height = 15,
+	.simopts.time_step = 0.1,
+	.simopts.parameter_callback = &huber_braun_parameter_callback_single_center,
+	.simopts.coupling_callback = &coupling_callback_lattice,
+	.simopts.initial_values_callback = &initial_values_callback_zero,
+	.simopts.model = &huber_braun_model,
+	.simopts.restart_file = NULL,
+	.simopts.transient_time = 0.0,
+	.simopts.state_cache_dir = NULL,
+	.popts.final_time = 10000,
+	.popts.print_time = 1,
+	.popts.output_dir = "output",
+	.popts.print_neurons = false,
+	.popts.record_neurons = NULL,
+	.popts.record_variables = NULL,
+	.popts.print_voltage_matrix = true,
+	.popts.print_raster_plot = false,
+	.popts.print_envelope = false,
+	.popts.checkpoint_every = 0.0,
+	.popts.checkpoint_file = NULL,
+	.popts.checkpoint_background = true,
+	.popts.output_format = OUTPUT_FORMAT_TEXT,
+	.popts.binary_value_size = sizeof (double),
+	.popts.output_chunk = 64,
+	.popts.output_buffers = 0,
+	.popts.output_bulk = false,
+	.popts.output_backend = BULK_WRITER_URING,
+	.popts.output_queue_depth = 8,
+	.popts.output_direct = false,
+	.popts.text_precision = 10,
+	.popts.output_stream = NULL,
+	.popts.stream_binary = true,
+	.popts.stream_queue_size = 16,
+	.popts.shm_export = NULL,
+	.popts.shm_slots = 64,
+	.popts.spike_aer = false,
+	.popts.spike_time_format = SPIKE_TIME_FLOAT,
+	.popts.spike_delta = true,
+	.popts.transpose_output = false,
+	.popts.spike_stats = false,
+	.popts.spike_stats_every = 0.0,
+	.popts.spike_stats_options.threshold = 0.0,
+	.popts.spike_stats_options.burst_isi = 20.0,
+	.popts.spike_stats_options.bin_count = 50,
+	.popts.spike_stats_options.bin_width = 5.0,
+	.popts.synchrony_measures = 0,
+	.popts.synchrony_window = 100.0,
+	.popts.wavefront = false,
+	.popts.wavefront_window = 10.0,
+	.popts.activation_map_every = 0.0,
+	.popts.wavefront_options.threshold = 0.0,
+	.popts.wavefront_options.track_radius = 2.0,
+	.popts.spectrum = NULL,
+	.popts.spectrum_options.window_length = 4096,
+	.popts.spectrum_options.overlap = 0.5,
+	.popts.render = false,
+	.popts.render_every = 1.0,
+	.popts.render_options.format = IMAGE_FORMAT_PNG,
+	.popts.render_options.scale = 4,
+	.popts.render_options.thread_count = 4,
+	.popts.render_options.frame_delay = 4,
+	.vopts.screen_width = 800,
+	.vopts.screen_height = 800,
+	.vopts.low_matrix_value = -80.0,
+	.vopts.high_matrix_value = 30.0,
+	.vopts.low_color.r = 122,
+	.vopts.low_color.g = 31,
+	.vopts.low_color.b = 110,
+	.vopts.high_color.r = 184,
+	.vopts.high_color.g = 172,
+	.vopts.high_color.b = 9,
+	.vopts.fontpath = "res/Monoid-Regular-NoCalt.ttf",
+	.vopts.free_run = false,
+	.vopts.sim_speed = 0.0
+};
+
+int print_help(void);
+int print_version(void);
 int visualize_main(struct simulation_options *simopts, struct visual_options *vopts);
-int print_data_main(struct simulation_options *simopts, struct print_options *popts);
+int print_data_main(struct simulation_options *simopts, struct print_options *popts, struct visual_options *vopts);
 
 struct run_state parse_command_line_arguments(int argc, const char **argv)
 {
@@ -960,7 +2433,7 @@ int main(int argc, const char **argv)
 	case RUN_STATE_VISUALIZE:
 		return visualize_main(&state.simopts, &state.vopts);
 	case RUN_STATE_OUTPUT_DATA:
-		return print_data_main(&state.simopts, &state.popts);
+		return print_data_main(&state.simopts, &state.popts, &state.vopts);
 	case RUN_STATE_PRINT_VERSION:
 		return print_version();
 	case RUN_STATE_PRINT_HELP:
@@ -973,6 +2446,131 @@ int main(int argc, const char **argv)
 	return 1;
 }
 
+void checkpoint_info_from_options(struct simulation_options *simopts, struct checkpoint_info *info)
+{
+	info->model_name = entry_name(model_entries, simopts->model);
+	info->parameter_callback_name = entry_name(parameter_callback_entries, simopts->parameter_callback);
+	info->coupling_callback_name = entry_name(coupling_callback_entries, simopts->coupling_callback);
+	info->initial_values_callback_name = entry_name(initial_values_callback_entries,
+							simopts->initial_values_callback);
+	info->time_step = simopts->time_step;
+	info->coupling_constant_is_random = simopts->coupling_constant_is_random;
+	info->coupling_constant = simopts->coupling_constant;
+	info->lowest_random_value = simopts->random_value_interval.lowest;
+	info->highest_random_value = simopts->random_value_interval.highest;
+}
+
+bool checkpoint_apply_to_options(checkpoint cp, struct simulation_options *simopts)
+{
+	struct checkpoint_info info;
+	checkpoint_get_info(cp, &info);
+
+	struct dynamical_model *model = entry_data(model_entries, info.model_name);
+	void *parameter_callback = entry_data(parameter_callback_entries, info.parameter_callback_name);
+	void *coupling_callback = entry_data(coupling_callback_entries, info.coupling_callback_name);
+	void *initial_values_callback = entry_data(initial_values_callback_entries,
+						   info.initial_values_callback_name);
+	if (!model || !parameter_callback || !coupling_callback || !initial_values_callback) {
+		return false;
+	}
+	if (model->number_of_variables != checkpoint_get_element_size(cp)) {
+		return false;
+	}
+
+	simopts->model = model;
+	simopts->parameter_callback = parameter_callback;
+	simopts->coupling_callback = coupling_callback;
+	simopts->initial_values_callback = initial_values_callback;
+	simopts->neuron_count = checkpoint_get_system_size(cp);
+	simopts->grid_width = checkpoint_get_grid_width(cp);
+	simopts->grid_height = checkpoint_get_grid_height(cp);
+	simopts->time_step = info.time_step;
+	simopts->coupling_constant_is_random = info.coupling_constant_is_random;
+	simopts->coupling_constant = info.coupling_constant;
+	simopts->random_value_interval.lowest = info.lowest_random_value;
+	simopts->random_value_interval.highest = info.highest_random_value;
+
+	return true;
+}
+
+/* Integrates the system through the transient, or skips it entirely when
+ * the state cache already holds the settled state for this configuration. */
+void settle_dynamical_system(dynamical_system ds, struct simulation_options *simopts)
+{
+	struct checkpoint_info info;
+	checkpoint_info_from_options(simopts, &info);
+	uint64_t key = state_cache_key(&info, simopts->neuron_count,
+				       simopts->grid_width, simopts->grid_height,
+				       simopts->transient_time);
+
+	if (simopts->state_cache_dir && state_cache_restore(simopts->state_cache_dir, key, ds)) {
+		dynamical_system_set_time(ds, 0.0);
+		return;
+	}
+
+	while (dynamical_system_get_time(ds) < simopts->transient_time) {
+		math_utils_rk4_integrate(ds, simopts->time_step);
+	}
+
+	if (simopts->state_cache_dir && !state_cache_store(simopts->state_cache_dir, key, ds, &info)) {
+		printf("Unable to store the settled state in [%s].\n", simopts->state_cache_dir);
+	}
+	dynamical_system_set_time(ds, 0.0);
+}
+
+/* Builds the dynamical system described by the options, continuing from
+ * the checkpoint given with --restart if there is one. */
+dynamical_system create_dynamical_system(struct simulation_options *simopts)
+{
+	checkpoint cp = NULL;
+	if (simopts->restart_file) {
+		cp = checkpoint_open(simopts->restart_file);
+		if (!cp) {
+			printf("Unable to read the checkpoint file [%s].\n", simopts->restart_file);
+			return NULL;
+		}
+		if (!checkpoint_apply_to_options(cp, simopts)) {
+			printf("The checkpoint file [%s] does not match any known configuration.\n",
+			       simopts->restart_file);
+			checkpoint_close(&cp);
+			return NULL;
+		}
+	}
+
+	if (simopts->coupling_constant_is_random) {
+		neuron_config_coupling_is_random_set(true,
+						     simopts->random_value_interval.highest,
+						     simopts->random_value_interval.lowest);
+	}
+	else {
+		neuron_config_coupling_constant_set(simopts->coupling_constant);
+	}
+
+	dynamical_system ds = dynamical_system_create(simopts->neuron_count,
+						      simopts->grid_width,
+						      simopts->grid_height,
+						      simopts->model->number_of_variables,
+						      simopts->parameter_callback,
+						      simopts->coupling_callback,
+						      simopts->initial_values_callback,
+						      simopts->model->derivatives);
+
+	if (cp) {
+		if (!ds || !checkpoint_restore(cp, ds)) {
+			printf("Unable to restore the checkpoint file [%s].\n", simopts->restart_file);
+			if (ds) {
+				dynamical_system_destroy(&ds);
+			}
+		}
+		checkpoint_close(&cp);
+	}
+	else if (ds && simopts->transient_time > 0.0) {
+		settle_dynamical_system(ds, simopts);
+	}
+
+	return ds;
+}
+
 void clerp(double input, double low_input, double high_input, SDL_Color *low_color, SDL_Color *high_color, SDL_Color *out_color)
 {
 	out_color->r = math_utils_lerp(input, low_input, high_input, low_color->r, high_color->r);
@@ -981,81 +2579,236 @@ void clerp(double input, double low_input, double high_input, SDL_Color *low_col
 	out_color->a = 255;
 }
 
-void draw_color_map_cell(SDL_Renderer *renderer,
-			 SDL_Color *low_color, SDL_Color *high_color,
-			 double low_input, double high_input,
-			 uint x, uint y, uint width, uint height, double value)
+/* A texture of one line of text, only rendered again when its text
+ * changes. */
+struct text_texture {
+	char text[512];
+	SDL_Texture *texture;
+	uint width;
+	uint height;
+};
+
+bool text_texture_update(SDL_Renderer *renderer, TTF_Font *font, struct text_texture *tt, const char *text)
 {
-	SDL_Color c;
-	clerp(value, low_input, high_input, low_color, high_color, &c);
+	if (tt->texture && !strcmp(tt->text, text)) {
+		return true;
+	}
 
+	SDL_Surface *surface = TTF_RenderText_Solid(font, text, (SDL_Color){80, 80, 80, 255});
+	if (!surface) {
+		return false;
+	}
+	SDL_Texture *texture = SDL_CreateTextureFromSurface(renderer, surface);
+	uint width = surface->w;
+	uint height = surface->h;
+	SDL_FreeSurface(surface);
+	if (!texture) {
+		return false;
+	}
+
+	if (tt->texture) {
+		SDL_DestroyTexture(tt->texture);
+	}
+	tt->texture = texture;
+	tt->width = width;
+	tt->height = height;
+	snprintf(tt->text, sizeof tt->text, "%s", text);
+	return true;
+}
+
+void text_texture_draw(SDL_Renderer *renderer, struct text_texture *tt, uint x, uint y)
+{
 	SDL_Rect rect = (SDL_Rect) {
 		.x = x,
 		.y = y,
-		.w = width,
-		.h = height
+		.w = tt->width,
+		.h = tt->height
 	};
+	SDL_RenderCopy(renderer, tt->texture, NULL, &rect);
+}
+
+void text_texture_destroy(struct text_texture *tt)
+{
+	if (tt->texture) {
+		SDL_DestroyTexture(tt->texture);
+		tt->texture = NULL;
+	}
+}
+
+/* The textures of the legend, kept from frame to frame. The gradient is one
+ * texel high and stretched over the color bar, and is only built again
+ * when the colors or the width of the bar change. */
+struct legend {
+	struct text_texture low_text;
+	struct text_texture high_text;
+	SDL_Texture *gradient;
+	uint gradient_width;
+	SDL_Color low_color;
+	SDL_Color high_color;
+};
+
+static bool same_color(SDL_Color *a, SDL_Color *b)
+{
+	return a->r == b->r && a->g == b->g && a->b == b->b;
+}
+
+static bool update_gradient(SDL_Renderer *renderer, struct legend *legend,
+			    SDL_Color *low_color, SDL_Color *high_color, uint width)
+{
+	if (legend->gradient && legend->gradient_width == width
+	    && same_color(&legend->low_color, low_color) && same_color(&legend->high_color, high_color)) {
+		return true;
+	}
+
+	SDL_Texture *gradient = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC,
+						  width, 1);
+	if (!gradient) {
+		return false;
+	}
+	uint32_t *pixels = malloc((sizeof *pixels) * width);
+	for (uint x = 0; x < width; x++) {
+		SDL_Color c;
+		clerp(x, 0, width - 1, low_color, high_color, &c);
+		pixels[x] = (uint32_t)0xff << 24 | (uint32_t)c.r << 16 | (uint32_t)c.g << 8 | c.b;
+	}
+	SDL_UpdateTexture(gradient, NULL, pixels, width * sizeof *pixels);
+	free(pixels);
 
-	SDL_SetRenderDrawColor(renderer, c.r, c.g, c.b, 255);
-	SDL_RenderFillRect(renderer, &rect);
+	if (legend->gradient) {
+		SDL_DestroyTexture(legend->gradient);
+	}
+	legend->gradient = gradient;
+	legend->gradient_width = width;
+	legend->low_color = *low_color;
+	legend->high_color = *high_color;
+	return true;
 }
 
-void draw_legend(SDL_Renderer *renderer, TTF_Font *font,
+void draw_legend(SDL_Renderer *renderer, TTF_Font *font, struct legend *legend,
 		 SDL_Color *low_color, SDL_Color *high_color,
 		 double low_value, double high_value,
 		 uint x, uint y, uint width, uint height)
 {
-	static char low_value_text[64];
-	static char high_value_text[64];
+	char low_value_text[64];
+	char high_value_text[64];
 	snprintf(low_value_text, 64, "%.3f", low_value);
 	snprintf(high_value_text, 64, "%.3f", high_value);
-	SDL_Surface *low_text_surface = TTF_RenderText_Solid(font, low_value_text, (SDL_Color){80, 80, 80, 255});
-	SDL_Surface *high_text_surface = TTF_RenderText_Solid(font, high_value_text, (SDL_Color){80, 80, 80, 255});
-	uint low_width = low_text_surface->w;
-	uint low_height = low_text_surface->h;
-	uint high_width = high_text_surface->w;
-	uint high_height = high_text_surface->h;
-	SDL_Texture *low_text_texture = SDL_CreateTextureFromSurface(renderer, low_text_surface);
-	SDL_Texture *high_text_texture = SDL_CreateTextureFromSurface(renderer, high_text_surface);
+	if (!text_texture_update(renderer, font, &legend->low_text, low_value_text)
+	    || !text_texture_update(renderer, font, &legend->high_text, high_value_text)) {
+		return;
+	}
+	uint low_width = legend->low_text.width;
+	uint low_height = legend->low_text.height;
+	uint high_width = legend->high_text.width;
 	uint padding_width = 10;
 	uint color_bar_width = width - (low_width + high_width) - 2 * padding_width;
 	uint color_bar_height = height;
 	uint color_bar_x = x + low_width + padding_width;
 	uint color_bar_y = y;
 
-	SDL_Rect low_text_rect;
-	low_text_rect.x = x + padding_width / 2.0;
-	low_text_rect.y = (y + color_bar_height / 2.0) - (low_height / 2.0);
-	low_text_rect.w = low_width;
-	low_text_rect.h = low_height;
-
-	SDL_Rect high_text_rect;
-	high_text_rect.x = color_bar_x + color_bar_width + padding_width / 2.0;
-	high_text_rect.y = (y + color_bar_height / 2.0) - (low_height / 2.0);
-	high_text_rect.w = high_width;
-	high_text_rect.h = high_height;
-	
-	SDL_RenderCopy(renderer, low_text_texture, NULL, &low_text_rect);
-	SDL_RenderCopy(renderer, high_text_texture, NULL, &high_text_rect);
+	text_texture_draw(renderer, &legend->low_text,
+			  x + padding_width / 2.0, (y + color_bar_height / 2.0) - (low_height / 2.0));
+	text_texture_draw(renderer, &legend->high_text,
+			  color_bar_x + color_bar_width + padding_width / 2.0,
+			  (y + color_bar_height / 2.0) - (low_height / 2.0));
+
+	/* the color bar covers both of its ends */
+	if (update_gradient(renderer, legend, low_color, high_color, color_bar_width + 1)) {
+		SDL_Rect rect = (SDL_Rect) {
+			.x = color_bar_x,
+			.y = color_bar_y,
+			.w = color_bar_width + 1,
+			.h = color_bar_height
+		};
+		SDL_RenderCopy(renderer, legend->gradient, NULL, &rect);
+	}
+}
+
+void legend_destroy(struct legend *legend)
+{
+	text_texture_destroy(&legend->low_text);
+	text_texture_destroy(&legend->high_text);
+	if (legend->gradient) {
+		SDL_DestroyTexture(legend->gradient);
+		legend->gradient = NULL;
+	}
+}
+
+/* Shared between the render loop and the simulation thread, which owns the
+ * dynamical system. The flags and counters are only accessed atomically,
+ * and the state only goes out through the snapshot buffer. */
+struct simulation_thread {
+	dynamical_system ds;
+	snapshot_buffer snapshots;
+	double time_step;
+	double sim_speed;
+	uint publish_millis;
+	int stop;
+	int free_run;
+	int frame_step;
+	int step_requests;
+};
+
+static void publish_snapshot(struct simulation_thread *st)
+{
+	size_t value_count = (size_t)dynamical_system_get_system_size(st->ds) * dynamical_system_get_element_size(st->ds);
+	memcpy(snapshot_buffer_begin(st->snapshots), dynamical_system_get_values(st->ds),
+	       (sizeof (double)) * value_count);
+	snapshot_buffer_publish(st->snapshots, dynamical_system_get_time(st->ds));
+}
+
+/* Integrates on requests of single frame steps from the arrow keys, or on
+ * its own while running freely, as fast as possible or at sim_speed
+ * simulated milliseconds per second. Snapshots go out after every frame
+ * step, and at most every publish_millis while running. */
+static int simulate(void *data)
+{
+	struct simulation_thread *st = data;
+	bool was_running = false, changed = false;
+	uint baseline_millis = 0, published_millis = 0;
+	double baseline_time = 0.0;
+
+	while (!__atomic_load_n(&st->stop, __ATOMIC_ACQUIRE)) {
+		bool running = __atomic_load_n(&st->free_run, __ATOMIC_ACQUIRE);
+		int requests = __atomic_exchange_n(&st->step_requests, 0, __ATOMIC_ACQ_REL);
+		int frame_step = __atomic_load_n(&st->frame_step, __ATOMIC_RELAXED);
+		uint now = SDL_GetTicks();
+
+		if (requests) {
+			for (int i = 0; i < abs(requests); i++) {
+				math_utils_rk4_integrate(st->ds, (requests < 0 ? -1 : 1) * frame_step * st->time_step);
+			}
+			publish_snapshot(st);
+			published_millis = now;
+			changed = false;
+		}
+		else if (running) {
+			if (!was_running) {
+				baseline_millis = now;
+				baseline_time = dynamical_system_get_time(st->ds);
+			}
+			if (st->sim_speed > 0.0
+			    && dynamical_system_get_time(st->ds) - baseline_time >= st->sim_speed * (now - baseline_millis) / 1000.0) {
+				SDL_Delay(1);
+			}
+			else {
+				math_utils_rk4_integrate(st->ds, st->time_step);
+				changed = true;
+			}
+		}
+		else {
+			SDL_Delay(1);
+		}
+		was_running = running;
 
-	uint legend_start = color_bar_x;
-	uint legend_end = color_bar_x + color_bar_width;
-	for (uint x = legend_start; x <= legend_end; x++) {
-		SDL_Color c;
-		clerp(x, legend_start, legend_end, low_color, high_color, &c);
-		SDL_SetRenderDrawColor(renderer, c.r, c.g, c.b, 255);
-		SDL_Rect rect;
-		rect.x = x;
-		rect.y = color_bar_y;
-		rect.w = 1;
-		rect.h = color_bar_height;
-		SDL_RenderFillRect(renderer, &rect);
+		if (changed && (!running || now - published_millis >= st->publish_millis)) {
+			publish_snapshot(st);
+			published_millis = now;
+			changed = false;
+		}
 	}
 
-	SDL_FreeSurface(low_text_surface);
-	SDL_FreeSurface(high_text_surface);
-	SDL_DestroyTexture(low_text_texture);
-	SDL_DestroyTexture(high_text_texture);
+	return 0;
 }
 
 int visualize_main(struct simulation_options *simopts, struct visual_options *vopts)
@@ -1088,34 +2841,40 @@ int visualize_main(struct simulation_options *simopts, struct visual_options *vo
 	}
 	
 	/* constuct the neural network */
-	if (simopts->coupling_constant_is_random) {
-		neuron_config_coupling_is_random_set(true,
-						     simopts->random_value_interval.highest,
-						     simopts->random_value_interval.lowest);
-	}
-	else {
-		neuron_config_coupling_constant_set(simopts->coupling_constant);
+	dynamical_system ds = create_dynamical_system(simopts);
+	if (!ds) {
+		puts("Unable to create the dynamical system. Exiting now.");
+		return 1;
 	}
 
 	uint matrix_width = simopts->grid_width;
 	uint matrix_height = simopts->grid_height;
 
-	double sim_time = 0.0;
-
-	dynamical_system ds = dynamical_system_create(simopts->neuron_count,
-						      simopts->grid_width,
-						      simopts->grid_height,
-						      simopts->model->number_of_variables,
-						      simopts->parameter_callback,
-						      simopts->coupling_callback,
-						      simopts->initial_values_callback,
-						      simopts->model->derivatives);
-
 	bool running = true;
 	uint frame_step = 1;
 	uint millis_per_frame = 1000 / 60;
 	uint start_time_millis, end_time_millis;
 
+	/* the dynamical system belongs to the simulation thread from here on */
+	struct simulation_thread st = {
+		.ds = ds,
+		.snapshots = snapshot_buffer_create((size_t)dynamical_system_get_system_size(ds)
+						    * dynamical_system_get_element_size(ds)),
+		.time_step = simopts->time_step,
+		.sim_speed = vopts->sim_speed,
+		.publish_millis = millis_per_frame / 2,
+		.stop = false,
+		.free_run = vopts->free_run,
+		.frame_step = frame_step,
+		.step_requests = 0
+	};
+	publish_snapshot(&st);
+	SDL_Thread *simulation = SDL_CreateThread(&simulate, "simulation", &st);
+	if (!simulation) {
+		puts("Unable to start the simulation thread using SDL_CreateThread. Exiting now.");
+		return 1;
+	}
+
 	SDL_Color low_color;
 	low_color.r = vopts->low_color.r;
 	low_color.g = vopts->low_color.g;
@@ -1127,6 +2886,28 @@ int visualize_main(struct simulation_options *simopts, struct visual_options *vo
 	high_color.b = vopts->high_color.b;
 
 	uint header_height = 100;
+
+	/* the heat map is one texel per neuron, stretched over the window */
+	color_map heat_map_colors = color_map_create(vopts->low_matrix_value, vopts->high_matrix_value,
+						     (struct color_map_rgb){ low_color.r, low_color.g, low_color.b },
+						     (struct color_map_rgb){ high_color.r, high_color.g, high_color.b });
+	SDL_Texture *heat_map = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+						  matrix_width, matrix_height);
+	if (!heat_map) {
+		puts("Unable to create the heat map texture using SDL_CreateTexture. Exiting now.");
+		return 1;
+	}
+	uint32_t *heat_map_pixels = malloc((sizeof *heat_map_pixels) * matrix_width * matrix_height);
+	SDL_Rect heat_map_rect = (SDL_Rect) {
+		.x = 0,
+		.y = header_height,
+		.w = vopts->screen_width,
+		.h = vopts->screen_height - header_height
+	};
+
+	/* text is only rasterized again when it changes */
+	struct text_texture header = {0};
+	struct legend legend = {0};
 	
 	while (running) {
 		start_time_millis = SDL_GetTicks();
@@ -1143,17 +2924,22 @@ int visualize_main(struct simulation_options *simopts, struct visual_options *vo
 				}
 				else if (scancode == SDL_SCANCODE_UP) {
 					frame_step++;
+					__atomic_store_n(&st.frame_step, frame_step, __ATOMIC_RELAXED);
 				}
 				else if (scancode == SDL_SCANCODE_DOWN) {
 					if (frame_step > 1) {
 						frame_step--;
 					}
+					__atomic_store_n(&st.frame_step, frame_step, __ATOMIC_RELAXED);
 				}
 				else if (scancode == SDL_SCANCODE_LEFT) {
-					math_utils_rk4_integrate(ds, frame_step * -simopts->time_step);
+					__atomic_sub_fetch(&st.step_requests, 1, __ATOMIC_RELEASE);
 				}
 				else if (scancode == SDL_SCANCODE_RIGHT) {
-					math_utils_rk4_integrate(ds, frame_step * simopts->time_step);
+					__atomic_add_fetch(&st.step_requests, 1, __ATOMIC_RELEASE);
+				}
+				else if (scancode == SDL_SCANCODE_SPACE) {
+					__atomic_xor_fetch(&st.free_run, true, __ATOMIC_RELEASE);
 				}
 				break;
 			}
@@ -1168,51 +2954,42 @@ int visualize_main(struct simulation_options *simopts, struct visual_options *vo
 		SDL_RenderClear(renderer);
 		
 		/* draw the heat map cells representing the voltage of each neuron */
-		for (uint row = 0; row < matrix_height; row++) {
-			for (uint col = 0; col < matrix_width; col++) {
-				double cell_width = vopts->screen_width / (double)matrix_width;
-				double cell_height = (vopts->screen_height - header_height) / (double)matrix_height;
-				draw_color_map_cell(renderer, &low_color, &high_color, vopts->low_matrix_value, vopts->high_matrix_value,
-						    ceill(col * cell_width),
-						    ceill(header_height + row * cell_height),
-						    ceill(cell_width),
-						    ceill(cell_height),
-						    dynamical_system_get_value(ds, row * matrix_width + col, 0));
-						    
-			}
-		}
+		double sim_time;
+		const double *values = snapshot_buffer_take(st.snapshots, &sim_time);
+		color_map_fill(heat_map_colors, values, simopts->model->number_of_variables,
+			       matrix_width * matrix_height, heat_map_pixels);
+		SDL_UpdateTexture(heat_map, NULL, heat_map_pixels, matrix_width * sizeof *heat_map_pixels);
+		SDL_RenderCopy(renderer, heat_map, NULL, &heat_map_rect);
 
 		/* draw header information */
-		double sim_time = dynamical_system_get_time(ds);
 		char message[512];
-		snprintf(message, 512, "Time: %.2fms -- Frame Step: %.2fms", sim_time, simopts->time_step * frame_step);
-		SDL_Surface *text_surface = TTF_RenderText_Solid(font, message, (SDL_Color){80, 80, 80, 255});
-		SDL_Texture *text_texture = SDL_CreateTextureFromSurface(renderer, text_surface);
-		uint message_width = text_surface->w;
-		uint message_height = text_surface->h;
-		SDL_Rect text_rect;
-		text_rect.x = 0;
-		text_rect.y = 0;
-		text_rect.w = message_width;
-		text_rect.h = message_height;
-		
-		SDL_RenderCopy(renderer, text_texture, NULL, &text_rect);
-		draw_legend(renderer, font,
+		snprintf(message, 512, "Time: %.2fms -- Frame Step: %.2fms%s", sim_time, simopts->time_step * frame_step,
+			 __atomic_load_n(&st.free_run, __ATOMIC_RELAXED) ? " -- Running" : "");
+		if (text_texture_update(renderer, font, &header, message)) {
+			text_texture_draw(renderer, &header, 0, 0);
+		}
+		draw_legend(renderer, font, &legend,
 			    &low_color, &high_color, vopts->low_matrix_value, vopts->high_matrix_value,
-			    0, message_height, 800, 50);
+			    0, header.height, 800, 50);
 		
 		SDL_RenderPresent(renderer);
 
-		SDL_FreeSurface(text_surface);
-		SDL_DestroyTexture(text_texture);
-
 		end_time_millis = SDL_GetTicks();
-		uint duration_millis = start_time_millis - end_time_millis;
-		if (duration_millis > millis_per_frame) {
+		uint duration_millis = end_time_millis - start_time_millis;
+		if (duration_millis < millis_per_frame) {
 			SDL_Delay(millis_per_frame - duration_millis);
 		}
 	}
 
+	__atomic_store_n(&st.stop, true, __ATOMIC_RELEASE);
+	SDL_WaitThread(simulation, NULL);
+	snapshot_buffer_destroy(&st.snapshots);
+
+	text_texture_destroy(&header);
+	legend_destroy(&legend);
+	SDL_DestroyTexture(heat_map);
+	free(heat_map_pixels);
+	color_map_destroy(&heat_map_colors);
 	SDL_DestroyRenderer(renderer);
 	TTF_CloseFont(font);
 	SDL_DestroyWindow(window);
@@ -1225,122 +3002,1001 @@ int visualize_main(struct simulation_options *simopts, struct visual_options *vo
 	return 0;
 }
 
-int print_data_main(struct simulation_options *simopts, struct print_options *popts)
+/* Returns a newly allocated path to the given file inside the directory. */
+char *output_path(const char *dirname, const char *filename)
 {
-	const double progress_print_interval = 1.0;
+	size_t path_size = strlen(dirname) + 1 + strlen(filename) + 1;
+	char *path = malloc(path_size);
+	snprintf(path, path_size, "%s/%s", dirname, filename);
+	return path;
+}
 
-	if (simopts->coupling_constant_is_random) {
-		neuron_config_coupling_is_random_set(true,
-						     simopts->random_value_interval.highest,
-						     simopts->random_value_interval.lowest);
+/* Returns whether dirname holds anything but the checkpoint restarted
+ * from. The earlier run kept writing after its last checkpoint, so the
+ * restarted run must not add its samples to the same files. */
+bool output_dir_holds_outputs(const char *dirname, const char *restart_file)
+{
+	DIR *dir = opendir(dirname);
+	if (!dir) {
+		return false;
 	}
-	else {
-		neuron_config_coupling_constant_set(simopts->coupling_constant);
+
+	struct stat restart_st;
+	bool has_restart = !stat(restart_file, &restart_st);
+	bool result = false;
+	struct dirent *entry;
+	while (!result && (entry = readdir(dir))) {
+		if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, "..")) {
+			continue;
+		}
+		char *path = output_path(dirname, entry->d_name);
+		struct stat st;
+		result = stat(path, &st) || !has_restart
+			|| st.st_dev != restart_st.st_dev || st.st_ino != restart_st.st_ino;
+		free(path);
 	}
+	closedir(dir);
+
+	return result;
+}
 
+/* Everything needed to write one sample of the simulation to the data
+ * files, either from the integration loop or from the output writer. */
+struct output_context {
 	file_table fs;
-	if (popts->print_neurons && popts->print_voltage_matrix && popts->print_raster_plot) {
-		fs = file_table_create(popts->output_dir,
-				       simopts->neuron_count,
-				       2, "voltage_matrix.dat", "raster_plot.dat");
+	frame_file ff;
+	compressed_file cf;
+	container nc;
+	spike_file sf;
+	file_table envelope_fs;
+	file_table_handle voltage_matrix_file;
+	file_table_handle raster_plot_file;
+	file_table_handle envelope_file;
+	bool print_neurons;
+	bool print_voltage_matrix;
+	bool print_raster_plot;
+	uint system_size;
+	uint element_size;
+	uint grid_width;
+	uint grid_height;
+	double *previous_voltages;
+	text_buffer text;
+	uint text_precision;
+	selection record;
+	bool copy_values;
+	size_t envelope_offset;
+	size_t record_offset;
+	stream_sink sink;
+	bool stream_binary;
+	uint stream_value_size;
+	unsigned char *stream_frame;
+	shm_ring shm;
+};
+
+/* A sample as it is queued for the output writer. The values of the
+ * dynamical system are only copied if an output needs all of them. When
+ * the envelope is printed, its DECIMATOR_FIELD_COUNT values per neuron
+ * start at envelope_offset, and the values selected for the neuron data
+ * files start at record_offset. */
+struct output_frame {
+	double time;
+	double values[];
+};
+
+/* Sends one sample to the output stream, as a binary frame message or as a
+ * frame of the voltage matrix file. */
+bool send_output(struct output_context *ctx, double time, const double *values)
+{
+	uint value_count = ctx->system_size * ctx->element_size;
+
+	if (ctx->stream_binary) {
+		unsigned char *frame = ctx->stream_frame;
+		memcpy(frame, &time, sizeof time);
+		if (ctx->stream_value_size == sizeof (double)) {
+			memcpy(frame + sizeof time, values, (sizeof *values) * value_count);
+		}
+		else {
+			float *frame_values = (float *)(frame + sizeof time);
+			for (uint i = 0; i < value_count; i++) {
+				frame_values[i] = values[i];
+			}
+		}
+		return stream_sink_send(ctx->sink, STREAM_MESSAGE_FRAME, frame,
+					sizeof time + (size_t)ctx->stream_value_size * value_count);
+	}
+
+	text_buffer text = ctx->text;
+	text_buffer_clear(text);
+	text_buffer_string(text, "#aside time = ");
+	text_buffer_fixed(text, time, 6);
+	text_buffer_string(text, " ms\n");
+	for (uint row = 0; row < ctx->grid_height; row++) {
+		for (uint col = 0; col < ctx->grid_width; col++) {
+			text_buffer_exponent(text, values[(row * ctx->grid_width + col) * ctx->element_size],
+					     ctx->text_precision);
+			text_buffer_char(text, ' ');
+		}
+		text_buffer_char(text, '\n');
+	}
+	text_buffer_char(text, '\n');
+	return stream_sink_send_raw(ctx->sink, text_buffer_get_data(text), text_buffer_get_size(text));
+}
+
+/* Writes one sample, given as the values of the dynamical system in their
+ * row-major layout, to every output that is enabled. envelope holds the
+ * summary of the steps since the previous sample, if it is printed, and
+ * record the values selected for the neuron data files. */
+bool write_output(struct output_context *ctx, double time, const double *values, const double *envelope,
+		  const double *record)
+{
+	file_table fs = ctx->fs;
+	uint element_size = ctx->element_size;
+	uint grid_width = ctx->grid_width;
+	uint grid_height = ctx->grid_height;
+
+	if (ctx->ff && !frame_file_write(ctx->ff, time, values)) {
+		return false;
+	}
+	if (ctx->cf && !compressed_file_write(ctx->cf, time, values)) {
+		return false;
+	}
+	if (ctx->nc && !container_write(ctx->nc, time, values)) {
+		return false;
+	}
+	if (ctx->sink && !send_output(ctx, time, values)) {
+		return false;
+	}
+	if (ctx->shm) {
+		shm_ring_publish(ctx->shm, time, values);
+	}
+	/* every file gets its text formatted in one piece and written at once */
+	text_buffer text = ctx->text;
+	uint precision = ctx->text_precision;
+	if (ctx->print_neurons) {
+		uint record_count = selection_get_neuron_count(ctx->record);
+		uint record_variable_count = selection_get_variable_count(ctx->record);
+		for (uint i = 0; i < record_count; i++, record += record_variable_count) {
+			text_buffer_clear(text);
+			text_buffer_exponent(text, time, precision);
+			for (uint variable = 0; variable < record_variable_count; variable++) {
+				text_buffer_char(text, ' ');
+				text_buffer_exponent(text, record[variable], precision);
+			}
+			text_buffer_char(text, '\n');
+			if (!file_table_write(fs, file_table_index_handle(fs, i),
+					      text_buffer_get_data(text), text_buffer_get_size(text))) {
+				return false;
+			}
+		}
+	}
+	if (ctx->print_voltage_matrix) {
+		text_buffer_clear(text);
+		text_buffer_string(text, "#aside time = ");
+		text_buffer_fixed(text, time, 6);
+		text_buffer_string(text, " ms\n");
+		if (!file_table_write(fs, ctx->voltage_matrix_file, text_buffer_get_data(text), text_buffer_get_size(text))
+		    || !file_table_write_matrix(fs, ctx->voltage_matrix_file, values, grid_height, grid_width,
+						element_size, precision)
+		    || !file_table_write(fs, ctx->voltage_matrix_file, "\n", 1)) {
+			return false;
+		}
+	}
+	if (ctx->print_raster_plot) {
+		text_buffer_clear(text);
+		for (uint i = 0; i < ctx->system_size; i++) {
+			double current_voltage = values[i * element_size];
+			if (current_voltage > 0.0 && ctx->previous_voltages[i] < 0.0) {
+				text_buffer_fixed(text, time, 6);
+				text_buffer_char(text, '\t');
+				text_buffer_uint(text, i);
+				text_buffer_char(text, '\n');
+			}
+			ctx->previous_voltages[i] = current_voltage;
+		}
+		if (!file_table_write(fs, ctx->raster_plot_file, text_buffer_get_data(text), text_buffer_get_size(text))) {
+			return false;
+		}
+	}
+	if (ctx->sf) {
+		for (uint i = 0; i < ctx->system_size; i++) {
+			double current_voltage = values[i * element_size];
+			if (current_voltage > 0.0 && ctx->previous_voltages[i] < 0.0
+			    && !spike_file_write(ctx->sf, time, i)) {
+				return false;
+			}
+			ctx->previous_voltages[i] = current_voltage;
+		}
 	}
-	else if (popts->print_neurons && popts->print_voltage_matrix) {
-		fs = file_table_create(popts->output_dir, simopts->neuron_count, 1, "voltage_matrix.dat");
+	if (ctx->envelope_fs) {
+		text_buffer_clear(text);
+		for (uint i = 0; i < ctx->system_size; i++, envelope += DECIMATOR_FIELD_COUNT) {
+			text_buffer_exponent(text, time, precision);
+			text_buffer_char(text, ' ');
+			text_buffer_uint(text, i);
+			for (uint field = 0; field < DECIMATOR_FIELD_COUNT; field++) {
+				text_buffer_char(text, ' ');
+				text_buffer_exponent(text, envelope[field], precision);
+			}
+			text_buffer_char(text, '\n');
+		}
+		if (!file_table_write(ctx->envelope_fs, ctx->envelope_file, text_buffer_get_data(text),
+				      text_buffer_get_size(text))) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool write_output_frame(void *context, const void *frame)
+{
+	const struct output_frame *output_frame = frame;
+	struct output_context *ctx = context;
+	const double *envelope = output_frame->values + ctx->envelope_offset;
+	const double *record = output_frame->values + ctx->record_offset;
+	return write_output(context, output_frame->time, output_frame->values, envelope, record);
+}
+
+int print_data_main(struct simulation_options *simopts, struct print_options *popts, struct visual_options *vopts)
+{
+	const double progress_print_interval = 1.0;
+
+	if (simopts->restart_file && output_dir_holds_outputs(popts->output_dir, simopts->restart_file)) {
+		printf("The output directory [%s] already holds data, restart into an empty one.\n",
+		       popts->output_dir);
+		return 1;
+	}
+
+	dynamical_system ds = create_dynamical_system(simopts);
+	if (!ds) {
+		puts("Fatal error: Could not create the dynamical system.");
+		return 1;
+	}
+
+	/* everything the setup below may fail after is released at cleanup */
+	int result = 1;
+	selection record = NULL;
+	selection spectrum_neurons = NULL;
+	file_table fs = NULL;
+	frame_file ff = NULL;
+	compressed_file cf = NULL;
+	container nc = NULL;
+	spike_file sf = NULL;
+	file_table envelope_fs = NULL;
+	decimator envelope_decimator = NULL;
+	double *envelope = NULL;
+	stream_sink sink = NULL;
+	shm_ring shm = NULL;
+	file_table synchrony_fs = NULL;
+	file_table wavefront_fs = NULL;
+	color_map render_colors = NULL;
+	image_sequence render_images = NULL;
+
+	bool binary_output = popts->output_format != OUTPUT_FORMAT_TEXT;
+	bool print_neurons = popts->print_neurons && !binary_output;
+	bool print_voltage_matrix = popts->print_voltage_matrix && !binary_output;
+	bool print_raster_plot = popts->print_raster_plot && !popts->spike_aer;
+	bool print_spikes = popts->print_raster_plot && popts->spike_aer;
+
+	const uint *record_neurons = NULL;
+	uint record_count = 0;
+	if (print_neurons) {
+		record = selection_create(popts->record_neurons, popts->record_variables, simopts->neuron_count,
+					  simopts->grid_width, simopts->grid_height,
+					  simopts->model->number_of_variables, simopts->model->variable_names);
+		if (!record) {
+			puts("Fatal error: Invalid selection of neurons or variables to record.");
+			goto cleanup;
+		}
+		record_neurons = selection_get_neurons(record);
+		record_count = selection_get_neuron_count(record);
+	}
+
+	if (print_neurons && print_voltage_matrix && print_raster_plot) {
+		fs = file_table_create_numbered(popts->output_dir, record_neurons, record_count,
+						2, "voltage_matrix.dat", "raster_plot.dat");
+	}
+	else if (print_neurons && print_voltage_matrix) {
+		fs = file_table_create_numbered(popts->output_dir, record_neurons, record_count,
+						1, "voltage_matrix.dat");
 	}
-	else if (popts->print_neurons && popts->print_raster_plot) {
-		fs = file_table_create(popts->output_dir, simopts->neuron_count, 1, "raster_plot.dat");
+	else if (print_neurons && print_raster_plot) {
+		fs = file_table_create_numbered(popts->output_dir, record_neurons, record_count,
+						1, "raster_plot.dat");
 	}
-	else if (popts->print_raster_plot && popts->print_voltage_matrix) {
+	else if (print_raster_plot && print_voltage_matrix) {
 		fs = file_table_create(popts->output_dir, 0, 2, "voltage_matrix.dat", "raster_plot.dat");
 	}
-	else if (popts->print_neurons) {
-		fs = file_table_create(popts->output_dir, simopts->neuron_count, 0);
+	else if (print_neurons) {
+		fs = file_table_create_numbered(popts->output_dir, record_neurons, record_count, 0);
 	}
-	else if (popts->print_voltage_matrix) {
+	else if (print_voltage_matrix) {
 		fs = file_table_create(popts->output_dir, 0, 1, "voltage_matrix.dat");
 	}
-	else if (popts->print_raster_plot) {
+	else if (print_raster_plot) {
 		fs = file_table_create(popts->output_dir, 0, 1, "raster_plot.dat");
 	}
-	else {
+	else if (!binary_output && !print_spikes && !popts->print_envelope && !popts->output_stream
+		 && !popts->shm_export && !popts->spike_stats && !popts->synchrony_measures
+		 && !popts->wavefront && !popts->spectrum && !popts->render) {
 		puts("Nothing to do.");
-		return 1;
+		goto cleanup;
 	}
 
-	if (!fs) {
+	if (!fs && (print_neurons || print_voltage_matrix || print_raster_plot)) {
 		puts("Fatal error: Could not create the file table.");
-		return 1;
+		goto cleanup;
 	}
 
-	dynamical_system ds = dynamical_system_create(simopts->neuron_count,
-						      simopts->grid_width,
-						      simopts->grid_height,
-						      simopts->model->number_of_variables,
-						      simopts->parameter_callback,
-						      simopts->coupling_callback,
-						      simopts->initial_values_callback,
-						      simopts->model->derivatives);
-						      
-						      
-	uint grid_width = simopts->grid_width;
-	uint grid_height = simopts->grid_height;
+	if (popts->spectrum && strcmp(popts->spectrum, "mean")) {
+		spectrum_neurons = selection_create(popts->spectrum, "0", simopts->neuron_count,
+						    simopts->grid_width, simopts->grid_height,
+						    simopts->model->number_of_variables, simopts->model->variable_names);
+		if (!spectrum_neurons) {
+			puts("Fatal error: Invalid selection of neurons for the spectrum.");
+			goto cleanup;
+		}
+	}
+
+	if (binary_output) {
+		struct frame_file_layout layout = {
+			.model_name = entry_name(model_entries, simopts->model),
+			.system_size = simopts->neuron_count,
+			.grid_width = simopts->grid_width,
+			.grid_height = simopts->grid_height,
+			.variable_count = simopts->model->number_of_variables,
+			.variable_names = simopts->model->variable_names,
+			.value_size = popts->binary_value_size,
+			.time_step = simopts->time_step,
+			.print_time = popts->print_time
+		};
+		char *frame_filename;
+		if (popts->output_format == OUTPUT_FORMAT_COMPRESSED) {
+			frame_filename = output_path(popts->output_dir, "frames.nnz");
+			cf = compressed_file_create(frame_filename, &layout, popts->output_chunk);
+		}
+		else if (popts->output_format == OUTPUT_FORMAT_CONTAINER) {
+			frame_filename = output_path(popts->output_dir, "frames.nnc");
+			nc = container_create(frame_filename, &layout, popts->output_chunk);
+		}
+		else {
+			frame_filename = output_path(popts->output_dir, "frames.bin");
+			struct bulk_writer_options bulk_options = {
+				.backend = popts->output_backend,
+				.queue_depth = popts->output_queue_depth,
+				.chunk_size = BULK_WRITER_CHUNK_SIZE,
+				.direct = popts->output_direct
+			};
+			ff = popts->output_bulk ? frame_file_create_bulk(frame_filename, &layout, &bulk_options)
+				: frame_file_create(frame_filename, &layout);
+		}
+		free(frame_filename);
+		if (!ff && !cf && !nc) {
+			puts("Fatal error: Could not create the frame file.");
+			goto cleanup;
+		}
+	}
 
-	timer timer = timer_begin();
+	if (print_spikes) {
+		struct spike_file_layout layout = {
+			.system_size = simopts->neuron_count,
+			.time_step = simopts->time_step,
+			.time_format = popts->spike_time_format,
+			.delta = popts->spike_delta
+		};
+		char *spike_filename = output_path(popts->output_dir, "spikes.aer");
+		sf = spike_file_create(spike_filename, &layout, SPIKE_FILE_BLOCK_SPIKES);
+		free(spike_filename);
+		if (!sf) {
+			puts("Fatal error: Could not create the spike file.");
+			goto cleanup;
+		}
+	}
+
+	if (popts->print_envelope) {
+		envelope_fs = file_table_create(popts->output_dir, 0, 1, "envelope.dat");
+		if (!envelope_fs) {
+			puts("Fatal error: Could not create the envelope file.");
+			goto cleanup;
+		}
+		envelope_decimator = decimator_create(simopts->neuron_count, simopts->model->number_of_variables, 0);
+		envelope = malloc((sizeof *envelope) * simopts->neuron_count * DECIMATOR_FIELD_COUNT);
+	}
+
+	if (popts->output_stream) {
+		sink = stream_sink_open(popts->output_stream, (size_t)popts->stream_queue_size << 20);
+		struct stream_layout stream_layout = {
+			.system_size = simopts->neuron_count,
+			.grid_width = simopts->grid_width,
+			.grid_height = simopts->grid_height,
+			.variable_count = simopts->model->number_of_variables,
+			.value_size = popts->binary_value_size,
+			.time_step = simopts->time_step,
+			.print_time = popts->print_time
+		};
+		if (!sink || (popts->stream_binary
+			      && !stream_sink_send(sink, STREAM_MESSAGE_LAYOUT, &stream_layout, sizeof stream_layout))) {
+			printf("Fatal error: Could not open the output stream [%s].\n", popts->output_stream);
+			goto cleanup;
+		}
+	}
+
+	if (popts->shm_export) {
+		struct shm_ring_layout shm_layout = {
+			.system_size = simopts->neuron_count,
+			.grid_width = simopts->grid_width,
+			.grid_height = simopts->grid_height,
+			.variable_count = simopts->model->number_of_variables,
+			.slot_count = popts->shm_slots,
+			.time_step = simopts->time_step,
+			.print_time = popts->print_time
+		};
+		shm = shm_ring_create(popts->shm_export, &shm_layout);
+		if (!shm) {
+			printf("Fatal error: Could not create the shared memory ring [%s].\n", popts->shm_export);
+			goto cleanup;
+		}
+	}
+
+	if (popts->synchrony_measures) {
+		synchrony_fs = file_table_create(popts->output_dir, 0, 1, "synchrony.dat");
+		if (!synchrony_fs) {
+			puts("Fatal error: Could not create the file table.");
+			goto cleanup;
+		}
+		file_table_special_print(synchrony_fs, "synchrony.dat",
+					 "#time phase_global phase_local chi_global chi_local correlation\n");
+	}
+
+	if (popts->wavefront) {
+		/* the grid is laid over the first neurons, as for the voltage matrix */
+		bool grid_fits = simopts->grid_width && simopts->grid_height
+			&& (uint64_t)simopts->grid_width * simopts->grid_height <= simopts->neuron_count;
+		if (grid_fits && popts->activation_map_every > 0.0) {
+			wavefront_fs = file_table_create(popts->output_dir, 0, 3, "wavefront.dat",
+							 "singularities.dat", "activation_map.dat");
+		}
+		else if (grid_fits) {
+			wavefront_fs = file_table_create(popts->output_dir, 0, 2, "wavefront.dat",
+							 "singularities.dat");
+		}
+		if (!wavefront_fs) {
+			puts(grid_fits ? "Fatal error: Could not create the file table."
+			     : "Fatal error: The grid does not fit in the network.");
+			goto cleanup;
+		}
+		file_table_special_print(wavefront_fs, "wavefront.dat",
+					 "#time activated centroid_x centroid_y speed singularities born died\n");
+		file_table_special_print(wavefront_fs, "singularities.dat", "#time id charge x y age\n");
+	}
+
+	if (popts->render) {
+		bool grid_fits = simopts->grid_width && simopts->grid_height
+			&& (uint64_t)simopts->grid_width * simopts->grid_height <= simopts->neuron_count;
+		char *prefix = output_path(popts->output_dir, "heat_map");
+		struct color_map_rgb palette[COLOR_MAP_PALETTE_SIZE];
+		struct color low_color = vopts->low_color, high_color = vopts->high_color;
+		render_colors = color_map_create(vopts->low_matrix_value, vopts->high_matrix_value,
+						 (struct color_map_rgb){ low_color.r, low_color.g, low_color.b },
+						 (struct color_map_rgb){ high_color.r, high_color.g, high_color.b });
+		color_map_get_palette(render_colors, palette);
+		if (grid_fits) {
+			render_images = image_sequence_create(prefix, simopts->grid_width, simopts->grid_height,
+							      palette, &popts->render_options);
+		}
+		free(prefix);
+		if (!render_images) {
+			puts(grid_fits ? "Fatal error: Could not start rendering the heat maps."
+			     : "Fatal error: The grid does not fit in the network.");
+			goto cleanup;
+		}
+	}
+
+	struct checkpoint_info cp_info;
+	checkpoint_info_from_options(simopts, &cp_info);
+	char *checkpoint_file = NULL;
+	if (popts->checkpoint_every > 0.0) {
+		if (popts->checkpoint_file) {
+			checkpoint_file = malloc(strlen(popts->checkpoint_file) + 1);
+			strcpy(checkpoint_file, popts->checkpoint_file);
+		}
+		else {
+			checkpoint_file = output_path(popts->output_dir, "checkpoint.bin");
+		}
+	}
 
-	double sim_time;
 	double *previous_voltages = malloc((sizeof *previous_voltages) * simopts->neuron_count);
 	for (uint i = 0; i < simopts->neuron_count; i++) {
 		previous_voltages[i] = dynamical_system_get_value(ds, i, 0);
 	}
+
+	struct output_context ctx = {
+		.fs = fs,
+		.ff = ff,
+		.cf = cf,
+		.nc = nc,
+		.sf = sf,
+		.envelope_fs = envelope_fs,
+		.voltage_matrix_file = print_voltage_matrix ? file_table_special_handle(fs, "voltage_matrix.dat") : 0,
+		.raster_plot_file = print_raster_plot ? file_table_special_handle(fs, "raster_plot.dat") : 0,
+		.envelope_file = envelope_fs ? file_table_special_handle(envelope_fs, "envelope.dat") : 0,
+		.print_neurons = print_neurons,
+		.print_voltage_matrix = print_voltage_matrix,
+		.print_raster_plot = print_raster_plot,
+		.system_size = simopts->neuron_count,
+		.element_size = simopts->model->number_of_variables,
+		.grid_width = simopts->grid_width,
+		.grid_height = simopts->grid_height,
+		.previous_voltages = previous_voltages,
+		.text = text_buffer_create(1 << 16),
+		.text_precision = popts->text_precision,
+		.record = record,
+		.copy_values = ff || cf || nc || sf || sink || shm || print_voltage_matrix || print_raster_plot,
+		.sink = sink,
+		.stream_binary = popts->stream_binary,
+		.stream_value_size = popts->binary_value_size,
+		.stream_frame = sink ? malloc(sizeof (double)
+					      + (size_t)popts->binary_value_size * simopts->neuron_count
+					      * simopts->model->number_of_variables)
+				     : NULL,
+		.shm = shm
+	};
+
+	size_t values_size = (sizeof (double)) * ctx.system_size * ctx.element_size;
+	size_t envelope_count = envelope ? (size_t)ctx.system_size * DECIMATOR_FIELD_COUNT : 0;
+	size_t record_value_count = record ? (size_t)record_count * selection_get_variable_count(record) : 0;
+	double *record_values = record ? malloc((sizeof *record_values) * record_value_count) : NULL;
+	ctx.envelope_offset = ctx.copy_values ? (size_t)ctx.system_size * ctx.element_size : 0;
+	ctx.record_offset = ctx.envelope_offset + envelope_count;
+	output_writer ow = NULL;
+	if (popts->output_buffers) {
+		ow = output_writer_create(popts->output_buffers,
+					  sizeof (struct output_frame) + (sizeof (double)) * (ctx.record_offset + record_value_count),
+					  &write_output_frame, &ctx);
+		if (!ow) {
+			puts("Unable to start the output writer, writing from the integration loop instead.");
+		}
+	}
+
+	spike_stats ss = NULL;
+	char *spike_stats_filename = NULL;
+	bool spike_stats_append = false;
+	if (popts->spike_stats) {
+		ss = spike_stats_create(simopts->neuron_count, simopts->model->number_of_variables,
+					dynamical_system_get_time(ds), dynamical_system_get_values(ds),
+					&popts->spike_stats_options);
+		spike_stats_filename = output_path(popts->output_dir, "spike_stats.dat");
+	}
+
+	synchrony sy = synchrony_fs ? synchrony_create(ds, popts->synchrony_measures) : NULL;
+	wavefront wf = wavefront_fs ? wavefront_create(simopts->grid_width, simopts->grid_height,
+						       simopts->model->number_of_variables,
+						       dynamical_system_get_time(ds), dynamical_system_get_values(ds),
+						       &popts->wavefront_options)
+				    : NULL;
+
+	/* the analysis files are written from the integration loop, so they
+	 * get a text buffer of their own while ctx.text may be in use by the
+	 * output writer */
+	text_buffer analysis_text = sy || wf ? text_buffer_create(1 << 12) : NULL;
+	file_table_handle synchrony_file = sy ? file_table_special_handle(synchrony_fs, "synchrony.dat") : 0;
+	file_table_handle wavefront_file = wf ? file_table_special_handle(wavefront_fs, "wavefront.dat") : 0;
+	file_table_handle singularities_file = wf ? file_table_special_handle(wavefront_fs, "singularities.dat") : 0;
+	file_table_handle activation_map_file = wf && popts->activation_map_every > 0.0
+		? file_table_special_handle(wavefront_fs, "activation_map.dat") : 0;
+
+	spectrum sp = NULL;
+	double *spectrum_samples = NULL;
+	if (popts->spectrum) {
+		uint channel_count = spectrum_neurons ? selection_get_neuron_count(spectrum_neurons) : 1;
+		sp = spectrum_create(channel_count, simopts->time_step, &popts->spectrum_options);
+		spectrum_samples = malloc((sizeof *spectrum_samples) * channel_count);
+	}
+
+	bool write_failed = false;
+	timer total_timer = timer_begin();
+
+	double sim_time;
+	const double start_time = dynamical_system_get_time(ds);
 	
 	while ((sim_time = dynamical_system_get_time(ds)) < popts->final_time) {
-		timer_print(timer, progress_print_interval,
+		timer_print(total_timer, progress_print_interval,
 				    "Progress: %3d%%, Time elapsed: %9.2fs\n",
 				    (int)(100 * sim_time / popts->final_time),
-				    timer_total_get(timer));
+				    timer_total_get(total_timer));
+		if (checkpoint_file && sim_time != start_time
+		    && math_utils_near_every(sim_time, simopts->time_step, popts->checkpoint_every)) {
+			enum checkpoint_background_status status;
+			if (popts->checkpoint_background) {
+				status = checkpoint_write_background(ds, &cp_info, checkpoint_file);
+			}
+			else {
+				status = checkpoint_write(ds, &cp_info, checkpoint_file)
+					? CHECKPOINT_BACKGROUND_STARTED : CHECKPOINT_BACKGROUND_FAILED;
+			}
+
+			if (status == CHECKPOINT_BACKGROUND_BUSY) {
+				printf("Skipped the checkpoint at %.2fms, the previous one is still being written.\n",
+				       sim_time);
+			}
+			else if (status == CHECKPOINT_BACKGROUND_FAILED) {
+				printf("Unable to write the checkpoint file [%s].\n", checkpoint_file);
+			}
+		}
+		if (envelope_decimator) {
+			decimator_add(envelope_decimator, dynamical_system_get_values(ds));
+		}
 		if (math_utils_near_every(sim_time, simopts->time_step, popts->print_time)) {
-			if (popts->print_neurons) {
-				for (uint i = 0; i < dynamical_system_get_system_size(ds); i++) {
-					file_table_index_print(fs, i, "%.10e %.10e %.10e %.10e %.10e\n",
-							       dynamical_system_get_time(ds),
-							       dynamical_system_get_value(ds, i, 0),
-							       dynamical_system_get_value(ds, i, 1));
+			if (ow) {
+				struct output_frame *frame = output_writer_acquire(ow);
+				if (!frame) {
+					puts("Fatal error: Could not write to the output files.");
+					write_failed = true;
+					break;
 				}
-			}
-			if (popts->print_voltage_matrix) {
-				file_table_special_print(fs, "voltage_matrix.dat",
-							 "#aside time = %f ms\n", sim_time);
-				for (uint row = 0; row < grid_height; row++) {
-					for (uint col = 0; col < grid_width; col++) {
-						file_table_special_print(fs, "voltage_matrix.dat", "%.10e ",
-									 dynamical_system_get_value(ds, row * grid_width + col, 0));
-					}
-					file_table_special_print(fs, "voltage_matrix.dat", "\n");
+				frame->time = sim_time;
+				if (ctx.copy_values) {
+					memcpy(frame->values, dynamical_system_get_values(ds), values_size);
 				}
-				file_table_special_print(fs, "voltage_matrix.dat", "\n");
+				if (envelope_decimator) {
+					decimator_take(envelope_decimator, frame->values + ctx.envelope_offset);
+				}
+				if (record) {
+					selection_gather(record, dynamical_system_get_values(ds), frame->values + ctx.record_offset);
+				}
+				output_writer_submit(ow);
 			}
-			if (popts->print_raster_plot) {
-				for (uint i = 0; i < simopts->neuron_count; i++) {
-					double current_voltage = dynamical_system_get_value(ds, i, 0);
-					if (current_voltage > 0.0 && previous_voltages[i] < 0.0) {
-						file_table_special_print(fs, "raster_plot.dat", "%f\t%d\n", sim_time, i);
-					}
-					previous_voltages[i] = current_voltage;
+			else {
+				if (envelope_decimator) {
+					decimator_take(envelope_decimator, envelope);
 				}
+				if (record) {
+					selection_gather(record, dynamical_system_get_values(ds), record_values);
+				}
+				if (!write_output(&ctx, sim_time, dynamical_system_get_values(ds), envelope, record_values)) {
+					puts("Fatal error: Could not write to the output files.");
+					write_failed = true;
+					break;
+				}
+			}
+		}
+		if (render_images && math_utils_near_every(sim_time, simopts->time_step, popts->render_every)) {
+			uint8_t *indices = image_sequence_acquire(render_images);
+			if (!indices) {
+				puts("Fatal error: Could not write the rendered heat maps.");
+				write_failed = true;
+				break;
 			}
+			color_map_fill_indices(render_colors, dynamical_system_get_values(ds),
+					       simopts->model->number_of_variables,
+					       simopts->grid_width * simopts->grid_height, indices);
+			image_sequence_submit(render_images);
 		}
 		
 		math_utils_rk4_integrate(ds, simopts->time_step);
+		if (ss) {
+			spike_stats_add(ss, dynamical_system_get_time(ds), dynamical_system_get_values(ds));
+			/* the last block is written after the loop */
+			if (popts->spike_stats_every > 0.0 && dynamical_system_get_time(ds) < popts->final_time
+			    && math_utils_near_every(dynamical_system_get_time(ds), simopts->time_step,
+						     popts->spike_stats_every)) {
+				if (!spike_stats_write(ss, spike_stats_filename, spike_stats_append,
+						       dynamical_system_get_time(ds), popts->text_precision)) {
+					printf("Unable to write the spike statistics [%s].\n", spike_stats_filename);
+				}
+				spike_stats_append = true;
+			}
+		}
+		if (sy) {
+			synchrony_add(sy, dynamical_system_get_time(ds), dynamical_system_get_values(ds));
+			if (math_utils_near_every(dynamical_system_get_time(ds), simopts->time_step,
+						  popts->synchrony_window)) {
+				struct synchrony_sample sample;
+				synchrony_take(sy, &sample);
+				double measures[] = { sample.phase_global, sample.phase_local, sample.chi_global,
+						      sample.chi_local, sample.correlation };
+				text_buffer_clear(analysis_text);
+				text_buffer_fixed(analysis_text, dynamical_system_get_time(ds), 6);
+				for (uint i = 0; i < sizeof measures / sizeof *measures; i++) {
+					text_buffer_char(analysis_text, ' ');
+					text_buffer_exponent(analysis_text, measures[i], popts->text_precision);
+				}
+				text_buffer_char(analysis_text, '\n');
+				if (!file_table_write(synchrony_fs, synchrony_file, text_buffer_get_data(analysis_text),
+						      text_buffer_get_size(analysis_text))) {
+					puts("Fatal error: Could not write to the output files.");
+					write_failed = true;
+					break;
+				}
+			}
+		}
+		if (wf) {
+			double time = dynamical_system_get_time(ds);
+			wavefront_add(wf, time, dynamical_system_get_values(ds));
+			if (math_utils_near_every(time, simopts->time_step, popts->wavefront_window)) {
+				struct wavefront_sample sample;
+				uint singularity_count;
+				wavefront_take(wf, &sample);
+				const struct wavefront_singularity *singularities =
+					wavefront_get_singularities(wf, &singularity_count);
+				uint precision = popts->text_precision;
+				text_buffer_clear(analysis_text);
+				text_buffer_fixed(analysis_text, time, 6);
+				text_buffer_char(analysis_text, ' ');
+				text_buffer_uint(analysis_text, sample.activated);
+				text_buffer_char(analysis_text, ' ');
+				text_buffer_exponent(analysis_text, sample.centroid_x, precision);
+				text_buffer_char(analysis_text, ' ');
+				text_buffer_exponent(analysis_text, sample.centroid_y, precision);
+				text_buffer_char(analysis_text, ' ');
+				text_buffer_exponent(analysis_text, sample.speed, precision);
+				text_buffer_char(analysis_text, ' ');
+				text_buffer_uint(analysis_text, sample.singularity_count);
+				text_buffer_char(analysis_text, ' ');
+				text_buffer_uint(analysis_text, sample.born);
+				text_buffer_char(analysis_text, ' ');
+				text_buffer_uint(analysis_text, sample.died);
+				text_buffer_char(analysis_text, '\n');
+				bool written = file_table_write(wavefront_fs, wavefront_file,
+								text_buffer_get_data(analysis_text),
+								text_buffer_get_size(analysis_text));
+
+				text_buffer_clear(analysis_text);
+				for (uint i = 0; i < singularity_count; i++) {
+					text_buffer_fixed(analysis_text, time, 6);
+					text_buffer_char(analysis_text, ' ');
+					text_buffer_uint(analysis_text, singularities[i].id);
+					text_buffer_string(analysis_text, singularities[i].charge < 0 ? " -" : " ");
+					text_buffer_uint(analysis_text, abs(singularities[i].charge));
+					text_buffer_char(analysis_text, ' ');
+					text_buffer_fixed(analysis_text, singularities[i].x, 1);
+					text_buffer_char(analysis_text, ' ');
+					text_buffer_fixed(analysis_text, singularities[i].y, 1);
+					text_buffer_char(analysis_text, ' ');
+					text_buffer_fixed(analysis_text, time - singularities[i].birth, 6);
+					text_buffer_char(analysis_text, '\n');
+				}
+				if (!written || !file_table_write(wavefront_fs, singularities_file,
+								  text_buffer_get_data(analysis_text),
+								  text_buffer_get_size(analysis_text))) {
+					puts("Fatal error: Could not write to the output files.");
+					write_failed = true;
+					break;
+				}
+			}
+			if (popts->activation_map_every > 0.0
+			    && math_utils_near_every(time, simopts->time_step, popts->activation_map_every)) {
+				text_buffer_clear(analysis_text);
+				text_buffer_string(analysis_text, "#aside time = ");
+				text_buffer_fixed(analysis_text, time, 6);
+				text_buffer_string(analysis_text, " ms\n");
+				if (!file_table_write(wavefront_fs, activation_map_file, text_buffer_get_data(analysis_text),
+						      text_buffer_get_size(analysis_text))
+				    || !file_table_write_matrix(wavefront_fs, activation_map_file,
+								wavefront_get_activation_map(wf), simopts->grid_height,
+								simopts->grid_width, 1, popts->text_precision)
+				    || !file_table_write(wavefront_fs, activation_map_file, "\n", 1)) {
+					puts("Fatal error: Could not write to the output files.");
+					write_failed = true;
+					break;
+				}
+			}
+		}
+		if (sp) {
+			const double *values = dynamical_system_get_values(ds);
+			if (spectrum_neurons) {
+				selection_gather(spectrum_neurons, values, spectrum_samples);
+			}
+			else {
+				double mean = 0.0;
+				for (uint i = 0; i < simopts->neuron_count; i++) {
+					mean += values[(size_t)i * simopts->model->number_of_variables];
+				}
+				spectrum_samples[0] = mean / simopts->neuron_count;
+			}
+			spectrum_add(sp, spectrum_samples);
+		}
+	}
+
+	if (ow) {
+		struct output_writer_stats stats;
+		output_writer_flush(ow);
+		output_writer_get_stats(ow, &stats);
+		if (!output_writer_destroy(&ow)) {
+			puts("Fatal error: Could not write to the output files.");
+			write_failed = true;
+		}
+		printf("Output writer: %llu samples written, integration stalled %llu times for %.2fs, "
+		       "at most %u of %u buffers in use.\n",
+		       (unsigned long long)stats.frames_written,
+		       (unsigned long long)stats.stalls, stats.stall_seconds,
+		       stats.max_queued, stats.slot_count);
+	}
+
+	if (render_images) {
+		if (!image_sequence_destroy(&render_images)) {
+			puts("Fatal error: Could not write the rendered heat maps.");
+			write_failed = true;
+		}
+		else {
+			printf("Rendered heat maps: %s written into [%s].\n",
+			       popts->render_options.format == IMAGE_FORMAT_GIF ? "one animation" : "images",
+			       popts->output_dir);
+		}
 	}
 
-	timer_end(&timer, "Total elapsed time: %.2fs\n", timer_total_get(timer));
+	timer_end(&total_timer, "Total elapsed time: %.2fs\n", timer_total_get(total_timer));
+
+	if (checkpoint_file && !checkpoint_wait_background()) {
+		printf("Unable to write the checkpoint file [%s].\n", checkpoint_file);
+	}
 
+	if (ss) {
+		if (!spike_stats_write(ss, spike_stats_filename, spike_stats_append, dynamical_system_get_time(ds),
+				       popts->text_precision)) {
+			printf("Unable to write the spike statistics [%s].\n", spike_stats_filename);
+		}
+		spike_stats_destroy(&ss);
+		free(spike_stats_filename);
+	}
+	if (sy) {
+		synchrony_destroy(&sy);
+	}
+	if (wf) {
+		wavefront_destroy(&wf);
+	}
+	if (analysis_text) {
+		text_buffer_destroy(&analysis_text);
+	}
+	if (sp) {
+		char *spectrum_filename = output_path(popts->output_dir, "spectrum.dat");
+		if (!spectrum_get_segment_count(sp)) {
+			puts("The run is shorter than one segment of the power spectral density.");
+		}
+		if (!spectrum_write(sp, spectrum_filename,
+				    spectrum_neurons ? selection_get_neurons(spectrum_neurons) : NULL,
+				    popts->text_precision)) {
+			printf("Unable to write the power spectral density [%s].\n", spectrum_filename);
+		}
+		spectrum_destroy(&sp);
+		free(spectrum_samples);
+		free(spectrum_filename);
+	}
 	free(previous_voltages);
+	free(record_values);
+	free(checkpoint_file);
+	text_buffer_destroy(&ctx.text);
+	if (ff) {
+		struct bulk_writer_stats stats;
+		bool bulk = frame_file_get_writer_stats(ff, &stats);
+		if (!frame_file_destroy(&ff)) {
+			puts("Fatal error: Could not write to the output files.");
+			write_failed = true;
+		}
+		if (bulk) {
+			printf("Bulk writer: %llu bytes through %s%s%s, stalled %llu times waiting for a free chunk.\n",
+			       (unsigned long long)stats.bytes_written,
+			       stats.backend == BULK_WRITER_URING ? "io_uring" : "a writer thread",
+			       stats.backend == BULK_WRITER_URING && stats.registered_buffers ? " with fixed buffers" : "",
+			       stats.direct ? " and O_DIRECT" : "",
+			       (unsigned long long)stats.stalls);
+		}
+	}
+	if (popts->transpose_output) {
+		char *frame_filename = output_path(popts->output_dir, "frames.bin");
+		char *trace_filename = output_path(popts->output_dir, "traces.bin");
+		if (popts->output_format != OUTPUT_FORMAT_BINARY) {
+			puts("The output is only transposed from the binary output format.");
+		}
+		else {
+			timer transpose_timer = timer_begin();
+			if (trace_file_transpose(frame_filename, trace_filename, TRACE_FILE_MEMORY_BUDGET)) {
+				timer_end(&transpose_timer, "Transposed the output into traces.bin in %.2fs\n",
+					  timer_total_get(transpose_timer));
+			}
+			else {
+				timer_end(&transpose_timer, NULL);
+				printf("Unable to write the trace file [%s].\n", trace_filename);
+			}
+		}
+		free(frame_filename);
+		free(trace_filename);
+	}
+	if (cf) {
+		uint64_t raw_bytes, stored_bytes;
+		bool flushed = compressed_file_flush(cf);
+		compressed_file_get_sizes(cf, &raw_bytes, &stored_bytes);
+		if (!compressed_file_destroy(&cf) || !flushed) {
+			puts("Fatal error: Could not write to the output files.");
+			write_failed = true;
+		}
+		printf("Compressed output: %llu bytes in place of %llu (%.2fx).\n",
+		       (unsigned long long)stored_bytes, (unsigned long long)raw_bytes,
+		       (double)raw_bytes / stored_bytes);
+	}
+	if (nc && !container_destroy(&nc)) {
+		puts("Fatal error: Could not write to the output files.");
+		write_failed = true;
+	}
+	if (sf) {
+		uint64_t spike_count = spike_file_get_spike_count(sf);
+		if (!spike_file_destroy(&sf)) {
+			puts("Fatal error: Could not write to the output files.");
+			write_failed = true;
+		}
+		printf("Spike output: %llu spikes written.\n", (unsigned long long)spike_count);
+	}
+	if (sink) {
+		struct stream_sink_stats stats;
+		stream_sink_get_stats(sink, &stats);
+		if (!stream_sink_close(&sink)) {
+			puts("Fatal error: Could not write to the output stream.");
+			write_failed = true;
+		}
+		printf("Output stream: %llu messages sent, %llu dropped.\n",
+		       (unsigned long long)stats.messages_sent, (unsigned long long)stats.messages_dropped);
+		free(ctx.stream_frame);
+	}
+	file_table *tables[] = { &fs, &envelope_fs, &synchrony_fs, &wavefront_fs };
+	for (uint i = 0; i < sizeof tables / sizeof *tables; i++) {
+		if (*tables[i] && !file_table_destroy(tables[i])) {
+			puts("Fatal error: Could not write to the output files.");
+			write_failed = true;
+		}
+	}
+	result = write_failed ? 1 : 0;
+
+cleanup:
+	if (render_colors) {
+		color_map_destroy(&render_colors);
+	}
+	if (render_images) {
+		image_sequence_destroy(&render_images);
+	}
+	if (wavefront_fs) {
+		file_table_destroy(&wavefront_fs);
+	}
+	if (synchrony_fs) {
+		file_table_destroy(&synchrony_fs);
+	}
+	if (shm) {
+		shm_ring_destroy(&shm);
+	}
+	if (sink) {
+		stream_sink_close(&sink);
+	}
+	if (envelope_fs) {
+		file_table_destroy(&envelope_fs);
+	}
+	if (envelope_decimator) {
+		decimator_destroy(&envelope_decimator);
+	}
+	free(envelope);
+	if (sf) {
+		spike_file_destroy(&sf);
+	}
+	if (nc) {
+		container_destroy(&nc);
+	}
+	if (cf) {
+		compressed_file_destroy(&cf);
+	}
+	if (ff) {
+		frame_file_destroy(&ff);
+	}
+	if (fs) {
+		file_table_destroy(&fs);
+	}
+	if (spectrum_neurons) {
+		selection_destroy(&spectrum_neurons);
+	}
+	if (record) {
+		selection_destroy(&record);
+	}
 	dynamical_system_destroy(&ds);
-	file_table_destroy(&fs);
 	temp_free();
-	
-	return 0;
+
+	return result;
 }
 
 int print_version(void)
@@ -3,6 +3,7 @@
 #include <assert.h>
 #include <math.h>
 #include <time.h>
+#include <stdint.h>
 #include "headers/math_utils.h"
 #include "headers/dynamical_system.h"
 #include "headers/temp_memory.h"
@@ -67,15 +68,42 @@ double math_utils_lerp(double input,
 		(high_output - low_output) / (high_input - low_input);
 }
 
-double math_utils_random_number(double lowest, double highest)
+/* A xorshift64* generator is used instead of rand() so that its state
+ * can be saved to and restored from a checkpoint. */
+static uint64_t random_state;
+static bool is_seeded = false;
+
+static uint64_t next_random(void)
+{
+	if (!is_seeded) {
+		math_utils_random_state_set((uint64_t)time(NULL));
+	}
+
+	random_state ^= random_state >> 12;
+	random_state ^= random_state << 25;
+	random_state ^= random_state >> 27;
+	return random_state * 0x2545F4914F6CDD1DULL;
+}
+
+uint64_t math_utils_random_state_get(void)
 {
-	static bool is_seeded = false;
 	if (!is_seeded) {
-		srand(time(NULL));
-		is_seeded = true;
+		math_utils_random_state_set((uint64_t)time(NULL));
 	}
 
-	double normalized_random_value = rand() / (double) RAND_MAX;
+	return random_state;
+}
+
+void math_utils_random_state_set(uint64_t state)
+{
+	/* the generator is stuck at zero if the state is ever zero */
+	random_state = state ? state : 0x9E3779B97F4A7C15ULL;
+	is_seeded = true;
+}
+
+double math_utils_random_number(double lowest, double highest)
+{
+	double normalized_random_value = (next_random() >> 11) / (double)(1ULL << 53);
 	return math_utils_lerp(normalized_random_value, 0.0, 1.0, lowest, highest);
 }
 
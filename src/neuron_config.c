@@ -137,7 +137,8 @@ struct dynamical_model huber_braun_model = (struct dynamical_model) {
 		&huber_braun_da_sd_wrt_dt,
 		&huber_braun_da_sr_wrt_dt
 	},
-	.number_of_variables = 4
+	.number_of_variables = 4,
+	.variable_names = (const char *[]) { "V", "a_K", "a_sd", "a_sr" }
 };
 
 double fitzhugh_nagumo_dv_wrt_dt(dynamical_system ds, uint index)
@@ -182,7 +183,8 @@ struct dynamical_model fitzhugh_nagumo_model = (struct dynamical_model) {
 		&fitzhugh_nagumo_dv_wrt_dt,
 		&fitzhugh_nagumo_dw_wrt_dt
 	},
-	.number_of_variables = 2
+	.number_of_variables = 2,
+	.variable_names = (const char *[]) { "v", "w" }
 };
 
 static struct fitzhugh_nagumo_profile firing_profile = {
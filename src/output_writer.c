@@ -0,0 +1,198 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+#include <time.h>
+#include "headers/output_writer.h"
+
+#include "tests/headers/test_utils.h"
+
+/* A ring of preallocated frame buffers shared between the integration
+ * thread and a writer thread. The integrator acquires the slot at the
+ * head, fills it and submits it; the writer hands the slot at the tail to
+ * the write callback and only then frees it, so a slot is never reused
+ * while it is being written. The integrator only waits when every slot is
+ * full, and those waits are counted as stalls.
+ */
+struct output_writer {
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t not_full;
+	pthread_cond_t not_empty;
+	bool (*write_frame)(void *context, const void *frame);
+	void *context;
+	bool done;
+	bool failed;
+	uint slot_count;
+	uint head;
+	uint tail;
+	uint count;
+	size_t frame_size;
+	struct output_writer_stats stats;
+	unsigned char *slots;
+};
+
+static double monotonic_seconds(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *writer_main(void *arg)
+{
+	output_writer ow = arg;
+
+	pthread_mutex_lock(&ow->lock);
+	for (;;) {
+		while (ow->count == 0 && !ow->done) {
+			pthread_cond_wait(&ow->not_empty, &ow->lock);
+		}
+		if (ow->count == 0) {
+			break;
+		}
+
+		const void *frame = ow->slots + ow->tail * ow->frame_size;
+		bool skip = ow->failed;
+		pthread_mutex_unlock(&ow->lock);
+
+		bool ok = skip || ow->write_frame(ow->context, frame);
+
+		pthread_mutex_lock(&ow->lock);
+		if (!ok) {
+			ow->failed = true;
+		}
+		else if (!skip) {
+			ow->stats.frames_written++;
+		}
+		ow->tail = (ow->tail + 1) % ow->slot_count;
+		ow->count--;
+		pthread_cond_signal(&ow->not_full);
+	}
+	pthread_mutex_unlock(&ow->lock);
+
+	return NULL;
+}
+
+output_writer output_writer_create(uint slot_count, size_t frame_size,
+				   bool (*write_frame)(void *context, const void *frame),
+				   void *context)
+{
+	assert("At least two slots are needed to write while integrating." && slot_count >= 2);
+	assert(write_frame);
+
+	output_writer result = malloc(sizeof *result);
+	result->slots = malloc(slot_count * frame_size);
+	if (!result->slots) {
+		free(result);
+		return NULL;
+	}
+
+	result->write_frame = write_frame;
+	result->context = context;
+	result->done = false;
+	result->failed = false;
+	result->slot_count = slot_count;
+	result->head = result->tail = result->count = 0;
+	result->frame_size = frame_size;
+	result->stats = (struct output_writer_stats) { .slot_count = slot_count };
+
+	pthread_mutex_init(&result->lock, NULL);
+	pthread_cond_init(&result->not_full, NULL);
+	pthread_cond_init(&result->not_empty, NULL);
+
+	if (pthread_create(&result->thread, NULL, &writer_main, result)) {
+		pthread_cond_destroy(&result->not_empty);
+		pthread_cond_destroy(&result->not_full);
+		pthread_mutex_destroy(&result->lock);
+		free(result->slots);
+		free(result);
+		return NULL;
+	}
+
+	return result;
+}
+
+/* Returns the next free slot to fill, waiting for the writer to catch up
+ * if the ring is full. Must be followed by output_writer_submit. Returns
+ * NULL once a frame has failed to be written. */
+void *output_writer_acquire(output_writer ow)
+{
+	assert(ow);
+
+	pthread_mutex_lock(&ow->lock);
+	if (ow->count == ow->slot_count) {
+		double stall_start = monotonic_seconds();
+		while (ow->count == ow->slot_count) {
+			pthread_cond_wait(&ow->not_full, &ow->lock);
+		}
+		ow->stats.stalls++;
+		ow->stats.stall_seconds += monotonic_seconds() - stall_start;
+	}
+	void *frame = ow->failed ? NULL : ow->slots + ow->head * ow->frame_size;
+	pthread_mutex_unlock(&ow->lock);
+
+	return frame;
+}
+
+void output_writer_submit(output_writer ow)
+{
+	assert(ow);
+
+	pthread_mutex_lock(&ow->lock);
+	ow->head = (ow->head + 1) % ow->slot_count;
+	ow->count++;
+	if (ow->count > ow->stats.max_queued) {
+		ow->stats.max_queued = ow->count;
+	}
+	pthread_cond_signal(&ow->not_empty);
+	pthread_mutex_unlock(&ow->lock);
+}
+
+/* Waits until every submitted frame has been handed to the write callback. */
+void output_writer_flush(output_writer ow)
+{
+	assert(ow);
+
+	pthread_mutex_lock(&ow->lock);
+	while (ow->count > 0) {
+		pthread_cond_wait(&ow->not_full, &ow->lock);
+	}
+	pthread_mutex_unlock(&ow->lock);
+}
+
+void output_writer_get_stats(output_writer ow, struct output_writer_stats *stats)
+{
+	assert(ow);
+	assert(stats);
+
+	pthread_mutex_lock(&ow->lock);
+	*stats = ow->stats;
+	pthread_mutex_unlock(&ow->lock);
+}
+
+/* Writes out every submitted frame before stopping the writer thread.
+ * Returns false if any frame could not be written. */
+bool output_writer_destroy(output_writer *ow)
+{
+	assert(ow);
+	assert(*ow);
+
+	pthread_mutex_lock(&(*ow)->lock);
+	(*ow)->done = true;
+	pthread_cond_signal(&(*ow)->not_empty);
+	pthread_mutex_unlock(&(*ow)->lock);
+	pthread_join((*ow)->thread, NULL);
+
+	bool result = !(*ow)->failed;
+
+	pthread_cond_destroy(&(*ow)->not_empty);
+	pthread_cond_destroy(&(*ow)->not_full);
+	pthread_mutex_destroy(&(*ow)->lock);
+	free((*ow)->slots);
+	free(*ow);
+	*ow = NULL;
+
+	return result;
+}
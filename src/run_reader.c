@@ -0,0 +1,382 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include "headers/run_reader.h"
+#include "headers/spike_file.h"
+#include "headers/trace_file.h"
+
+#include "tests/headers/test_utils.h"
+
+/* Gives direct access to the binary output of a run, frames.bin and
+ * spikes.aer, without parsing any text.
+ *
+ * frames.bin is mapped by a frame_reader, and every view handed out points
+ * straight into the mapping: a frame is one contiguous column, and the
+ * trace of a neuron is the same value taken every frame_size bytes. Since
+ * frames are sampled every print_time, the frame of a time is computed
+ * directly, and only searched for if the sampling was irregular. If the
+ * run was also transposed into traces.bin, traces are viewed from there
+ * instead, where they are contiguous.
+ *
+ * spikes.aer is block encoded, so its spikes are decoded once on opening
+ * into arrays of times and neurons. The time range they cover is split
+ * into equally wide buckets, one per SPIKES_PER_BUCKET spikes, and the
+ * index of the first spike of every bucket is kept, so that a window is
+ * found by computing its bucket and searching the spikes within it. A
+ * burst may put most spikes into a single bucket, so that search is a
+ * binary one.
+ */
+struct run_reader {
+	frame_reader fr;
+	trace_reader tr;
+	double frame_tolerance;
+	uint64_t spike_count;
+	double *spike_times;
+	uint32_t *spike_neurons;
+	uint64_t bucket_count;
+	uint64_t *bucket_start;
+	double bucket_width;
+	double spike_tolerance;
+};
+
+#define SPIKES_PER_BUCKET 8
+
+static char *path_join(const char *dirname, const char *filename)
+{
+	char *path = malloc(strlen(dirname) + strlen(filename) + 2);
+	strcpy(path, dirname);
+	strcat(path, "/");
+	strcat(path, filename);
+	return path;
+}
+
+static uint64_t spike_bucket(run_reader rr, double time)
+{
+	double bucket = floor((time - rr->spike_times[0]) / rr->bucket_width);
+	if (bucket < 0.0) {
+		return 0;
+	}
+	return bucket >= rr->bucket_count ? rr->bucket_count - 1 : (uint64_t)bucket;
+}
+
+/* Decodes every complete block of the spike file and indexes the spikes.
+ * Returns false if the file is damaged or its spikes are not in order. */
+static bool load_spikes(run_reader rr, spike_reader sr)
+{
+	struct spike_file_layout layout;
+	spike_reader_get_layout(sr, &layout);
+	rr->spike_tolerance = layout.time_step / 2;
+
+	uint64_t capacity = SPIKE_FILE_BLOCK_SPIKES;
+	rr->spike_times = malloc((sizeof *rr->spike_times) * capacity);
+	rr->spike_neurons = malloc((sizeof *rr->spike_neurons) * capacity);
+	uint spike_count;
+	while ((spike_count = spike_reader_next_block(sr))) {
+		if (rr->spike_count + spike_count > capacity) {
+			while (rr->spike_count + spike_count > capacity) {
+				capacity *= 2;
+			}
+			rr->spike_times = realloc(rr->spike_times, (sizeof *rr->spike_times) * capacity);
+			rr->spike_neurons = realloc(rr->spike_neurons, (sizeof *rr->spike_neurons) * capacity);
+		}
+		for (uint spike = 0; spike < spike_count; spike++, rr->spike_count++) {
+			rr->spike_times[rr->spike_count] = spike_reader_get_time(sr, spike);
+			rr->spike_neurons[rr->spike_count] = spike_reader_get_neuron(sr, spike);
+			if (rr->spike_count && rr->spike_times[rr->spike_count] < rr->spike_times[rr->spike_count - 1]) {
+				return false;
+			}
+		}
+	}
+
+	rr->bucket_count = rr->spike_count / SPIKES_PER_BUCKET + 1;
+	rr->bucket_width = rr->spike_count
+		? (rr->spike_times[rr->spike_count - 1] - rr->spike_times[0]) / rr->bucket_count : 0.0;
+	if (rr->bucket_width <= 0.0) {
+		rr->bucket_width = 1.0;
+	}
+	rr->bucket_start = malloc((sizeof *rr->bucket_start) * (rr->bucket_count + 1));
+	uint64_t spike = 0;
+	for (uint64_t bucket = 0; bucket < rr->bucket_count; bucket++) {
+		while (spike < rr->spike_count && spike_bucket(rr, rr->spike_times[spike]) < bucket) {
+			spike++;
+		}
+		rr->bucket_start[bucket] = spike;
+	}
+	rr->bucket_start[rr->bucket_count] = rr->spike_count;
+	return true;
+}
+
+/* Opens frames.bin and spikes.aer within the directory. Either may be
+ * missing, but not both. */
+run_reader run_reader_open(const char *dirname)
+{
+	assert(dirname);
+
+	char *frame_filename = path_join(dirname, "frames.bin");
+	char *trace_filename = path_join(dirname, "traces.bin");
+	char *spike_filename = path_join(dirname, "spikes.aer");
+	frame_reader fr = frame_reader_open(frame_filename);
+	trace_reader tr = fr ? trace_reader_open(trace_filename) : NULL;
+	spike_reader sr = spike_reader_open(spike_filename);
+	free(frame_filename);
+	free(trace_filename);
+	free(spike_filename);
+
+	/* traces written before the run was continued are out of date */
+	if (tr && trace_reader_get_frame_count(tr) != frame_reader_get_frame_count(fr)) {
+		trace_reader_close(&tr);
+	}
+
+	if (!fr && !sr) {
+		return NULL;
+	}
+
+	run_reader result = calloc(1, sizeof *result);
+	result->fr = fr;
+	result->tr = tr;
+	if (fr) {
+		struct frame_file_layout layout;
+		frame_reader_get_layout(fr, &layout);
+		result->frame_tolerance = layout.time_step / 2;
+	}
+	if (sr) {
+		bool loaded = load_spikes(result, sr);
+		spike_reader_close(&sr);
+		if (!loaded) {
+			run_reader_close(&result);
+		}
+	}
+	return result;
+}
+
+bool run_reader_has_frames(run_reader rr)
+{
+	assert(rr);
+	return rr->fr != NULL;
+}
+
+bool run_reader_has_spikes(run_reader rr)
+{
+	assert(rr);
+	return rr->spike_times != NULL;
+}
+
+void run_reader_get_layout(run_reader rr, struct frame_file_layout *layout)
+{
+	assert(rr);
+	assert("The run has no frames." && rr->fr);
+	frame_reader_get_layout(rr->fr, layout);
+}
+
+uint64_t run_reader_get_frame_count(run_reader rr)
+{
+	assert(rr);
+	return rr->fr ? frame_reader_get_frame_count(rr->fr) : 0;
+}
+
+/* Returns the first frame whose time is not below the given time, or the
+ * frame count if there is none. */
+static uint64_t frame_lower_bound(run_reader rr, double time)
+{
+	frame_reader fr = rr->fr;
+	uint64_t frame_count = frame_reader_get_frame_count(fr);
+	double first_time = frame_reader_get_time(fr, 0);
+	double last_time = frame_reader_get_time(fr, frame_count - 1);
+	if (time <= first_time) {
+		return 0;
+	}
+	if (time > last_time) {
+		return frame_count;
+	}
+
+	/* frames are evenly spaced unless the run was restarted off the grid */
+	uint64_t guess = (uint64_t)ceil((time - first_time) / (last_time - first_time) * (frame_count - 1));
+	if (guess < frame_count && frame_reader_get_time(fr, guess) >= time
+	    && (guess == 0 || frame_reader_get_time(fr, guess - 1) < time)) {
+		return guess;
+	}
+
+	uint64_t low = 0, high = frame_count;
+	while (low < high) {
+		uint64_t middle = low + (high - low) / 2;
+		if (frame_reader_get_time(fr, middle) < time) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+	return low;
+}
+
+/* Finds the frame sampled at the given time, which may be off by less than
+ * half a time step. Returns false if there is none. */
+bool run_reader_find_frame(run_reader rr, double time, uint64_t *frame)
+{
+	assert(rr);
+	assert(frame);
+
+	if (!run_reader_get_frame_count(rr)) {
+		return false;
+	}
+	*frame = frame_lower_bound(rr, time - rr->frame_tolerance);
+	return *frame < frame_reader_get_frame_count(rr->fr)
+		&& frame_reader_get_time(rr->fr, *frame) <= time + rr->frame_tolerance;
+}
+
+/* Views one variable of every neuron in the frame sampled at the given
+ * time, in the row-major layout of the grid. */
+bool run_reader_get_frame(run_reader rr, double time, uint variable, double *frame_time, struct run_view *view)
+{
+	assert(view);
+
+	uint64_t frame;
+	if (!run_reader_find_frame(rr, time, &frame)) {
+		return false;
+	}
+
+	struct frame_file_layout layout;
+	frame_reader_get_layout(rr->fr, &layout);
+	if (frame_time) {
+		*frame_time = frame_reader_get_time(rr->fr, frame);
+	}
+	view->data = frame_reader_get_column(rr->fr, frame, variable);
+	view->count = layout.system_size;
+	view->stride = layout.value_size;
+	view->value_size = layout.value_size;
+	return true;
+}
+
+/* Views the times of the frames sampled between both times, inclusive, and
+ * one variable of one neuron in each of them. Either view may be NULL. */
+bool run_reader_get_trace(run_reader rr, uint neuron, uint variable, double begin_time, double end_time,
+			  struct run_view *times, struct run_view *values)
+{
+	assert(rr);
+
+	if (!run_reader_get_frame_count(rr)) {
+		return false;
+	}
+	struct frame_file_layout layout;
+	frame_reader_get_layout(rr->fr, &layout);
+	assert("Given an invalid neuron." && neuron < layout.system_size);
+
+	uint64_t begin = frame_lower_bound(rr, begin_time - rr->frame_tolerance);
+	uint64_t end = frame_lower_bound(rr, nextafter(end_time + rr->frame_tolerance, INFINITY));
+	if (begin >= end) {
+		return false;
+	}
+
+	if (rr->tr) {
+		if (times) {
+			times->data = (const unsigned char *)(trace_reader_get_times(rr->tr) + begin);
+			times->count = end - begin;
+			times->stride = sizeof (double);
+			times->value_size = sizeof (double);
+		}
+		if (values) {
+			values->data = (const unsigned char *)trace_reader_get_trace(rr->tr, neuron, variable)
+				+ begin * layout.value_size;
+			values->count = end - begin;
+			values->stride = layout.value_size;
+			values->value_size = layout.value_size;
+		}
+		return true;
+	}
+
+	uint64_t frame_size = frame_reader_get_frame_size(rr->fr);
+	if (times) {
+		/* the time leads every frame, right before its first column */
+		times->data = (const unsigned char *)frame_reader_get_column(rr->fr, begin, 0) - sizeof (double);
+		times->count = end - begin;
+		times->stride = frame_size;
+		times->value_size = sizeof (double);
+	}
+	if (values) {
+		values->data = (const unsigned char *)frame_reader_get_column(rr->fr, begin, variable)
+			+ (uint64_t)neuron * layout.value_size;
+		values->count = end - begin;
+		values->stride = frame_size;
+		values->value_size = layout.value_size;
+	}
+	return true;
+}
+
+uint64_t run_reader_get_spike_count(run_reader rr)
+{
+	assert(rr);
+	return rr->spike_count;
+}
+
+/* Returns the first spike whose time is not below the given time. */
+static uint64_t spike_lower_bound(run_reader rr, double time)
+{
+	if (!rr->spike_count || time <= rr->spike_times[0]) {
+		return 0;
+	}
+	/* buckets grow with time, so the spike is within the bucket of the time */
+	uint64_t bucket = spike_bucket(rr, time);
+	uint64_t low = rr->bucket_start[bucket];
+	uint64_t high = rr->bucket_start[bucket + 1];
+	while (low < high) {
+		uint64_t middle = low + (high - low) / 2;
+		if (rr->spike_times[middle] < time) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+	return low;
+}
+
+/* Points times and neurons to the spikes between both times, inclusive, in
+ * the order of time, and returns how many there are. */
+uint64_t run_reader_get_spikes(run_reader rr, double begin_time, double end_time,
+			       const double **times, const uint32_t **neurons)
+{
+	assert(rr);
+	assert(times);
+	assert(neurons);
+
+	uint64_t begin = spike_lower_bound(rr, begin_time - rr->spike_tolerance);
+	uint64_t end = spike_lower_bound(rr, nextafter(end_time + rr->spike_tolerance, INFINITY));
+	*times = rr->spike_times + begin;
+	*neurons = rr->spike_neurons + begin;
+	return end > begin ? end - begin : 0;
+}
+
+void run_reader_close(run_reader *rr)
+{
+	assert(rr);
+	assert(*rr);
+
+	if ((*rr)->fr) {
+		frame_reader_close(&(*rr)->fr);
+	}
+	if ((*rr)->tr) {
+		trace_reader_close(&(*rr)->tr);
+	}
+	free((*rr)->spike_times);
+	free((*rr)->spike_neurons);
+	free((*rr)->bucket_start);
+	free(*rr);
+	*rr = NULL;
+}
+
+double run_view_get(const struct run_view *view, uint64_t i)
+{
+	assert(view);
+	assert("Given an invalid index." && i < view->count);
+
+	const unsigned char *value = view->data + i * view->stride;
+	if (view->value_size == sizeof (double)) {
+		double result;
+		memcpy(&result, value, sizeof result);
+		return result;
+	}
+	float result;
+	memcpy(&result, value, sizeof result);
+	return result;
+}
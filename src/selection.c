@@ -0,0 +1,271 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <ctype.h>
+#include <limits.h>
+#include <stdint.h>
+#include "headers/selection.h"
+
+#include "tests/headers/test_utils.h"
+
+/* Chooses which neurons and which of their dynamical variables are
+ * recorded. Both are kept as ascending lists of indices, so that gathering
+ * a sample copies only the selected values, in the order of the state.
+ *
+ * A neuron specification is a comma separated list of items:
+ *   I          the neuron with index I
+ *   I-J        the neurons from I to J
+ *   X:Y        the neuron in column X and row Y of the grid
+ *   X0:Y0-X1:Y1  the rectangular region of the grid between both corners
+ *   *          every neuron
+ * Any item but a single neuron may end in /S to take only every S-th
+ * neuron, or every S-th row and column of a region.
+ *
+ * A variable specification is a comma separated list of variable names or
+ * indices. A NULL specification selects everything.
+ */
+struct selection {
+	uint neuron_count;
+	uint *neurons;
+	uint variable_count;
+	uint *variables;
+	uint element_size;
+};
+
+static bool parse_uint(const char **str, uint *value)
+{
+	if (!isdigit((unsigned char)**str)) {
+		return false;
+	}
+
+	unsigned long result = 0;
+	while (isdigit((unsigned char)**str)) {
+		result = result * 10 + (**str - '0');
+		if (result > UINT_MAX) {
+			return false;
+		}
+		(*str)++;
+	}
+	*value = (uint)result;
+	return true;
+}
+
+/* Parses an index, or a grid cell if it is followed by a row. */
+static bool parse_point(const char **str, uint *col, uint *row, bool *is_cell)
+{
+	if (!parse_uint(str, col)) {
+		return false;
+	}
+	*is_cell = **str == ':';
+	if (*is_cell) {
+		(*str)++;
+		return parse_uint(str, row);
+	}
+	return true;
+}
+
+/* Marks the neurons of one item and advances str past it. */
+static bool parse_neuron_item(const char **str, bool *marks, uint system_size, uint grid_width, uint grid_height)
+{
+	uint first = 0, last = system_size - 1;
+	uint first_row = 0, last_row = 0;
+	bool is_cell = false, is_range = true;
+
+	if (**str == '*') {
+		(*str)++;
+	}
+	else {
+		if (!parse_point(str, &first, &first_row, &is_cell)) {
+			return false;
+		}
+		last = first;
+		last_row = first_row;
+		is_range = **str == '-';
+		if (is_range) {
+			bool last_is_cell;
+			(*str)++;
+			if (!parse_point(str, &last, &last_row, &last_is_cell) || last_is_cell != is_cell) {
+				return false;
+			}
+		}
+	}
+
+	uint stride = 1;
+	if (**str == '/') {
+		(*str)++;
+		if (!is_range || !parse_uint(str, &stride) || stride == 0) {
+			return false;
+		}
+	}
+	if (**str != ',' && **str != '\0') {
+		return false;
+	}
+
+	if (is_cell) {
+		/* the grid may be larger than the network, whose first neurons it covers */
+		if (first > last || first_row > last_row || last >= grid_width || last_row >= grid_height
+		    || (uint64_t)last_row * grid_width + last >= system_size) {
+			return false;
+		}
+		for (uint row = first_row; row <= last_row; row += stride) {
+			for (uint col = first; col <= last; col += stride) {
+				marks[row * grid_width + col] = true;
+			}
+		}
+	}
+	else {
+		if (first > last || last >= system_size) {
+			return false;
+		}
+		for (uint i = first; i <= last && i >= first; i += stride) {
+			marks[i] = true;
+		}
+	}
+	return true;
+}
+
+static bool parse_variable_item(const char **str, bool *marks, uint element_size, const char **variable_names)
+{
+	size_t length = strcspn(*str, ",");
+	uint variable;
+	const char *end = *str;
+	if (parse_uint(&end, &variable) && end == *str + length) {
+		if (variable >= element_size) {
+			return false;
+		}
+	}
+	else {
+		for (variable = 0; variable < element_size; variable++) {
+			if (strlen(variable_names[variable]) == length && !strncmp(variable_names[variable], *str, length)) {
+				break;
+			}
+		}
+		if (variable == element_size) {
+			return false;
+		}
+	}
+
+	marks[variable] = true;
+	*str += length;
+	return true;
+}
+
+/* Turns the marked indices into an ascending list, and returns its length. */
+static uint collect(const bool *marks, uint count, uint **indices)
+{
+	uint result = 0;
+	for (uint i = 0; i < count; i++) {
+		result += marks[i];
+	}
+
+	*indices = malloc((sizeof **indices) * (result ? result : 1));
+	for (uint i = 0, j = 0; i < count; i++) {
+		if (marks[i]) {
+			(*indices)[j++] = i;
+		}
+	}
+	return result;
+}
+
+/* Returns NULL if either specification is malformed, names something
+ * outside the system or selects nothing. */
+selection selection_create(const char *neuron_spec, const char *variable_spec,
+			   uint system_size, uint grid_width, uint grid_height,
+			   uint element_size, const char **variable_names)
+{
+	assert(system_size > 0);
+	assert(element_size > 0);
+	assert(variable_names);
+
+	bool *neuron_marks = calloc(system_size, sizeof *neuron_marks);
+	bool *variable_marks = calloc(element_size, sizeof *variable_marks);
+	bool valid = true;
+
+	const char *str = neuron_spec ? neuron_spec : "*";
+	while (valid) {
+		valid = parse_neuron_item(&str, neuron_marks, system_size, grid_width, grid_height);
+		if (*str++ != ',') {
+			break;
+		}
+	}
+
+	if (variable_spec) {
+		str = variable_spec;
+		while (valid) {
+			valid = parse_variable_item(&str, variable_marks, element_size, variable_names);
+			if (*str++ != ',') {
+				break;
+			}
+		}
+	}
+	else {
+		memset(variable_marks, true, (sizeof *variable_marks) * element_size);
+	}
+
+	selection result = NULL;
+	if (valid) {
+		result = malloc(sizeof *result);
+		result->neuron_count = collect(neuron_marks, system_size, &result->neurons);
+		result->variable_count = collect(variable_marks, element_size, &result->variables);
+		result->element_size = element_size;
+		if (!result->neuron_count || !result->variable_count) {
+			selection_destroy(&result);
+		}
+	}
+
+	free(neuron_marks);
+	free(variable_marks);
+	return result;
+}
+
+uint selection_get_neuron_count(selection s)
+{
+	assert(s);
+	return s->neuron_count;
+}
+
+const uint *selection_get_neurons(selection s)
+{
+	assert(s);
+	return s->neurons;
+}
+
+uint selection_get_variable_count(selection s)
+{
+	assert(s);
+	return s->variable_count;
+}
+
+const uint *selection_get_variables(selection s)
+{
+	assert(s);
+	return s->variables;
+}
+
+/* Copies the selected values out of the row-major layout of the dynamical
+ * system, into the variables of the first selected neuron, then of the
+ * next and so on. */
+void selection_gather(selection s, const double *values, double *out)
+{
+	assert(s);
+	assert(values);
+	assert(out);
+
+	for (uint i = 0; i < s->neuron_count; i++) {
+		const double *neuron_values = values + (size_t)s->neurons[i] * s->element_size;
+		for (uint j = 0; j < s->variable_count; j++) {
+			*out++ = neuron_values[s->variables[j]];
+		}
+	}
+}
+
+void selection_destroy(selection *s)
+{
+	assert(s);
+	assert(*s);
+
+	free((*s)->neurons);
+	free((*s)->variables);
+	free(*s);
+	*s = NULL;
+}
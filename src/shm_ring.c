@@ -0,0 +1,303 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "headers/shm_ring.h"
+
+#include "tests/headers/test_utils.h"
+
+/* Publishes frames into a POSIX shared memory object that any number of
+ * processes can map and read without ever holding up the writer.
+ *
+ * The object is the header below followed by slot_count slots of
+ * slot_size bytes, frame i going into slot i % slot_count. Each slot is a
+ * struct slot_header followed by the values of the frame. The sequence of
+ * a slot works as a seqlock: the writer makes it odd before touching the
+ * slot and even again afterwards, so a reader that sees the same even
+ * sequence before and after reading a slot knows that it read one whole
+ * frame. published counts the frames written so far, and closed is set
+ * once the writer is done.
+ */
+struct shm_ring_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t header_size;
+	uint32_t system_size;
+	uint32_t grid_width;
+	uint32_t grid_height;
+	uint32_t variable_count;
+	uint32_t slot_count;
+	uint32_t closed;
+	uint64_t slot_size;
+	uint64_t published;
+	double time_step;
+	double print_time;
+};
+
+struct slot_header {
+	uint64_t sequence;
+	uint64_t frame;
+	uint64_t time;
+	uint64_t reserved;
+};
+
+static const char shm_ring_magic[8] = "NNSHMRG";
+
+/* slots start, and are padded, to whole cache lines */
+#define SLOT_ALIGNMENT 64
+#define HEADER_SPACE (((sizeof (struct shm_ring_header)) + SLOT_ALIGNMENT - 1) & ~(size_t)(SLOT_ALIGNMENT - 1))
+
+struct shm_ring {
+	char *name;
+	struct shm_ring_header *header;
+	size_t size;
+	uint64_t published;
+};
+
+struct shm_reader {
+	const struct shm_ring_header *header;
+	size_t size;
+};
+
+static uint64_t slot_size_for(uint system_size, uint variable_count)
+{
+	uint64_t size = sizeof (struct slot_header) + (uint64_t)system_size * variable_count * sizeof (double);
+	return (size + SLOT_ALIGNMENT - 1) & ~(uint64_t)(SLOT_ALIGNMENT - 1);
+}
+
+static struct slot_header *slot_at(const struct shm_ring_header *header, uint64_t frame)
+{
+	return (struct slot_header *)((char *)header + HEADER_SPACE + (frame % header->slot_count) * header->slot_size);
+}
+
+/* Creates, or replaces, the shared memory object of the given name, which
+ * must start with a slash. */
+shm_ring shm_ring_create(const char *name, const struct shm_ring_layout *layout)
+{
+	assert(name);
+	assert(layout);
+	assert("The ring needs at least two slots." && layout->slot_count >= 2);
+
+	uint64_t slot_size = slot_size_for(layout->system_size, layout->variable_count);
+	size_t size = HEADER_SPACE + layout->slot_count * slot_size;
+
+	int fd = shm_open(name, O_CREAT | O_RDWR | O_TRUNC, 0644);
+	if (fd < 0) {
+		return NULL;
+	}
+	if (ftruncate(fd, size)) {
+		close(fd);
+		shm_unlink(name);
+		return NULL;
+	}
+	void *mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED) {
+		shm_unlink(name);
+		return NULL;
+	}
+
+	shm_ring result = malloc(sizeof *result);
+	result->name = malloc(strlen(name) + 1);
+	strcpy(result->name, name);
+	result->header = mapping;
+	result->size = size;
+	result->published = 0;
+
+	struct shm_ring_header *header = result->header;
+	header->version = SHM_RING_VERSION;
+	header->header_size = sizeof *header;
+	header->system_size = layout->system_size;
+	header->grid_width = layout->grid_width;
+	header->grid_height = layout->grid_height;
+	header->variable_count = layout->variable_count;
+	header->slot_count = layout->slot_count;
+	header->slot_size = slot_size;
+	header->time_step = layout->time_step;
+	header->print_time = layout->print_time;
+	/* readers only trust the header once the magic is in place */
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	memcpy(header->magic, shm_ring_magic, sizeof header->magic);
+
+	return result;
+}
+
+/* Takes the values in the row-major layout of the dynamical system and
+ * overwrites the oldest slot with them. Never waits for readers. */
+void shm_ring_publish(shm_ring ring, double time, const double *values)
+{
+	assert(ring);
+	assert(values);
+
+	struct shm_ring_header *header = ring->header;
+	struct slot_header *slot = slot_at(header, ring->published);
+	uint64_t sequence = slot->sequence;
+
+	__atomic_store_n(&slot->sequence, sequence + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	uint64_t time_bits;
+	memcpy(&time_bits, &time, sizeof time);
+	__atomic_store_n(&slot->frame, ring->published, __ATOMIC_RELAXED);
+	__atomic_store_n(&slot->time, time_bits, __ATOMIC_RELAXED);
+	memcpy(slot + 1, values, (sizeof *values) * header->system_size * header->variable_count);
+
+	__atomic_store_n(&slot->sequence, sequence + 2, __ATOMIC_RELEASE);
+	__atomic_store_n(&header->published, ++ring->published, __ATOMIC_RELEASE);
+}
+
+/* Marks the ring as closed for the readers attached to it and removes its
+ * name, so that no new reader can attach. */
+void shm_ring_destroy(shm_ring *ring)
+{
+	assert(ring);
+	assert(*ring);
+
+	__atomic_store_n(&(*ring)->header->closed, 1, __ATOMIC_RELEASE);
+	munmap((*ring)->header, (*ring)->size);
+	shm_unlink((*ring)->name);
+	free((*ring)->name);
+	free(*ring);
+	*ring = NULL;
+}
+
+shm_reader shm_reader_open(const char *name)
+{
+	assert(name);
+
+	int fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0) {
+		return NULL;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) || st.st_size < (off_t)HEADER_SPACE) {
+		close(fd);
+		return NULL;
+	}
+	void *mapping = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED) {
+		return NULL;
+	}
+
+	const struct shm_ring_header *header = mapping;
+	bool valid = !memcmp(header->magic, shm_ring_magic, sizeof header->magic);
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	valid = valid
+		&& header->version == SHM_RING_VERSION
+		&& header->header_size == sizeof *header
+		&& header->slot_count >= 2
+		&& header->slot_size == slot_size_for(header->system_size, header->variable_count)
+		&& HEADER_SPACE + header->slot_count * header->slot_size <= (uint64_t)st.st_size;
+	if (!valid) {
+		munmap(mapping, st.st_size);
+		return NULL;
+	}
+
+	shm_reader result = malloc(sizeof *result);
+	result->header = header;
+	result->size = st.st_size;
+	return result;
+}
+
+void shm_reader_get_layout(shm_reader reader, struct shm_ring_layout *layout)
+{
+	assert(reader);
+	assert(layout);
+
+	layout->system_size = reader->header->system_size;
+	layout->grid_width = reader->header->grid_width;
+	layout->grid_height = reader->header->grid_height;
+	layout->variable_count = reader->header->variable_count;
+	layout->slot_count = reader->header->slot_count;
+	layout->time_step = reader->header->time_step;
+	layout->print_time = reader->header->print_time;
+}
+
+/* Returns the number of frames published so far. The last slot_count of
+ * them may still be in the ring. */
+uint64_t shm_reader_get_published(shm_reader reader)
+{
+	assert(reader);
+	return __atomic_load_n(&reader->header->published, __ATOMIC_ACQUIRE);
+}
+
+bool shm_reader_is_closed(shm_reader reader)
+{
+	assert(reader);
+	return __atomic_load_n(&reader->header->closed, __ATOMIC_ACQUIRE);
+}
+
+/* Gives direct access to the values of a frame, without copying them.
+ * Returns NULL if the frame is not in the ring, or is being written. The
+ * values may be overwritten while they are used, so they are only to be
+ * trusted if shm_reader_validate then succeeds with the same sequence. */
+const double *shm_reader_peek(shm_reader reader, uint64_t frame, double *time, uint64_t *sequence)
+{
+	assert(reader);
+	assert(time);
+	assert(sequence);
+
+	const struct slot_header *slot = slot_at(reader->header, frame);
+	*sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+	if ((*sequence & 1) || __atomic_load_n(&slot->frame, __ATOMIC_RELAXED) != frame
+	    || frame >= shm_reader_get_published(reader)) {
+		return NULL;
+	}
+
+	uint64_t time_bits = __atomic_load_n(&slot->time, __ATOMIC_RELAXED);
+	memcpy(time, &time_bits, sizeof *time);
+	return (const double *)(slot + 1);
+}
+
+/* Tells whether the frame returned by shm_reader_peek with the given
+ * sequence stayed untouched until now. */
+bool shm_reader_validate(shm_reader reader, uint64_t frame, uint64_t sequence)
+{
+	assert(reader);
+
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return __atomic_load_n(&slot_at(reader->header, frame)->sequence, __ATOMIC_RELAXED) == sequence;
+}
+
+/* Copies the time and the values of a frame. Returns false if the frame is
+ * no longer, or not yet, in the ring. */
+bool shm_reader_read(shm_reader reader, uint64_t frame, double *time, double *values)
+{
+	assert(reader);
+	assert(values);
+
+	for (;;) {
+		uint64_t sequence;
+		const double *slot_values = shm_reader_peek(reader, frame, time, &sequence);
+		if (!slot_values) {
+			/* retry only while the writer is in the middle of this very frame */
+			if (frame >= shm_reader_get_published(reader)
+			    || frame + reader->header->slot_count <= shm_reader_get_published(reader)) {
+				return false;
+			}
+			continue;
+		}
+		memcpy(values, slot_values,
+		       (sizeof *values) * reader->header->system_size * reader->header->variable_count);
+		if (shm_reader_validate(reader, frame, sequence)) {
+			return true;
+		}
+	}
+}
+
+void shm_reader_close(shm_reader *reader)
+{
+	assert(reader);
+	assert(*reader);
+
+	munmap((void *)(*reader)->header, (*reader)->size);
+	free(*reader);
+	*reader = NULL;
+}
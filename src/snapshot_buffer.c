@@ -0,0 +1,98 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+#include "headers/snapshot_buffer.h"
+
+#include "tests/headers/test_utils.h"
+
+/* Hands snapshots of the state from one writer thread to one reader
+ * thread without locks, and without either of them ever waiting.
+ *
+ * There are three buffers: the writer fills its own, the reader reads its
+ * own, and the third one holds the last snapshot published. Publishing
+ * swaps the buffer of the writer with the third one, and taking swaps the
+ * buffer of the reader with it if it holds a snapshot that the reader has
+ * not seen yet. Both swaps are one atomic exchange of the index of the
+ * third buffer, along with a flag telling whether it is fresh. The writer
+ * can publish at any rate; snapshots that the reader does not take in
+ * time are overwritten.
+ */
+#define BUFFER_COUNT 3
+#define FRESH 4u
+
+struct snapshot_buffer {
+	double *values[BUFFER_COUNT];
+	double times[BUFFER_COUNT];
+	unsigned middle;
+	unsigned writing;
+	unsigned reading;
+	bool has_snapshot;
+};
+
+snapshot_buffer snapshot_buffer_create(size_t value_count)
+{
+	assert(value_count > 0);
+
+	snapshot_buffer result = malloc(sizeof *result);
+	for (unsigned i = 0; i < BUFFER_COUNT; i++) {
+		result->values[i] = malloc((sizeof *result->values[i]) * value_count);
+		result->times[i] = 0.0;
+	}
+	result->writing = 0;
+	result->middle = 1;
+	result->reading = 2;
+	result->has_snapshot = false;
+
+	return result;
+}
+
+/* Returns the buffer that the next snapshot is to be written into. Only
+ * to be called by the writer. */
+double *snapshot_buffer_begin(snapshot_buffer sb)
+{
+	assert(sb);
+	return sb->values[sb->writing];
+}
+
+/* Makes the buffer returned by snapshot_buffer_begin the latest snapshot. */
+void snapshot_buffer_publish(snapshot_buffer sb, double time)
+{
+	assert(sb);
+
+	sb->times[sb->writing] = time;
+	unsigned previous = __atomic_exchange_n(&sb->middle, sb->writing | FRESH, __ATOMIC_ACQ_REL);
+	sb->writing = previous & ~FRESH;
+}
+
+/* Returns the latest snapshot and its time, which stay untouched until the
+ * next call. Returns NULL while nothing has been published. Only to be
+ * called by the reader. */
+const double *snapshot_buffer_take(snapshot_buffer sb, double *time)
+{
+	assert(sb);
+	assert(time);
+
+	if (__atomic_load_n(&sb->middle, __ATOMIC_ACQUIRE) & FRESH) {
+		unsigned previous = __atomic_exchange_n(&sb->middle, sb->reading, __ATOMIC_ACQ_REL);
+		sb->reading = previous & ~FRESH;
+		sb->has_snapshot = true;
+	}
+	if (!sb->has_snapshot) {
+		return NULL;
+	}
+
+	*time = sb->times[sb->reading];
+	return sb->values[sb->reading];
+}
+
+void snapshot_buffer_destroy(snapshot_buffer *sb)
+{
+	assert(sb);
+	assert(*sb);
+
+	for (unsigned i = 0; i < BUFFER_COUNT; i++) {
+		free((*sb)->values[i]);
+	}
+	free(*sb);
+	*sb = NULL;
+}
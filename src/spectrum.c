@@ -0,0 +1,309 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include "headers/spectrum.h"
+
+#include "tests/headers/test_utils.h"
+
+#define TWO_PI 6.28318530717958647692
+
+/* Estimates the power spectral density of a number of channels with
+ * Welch's method, from samples taken while the system is integrated, so
+ * that no trace has to be stored.
+ *
+ * The last window_length samples of every channel are kept in a ring. Once
+ * it is full, and then every hop samples, the ring is taken as a segment:
+ * its mean is removed, it is multiplied by a periodic Hann window, and the
+ * squared magnitudes of its Fourier transform are added to the power sums
+ * of the channel. The densities are these sums averaged over the segments,
+ * one-sided and scaled to units squared per hertz.
+ *
+ * The transform is an iterative radix-2 FFT over tables of twiddle factors
+ * and bit-reversed indices computed once. Channels are real, so they are
+ * transformed two at a time, one as the real part and the other as the
+ * imaginary part of the input, and separated afterwards through the
+ * symmetry of the transform of a real signal.
+ */
+struct spectrum {
+	uint channel_count;
+	uint length;
+	uint hop;
+	double sample_rate;
+	double *window;
+	double window_power;
+	double *history;
+	uint64_t sample_count;
+	uint segment_count;
+	double *real;
+	double *imaginary;
+	double *cosines;
+	double *sines;
+	uint *reversed;
+	double *power;
+};
+
+/* sample_time is the time between two samples, in milliseconds. */
+spectrum spectrum_create(uint channel_count, double sample_time, const struct spectrum_options *options)
+{
+	assert(channel_count > 0);
+	assert(sample_time > 0.0);
+	assert(options);
+	assert("The window length must be a power of two." &&
+	       options->window_length >= 4 && !(options->window_length & (options->window_length - 1)));
+	assert(options->overlap >= 0.0 && options->overlap < 1.0);
+
+	spectrum result = malloc(sizeof *result);
+	uint n = options->window_length;
+	result->channel_count = channel_count;
+	result->length = n;
+	result->hop = n - (uint)(options->overlap * n);
+	result->sample_rate = 1000.0 / sample_time;
+	result->sample_count = 0;
+	result->segment_count = 0;
+
+	result->window = malloc((sizeof *result->window) * n);
+	result->window_power = 0.0;
+	for (uint i = 0; i < n; i++) {
+		result->window[i] = 0.5 - 0.5 * cos(TWO_PI * i / n);
+		result->window_power += result->window[i] * result->window[i];
+	}
+
+	result->cosines = malloc((sizeof *result->cosines) * n / 2);
+	result->sines = malloc((sizeof *result->sines) * n / 2);
+	for (uint i = 0; i < n / 2; i++) {
+		result->cosines[i] = cos(TWO_PI * i / n);
+		result->sines[i] = -sin(TWO_PI * i / n);
+	}
+	uint bits = 0;
+	while ((1u << bits) < n) {
+		bits++;
+	}
+	result->reversed = malloc((sizeof *result->reversed) * n);
+	for (uint i = 0; i < n; i++) {
+		uint reversed = 0;
+		for (uint b = 0; b < bits; b++) {
+			reversed |= ((i >> b) & 1) << (bits - 1 - b);
+		}
+		result->reversed[i] = reversed;
+	}
+
+	result->history = malloc((sizeof *result->history) * n * channel_count);
+	result->real = malloc((sizeof *result->real) * n);
+	result->imaginary = malloc((sizeof *result->imaginary) * n);
+	result->power = calloc((size_t)(n / 2 + 1) * channel_count, sizeof *result->power);
+
+	return result;
+}
+
+/* Transforms real + i imaginary in place. */
+static void transform(spectrum sp)
+{
+	uint n = sp->length;
+	double *re = sp->real, *im = sp->imaginary;
+
+	for (uint i = 0; i < n; i++) {
+		uint j = sp->reversed[i];
+		if (i < j) {
+			double t = re[i];
+			re[i] = re[j];
+			re[j] = t;
+			t = im[i];
+			im[i] = im[j];
+			im[j] = t;
+		}
+	}
+
+	for (uint size = 2; size <= n; size *= 2) {
+		uint half = size / 2, step = n / size;
+		for (uint start = 0; start < n; start += size) {
+			for (uint k = 0; k < half; k++) {
+				double wr = sp->cosines[k * step], wi = sp->sines[k * step];
+				uint a = start + k, b = a + half;
+				double tr = wr * re[b] - wi * im[b];
+				double ti = wr * im[b] + wi * re[b];
+				re[b] = re[a] - tr;
+				im[b] = im[a] - ti;
+				re[a] += tr;
+				im[a] += ti;
+			}
+		}
+	}
+}
+
+/* Copies the segment of a channel out of the ring, oldest sample first,
+ * with its mean removed and windowed. */
+static void load_segment(spectrum sp, uint channel, double *out)
+{
+	uint n = sp->length;
+	const double *ring = sp->history + (size_t)channel * n;
+	uint oldest = sp->sample_count % n;
+
+	double mean = 0.0;
+	for (uint i = 0; i < n; i++) {
+		mean += ring[i];
+	}
+	mean /= n;
+	for (uint i = 0; i < n; i++) {
+		out[i] = (ring[(oldest + i) % n] - mean) * sp->window[i];
+	}
+}
+
+static void add_segment(spectrum sp)
+{
+	uint n = sp->length, bins = n / 2 + 1;
+	double *re = sp->real, *im = sp->imaginary;
+
+	for (uint channel = 0; channel < sp->channel_count; channel += 2) {
+		bool paired = channel + 1 < sp->channel_count;
+		load_segment(sp, channel, re);
+		if (paired) {
+			load_segment(sp, channel + 1, im);
+		}
+		else {
+			memset(im, 0, (sizeof *im) * n);
+		}
+		transform(sp);
+
+		double *first = sp->power + (size_t)channel * bins;
+		double *second = paired ? first + bins : NULL;
+		for (uint k = 0; k < bins; k++) {
+			uint mirror = (n - k) % n;
+			double sum_re = re[k] + re[mirror], difference_re = re[k] - re[mirror];
+			double sum_im = im[k] + im[mirror], difference_im = im[k] - im[mirror];
+			/* the transform of the real part is (Z[k] + conj(Z[n - k])) / 2, and
+			 * that of the imaginary part (Z[k] - conj(Z[n - k])) / 2i */
+			first[k] += (sum_re * sum_re + difference_im * difference_im) / 4.0;
+			if (paired) {
+				second[k] += (sum_im * sum_im + difference_re * difference_re) / 4.0;
+			}
+		}
+	}
+	sp->segment_count++;
+}
+
+/* Takes one sample of every channel. */
+void spectrum_add(spectrum sp, const double *samples)
+{
+	assert(sp);
+	assert(samples);
+
+	uint n = sp->length;
+	uint position = sp->sample_count % n;
+	for (uint channel = 0; channel < sp->channel_count; channel++) {
+		sp->history[(size_t)channel * n + position] = samples[channel];
+	}
+	sp->sample_count++;
+
+	if (sp->sample_count >= n && (sp->sample_count - n) % sp->hop == 0) {
+		add_segment(sp);
+	}
+}
+
+uint spectrum_get_segment_count(spectrum sp)
+{
+	assert(sp);
+	return sp->segment_count;
+}
+
+/* Returns the number of frequency bins, from 0 to the Nyquist frequency. */
+uint spectrum_get_bin_count(spectrum sp)
+{
+	assert(sp);
+	return sp->length / 2 + 1;
+}
+
+/* Returns the frequency of a bin, in hertz. */
+double spectrum_get_frequency(spectrum sp, uint bin)
+{
+	assert(sp);
+	assert(bin < spectrum_get_bin_count(sp));
+	return bin * sp->sample_rate / sp->length;
+}
+
+/* Fills density with the one-sided power spectral density of a channel,
+ * averaged over the segments so far. Returns false if there is no whole
+ * segment yet. */
+bool spectrum_get_density(spectrum sp, uint channel, double *density)
+{
+	assert(sp);
+	assert(channel < sp->channel_count);
+	assert(density);
+
+	if (!sp->segment_count) {
+		return false;
+	}
+
+	uint bins = spectrum_get_bin_count(sp);
+	const double *power = sp->power + (size_t)channel * bins;
+	double scale = 1.0 / (sp->segment_count * sp->sample_rate * sp->window_power);
+	for (uint k = 0; k < bins; k++) {
+		/* every bin but zero and the Nyquist frequency also holds its negative twin */
+		density[k] = power[k] * scale * (k == 0 || k == bins - 1 ? 1.0 : 2.0);
+	}
+	return true;
+}
+
+/* Writes a row per frequency bin, with the density of every channel. The
+ * columns are named after the given neurons, or the only column "mean" if
+ * there are none. */
+bool spectrum_write(spectrum sp, const char *filename, const uint *neurons, uint precision)
+{
+	assert(sp);
+	assert(filename);
+	assert(neurons || sp->channel_count == 1);
+
+	FILE *fh = fopen(filename, "w");
+	if (!fh) {
+		return false;
+	}
+
+	uint bins = spectrum_get_bin_count(sp);
+	double *densities = malloc((sizeof *densities) * bins * sp->channel_count);
+	bool has_segments = true;
+	for (uint channel = 0; channel < sp->channel_count; channel++) {
+		has_segments = spectrum_get_density(sp, channel, densities + (size_t)channel * bins);
+	}
+
+	fprintf(fh, "#aside segments = %u, window = %u samples\n", sp->segment_count, sp->length);
+	fprintf(fh, "#frequency");
+	for (uint channel = 0; channel < sp->channel_count; channel++) {
+		if (neurons) {
+			fprintf(fh, " %u", neurons[channel]);
+		}
+		else {
+			fprintf(fh, " mean");
+		}
+	}
+	fputc('\n', fh);
+	for (uint k = 0; has_segments && k < bins; k++) {
+		fprintf(fh, "%.*e", precision, spectrum_get_frequency(sp, k));
+		for (uint channel = 0; channel < sp->channel_count; channel++) {
+			fprintf(fh, " %.*e", precision, densities[(size_t)channel * bins + k]);
+		}
+		fputc('\n', fh);
+	}
+
+	free(densities);
+	bool success = !ferror(fh);
+	return !fclose(fh) && success;
+}
+
+void spectrum_destroy(spectrum *sp)
+{
+	assert(sp);
+	assert(*sp);
+
+	free((*sp)->window);
+	free((*sp)->cosines);
+	free((*sp)->sines);
+	free((*sp)->reversed);
+	free((*sp)->history);
+	free((*sp)->real);
+	free((*sp)->imaginary);
+	free((*sp)->power);
+	free(*sp);
+	*sp = NULL;
+}
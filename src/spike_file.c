@@ -0,0 +1,356 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include "headers/spike_file.h"
+
+#include "tests/headers/test_utils.h"
+
+/* A spike file holds the spikes of a run as address events: the time of
+ * the spike and the 32 bit id of the neuron that fired. After the header
+ * below, spikes are written in blocks of up to block_spikes spikes, each a
+ * block header followed by size bytes.
+ *
+ * A time is kept as a 64 bit integer, either the step index or the bits of
+ * the double, which for the non-negative times of a run grow along with
+ * the time itself. Without delta encoding, every spike is stored as that
+ * integer followed by the neuron id. With delta encoding, the integer is
+ * replaced by its difference from the previous spike of the block, zigzag
+ * and varint encoded, which takes a single byte for all but the first of
+ * the spikes of a sample.
+ *
+ * Blocks are only ever appended, and a block that is cut short by a crash
+ * is ignored by the reader.
+ */
+struct spike_file_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t header_size;
+	uint32_t system_size;
+	uint32_t time_format;
+	uint32_t delta;
+	uint32_t block_spikes;
+	double time_step;
+};
+
+struct block_header {
+	uint32_t spike_count;
+	uint32_t size;
+};
+
+static const char spike_file_magic[8] = "NNSPIKE";
+
+/* the largest encoding of one spike: a ten byte varint and the neuron id */
+#define SPIKE_MAX_SIZE (10 + sizeof (uint32_t))
+
+/* The spikes of the block being filled or read, and the buffer used to
+ * encode or decode it. */
+struct block {
+	uint spike_count;
+	uint64_t *times;
+	uint32_t *neurons;
+	unsigned char *data;
+};
+
+struct spike_file {
+	FILE *fh;
+	struct spike_file_header header;
+	struct block block;
+	uint64_t spike_count;
+};
+
+struct spike_reader {
+	FILE *fh;
+	struct spike_file_header header;
+	struct block block;
+};
+
+static void block_init(struct block *block, uint block_spikes)
+{
+	block->spike_count = 0;
+	block->times = malloc((sizeof *block->times) * block_spikes);
+	block->neurons = malloc((sizeof *block->neurons) * block_spikes);
+	block->data = malloc(SPIKE_MAX_SIZE * block_spikes);
+}
+
+static void block_free(struct block *block)
+{
+	free(block->times);
+	free(block->neurons);
+	free(block->data);
+}
+
+static bool header_is_valid(const struct spike_file_header *header)
+{
+	return !memcmp(header->magic, spike_file_magic, sizeof header->magic)
+		&& header->version == SPIKE_FILE_VERSION
+		&& header->header_size == sizeof *header
+		&& (header->time_format == SPIKE_TIME_FLOAT || header->time_format == SPIKE_TIME_STEP)
+		&& header->block_spikes > 0;
+}
+
+static size_t put_varint(unsigned char *out, uint64_t value)
+{
+	size_t size = 0;
+	while (value >= 0x80) {
+		out[size++] = (unsigned char)(value | 0x80);
+		value >>= 7;
+	}
+	out[size++] = (unsigned char)value;
+	return size;
+}
+
+/* Returns the number of bytes read, or zero if the varint does not end
+ * within in_size bytes. */
+static size_t get_varint(const unsigned char *in, size_t in_size, uint64_t *value)
+{
+	*value = 0;
+	for (size_t size = 0; size < in_size && size < 10; size++) {
+		*value |= (uint64_t)(in[size] & 0x7f) << (7 * size);
+		if (!(in[size] & 0x80)) {
+			return size + 1;
+		}
+	}
+	return 0;
+}
+
+/* Reads the next block header and the bytes after it. Returns false at the
+ * end of the file and for a block that was not written completely. */
+static bool read_block(FILE *fh, const struct spike_file_header *header, struct block *block,
+		       struct block_header *bh)
+{
+	if (fread(bh, sizeof *bh, 1, fh) != 1
+	    || bh->spike_count == 0 || bh->spike_count > header->block_spikes
+	    || bh->size > SPIKE_MAX_SIZE * header->block_spikes) {
+		return false;
+	}
+	return fread(block->data, 1, bh->size, fh) == bh->size;
+}
+
+spike_file spike_file_create(const char *filename, const struct spike_file_layout *layout,
+			     uint block_spikes)
+{
+	assert(filename);
+	assert(layout);
+	assert("Blocks must hold at least one spike." && block_spikes > 0);
+	assert("Step indices need a time step." && (layout->time_format == SPIKE_TIME_FLOAT || layout->time_step > 0.0));
+
+	spike_file result = malloc(sizeof *result);
+	memset(&result->header, 0, sizeof result->header);
+	memcpy(result->header.magic, spike_file_magic, sizeof result->header.magic);
+	result->header.version = SPIKE_FILE_VERSION;
+	result->header.header_size = sizeof result->header;
+	result->header.system_size = layout->system_size;
+	result->header.time_format = layout->time_format;
+	result->header.delta = layout->delta;
+	result->header.block_spikes = block_spikes;
+	result->header.time_step = layout->time_step;
+	block_init(&result->block, block_spikes);
+	result->spike_count = 0;
+	result->fh = fopen(filename, "w+b");
+	if (!result->fh || fwrite(&result->header, sizeof result->header, 1, result->fh) != 1) {
+		if (result->fh) {
+			fclose(result->fh);
+		}
+		block_free(&result->block);
+		free(result);
+		return NULL;
+	}
+
+	return result;
+}
+
+/* The spike is written once its block is full. */
+bool spike_file_write(spike_file sf, double time, uint neuron)
+{
+	assert(sf);
+	assert("Given an invalid neuron." && neuron < sf->header.system_size);
+
+	struct block *block = &sf->block;
+	if (sf->header.time_format == SPIKE_TIME_STEP) {
+		block->times[block->spike_count] = (uint64_t)llround(time / sf->header.time_step);
+	}
+	else {
+		memcpy(&block->times[block->spike_count], &time, sizeof time);
+	}
+	block->neurons[block->spike_count] = neuron;
+	block->spike_count++;
+	sf->spike_count++;
+
+	if (block->spike_count == sf->header.block_spikes) {
+		return spike_file_flush(sf);
+	}
+	return true;
+}
+
+/* Encodes and writes the spikes gathered so far as a block of its own. */
+bool spike_file_flush(spike_file sf)
+{
+	assert(sf);
+
+	struct block *block = &sf->block;
+	if (block->spike_count == 0) {
+		return true;
+	}
+
+	size_t size = 0;
+	uint64_t previous = 0;
+	for (uint spike = 0; spike < block->spike_count; spike++) {
+		uint64_t time = block->times[spike];
+		if (sf->header.delta) {
+			int64_t difference = (int64_t)(time - previous);
+			size += put_varint(block->data + size, ((uint64_t)difference << 1) ^ (uint64_t)(difference >> 63));
+			previous = time;
+		}
+		else {
+			memcpy(block->data + size, &time, sizeof time);
+			size += sizeof time;
+		}
+		memcpy(block->data + size, &block->neurons[spike], sizeof (uint32_t));
+		size += sizeof (uint32_t);
+	}
+
+	struct block_header bh = {
+		.spike_count = block->spike_count,
+		.size = size
+	};
+	block->spike_count = 0;
+	return fwrite(&bh, sizeof bh, 1, sf->fh) == 1
+		&& fwrite(block->data, 1, size, sf->fh) == size;
+}
+
+uint64_t spike_file_get_spike_count(spike_file sf)
+{
+	return sf->spike_count;
+}
+
+/* Writes the last, partially filled block and closes the file. Returns
+ * false if any of that failed. */
+bool spike_file_destroy(spike_file *sf)
+{
+	assert(sf);
+	assert(*sf);
+
+	bool success = spike_file_flush(*sf);
+	success = !fclose((*sf)->fh) && success;
+	block_free(&(*sf)->block);
+	free(*sf);
+	*sf = NULL;
+	return success;
+}
+
+spike_reader spike_reader_open(const char *filename)
+{
+	assert(filename);
+
+	FILE *fh = fopen(filename, "rb");
+	if (!fh) {
+		return NULL;
+	}
+
+	spike_reader result = malloc(sizeof *result);
+	if (fread(&result->header, sizeof result->header, 1, fh) != 1 || !header_is_valid(&result->header)) {
+		fclose(fh);
+		free(result);
+		return NULL;
+	}
+
+	result->fh = fh;
+	block_init(&result->block, result->header.block_spikes);
+	return result;
+}
+
+void spike_reader_get_layout(spike_reader sr, struct spike_file_layout *layout)
+{
+	assert(sr);
+	assert(layout);
+
+	layout->system_size = sr->header.system_size;
+	layout->time_step = sr->header.time_step;
+	layout->time_format = sr->header.time_format;
+	layout->delta = sr->header.delta;
+}
+
+/* Reads and decodes the next block, and returns the number of spikes in it.
+ * Returns zero once there are no more complete blocks, or if the block
+ * cannot be decoded. */
+uint spike_reader_next_block(spike_reader sr)
+{
+	assert(sr);
+
+	struct block *block = &sr->block;
+	struct block_header bh;
+	block->spike_count = 0;
+	if (!read_block(sr->fh, &sr->header, block, &bh)) {
+		return 0;
+	}
+
+	size_t used = 0;
+	uint64_t previous = 0;
+	for (uint spike = 0; spike < bh.spike_count; spike++) {
+		uint64_t time;
+		if (sr->header.delta) {
+			uint64_t zigzag;
+			size_t size = get_varint(block->data + used, bh.size - used, &zigzag);
+			if (!size) {
+				return 0;
+			}
+			time = previous + ((zigzag >> 1) ^ -(zigzag & 1));
+			previous = time;
+			used += size;
+		}
+		else {
+			if (bh.size - used < sizeof time) {
+				return 0;
+			}
+			memcpy(&time, block->data + used, sizeof time);
+			used += sizeof time;
+		}
+		if (bh.size - used < sizeof (uint32_t)) {
+			return 0;
+		}
+		block->times[spike] = time;
+		memcpy(&block->neurons[spike], block->data + used, sizeof (uint32_t));
+		used += sizeof (uint32_t);
+	}
+	if (used != bh.size) {
+		return 0;
+	}
+
+	block->spike_count = bh.spike_count;
+	return block->spike_count;
+}
+
+double spike_reader_get_time(spike_reader sr, uint spike)
+{
+	assert("Given an invalid spike." && spike < sr->block.spike_count);
+
+	uint64_t time = sr->block.times[spike];
+	if (sr->header.time_format == SPIKE_TIME_STEP) {
+		return time * sr->header.time_step;
+	}
+
+	double result;
+	memcpy(&result, &time, sizeof result);
+	return result;
+}
+
+uint spike_reader_get_neuron(spike_reader sr, uint spike)
+{
+	assert("Given an invalid spike." && spike < sr->block.spike_count);
+	return sr->block.neurons[spike];
+}
+
+void spike_reader_close(spike_reader *sr)
+{
+	assert(sr);
+	assert(*sr);
+
+	fclose((*sr)->fh);
+	block_free(&(*sr)->block);
+	free(*sr);
+	*sr = NULL;
+}
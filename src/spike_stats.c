@@ -0,0 +1,223 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include "headers/spike_stats.h"
+
+#include "tests/headers/test_utils.h"
+
+/* Keeps the spike-train statistics of every neuron as the integration runs,
+ * so that firing rates, interspike intervals and bursts are known without
+ * writing and reading back a raster plot.
+ *
+ * Spikes are detected at every integration step, and the time of a
+ * crossing is interpolated linearly between the two steps around it. Each
+ * neuron only keeps running sums: the mean and variance of its intervals
+ * are updated with Welford's method, and the length of the burst it is in,
+ * so memory does not grow with the length of the run.
+ */
+struct spike_stats {
+	uint system_size;
+	uint element_size;
+	struct spike_stats_options options;
+	double start_time;
+	double previous_time;
+	double *previous_voltages;
+	uint64_t *spike_count;
+	double *last_spike;
+	double *isi_mean;
+	double *isi_m2;
+	double *isi_min;
+	double *isi_max;
+	uint *burst_length;
+	uint64_t *burst_count;
+	uint64_t *burst_spikes;
+	uint32_t *histogram;
+};
+
+/* Starts the statistics at start_time, from the values of the dynamical
+ * system in their row-major layout. */
+spike_stats spike_stats_create(uint system_size, uint element_size, double start_time,
+			       const double *values, const struct spike_stats_options *options)
+{
+	assert(values);
+	assert(options);
+	assert("The histogram needs at least one bin." && options->bin_count > 0);
+	assert("The bins need a positive width." && options->bin_width > 0.0);
+
+	spike_stats result = malloc(sizeof *result);
+	result->system_size = system_size;
+	result->element_size = element_size;
+	result->options = *options;
+	result->start_time = start_time;
+	result->previous_time = start_time;
+	result->previous_voltages = malloc((sizeof *result->previous_voltages) * system_size);
+	for (uint i = 0; i < system_size; i++) {
+		result->previous_voltages[i] = values[(size_t)i * element_size];
+	}
+	result->spike_count = calloc(system_size, sizeof *result->spike_count);
+	result->last_spike = calloc(system_size, sizeof *result->last_spike);
+	result->isi_mean = calloc(system_size, sizeof *result->isi_mean);
+	result->isi_m2 = calloc(system_size, sizeof *result->isi_m2);
+	result->isi_min = calloc(system_size, sizeof *result->isi_min);
+	result->isi_max = calloc(system_size, sizeof *result->isi_max);
+	result->burst_length = calloc(system_size, sizeof *result->burst_length);
+	result->burst_count = calloc(system_size, sizeof *result->burst_count);
+	result->burst_spikes = calloc(system_size, sizeof *result->burst_spikes);
+	result->histogram = calloc((size_t)system_size * options->bin_count, sizeof *result->histogram);
+
+	return result;
+}
+
+static void add_spike(spike_stats ss, uint i, double time)
+{
+	uint64_t isi_count = ss->spike_count[i]++;
+	if (isi_count == 0) {
+		ss->last_spike[i] = time;
+		return;
+	}
+
+	double isi = time - ss->last_spike[i];
+	ss->last_spike[i] = time;
+
+	double delta = isi - ss->isi_mean[i];
+	ss->isi_mean[i] += delta / isi_count;
+	ss->isi_m2[i] += delta * (isi - ss->isi_mean[i]);
+	if (isi_count == 1) {
+		ss->isi_min[i] = ss->isi_max[i] = isi;
+	}
+	else {
+		ss->isi_min[i] = isi < ss->isi_min[i] ? isi : ss->isi_min[i];
+		ss->isi_max[i] = isi > ss->isi_max[i] ? isi : ss->isi_max[i];
+	}
+
+	double bin = floor(isi / ss->options.bin_width);
+	uint last_bin = ss->options.bin_count - 1;
+	ss->histogram[(size_t)i * ss->options.bin_count + (bin < last_bin ? (uint)bin : last_bin)]++;
+
+	/* a burst starts with the spike before its first short interval */
+	if (isi <= ss->options.burst_isi) {
+		ss->burst_length[i] = ss->burst_length[i] ? ss->burst_length[i] + 1 : 2;
+	}
+	else if (ss->burst_length[i]) {
+		ss->burst_count[i]++;
+		ss->burst_spikes[i] += ss->burst_length[i];
+		ss->burst_length[i] = 0;
+	}
+}
+
+/* Takes the values of the dynamical system after a step, in their
+ * row-major layout, at the given time. */
+void spike_stats_add(spike_stats ss, double time, const double *values)
+{
+	assert(ss);
+	assert(values);
+
+	double threshold = ss->options.threshold;
+	double step = time - ss->previous_time;
+	const double *voltage = values;
+	for (uint i = 0; i < ss->system_size; i++, voltage += ss->element_size) {
+		double previous = ss->previous_voltages[i];
+		if (*voltage >= threshold && previous < threshold) {
+			add_spike(ss, i, ss->previous_time + step * (threshold - previous) / (*voltage - previous));
+		}
+		ss->previous_voltages[i] = *voltage;
+	}
+	ss->previous_time = time;
+}
+
+/* Summarizes a neuron as of the given time. A burst still going on counts
+ * as a finished one. */
+void spike_stats_get_summary(spike_stats ss, uint neuron, double time, struct spike_stats_summary *summary)
+{
+	assert(ss);
+	assert(summary);
+	assert("Given an invalid neuron." && neuron < ss->system_size);
+
+	uint64_t spike_count = ss->spike_count[neuron];
+	uint64_t isi_count = spike_count ? spike_count - 1 : 0;
+	double duration = time - ss->start_time;
+
+	summary->spike_count = spike_count;
+	summary->rate = duration > 0.0 ? 1000.0 * spike_count / duration : 0.0;
+	summary->isi_count = isi_count;
+	summary->isi_mean = isi_count ? ss->isi_mean[neuron] : NAN;
+	summary->isi_sd = isi_count > 1 ? sqrt(ss->isi_m2[neuron] / (isi_count - 1)) : NAN;
+	summary->isi_cv = summary->isi_sd / summary->isi_mean;
+	summary->isi_min = isi_count ? ss->isi_min[neuron] : NAN;
+	summary->isi_max = isi_count ? ss->isi_max[neuron] : NAN;
+	summary->burst_count = ss->burst_count[neuron] + (ss->burst_length[neuron] > 0);
+	summary->burst_spikes = ss->burst_spikes[neuron] + ss->burst_length[neuron];
+	summary->burst_mean_spikes = summary->burst_count
+		? (double)summary->burst_spikes / summary->burst_count : 0.0;
+}
+
+/* Returns the bin_count interval counts of a neuron. */
+const uint32_t *spike_stats_get_histogram(spike_stats ss, uint neuron)
+{
+	assert(ss);
+	assert("Given an invalid neuron." && neuron < ss->system_size);
+	return ss->histogram + (size_t)neuron * ss->options.bin_count;
+}
+
+/* Writes a block holding one line per neuron: its index, spike count,
+ * rate, interval count, mean, standard deviation, coefficient of
+ * variation, minimum and maximum, burst count, spikes in bursts and mean
+ * spikes per burst, followed by its interval histogram. Blocks written at
+ * different times are appended after each other unless append is false. */
+bool spike_stats_write(spike_stats ss, const char *filename, bool append, double time, uint precision)
+{
+	assert(ss);
+	assert(filename);
+
+	FILE *fh = fopen(filename, append ? "a" : "w");
+	if (!fh) {
+		return false;
+	}
+
+	fprintf(fh, "#aside time = %f ms\n", time);
+	fprintf(fh, "#neuron spikes rate isis isi_mean isi_sd isi_cv isi_min isi_max "
+		"bursts burst_spikes burst_mean_spikes histogram[%u x %g ms]\n",
+		ss->options.bin_count, ss->options.bin_width);
+	for (uint i = 0; i < ss->system_size; i++) {
+		struct spike_stats_summary summary;
+		spike_stats_get_summary(ss, i, time, &summary);
+		fprintf(fh, "%u %llu %.*e %llu %.*e %.*e %.*e %.*e %.*e %llu %llu %.*e",
+			i, (unsigned long long)summary.spike_count, precision, summary.rate,
+			(unsigned long long)summary.isi_count, precision, summary.isi_mean,
+			precision, summary.isi_sd, precision, summary.isi_cv,
+			precision, summary.isi_min, precision, summary.isi_max,
+			(unsigned long long)summary.burst_count, (unsigned long long)summary.burst_spikes,
+			precision, summary.burst_mean_spikes);
+		const uint32_t *histogram = spike_stats_get_histogram(ss, i);
+		for (uint bin = 0; bin < ss->options.bin_count; bin++) {
+			fprintf(fh, " %u", (uint)histogram[bin]);
+		}
+		fputc('\n', fh);
+	}
+	fputc('\n', fh);
+
+	bool success = !ferror(fh);
+	return !fclose(fh) && success;
+}
+
+void spike_stats_destroy(spike_stats *ss)
+{
+	assert(ss);
+	assert(*ss);
+
+	free((*ss)->previous_voltages);
+	free((*ss)->spike_count);
+	free((*ss)->last_spike);
+	free((*ss)->isi_mean);
+	free((*ss)->isi_m2);
+	free((*ss)->isi_min);
+	free((*ss)->isi_max);
+	free((*ss)->burst_length);
+	free((*ss)->burst_count);
+	free((*ss)->burst_spikes);
+	free((*ss)->histogram);
+	free(*ss);
+	*ss = NULL;
+}
@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "headers/state_cache.h"
+#include "headers/math_utils.h"
+
+#include "tests/headers/test_utils.h"
+
+/* Cached states are ordinary checkpoints named after a 64 bit FNV-1a hash
+ * of everything that influences the trajectory up to the end of the
+ * transient. Two runs that agree on all of it start from the same state.
+ */
+
+static const uint64_t fnv_offset_basis = 0xcbf29ce484222325ULL;
+static const uint64_t fnv_prime = 0x100000001b3ULL;
+
+static uint64_t hash_bytes(uint64_t hash, const void *data, size_t size)
+{
+	const unsigned char *bytes = data;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= fnv_prime;
+	}
+	return hash;
+}
+
+static uint64_t hash_string(uint64_t hash, const char *str)
+{
+	/* hash the terminator too, so that "ab" + "c" differs from "a" + "bc" */
+	return str ? hash_bytes(hash, str, strlen(str) + 1) : hash_bytes(hash, "", 1);
+}
+
+uint64_t state_cache_key(const struct checkpoint_info *info,
+			 uint system_size, uint grid_width, uint grid_height, double transient_time)
+{
+	assert(info);
+
+	uint32_t version = CHECKPOINT_VERSION;
+	uint32_t sizes[] = { system_size, grid_width, grid_height };
+	uint32_t is_random = info->coupling_constant_is_random;
+
+	uint64_t hash = fnv_offset_basis;
+	hash = hash_bytes(hash, &version, sizeof version);
+	hash = hash_string(hash, info->model_name);
+	hash = hash_string(hash, info->parameter_callback_name);
+	hash = hash_string(hash, info->coupling_callback_name);
+	hash = hash_string(hash, info->initial_values_callback_name);
+	hash = hash_bytes(hash, sizes, sizeof sizes);
+	hash = hash_bytes(hash, &info->time_step, sizeof info->time_step);
+	hash = hash_bytes(hash, &is_random, sizeof is_random);
+	if (info->coupling_constant_is_random) {
+		hash = hash_bytes(hash, &info->lowest_random_value, sizeof info->lowest_random_value);
+		hash = hash_bytes(hash, &info->highest_random_value, sizeof info->highest_random_value);
+	}
+	else {
+		hash = hash_bytes(hash, &info->coupling_constant, sizeof info->coupling_constant);
+	}
+	hash = hash_bytes(hash, &transient_time, sizeof transient_time);
+
+	return hash;
+}
+
+char *state_cache_filename(const char *cache_dir, uint64_t key)
+{
+	assert(cache_dir);
+
+	size_t filename_size = strlen(cache_dir) + strlen("/.bin") + 16 + 1;
+	char *filename = malloc(filename_size);
+	snprintf(filename, filename_size, "%s/%016llx.bin", cache_dir, (unsigned long long)key);
+	return filename;
+}
+
+checkpoint state_cache_lookup(const char *cache_dir, uint64_t key)
+{
+	char *filename = state_cache_filename(cache_dir, key);
+	checkpoint result = checkpoint_open(filename);
+	free(filename);
+	return result;
+}
+
+/* Copies the cached values into ds and returns whether there were any.
+ * The random generator keeps its live state: the cached one would make
+ * every run with random couplings draw the same weights after the hit. */
+bool state_cache_restore(const char *cache_dir, uint64_t key, dynamical_system ds)
+{
+	checkpoint cp = state_cache_lookup(cache_dir, key);
+	if (!cp) {
+		return false;
+	}
+
+	uint64_t random_state = math_utils_random_state_get();
+	bool result = checkpoint_restore(cp, ds);
+	math_utils_random_state_set(random_state);
+	checkpoint_close(&cp);
+	return result;
+}
+
+bool state_cache_store(const char *cache_dir, uint64_t key,
+		       dynamical_system ds, const struct checkpoint_info *info)
+{
+	char *filename = state_cache_filename(cache_dir, key);
+	bool result = checkpoint_write(ds, info, filename);
+	free(filename);
+	return result;
+}
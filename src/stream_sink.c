@@ -0,0 +1,232 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "headers/stream_sink.h"
+
+#include "tests/headers/test_utils.h"
+
+/* Sends output to a consumer reading from standard output, a named pipe or
+ * a Unix domain socket, without ever making the simulation wait for it.
+ *
+ * Messages are appended to a queue of queue_size bytes, and as much of the
+ * queue as the consumer accepts is written with non-blocking writes each
+ * time a message is added. A message that does not fit into the queue is
+ * dropped as a whole, so that the consumer always receives complete
+ * messages. Only on closing does the sink wait for the queue to drain.
+ */
+struct stream_sink {
+	int fd;
+	bool is_socket;
+	unsigned char *queue;
+	size_t queue_size;
+	size_t start;
+	size_t end;
+	bool failed;
+	uint64_t sequence;
+	struct stream_sink_stats stats;
+};
+
+stream_sink stream_sink_create(int fd, size_t queue_size)
+{
+	assert(fd >= 0);
+	assert(queue_size > 0);
+
+	/* a consumer going away shows up as EPIPE rather than ending the run */
+	signal(SIGPIPE, SIG_IGN);
+
+	int flags = fcntl(fd, F_GETFL);
+	if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+		return NULL;
+	}
+
+	struct stat st;
+	stream_sink result = malloc(sizeof *result);
+	result->fd = fd;
+	result->is_socket = !fstat(fd, &st) && S_ISSOCK(st.st_mode);
+	result->queue = malloc(queue_size);
+	result->queue_size = queue_size;
+	result->start = 0;
+	result->end = 0;
+	result->failed = false;
+	result->sequence = 0;
+	result->stats = (struct stream_sink_stats){0};
+
+	return result;
+}
+
+/* Opens a sink for the given target: "-" for standard output, "unix:PATH"
+ * for a Unix domain socket listening at PATH, and the path of a named pipe
+ * otherwise. Opening a named pipe waits for a consumer to open its end.
+ *
+ * When the sink takes standard output, the messages the program prints are
+ * moved to standard error, so that they do not end up in the stream. */
+stream_sink stream_sink_open(const char *target, size_t queue_size)
+{
+	assert(target);
+
+	int fd;
+	if (!strcmp(target, "-")) {
+		fflush(stdout);
+		fd = dup(STDOUT_FILENO);
+		if (fd >= 0 && dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+			close(fd);
+			fd = -1;
+		}
+	}
+	else if (!strncmp(target, "unix:", 5)) {
+		struct sockaddr_un address = { .sun_family = AF_UNIX };
+		const char *path = target + 5;
+		if (strlen(path) >= sizeof address.sun_path) {
+			return NULL;
+		}
+		strcpy(address.sun_path, path);
+
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd >= 0 && connect(fd, (struct sockaddr *)&address, sizeof address) < 0) {
+			close(fd);
+			fd = -1;
+		}
+	}
+	else {
+		fd = open(target, O_WRONLY);
+	}
+
+	if (fd < 0) {
+		return NULL;
+	}
+
+	stream_sink result = stream_sink_create(fd, queue_size);
+	if (!result) {
+		close(fd);
+	}
+	return result;
+}
+
+/* Writes as much of the queue as the consumer takes without blocking. */
+static void send_queued(stream_sink ss)
+{
+	while (!ss->failed && ss->start < ss->end) {
+		ssize_t written;
+		if (ss->is_socket) {
+			written = send(ss->fd, ss->queue + ss->start, ss->end - ss->start, MSG_NOSIGNAL);
+		}
+		else {
+			written = write(ss->fd, ss->queue + ss->start, ss->end - ss->start);
+		}
+
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				ss->failed = true;
+			}
+			break;
+		}
+		ss->start += written;
+		ss->stats.bytes_sent += written;
+	}
+
+	if (ss->start == ss->end) {
+		ss->start = ss->end = 0;
+	}
+}
+
+/* Adds the given pieces to the queue as one message, or drops them all if
+ * they do not fit. */
+static bool enqueue(stream_sink ss, const void *first, size_t first_size, const void *second, size_t second_size)
+{
+	ss->sequence++;
+	send_queued(ss);
+	if (ss->failed) {
+		return false;
+	}
+
+	size_t size = first_size + second_size;
+	if (ss->end - ss->start + size > ss->queue_size) {
+		ss->stats.messages_dropped++;
+		return true;
+	}
+	if (ss->end + size > ss->queue_size) {
+		memmove(ss->queue, ss->queue + ss->start, ss->end - ss->start);
+		ss->end -= ss->start;
+		ss->start = 0;
+	}
+
+	memcpy(ss->queue + ss->end, first, first_size);
+	if (second_size) {
+		memcpy(ss->queue + ss->end + first_size, second, second_size);
+	}
+	ss->end += size;
+	ss->stats.messages_sent++;
+
+	send_queued(ss);
+	return !ss->failed;
+}
+
+/* Sends a message of the given type behind a struct stream_message_header.
+ * Returns false once the consumer has gone away; a message dropped because
+ * the queue is full is not an error. */
+bool stream_sink_send(stream_sink ss, uint32_t type, const void *data, size_t size)
+{
+	assert(ss);
+
+	struct stream_message_header header = {
+		.magic = STREAM_SINK_MAGIC,
+		.type = type,
+		.size = size,
+		.sequence = ss->sequence
+	};
+	return enqueue(ss, &header, sizeof header, data, size);
+}
+
+/* Sends data as it is, for streams that frame their messages themselves,
+ * like text that a consumer reads line by line. */
+bool stream_sink_send_raw(stream_sink ss, const void *data, size_t size)
+{
+	assert(ss);
+	return enqueue(ss, data, size, NULL, 0);
+}
+
+void stream_sink_get_stats(stream_sink ss, struct stream_sink_stats *stats)
+{
+	assert(ss);
+	assert(stats);
+	*stats = ss->stats;
+}
+
+/* Waits for the consumer to take what is left in the queue and closes the
+ * sink. Returns false if not everything could be sent. */
+bool stream_sink_close(stream_sink *ss)
+{
+	assert(ss);
+	assert(*ss);
+
+	stream_sink s = *ss;
+	send_queued(s);
+	while (!s->failed && s->start < s->end) {
+		struct pollfd pfd = { .fd = s->fd, .events = POLLOUT };
+		if (poll(&pfd, 1, -1) < 0 && errno != EINTR) {
+			s->failed = true;
+		}
+		send_queued(s);
+	}
+
+	bool success = !s->failed;
+	close(s->fd);
+	free(s->queue);
+	free(s);
+	*ss = NULL;
+	return success;
+}
@@ -0,0 +1,373 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include "headers/synchrony.h"
+#include "headers/math_utils.h"
+
+#include "tests/headers/test_utils.h"
+
+#define TWO_PI 6.28318530717958647692
+
+/* Measures how synchronized the network is while it is integrated, over
+ * windows of integration steps.
+ *
+ * phase  The Kuramoto order parameter |<exp(i phi)>| of phases taken from
+ *        spike times: a neuron goes from 0 to 2 pi between two spikes,
+ *        over the length of its last interspike interval. Only neurons
+ *        that spiked at least twice have a phase. Taken at the end of the
+ *        window.
+ * chi    The ratio of the deviation over time of the mean voltage to the
+ *        mean deviation of single voltages, which is 1 for a synchronized
+ *        network and near 1 / sqrt(N) for an asynchronous one.
+ * correlation  The Pearson correlation of the voltages at both ends of
+ *        every edge of the coupling graph, averaged over the edges.
+ *
+ * The coupling graph is read once from the dynamical system into a
+ * compressed list of neighbours, and every edge is counted once, so the
+ * coupling is taken to be symmetric. Every step, the voltages are first
+ * gathered into a contiguous array, so that the sums over neurons run as
+ * plain loops over arrays. Only sums are kept, which are cleared by every
+ * synchrony_take.
+ */
+struct synchrony {
+	uint measures;
+	uint system_size;
+	uint element_size;
+	uint *neighbour_start;
+	uint *neighbours;
+	uint edge_count;
+	uint *edge_first;
+	uint *edge_second;
+	double *voltages;
+	double *local_means;
+	uint64_t step_count;
+	double time;
+	/* phase */
+	double *previous_voltages;
+	double *last_spike;
+	double *interval;
+	/* chi and correlation */
+	double *sum;
+	double *sum_squares;
+	double mean_sum;
+	double mean_sum_squares;
+	double *local_sum;
+	double *local_sum_squares;
+	double *edge_sum_products;
+};
+
+/* Reads the coupling graph of ds into compressed neighbour lists. Random
+ * couplings draw from the generator, so its state is put back afterwards,
+ * as the analysis must leave the integration untouched. */
+static void read_graph(synchrony sy, dynamical_system ds)
+{
+	uint64_t random_state = math_utils_random_state_get();
+	uint n = sy->system_size;
+	uint capacity = n;
+	sy->neighbour_start = malloc((sizeof *sy->neighbour_start) * (n + 1));
+	sy->neighbours = malloc((sizeof *sy->neighbours) * capacity);
+
+	uint count = 0;
+	for (uint i = 0; i < n; i++) {
+		sy->neighbour_start[i] = count;
+		uint edges_found = dynamical_system_get_coupling(ds, i);
+		const struct edge *edges = dynamical_system_get_edge_pool(ds);
+		for (uint e = 0; e < edges_found; e++) {
+			if (edges[e].index == i || edges[e].index >= n) {
+				continue;
+			}
+			if (count == capacity) {
+				capacity *= 2;
+				sy->neighbours = realloc(sy->neighbours, (sizeof *sy->neighbours) * capacity);
+			}
+			sy->neighbours[count++] = edges[e].index;
+		}
+	}
+	sy->neighbour_start[n] = count;
+	math_utils_random_state_set(random_state);
+
+	sy->edge_count = 0;
+	for (uint i = 0; i < n; i++) {
+		for (uint k = sy->neighbour_start[i]; k < sy->neighbour_start[i + 1]; k++) {
+			sy->edge_count += sy->neighbours[k] > i;
+		}
+	}
+	sy->edge_first = malloc((sizeof *sy->edge_first) * (sy->edge_count ? sy->edge_count : 1));
+	sy->edge_second = malloc((sizeof *sy->edge_second) * (sy->edge_count ? sy->edge_count : 1));
+	for (uint i = 0, e = 0; i < n; i++) {
+		for (uint k = sy->neighbour_start[i]; k < sy->neighbour_start[i + 1]; k++) {
+			if (sy->neighbours[k] > i) {
+				sy->edge_first[e] = i;
+				sy->edge_second[e] = sy->neighbours[k];
+				e++;
+			}
+		}
+	}
+}
+
+static void clear_sums(synchrony sy)
+{
+	size_t size = (sizeof (double)) * sy->system_size;
+	sy->step_count = 0;
+	sy->mean_sum = sy->mean_sum_squares = 0.0;
+	memset(sy->sum, 0, size);
+	memset(sy->sum_squares, 0, size);
+	memset(sy->local_sum, 0, size);
+	memset(sy->local_sum_squares, 0, size);
+	memset(sy->edge_sum_products, 0, (sizeof *sy->edge_sum_products) * (sy->edge_count ? sy->edge_count : 1));
+}
+
+/* Starts measuring from the current state and time of ds. */
+synchrony synchrony_create(dynamical_system ds, uint measures)
+{
+	assert(ds);
+	assert("No synchrony measure is given." && measures);
+
+	synchrony result = malloc(sizeof *result);
+	uint n = dynamical_system_get_system_size(ds);
+	result->measures = measures;
+	result->system_size = n;
+	result->element_size = dynamical_system_get_element_size(ds);
+	read_graph(result, ds);
+
+	size_t size = (sizeof (double)) * n;
+	result->voltages = malloc(size);
+	result->local_means = malloc(size);
+	result->time = dynamical_system_get_time(ds);
+	result->previous_voltages = malloc(size);
+	result->last_spike = malloc(size);
+	result->interval = calloc(n, sizeof *result->interval);
+	for (uint i = 0; i < n; i++) {
+		result->previous_voltages[i] = dynamical_system_get_value(ds, i, 0);
+		result->last_spike[i] = -INFINITY;
+	}
+	result->sum = malloc(size);
+	result->sum_squares = malloc(size);
+	result->local_sum = malloc(size);
+	result->local_sum_squares = malloc(size);
+	result->edge_sum_products = malloc((sizeof *result->edge_sum_products)
+					   * (result->edge_count ? result->edge_count : 1));
+	clear_sums(result);
+
+	return result;
+}
+
+/* Takes the values of the dynamical system after a step, in their
+ * row-major layout, at the given time. */
+void synchrony_add(synchrony sy, double time, const double *values)
+{
+	assert(sy);
+	assert(values);
+
+	uint n = sy->system_size;
+	double *v = sy->voltages;
+	for (uint i = 0; i < n; i++) {
+		v[i] = values[(size_t)i * sy->element_size];
+	}
+
+	if (sy->measures & SYNCHRONY_PHASE) {
+		/* upward zero crossings, interpolated between both steps */
+		double step = time - sy->time;
+		for (uint i = 0; i < n; i++) {
+			double previous = sy->previous_voltages[i];
+			if (v[i] >= 0.0 && previous < 0.0) {
+				double spike = sy->time + step * -previous / (v[i] - previous);
+				sy->interval[i] = isinf(sy->last_spike[i]) ? 0.0 : spike - sy->last_spike[i];
+				sy->last_spike[i] = spike;
+			}
+		}
+		memcpy(sy->previous_voltages, v, (sizeof *v) * n);
+	}
+
+	if (sy->measures & SYNCHRONY_CHI) {
+		double mean = 0.0;
+		for (uint i = 0; i < n; i++) {
+			mean += v[i];
+		}
+		mean /= n;
+		sy->mean_sum += mean;
+		sy->mean_sum_squares += mean * mean;
+
+		for (uint i = 0; i < n; i++) {
+			double local = v[i];
+			for (uint k = sy->neighbour_start[i]; k < sy->neighbour_start[i + 1]; k++) {
+				local += v[sy->neighbours[k]];
+			}
+			sy->local_means[i] = local / (sy->neighbour_start[i + 1] - sy->neighbour_start[i] + 1);
+		}
+		for (uint i = 0; i < n; i++) {
+			sy->local_sum[i] += sy->local_means[i];
+			sy->local_sum_squares[i] += sy->local_means[i] * sy->local_means[i];
+		}
+	}
+
+	if (sy->measures & (SYNCHRONY_CHI | SYNCHRONY_CORRELATION)) {
+		for (uint i = 0; i < n; i++) {
+			sy->sum[i] += v[i];
+			sy->sum_squares[i] += v[i] * v[i];
+		}
+	}
+
+	if (sy->measures & SYNCHRONY_CORRELATION) {
+		for (uint e = 0; e < sy->edge_count; e++) {
+			sy->edge_sum_products[e] += v[sy->edge_first[e]] * v[sy->edge_second[e]];
+		}
+	}
+
+	sy->time = time;
+	sy->step_count++;
+}
+
+static double variance(double sum, double sum_squares, double count)
+{
+	double mean = sum / count;
+	double result = sum_squares / count - mean * mean;
+	return result > 0.0 ? result : 0.0;
+}
+
+static void take_phase(synchrony sy, struct synchrony_sample *sample)
+{
+	uint n = sy->system_size;
+	double *cosines = sy->voltages;
+	double *sines = sy->local_means;
+	double global_cos = 0.0, global_sin = 0.0, local_sum = 0.0;
+	uint phase_count = 0, local_count = 0;
+
+	for (uint i = 0; i < n; i++) {
+		if (sy->interval[i] > 0.0) {
+			double fraction = (sy->time - sy->last_spike[i]) / sy->interval[i];
+			double phase = TWO_PI * (fraction < 1.0 ? fraction : 1.0);
+			cosines[i] = cos(phase);
+			sines[i] = sin(phase);
+			global_cos += cosines[i];
+			global_sin += sines[i];
+			phase_count++;
+		}
+	}
+	for (uint i = 0; i < n; i++) {
+		if (sy->interval[i] <= 0.0) {
+			continue;
+		}
+		double local_cos = cosines[i], local_sin = sines[i];
+		uint count = 1;
+		for (uint k = sy->neighbour_start[i]; k < sy->neighbour_start[i + 1]; k++) {
+			uint j = sy->neighbours[k];
+			if (sy->interval[j] > 0.0) {
+				local_cos += cosines[j];
+				local_sin += sines[j];
+				count++;
+			}
+		}
+		local_sum += hypot(local_cos, local_sin) / count;
+		local_count++;
+	}
+
+	sample->phase_global = phase_count ? hypot(global_cos, global_sin) / phase_count : NAN;
+	sample->phase_local = local_count ? local_sum / local_count : NAN;
+}
+
+static void take_chi(synchrony sy, struct synchrony_sample *sample)
+{
+	uint n = sy->system_size;
+	double count = sy->step_count;
+	double *variances = sy->voltages;
+	double variance_sum = 0.0, local_sum = 0.0;
+	uint local_count = 0;
+
+	for (uint i = 0; i < n; i++) {
+		variances[i] = variance(sy->sum[i], sy->sum_squares[i], count);
+		variance_sum += variances[i];
+	}
+	for (uint i = 0; i < n; i++) {
+		double neighbourhood_variance = variances[i];
+		for (uint k = sy->neighbour_start[i]; k < sy->neighbour_start[i + 1]; k++) {
+			neighbourhood_variance += variances[sy->neighbours[k]];
+		}
+		neighbourhood_variance /= sy->neighbour_start[i + 1] - sy->neighbour_start[i] + 1;
+		if (neighbourhood_variance > 0.0) {
+			local_sum += sqrt(variance(sy->local_sum[i], sy->local_sum_squares[i], count)
+					  / neighbourhood_variance);
+			local_count++;
+		}
+	}
+
+	double mean_variance = variance(sy->mean_sum, sy->mean_sum_squares, count);
+	sample->chi_global = variance_sum > 0.0 ? sqrt(mean_variance / (variance_sum / n)) : NAN;
+	sample->chi_local = local_count ? local_sum / local_count : NAN;
+}
+
+static void take_correlation(synchrony sy, struct synchrony_sample *sample)
+{
+	double count = sy->step_count;
+	double correlation_sum = 0.0;
+	uint correlation_count = 0;
+
+	for (uint e = 0; e < sy->edge_count; e++) {
+		uint a = sy->edge_first[e], b = sy->edge_second[e];
+		double deviations = sqrt(variance(sy->sum[a], sy->sum_squares[a], count)
+					 * variance(sy->sum[b], sy->sum_squares[b], count));
+		if (deviations > 0.0) {
+			double covariance = sy->edge_sum_products[e] / count - (sy->sum[a] / count) * (sy->sum[b] / count);
+			correlation_sum += covariance / deviations;
+			correlation_count++;
+		}
+	}
+
+	sample->correlation = correlation_count ? correlation_sum / correlation_count : NAN;
+}
+
+/* Computes the measures over the steps added since the last call, and
+ * starts a new window. */
+void synchrony_take(synchrony sy, struct synchrony_sample *sample)
+{
+	assert(sy);
+	assert(sample);
+
+	sample->phase_global = sample->phase_local = NAN;
+	sample->chi_global = sample->chi_local = NAN;
+	sample->correlation = NAN;
+
+	if (sy->measures & SYNCHRONY_PHASE) {
+		take_phase(sy, sample);
+	}
+	if (sy->step_count && (sy->measures & SYNCHRONY_CHI)) {
+		take_chi(sy, sample);
+	}
+	if (sy->step_count && (sy->measures & SYNCHRONY_CORRELATION)) {
+		take_correlation(sy, sample);
+	}
+
+	clear_sums(sy);
+}
+
+/* Returns the number of edges of the coupling graph, each counted once. */
+uint synchrony_get_edge_count(synchrony sy)
+{
+	assert(sy);
+	return sy->edge_count;
+}
+
+void synchrony_destroy(synchrony *sy)
+{
+	assert(sy);
+	assert(*sy);
+
+	free((*sy)->neighbour_start);
+	free((*sy)->neighbours);
+	free((*sy)->edge_first);
+	free((*sy)->edge_second);
+	free((*sy)->voltages);
+	free((*sy)->local_means);
+	free((*sy)->previous_voltages);
+	free((*sy)->last_spike);
+	free((*sy)->interval);
+	free((*sy)->sum);
+	free((*sy)->sum_squares);
+	free((*sy)->local_sum);
+	free((*sy)->local_sum_squares);
+	free((*sy)->edge_sum_products);
+	free(*sy);
+	*sy = NULL;
+}
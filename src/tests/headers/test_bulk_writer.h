@@ -0,0 +1,9 @@
+#ifndef TEST_BULK_WRITER_H
+#define TEST_BULK_WRITER_H
+
+#include <stdbool.h>
+
+bool test_bulk_writer_write(void);
+bool test_bulk_writer_offset(void);
+
+#endif
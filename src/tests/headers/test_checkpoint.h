@@ -0,0 +1,10 @@
+#ifndef TEST_CHECKPOINT_H
+#define TEST_CHECKPOINT_H
+
+#include <stdbool.h>
+
+bool test_checkpoint_write_restore(void);
+bool test_checkpoint_open_invalid(void);
+bool test_checkpoint_background(void);
+
+#endif
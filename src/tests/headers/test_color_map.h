@@ -0,0 +1,9 @@
+#ifndef TEST_COLOR_MAP_H
+#define TEST_COLOR_MAP_H
+
+#include <stdbool.h>
+
+bool test_color_map_lookup(void);
+bool test_color_map_fill(void);
+
+#endif
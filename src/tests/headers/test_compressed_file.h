@@ -0,0 +1,8 @@
+#ifndef TEST_COMPRESSED_FILE_H
+#define TEST_COMPRESSED_FILE_H
+
+#include <stdbool.h>
+
+bool test_compressed_file_write_read(void);
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef TEST_COMPRESSION_H
+#define TEST_COMPRESSION_H
+
+#include <stdbool.h>
+
+bool test_compression_xor_round_trip(void);
+bool test_compression_lz_round_trip(void);
+
+#endif
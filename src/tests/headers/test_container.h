@@ -0,0 +1,9 @@
+#ifndef TEST_CONTAINER_H
+#define TEST_CONTAINER_H
+
+#include <stdbool.h>
+
+bool test_container_write_read(void);
+bool test_container_recover(void);
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef TEST_DECIMATOR_H
+#define TEST_DECIMATOR_H
+
+#include <stdbool.h>
+
+bool test_decimator_take(void);
+
+#endif
@@ -5,5 +5,8 @@
 #include <stdbool.h>
 
 bool test_file_table_create_destroy(void);
+bool test_file_table_handles(void);
+bool test_file_table_open_failure(void);
+bool test_file_table_write_failure(void);
 
 #endif
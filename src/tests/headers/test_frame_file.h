@@ -0,0 +1,8 @@
+#ifndef TEST_FRAME_FILE_H
+#define TEST_FRAME_FILE_H
+
+#include <stdbool.h>
+
+bool test_frame_file_write_read(void);
+
+#endif
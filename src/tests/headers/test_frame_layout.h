@@ -0,0 +1,13 @@
+#ifndef TEST_FRAME_LAYOUT_H
+#define TEST_FRAME_LAYOUT_H
+
+#include <stdbool.h>
+#include "../../headers/frame_file.h"
+
+struct frame_file_layout test_frame_layout(uint grid_width, uint grid_height, uint variable_count, uint value_size);
+double test_frame_value(uint frame, uint system, uint variable);
+double test_frame_stored_value(const struct frame_file_layout *layout, uint frame, uint system, uint variable);
+void test_frame_values(const struct frame_file_layout *layout, uint frame, double *values);
+bool test_frame_layout_matches(const struct frame_file_layout *layout, const struct frame_file_layout *expected);
+
+#endif
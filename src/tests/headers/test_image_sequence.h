@@ -0,0 +1,9 @@
+#ifndef TEST_IMAGE_SEQUENCE_H
+#define TEST_IMAGE_SEQUENCE_H
+
+#include <stdbool.h>
+
+bool test_image_sequence_ppm_png(void);
+bool test_image_sequence_gif(void);
+
+#endif
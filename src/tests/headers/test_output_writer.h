@@ -0,0 +1,9 @@
+#ifndef TEST_OUTPUT_WRITER_H
+#define TEST_OUTPUT_WRITER_H
+
+#include <stdbool.h>
+
+bool test_output_writer_order(void);
+bool test_output_writer_failure(void);
+
+#endif
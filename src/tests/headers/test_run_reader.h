@@ -0,0 +1,9 @@
+#ifndef TEST_RUN_READER_H
+#define TEST_RUN_READER_H
+
+#include <stdbool.h>
+
+bool test_run_reader_frames(void);
+bool test_run_reader_spikes(void);
+
+#endif
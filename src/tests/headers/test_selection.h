@@ -0,0 +1,9 @@
+#ifndef TEST_SELECTION_H
+#define TEST_SELECTION_H
+
+#include <stdbool.h>
+
+bool test_selection_parse(void);
+bool test_selection_gather(void);
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef TEST_SHM_RING_H
+#define TEST_SHM_RING_H
+
+#include <stdbool.h>
+
+bool test_shm_ring_publish_read(void);
+bool test_shm_ring_overwrite(void);
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef TEST_SNAPSHOT_BUFFER_H
+#define TEST_SNAPSHOT_BUFFER_H
+
+#include <stdbool.h>
+
+bool test_snapshot_buffer_latest(void);
+bool test_snapshot_buffer_threads(void);
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef TEST_SPECTRUM_H
+#define TEST_SPECTRUM_H
+
+#include <stdbool.h>
+
+bool test_spectrum_sines(void);
+bool test_spectrum_segments(void);
+
+#endif
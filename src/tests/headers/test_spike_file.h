@@ -0,0 +1,8 @@
+#ifndef TEST_SPIKE_FILE_H
+#define TEST_SPIKE_FILE_H
+
+#include <stdbool.h>
+
+bool test_spike_file_write_read(void);
+
+#endif
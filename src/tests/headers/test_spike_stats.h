@@ -0,0 +1,9 @@
+#ifndef TEST_SPIKE_STATS_H
+#define TEST_SPIKE_STATS_H
+
+#include <stdbool.h>
+
+bool test_spike_stats_intervals(void);
+bool test_spike_stats_bursts(void);
+
+#endif
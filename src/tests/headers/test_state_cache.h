@@ -0,0 +1,9 @@
+#ifndef TEST_STATE_CACHE_H
+#define TEST_STATE_CACHE_H
+
+#include <stdbool.h>
+
+bool test_state_cache_key(void);
+bool test_state_cache_restore(void);
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef TEST_STREAM_SINK_H
+#define TEST_STREAM_SINK_H
+
+#include <stdbool.h>
+
+bool test_stream_sink_send(void);
+bool test_stream_sink_drop(void);
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef TEST_SYNCHRONY_H
+#define TEST_SYNCHRONY_H
+
+#include <stdbool.h>
+
+bool test_synchrony_in_phase(void);
+bool test_synchrony_anti_phase(void);
+bool test_synchrony_random_coupling(void);
+
+#endif
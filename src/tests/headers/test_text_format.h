@@ -0,0 +1,9 @@
+#ifndef TEST_TEXT_FORMAT_H
+#define TEST_TEXT_FORMAT_H
+
+#include <stdbool.h>
+
+bool test_text_format_matches_printf(void);
+bool test_text_buffer_append(void);
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef TEST_TRACE_FILE_H
+#define TEST_TRACE_FILE_H
+
+#include <stdbool.h>
+
+bool test_trace_file_transpose(void);
+bool test_trace_file_capacity(void);
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef TEST_WAVEFRONT_H
+#define TEST_WAVEFRONT_H
+
+#include <stdbool.h>
+
+bool test_wavefront_plane_wave(void);
+bool test_wavefront_spiral(void);
+
+#endif
@@ -4,9 +4,35 @@
 #include "headers/test_timer.h"
 #include "headers/test_utils.h"
 #include "headers/test_temp_memory.h"
+#include "headers/test_checkpoint.h"
+#include "headers/test_state_cache.h"
+#include "headers/test_frame_file.h"
+#include "headers/test_output_writer.h"
+#include "headers/test_compression.h"
+#include "headers/test_compressed_file.h"
+#include "headers/test_container.h"
+#include "headers/test_decimator.h"
+#include "headers/test_text_format.h"
+#include "headers/test_stream_sink.h"
+#include "headers/test_spike_file.h"
+#include "headers/test_selection.h"
+#include "headers/test_bulk_writer.h"
+#include "headers/test_shm_ring.h"
+#include "headers/test_run_reader.h"
+#include "headers/test_trace_file.h"
+#include "headers/test_spike_stats.h"
+#include "headers/test_synchrony.h"
+#include "headers/test_wavefront.h"
+#include "headers/test_spectrum.h"
+#include "headers/test_color_map.h"
+#include "headers/test_snapshot_buffer.h"
+#include "headers/test_image_sequence.h"
 
 static const struct test_entry entries[] = {
 	test_entry(test_file_table_create_destroy),
+	test_entry(test_file_table_handles),
+	test_entry(test_file_table_open_failure),
+	test_entry(test_file_table_write_failure),
 	test_entry(test_temp_malloc),
 	test_entry(test_temp_free),
 	test_entry(test_math_utils_wrap_around),
@@ -16,6 +42,50 @@ static const struct test_entry entries[] = {
 	test_entry(test_math_utils_rk4_integrate_9_constant_velocity),
 	test_entry(test_timer_begin_end),
 	test_entry(test_timer_total_get),
+	test_entry(test_checkpoint_write_restore),
+	test_entry(test_checkpoint_open_invalid),
+	test_entry(test_checkpoint_background),
+	test_entry(test_state_cache_key),
+	test_entry(test_state_cache_restore),
+	test_entry(test_frame_file_write_read),
+	test_entry(test_output_writer_order),
+	test_entry(test_output_writer_failure),
+	test_entry(test_compression_xor_round_trip),
+	test_entry(test_compression_lz_round_trip),
+	test_entry(test_compressed_file_write_read),
+	test_entry(test_container_write_read),
+	test_entry(test_container_recover),
+	test_entry(test_decimator_take),
+	test_entry(test_text_format_matches_printf),
+	test_entry(test_text_buffer_append),
+	test_entry(test_stream_sink_send),
+	test_entry(test_stream_sink_drop),
+	test_entry(test_spike_file_write_read),
+	test_entry(test_selection_parse),
+	test_entry(test_selection_gather),
+	test_entry(test_bulk_writer_write),
+	test_entry(test_bulk_writer_offset),
+	test_entry(test_shm_ring_publish_read),
+	test_entry(test_shm_ring_overwrite),
+	test_entry(test_run_reader_frames),
+	test_entry(test_run_reader_spikes),
+	test_entry(test_trace_file_transpose),
+	test_entry(test_trace_file_capacity),
+	test_entry(test_spike_stats_intervals),
+	test_entry(test_spike_stats_bursts),
+	test_entry(test_synchrony_in_phase),
+	test_entry(test_synchrony_anti_phase),
+	test_entry(test_synchrony_random_coupling),
+	test_entry(test_wavefront_plane_wave),
+	test_entry(test_wavefront_spiral),
+	test_entry(test_spectrum_sines),
+	test_entry(test_spectrum_segments),
+	test_entry(test_color_map_lookup),
+	test_entry(test_color_map_fill),
+	test_entry(test_snapshot_buffer_latest),
+	test_entry(test_snapshot_buffer_threads),
+	test_entry(test_image_sequence_ppm_png),
+	test_entry(test_image_sequence_gif),
 	null_entry
 };
 
@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <string.h>
+#include "headers/test_bulk_writer.h"
+#include "../headers/bulk_writer.h"
+#include "headers/test_utils.h"
+
+static const char *bulk_writer_test_filename = "test_bulk.bin";
+
+static unsigned char test_byte(size_t i)
+{
+	return (unsigned char)(i * 7 + i / 251);
+}
+
+/* Checks that the file holds prefix_size bytes of prefix followed by size
+ * test bytes, and nothing more. */
+static bool file_holds(const unsigned char *prefix, size_t prefix_size, size_t size)
+{
+	FILE *fh = fopen(bulk_writer_test_filename, "rb");
+	if (!fh) {
+		return false;
+	}
+
+	bool result = true;
+	for (size_t i = 0; result && i < prefix_size; i++) {
+		result = fgetc(fh) == prefix[i];
+	}
+	for (size_t i = 0; result && i < size; i++) {
+		result = fgetc(fh) == test_byte(i);
+	}
+	result = result && fgetc(fh) == EOF;
+	fclose(fh);
+	return result;
+}
+
+/* Writes size test bytes after prefix in pieces of odd sizes, so that they
+ * straddle the chunks. */
+static bool write_and_check(enum bulk_writer_backend backend, bool direct, const unsigned char *prefix,
+			    size_t prefix_size, size_t size)
+{
+	FILE *fh = fopen(bulk_writer_test_filename, "wb");
+	fwrite(prefix, 1, prefix_size, fh);
+	fwrite("left over", 1, 9, fh);
+	fclose(fh);
+
+	struct bulk_writer_options options = {
+		.backend = backend,
+		.queue_depth = 3,
+		.chunk_size = 2 * BULK_WRITER_ALIGNMENT,
+		.direct = direct
+	};
+	bulk_writer bw = bulk_writer_open(bulk_writer_test_filename, prefix_size, &options);
+	bool result = bw != NULL;
+
+	unsigned char piece[1000];
+	for (size_t written = 0; result && written < size; ) {
+		size_t piece_size = size - written < 999 ? size - written : 999;
+		for (size_t i = 0; i < piece_size; i++) {
+			piece[i] = test_byte(written + i);
+		}
+		result = bulk_writer_write(bw, piece, piece_size);
+		written += piece_size;
+	}
+
+	struct bulk_writer_stats stats;
+	if (bw) {
+		bulk_writer_get_stats(bw, &stats);
+		result = bulk_writer_close(&bw) && result && !bw;
+	}
+	/* io_uring may fall back to the thread, but never the other way around */
+	result = result && (backend == BULK_WRITER_URING || stats.backend == BULK_WRITER_THREAD)
+		&& file_holds(prefix, prefix_size, size);
+	remove(bulk_writer_test_filename);
+
+	return result;
+}
+
+bool test_bulk_writer_write(void)
+{
+	size_t previous_allocations = current_number_of_allocations();
+
+	bool test_1 = write_and_check(BULK_WRITER_URING, false, NULL, 0, 100000)
+		&& write_and_check(BULK_WRITER_THREAD, false, NULL, 0, 100000);
+	bool test_2 = write_and_check(BULK_WRITER_URING, true, NULL, 0, 100000)
+		&& write_and_check(BULK_WRITER_THREAD, true, NULL, 0, 100000);
+	/* exactly full chunks, and nothing at all */
+	bool test_3 = write_and_check(BULK_WRITER_URING, true, NULL, 0, 6 * BULK_WRITER_ALIGNMENT)
+		&& write_and_check(BULK_WRITER_THREAD, false, NULL, 0, 0);
+
+	struct bulk_writer_options options = { .backend = BULK_WRITER_THREAD, .queue_depth = 1, .chunk_size = 4096 };
+	bool test_4 = is_assert_invoked(bulk_writer_open(bulk_writer_test_filename, 0, &options));
+	options.queue_depth = 2;
+	options.chunk_size = 1000;
+	bool test_5 = is_assert_invoked(bulk_writer_open(bulk_writer_test_filename, 0, &options));
+
+	bool test_6 = previous_allocations == current_number_of_allocations();
+
+	return test_1 && test_2 && test_3 && test_4 && test_5 && test_6;
+}
+
+bool test_bulk_writer_offset(void)
+{
+	size_t previous_allocations = current_number_of_allocations();
+
+	/* a header that ends within a block, as when a frame file is continued */
+	unsigned char prefix[5000];
+	for (size_t i = 0; i < sizeof prefix; i++) {
+		prefix[i] = (unsigned char)(255 - i % 256);
+	}
+
+	bool test_1 = write_and_check(BULK_WRITER_URING, false, prefix, sizeof prefix, 30000)
+		&& write_and_check(BULK_WRITER_THREAD, false, prefix, sizeof prefix, 30000);
+	bool test_2 = write_and_check(BULK_WRITER_URING, true, prefix, sizeof prefix, 30000)
+		&& write_and_check(BULK_WRITER_THREAD, true, prefix, sizeof prefix, 30000);
+	bool test_3 = write_and_check(BULK_WRITER_URING, true, prefix, 100, 10);
+
+	bool test_4 = previous_allocations == current_number_of_allocations();
+
+	return test_1 && test_2 && test_3 && test_4;
+}
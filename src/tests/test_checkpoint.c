@@ -0,0 +1,189 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "headers/test_checkpoint.h"
+#include "../headers/checkpoint.h"
+#include "../headers/dynamical_system.h"
+#include "../headers/math_utils.h"
+#include "headers/test_utils.h"
+
+static const char *checkpoint_test_filename = "test_checkpoint.bin";
+
+static double unit_parameter = 1.0;
+static void *unit_parameter_callback(dynamical_system ds, uint index)
+{
+	return &unit_parameter;
+}
+static uint line_coupling_callback(dynamical_system ds, uint first_index)
+{
+	struct edge *edge_pool = dynamical_system_get_edge_pool(ds);
+	edge_pool[0].index = (first_index + 1) % dynamical_system_get_system_size(ds);
+	edge_pool[0].value = 0.5;
+	return 1;
+}
+static void counting_initial_values_callback(uint index, uint size, double *system_values)
+{
+	for (uint i = 0; i < size; i++) {
+		system_values[i] = index * size + i;
+	}
+}
+static void zero_initial_values_callback(uint index, uint size, double *system_values)
+{
+	for (uint i = 0; i < size; i++) {
+		system_values[i] = 0.0;
+	}
+}
+static double unit_derivative(dynamical_system ds, uint index)
+{
+	return 1.0;
+}
+
+bool test_checkpoint_write_restore(void)
+{
+	double (*derivatives[])(dynamical_system, uint) = { &unit_derivative, &unit_derivative };
+	struct checkpoint_info info = {
+		.model_name = "model",
+		.parameter_callback_name = "parameters",
+		.coupling_callback_name = "coupling",
+		.initial_values_callback_name = "initial",
+		.time_step = 0.1,
+		.coupling_constant_is_random = false,
+		.coupling_constant = 0.5
+	};
+
+	size_t previous_allocations = current_number_of_allocations();
+	dynamical_system original = dynamical_system_create(4, 2, 2, 2,
+							    unit_parameter_callback,
+							    line_coupling_callback,
+							    counting_initial_values_callback,
+							    derivatives);
+	dynamical_system_set_time(original, 12.5);
+	math_utils_random_state_set(42);
+
+	bool test_1 = checkpoint_write(original, &info, checkpoint_test_filename);
+	math_utils_random_state_set(7);
+
+	checkpoint cp = checkpoint_open(checkpoint_test_filename);
+	bool test_2 = cp != NULL;
+
+	struct checkpoint_info read_info;
+	checkpoint_get_info(cp, &read_info);
+	bool test_3 = !strcmp(read_info.model_name, "model")
+		&& !strcmp(read_info.coupling_callback_name, "coupling")
+		&& read_info.time_step == 0.1
+		&& checkpoint_get_system_size(cp) == 4
+		&& checkpoint_get_element_size(cp) == 2
+		&& checkpoint_get_grid_width(cp) == 2;
+
+	dynamical_system restored = dynamical_system_create(4, 2, 2, 2,
+							    unit_parameter_callback,
+							    line_coupling_callback,
+							    zero_initial_values_callback,
+							    derivatives);
+	bool test_4 = checkpoint_restore(cp, restored);
+	bool test_5 = dynamical_system_get_time(restored) == 12.5
+		&& math_utils_random_state_get() == 42;
+	for (uint i = 0; i < 4; i++) {
+		for (uint j = 0; j < 2; j++) {
+			test_5 = test_5 && dynamical_system_get_value(restored, i, j)
+				== dynamical_system_get_value(original, i, j);
+		}
+	}
+
+	checkpoint_close(&cp);
+	bool test_6 = cp == NULL;
+
+	dynamical_system_destroy(&original);
+	dynamical_system_destroy(&restored);
+	remove(checkpoint_test_filename);
+
+	bool test_7 = previous_allocations == current_number_of_allocations();
+
+	return test_1 && test_2 && test_3 && test_4 && test_5 && test_6 && test_7;
+}
+
+bool test_checkpoint_open_invalid(void)
+{
+	FILE *fh = fopen(checkpoint_test_filename, "wb");
+	fputs("this is not a checkpoint", fh);
+	fclose(fh);
+
+	bool test_1 = checkpoint_open(checkpoint_test_filename) == NULL;
+	remove(checkpoint_test_filename);
+	bool test_2 = checkpoint_open(checkpoint_test_filename) == NULL;
+
+	return test_1 && test_2;
+}
+
+bool test_checkpoint_background(void)
+{
+	double (*derivatives[])(dynamical_system, uint) = { &unit_derivative, &unit_derivative };
+	struct checkpoint_info info = {
+		.model_name = "model",
+		.parameter_callback_name = "parameters",
+		.coupling_callback_name = "coupling",
+		.initial_values_callback_name = "initial",
+		.time_step = 0.1,
+		.coupling_constant_is_random = false,
+		.coupling_constant = 0.5
+	};
+
+	size_t previous_allocations = current_number_of_allocations();
+	dynamical_system original = dynamical_system_create(4, 2, 2, 2,
+							    unit_parameter_callback,
+							    line_coupling_callback,
+							    counting_initial_values_callback,
+							    derivatives);
+	dynamical_system_set_time(original, 3.5);
+
+	/* the child opens the temporary file for writing first, which blocks
+	 * on a fifo until it is read, so the write is still running below */
+	const char *temp_filename = "test_checkpoint.bin.tmp";
+	remove(temp_filename);
+	bool test_1 = !mkfifo(temp_filename, 0600)
+		&& checkpoint_write_background(original, &info, checkpoint_test_filename)
+		== CHECKPOINT_BACKGROUND_STARTED;
+	bool test_2 = checkpoint_write_background(original, &info, checkpoint_test_filename)
+		== CHECKPOINT_BACKGROUND_BUSY;
+
+	/* a fifo cannot be rewound to fill in the header, so this write fails */
+	int fd = open(temp_filename, O_RDONLY);
+	char buffer[256];
+	while (fd >= 0 && read(fd, buffer, sizeof buffer) > 0) {
+	}
+	if (fd >= 0) {
+		close(fd);
+	}
+	bool test_3 = !checkpoint_wait_background() && checkpoint_open(checkpoint_test_filename) == NULL;
+
+	dynamical_system_set_time(original, 4.5);
+	bool test_4 = checkpoint_write_background(original, &info, checkpoint_test_filename)
+		== CHECKPOINT_BACKGROUND_STARTED;
+	bool test_5 = checkpoint_wait_background();
+
+	checkpoint cp = checkpoint_open(checkpoint_test_filename);
+	dynamical_system restored = dynamical_system_create(4, 2, 2, 2,
+							    unit_parameter_callback,
+							    line_coupling_callback,
+							    zero_initial_values_callback,
+							    derivatives);
+	bool test_6 = cp && checkpoint_restore(cp, restored)
+		&& dynamical_system_get_time(restored) == 4.5
+		&& !memcmp(dynamical_system_get_values(restored), dynamical_system_get_values(original),
+			   sizeof (double) * 4 * 2);
+	if (cp) {
+		checkpoint_close(&cp);
+	}
+
+	dynamical_system_destroy(&original);
+	dynamical_system_destroy(&restored);
+	remove(checkpoint_test_filename);
+
+	bool test_7 = previous_allocations == current_number_of_allocations();
+
+	return test_1 && test_2 && test_3 && test_4 && test_5 && test_6 && test_7;
+}
@@ -0,0 +1,57 @@
+#include <stdlib.h>
+#include <math.h>
+#include "headers/test_color_map.h"
+#include "../headers/color_map.h"
+#include "headers/test_utils.h"
+
+static const struct color_map_rgb low = { .r = 0, .g = 0, .b = 255 };
+static const struct color_map_rgb high = { .r = 255, .g = 100, .b = 0 };
+
+bool test_color_map_lookup(void)
+{
+	size_t previous_allocations = current_number_of_allocations();
+
+	color_map cm = color_map_create(-80.0, 30.0, low, high);
+	bool test_1 = color_map_lookup(cm, -80.0) == 0xff0000ff && color_map_lookup(cm, 30.0) == 0xffff6400;
+	/* out of the range and NaN take the nearest end */
+	bool test_2 = color_map_lookup(cm, -1000.0) == 0xff0000ff && color_map_lookup(cm, 1000.0) == 0xffff6400
+		&& color_map_lookup(cm, NAN) == 0xff0000ff;
+	uint32_t middle = color_map_lookup(cm, -25.0);
+	bool test_3 = abs((int)((middle >> 16) & 0xff) - 127) <= 1 && abs((int)((middle >> 8) & 0xff) - 50) <= 1
+		&& abs((int)(middle & 0xff) - 127) <= 1 && middle >> 24 == 0xff;
+
+	color_map_destroy(&cm);
+	bool test_4 = previous_allocations == current_number_of_allocations();
+
+	return test_1 && test_2 && test_3 && test_4;
+}
+
+bool test_color_map_fill(void)
+{
+	size_t previous_allocations = current_number_of_allocations();
+
+	color_map cm = color_map_create(0.0, 1.0, low, high);
+	/* two variables per system, only the first of which is mapped */
+	double values[8] = { 0.0, 5.0, 1.0, 5.0, 0.25, 5.0, -1.0, 5.0 };
+	uint32_t pixels[4];
+	color_map_fill(cm, values, 2, 4, pixels);
+	bool test_1 = pixels[0] == color_map_lookup(cm, 0.0) && pixels[1] == color_map_lookup(cm, 1.0)
+		&& pixels[2] == color_map_lookup(cm, 0.25) && pixels[3] == pixels[0];
+	bool test_2 = pixels[0] != pixels[1] && pixels[2] != pixels[0];
+
+	/* the same values as indices into a palette along the same line */
+	uint8_t indices[4];
+	struct color_map_rgb palette[COLOR_MAP_PALETTE_SIZE];
+	color_map_fill_indices(cm, values, 2, 4, indices);
+	color_map_get_palette(cm, palette);
+	bool test_3 = indices[0] == 0 && indices[1] == COLOR_MAP_PALETTE_SIZE - 1 && indices[2] == 64
+		&& indices[3] == 0;
+	bool test_4 = palette[0].r == low.r && palette[0].g == low.g && palette[0].b == low.b
+		&& palette[COLOR_MAP_PALETTE_SIZE - 1].r == high.r && palette[COLOR_MAP_PALETTE_SIZE - 1].g == high.g
+		&& palette[COLOR_MAP_PALETTE_SIZE - 1].b == high.b;
+
+	color_map_destroy(&cm);
+	bool test_5 = previous_allocations == current_number_of_allocations();
+
+	return test_1 && test_2 && test_3 && test_4 && test_5;
+}
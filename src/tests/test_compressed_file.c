@@ -0,0 +1,70 @@
+#include <stdio.h>
+#include "headers/test_compressed_file.h"
+#include "headers/test_frame_layout.h"
+#include "../headers/compressed_file.h"
+#include "headers/test_utils.h"
+
+static const char *compressed_file_test_filename = "test_frames.nnz";
+
+/* Reads every frame back and compares it against the fixture values. */
+static bool read_and_check(const struct frame_file_layout *expected_layout, uint expected_frames)
+{
+	compressed_reader cr = compressed_reader_open(compressed_file_test_filename);
+	if (!cr) {
+		return false;
+	}
+
+	struct frame_file_layout layout;
+	compressed_reader_get_layout(cr, &layout);
+	bool result = test_frame_layout_matches(&layout, expected_layout);
+
+	uint frames = 0;
+	uint chunk_frames;
+	while ((chunk_frames = compressed_reader_next_chunk(cr))) {
+		for (uint frame = 0; frame < chunk_frames; frame++, frames++) {
+			const double *values = compressed_reader_get_values(cr, frame);
+			result = result && compressed_reader_get_time(cr, frame) == frames;
+			for (uint system = 0; system < layout.system_size; system++) {
+				for (uint variable = 0; variable < layout.variable_count; variable++) {
+					result = result && values[system * layout.variable_count + variable]
+						== test_frame_stored_value(&layout, frames, system, variable);
+				}
+			}
+		}
+	}
+
+	compressed_reader_close(&cr);
+	return result && frames == expected_frames;
+}
+
+static bool write_and_check(uint value_size)
+{
+	struct frame_file_layout layout = test_frame_layout(3, 1, 2, value_size);
+	double values[6];
+
+	/* ten frames in chunks of four leave a partial last chunk */
+	compressed_file cf = compressed_file_create(compressed_file_test_filename, &layout, 4);
+	bool result = cf != NULL;
+	for (uint frame = 0; result && frame < 10; frame++) {
+		test_frame_values(&layout, frame, values);
+		result = compressed_file_write(cf, frame, values);
+	}
+	result = result && compressed_file_get_frame_count(cf) == 10;
+	result = compressed_file_destroy(&cf) && result;
+
+	result = result && read_and_check(&layout, 10);
+	remove(compressed_file_test_filename);
+
+	return result;
+}
+
+bool test_compressed_file_write_read(void)
+{
+	size_t previous_allocations = current_number_of_allocations();
+
+	bool test_1 = write_and_check(sizeof (double));
+	bool test_2 = write_and_check(sizeof (float));
+	bool test_3 = previous_allocations == current_number_of_allocations();
+
+	return test_1 && test_2 && test_3;
+}
@@ -0,0 +1,99 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "headers/test_compression.h"
+#include "../headers/deftypes.h"
+#include "../headers/compression.h"
+#include "headers/test_utils.h"
+
+static bool xor_round_trip(const double *values, size_t count)
+{
+	unsigned char *encoded = malloc(compression_xor_bound(count));
+	double *decoded = malloc((sizeof *decoded) * count);
+
+	size_t encoded_size = compression_xor_encode(values, count, 1, encoded);
+	bool result = encoded_size <= compression_xor_bound(count)
+		&& compression_xor_decode(encoded, encoded_size, decoded, count, 1) == encoded_size
+		&& !memcmp(values, decoded, (sizeof *values) * count);
+
+	free(encoded);
+	free(decoded);
+	return result;
+}
+
+bool test_compression_xor_round_trip(void)
+{
+	double smooth[256], noise[256], constant[256];
+	for (uint i = 0; i < 256; i++) {
+		smooth[i] = -65.0 + 10.0 * sin(i * 0.05);
+		noise[i] = (double)rand() / RAND_MAX * 1e10 - (i % 2 ? 1e-300 : 0.0);
+		constant[i] = 42.0;
+	}
+	const double special[] = { 0.0, -0.0, INFINITY, -INFINITY, NAN, 1e-310, 1.0, 1.0 };
+
+	bool test_1 = xor_round_trip(smooth, 256);
+	bool test_2 = xor_round_trip(noise, 256);
+	bool test_3 = xor_round_trip(constant, 256);
+	bool test_4 = xor_round_trip(special, 8);
+
+	/* a constant series needs a single bit per value after the first */
+	unsigned char encoded[64];
+	bool test_5 = compression_xor_encode(constant, 256, 1, encoded) == 8 + 255 / 8 + 1;
+
+	/* a strided series only reads and writes every stride-th value */
+	double interleaved[8] = { 1.0, -1.0, 2.0, -1.0, 3.0, -1.0, 4.0, -1.0 };
+	double decoded[8] = { 0 };
+	size_t size = compression_xor_encode(interleaved, 4, 2, encoded);
+	bool test_6 = compression_xor_decode(encoded, size, decoded, 4, 2) == size
+		&& decoded[6] == 4.0 && decoded[1] == 0.0;
+
+	/* truncated input is refused */
+	bool test_7 = compression_xor_decode(encoded, size - 1, decoded, 4, 2) == 0;
+
+	return test_1 && test_2 && test_3 && test_4 && test_5 && test_6 && test_7;
+}
+
+bool test_compression_lz_round_trip(void)
+{
+	size_t size = 10000;
+	unsigned char *input = malloc(size);
+	unsigned char *encoded = malloc(compression_lz_bound(size));
+	unsigned char *decoded = malloc(size);
+
+	/* repetitive data */
+	for (size_t i = 0; i < size; i++) {
+		input[i] = "neuralnet"[i % 9];
+	}
+	size_t encoded_size = compression_lz_encode(input, size, encoded);
+	bool test_1 = encoded_size < size / 10
+		&& compression_lz_decode(encoded, encoded_size, decoded, size) == size
+		&& !memcmp(input, decoded, size);
+
+	/* incompressible data stays within the bound */
+	for (size_t i = 0; i < size; i++) {
+		input[i] = rand();
+	}
+	encoded_size = compression_lz_encode(input, size, encoded);
+	bool test_2 = encoded_size <= compression_lz_bound(size)
+		&& compression_lz_decode(encoded, encoded_size, decoded, size) == size
+		&& !memcmp(input, decoded, size);
+
+	/* short and empty inputs */
+	encoded_size = compression_lz_encode(input, 3, encoded);
+	bool test_3 = compression_lz_decode(encoded, encoded_size, decoded, size) == 3
+		&& !memcmp(input, decoded, 3);
+	bool test_4 = compression_lz_decode(encoded, compression_lz_encode(input, 0, encoded), decoded, size) == 0;
+
+	/* output that does not fit is refused */
+	for (size_t i = 0; i < size; i++) {
+		input[i] = 0;
+	}
+	encoded_size = compression_lz_encode(input, size, encoded);
+	bool test_5 = compression_lz_decode(encoded, encoded_size, decoded, size - 1) == 0;
+
+	free(input);
+	free(encoded);
+	free(decoded);
+
+	return test_1 && test_2 && test_3 && test_4 && test_5;
+}
@@ -0,0 +1,90 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "headers/test_container.h"
+#include "headers/test_frame_layout.h"
+#include "../headers/container.h"
+#include "headers/test_utils.h"
+
+static const char *container_test_filename = "test_frames.nnc";
+
+static bool write_frames(container c, const struct frame_file_layout *layout, uint first_frame, uint frame_count)
+{
+	bool result = true;
+	double values[6];
+	for (uint frame = first_frame; frame < first_frame + frame_count; frame++) {
+		test_frame_values(layout, frame, values);
+		result = container_write(c, frame, values) && result;
+	}
+	return result;
+}
+
+/* Checks that every frame up to frame_count reads back, and that a time
+ * range is found through the chunks that hold it. */
+static bool read_and_check(const struct frame_file_layout *expected_layout, uint frame_count, bool expect_index)
+{
+	container_reader cr = container_reader_open(container_test_filename);
+	if (!cr) {
+		return false;
+	}
+
+	struct frame_file_layout layout;
+	container_reader_get_layout(cr, &layout);
+	bool result = test_frame_layout_matches(&layout, expected_layout)
+		&& container_reader_has_index(cr) == expect_index;
+
+	double times[16], values[16];
+	uint64_t count = container_reader_read_range(cr, 1, 2, 0.0, 1e9, times, values, 16);
+	result = result && count == frame_count;
+	for (uint64_t i = 0; i < count; i++) {
+		result = result && times[i] == i && values[i] == test_frame_value(i, 2, 1);
+	}
+
+	count = container_reader_read_range(cr, 0, 1, 5.0, 6.5, times, values, 16);
+	result = result && count == 2 && times[0] == 5.0 && values[1] == test_frame_value(6, 1, 0);
+
+	/* with chunks of four frames, time 5 is in the second chunk */
+	result = result && container_reader_find_chunk(cr, 0, 5.0) == 1
+		&& container_reader_find_chunk(cr, 0, 1e9) == container_reader_get_chunk_count(cr, 0);
+
+	container_reader_close(&cr);
+	return result;
+}
+
+bool test_container_write_read(void)
+{
+	size_t previous_allocations = current_number_of_allocations();
+	struct frame_file_layout layout = test_frame_layout(3, 1, 2, sizeof (double));
+
+	container c = container_create(container_test_filename, &layout, 4);
+	bool test_1 = c && write_frames(c, &layout, 0, 10) && container_get_frame_count(c) == 10;
+	test_1 = container_destroy(&c) && test_1;
+
+	bool test_2 = read_and_check(&layout, 10, true);
+	bool test_3 = previous_allocations == current_number_of_allocations();
+	remove(container_test_filename);
+
+	return test_1 && test_2 && test_3;
+}
+
+bool test_container_recover(void)
+{
+	struct frame_file_layout layout = test_frame_layout(3, 1, 2, sizeof (double));
+
+	container c = container_create(container_test_filename, &layout, 4);
+	write_frames(c, &layout, 0, 10);
+	container_destroy(&c);
+	bool test_1 = read_and_check(&layout, 10, true);
+
+	/* lose the end of the file as in a crash; the chunks are found without the index */
+	struct stat st;
+	stat(container_test_filename, &st);
+	truncate(container_test_filename, st.st_size - 20);
+	bool test_2 = read_and_check(&layout, 10, false);
+
+	remove(container_test_filename);
+
+	return test_1 && test_2;
+}
@@ -0,0 +1,42 @@
+#include "headers/test_decimator.h"
+#include "../headers/decimator.h"
+#include "headers/test_utils.h"
+
+bool test_decimator_take(void)
+{
+	size_t previous_allocations = current_number_of_allocations();
+
+	/* two systems of two variables each, summarizing the second variable */
+	decimator d = decimator_create(2, 2, 1);
+	const double samples[][4] = {
+		{ 0.0, 1.0, 0.0, -1.0 },
+		{ 0.0, 5.0, 0.0, -3.0 },
+		{ 0.0, 3.0, 0.0, -2.0 }
+	};
+	for (uint i = 0; i < 3; i++) {
+		decimator_add(d, samples[i]);
+	}
+
+	double envelope[2 * DECIMATOR_FIELD_COUNT];
+	bool test_1 = decimator_get_sample_count(d) == 3;
+	decimator_take(d, envelope);
+	bool test_2 = envelope[DECIMATOR_MIN] == 1.0 && envelope[DECIMATOR_MAX] == 5.0
+		&& envelope[DECIMATOR_MEAN] == 3.0 && envelope[DECIMATOR_LAST] == 3.0;
+	bool test_3 = envelope[DECIMATOR_FIELD_COUNT + DECIMATOR_MIN] == -3.0
+		&& envelope[DECIMATOR_FIELD_COUNT + DECIMATOR_MAX] == -1.0
+		&& envelope[DECIMATOR_FIELD_COUNT + DECIMATOR_MEAN] == -2.0;
+
+	/* a new bucket starts from its own first sample */
+	decimator_add(d, samples[2]);
+	bool test_4 = decimator_get_sample_count(d) == 1;
+	decimator_take(d, envelope);
+	bool test_5 = envelope[DECIMATOR_MIN] == 3.0 && envelope[DECIMATOR_MAX] == 3.0
+		&& decimator_get_sample_count(d) == 0;
+
+	bool test_6 = is_assert_invoked(decimator_take(d, envelope));
+
+	decimator_destroy(&d);
+	bool test_7 = previous_allocations == current_number_of_allocations();
+
+	return test_1 && test_2 && test_3 && test_4 && test_5 && test_6 && test_7;
+}
@@ -1,4 +1,8 @@
 
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include "headers/test_file_table.h"
 #include "../headers/file_table.h"
 #include "headers/test_utils.h"
@@ -14,3 +18,82 @@ bool test_file_table_create_destroy()
 
 	return test_1 && test_2 && test_3;
 }
+
+bool test_file_table_handles(void)
+{
+	size_t prev_allocs = current_number_of_allocations();
+	file_table fa = file_table_create(".", 0, 1, "test_matrix.dat");
+	file_table_handle matrix = file_table_special_handle(fa, "test_matrix.dat");
+
+	/* a 2 by 2 matrix taken from every other value */
+	const double values[] = { 1.0, 0.0, -2.0, 0.0, 0.5, 0.0, 3.0, 0.0 };
+	file_table_write(fa, matrix, "#\n", 2);
+	file_table_write_matrix(fa, matrix, values, 2, 2, 2, 3);
+	bool test_1 = is_assert_invoked(file_table_special_handle(fa, "missing.dat"));
+	file_table_destroy(&fa);
+
+	char contents[128] = {0};
+	FILE *fh = fopen("test_matrix.dat", "r");
+	bool test_2 = fh && fread(contents, 1, sizeof contents - 1, fh) > 0
+		&& !strcmp(contents, "#\n1.000e+00 -2.000e+00 \n5.000e-01 3.000e+00 \n");
+	if (fh) {
+		fclose(fh);
+	}
+	remove("test_matrix.dat");
+
+	bool test_3 = prev_allocs == current_number_of_allocations();
+
+	return test_1 && test_2 && test_3;
+}
+
+bool test_file_table_open_failure(void)
+{
+	/* a directory in place of a file makes its fopen fail */
+	mkdir("test_file_table", 0700);
+	mkdir("test_file_table/1.dat", 0700);
+	mkdir("test_file_table/blocked.dat", 0700);
+
+	size_t prev_allocs = current_number_of_allocations();
+	bool test_1 = file_table_create("test_file_table", 3, 0) == NULL;
+	bool test_2 = file_table_create_numbered("test_file_table", (uint[]){ 0, 2 }, 2,
+						 2, "first.dat", "blocked.dat") == NULL;
+	bool test_3 = prev_allocs == current_number_of_allocations();
+
+	remove("test_file_table/0.dat");
+	remove("test_file_table/2.dat");
+	remove("test_file_table/first.dat");
+	rmdir("test_file_table/1.dat");
+	rmdir("test_file_table/blocked.dat");
+	rmdir("test_file_table");
+
+	return test_1 && test_2 && test_3;
+}
+
+bool test_file_table_write_failure(void)
+{
+	size_t prev_allocs = current_number_of_allocations();
+
+	/* every write to /dev/full fails once it leaves the stdio buffer */
+	file_table fa = file_table_create("/dev", 0, 1, "full");
+	bool test_1 = fa != NULL;
+	if (!fa) {
+		return false;
+	}
+	bool test_2 = file_table_write(fa, file_table_special_handle(fa, "full"), "#\n", 2);
+	bool test_3 = !file_table_destroy(&fa) && fa == NULL;
+
+	/* more than the buffer holds fails right away */
+	static char large[1 << 21];
+	fa = file_table_create("/dev", 0, 1, "full");
+	bool test_4 = !file_table_write(fa, file_table_special_handle(fa, "full"), large, sizeof large);
+	file_table_destroy(&fa);
+
+	fa = file_table_create(".", 0, 1, "test_matrix.dat");
+	bool test_5 = file_table_write(fa, file_table_special_handle(fa, "test_matrix.dat"), "#\n", 2)
+		&& file_table_destroy(&fa);
+	remove("test_matrix.dat");
+
+	bool test_6 = prev_allocs == current_number_of_allocations();
+
+	return test_1 && test_2 && test_3 && test_4 && test_5 && test_6;
+}
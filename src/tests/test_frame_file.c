@@ -0,0 +1,55 @@
+#include <stdio.h>
+#include "headers/test_frame_file.h"
+#include "headers/test_frame_layout.h"
+#include "../headers/frame_file.h"
+#include "headers/test_utils.h"
+
+static const char *frame_file_test_filename = "test_frames.bin";
+
+static bool write_and_check(uint value_size)
+{
+	struct frame_file_layout layout = test_frame_layout(3, 1, 2, value_size);
+	double values[6];
+
+	frame_file ff = frame_file_create(frame_file_test_filename, &layout);
+	bool result = ff != NULL;
+	for (uint frame = 0; result && frame < 2; frame++) {
+		test_frame_values(&layout, frame, values);
+		result = frame_file_write(ff, frame, values);
+	}
+	result = result && frame_file_get_frame_count(ff) == 2;
+	frame_file_destroy(&ff);
+
+	frame_reader fr = frame_reader_open(frame_file_test_filename);
+	result = result && fr != NULL;
+
+	struct frame_file_layout read_layout;
+	frame_reader_get_layout(fr, &read_layout);
+	result = result && test_frame_layout_matches(&read_layout, &layout);
+
+	/* frames are stored column by column, unlike the values written */
+	result = result && frame_reader_get_frame_count(fr) == 2;
+	result = result && frame_reader_get_time(fr, 1) == 1.0;
+	for (uint system = 0; system < 3; system++) {
+		for (uint variable = 0; variable < 2; variable++) {
+			result = result && frame_reader_get_value(fr, 1, variable, system)
+				== test_frame_stored_value(&layout, 1, system, variable);
+		}
+	}
+
+	frame_reader_close(&fr);
+	remove(frame_file_test_filename);
+
+	return result;
+}
+
+bool test_frame_file_write_read(void)
+{
+	size_t previous_allocations = current_number_of_allocations();
+
+	bool test_1 = write_and_check(sizeof (double));
+	bool test_2 = write_and_check(sizeof (float));
+	bool test_3 = previous_allocations == current_number_of_allocations();
+
+	return test_1 && test_2 && test_3;
+}
@@ -0,0 +1,64 @@
+#include <string.h>
+#include "headers/test_frame_layout.h"
+#include "headers/test_utils.h"
+
+/* The layout and values shared by the tests of the frame based formats. */
+
+static const char *test_variable_names[] = { "x", "y", "z" };
+
+/* A grid of systems, each with the first variable_count of x, y and z. */
+struct frame_file_layout test_frame_layout(uint grid_width, uint grid_height, uint variable_count, uint value_size)
+{
+	return (struct frame_file_layout) {
+		.model_name = "test-model",
+		.system_size = grid_width * grid_height,
+		.grid_width = grid_width,
+		.grid_height = grid_height,
+		.variable_count = variable_count,
+		.variable_names = test_variable_names,
+		.value_size = value_size,
+		.time_step = 0.1,
+		.print_time = 1.0
+	};
+}
+
+/* Every value differs, and most of them are rounded when stored as floats. */
+double test_frame_value(uint frame, uint system, uint variable)
+{
+	return frame * 100.0 + system * 1.1 + variable * 0.25;
+}
+
+/* The value as it reads back from a file of the given layout. */
+double test_frame_stored_value(const struct frame_file_layout *layout, uint frame, uint system, uint variable)
+{
+	double value = test_frame_value(frame, system, variable);
+	return layout->value_size == sizeof (float) ? (float)value : value;
+}
+
+/* Fills values with a frame in the row-major layout of the dynamical
+ * system, one row of variable_count values per system. */
+void test_frame_values(const struct frame_file_layout *layout, uint frame, double *values)
+{
+	for (uint system = 0; system < layout->system_size; system++) {
+		for (uint variable = 0; variable < layout->variable_count; variable++) {
+			values[system * layout->variable_count + variable] = test_frame_value(frame, system, variable);
+		}
+	}
+}
+
+/* Compares a layout read back from a file against the one it was written with. */
+bool test_frame_layout_matches(const struct frame_file_layout *layout, const struct frame_file_layout *expected)
+{
+	bool result = layout->system_size == expected->system_size
+		&& layout->grid_width == expected->grid_width
+		&& layout->grid_height == expected->grid_height
+		&& layout->variable_count == expected->variable_count
+		&& layout->value_size == expected->value_size
+		&& layout->time_step == expected->time_step
+		&& layout->print_time == expected->print_time
+		&& !strcmp(layout->model_name, expected->model_name);
+	for (uint variable = 0; result && variable < layout->variable_count; variable++) {
+		result = !strcmp(layout->variable_names[variable], expected->variable_names[variable]);
+	}
+	return result;
+}
@@ -0,0 +1,467 @@
+#include <stdio.h>
+#include <string.h>
+#include "headers/test_image_sequence.h"
+#include "../headers/image_sequence.h"
+#include "../headers/deftypes.h"
+#include "headers/test_utils.h"
+
+static const char *image_sequence_test_prefix = "test_image_sequence";
+
+static void make_palette(struct color_map_rgb *palette)
+{
+	for (uint i = 0; i < COLOR_MAP_PALETTE_SIZE; i++) {
+		palette[i] = (struct color_map_rgb){ i, 255 - i, i / 2 };
+	}
+}
+
+/* Something different in every cell of every frame. */
+static void make_frame(uint8_t *indices, uint count, uint frame)
+{
+	uint32_t state = frame * 2654435761u + 1;
+	for (uint i = 0; i < count; i++) {
+		state = state * 1664525u + 1013904223u;
+		indices[i] = state >> 24;
+	}
+}
+
+static size_t read_file(const char *filename, uint8_t *bytes, size_t size)
+{
+	FILE *fh = fopen(filename, "rb");
+	if (!fh) {
+		return 0;
+	}
+	size_t length = fread(bytes, 1, size, fh);
+	fclose(fh);
+	return length;
+}
+
+static uint32_t read_u32_be(const uint8_t *bytes)
+{
+	return (uint32_t)bytes[0] << 24 | (uint32_t)bytes[1] << 16 | (uint32_t)bytes[2] << 8 | bytes[3];
+}
+
+static uint32_t crc32(const uint8_t *data, size_t size)
+{
+	uint32_t result = 0xffffffff;
+	for (size_t i = 0; i < size; i++) {
+		result ^= data[i];
+		for (uint bit = 0; bit < 8; bit++) {
+			result = (result >> 1) ^ (0xedb88320 & -(result & 1));
+		}
+	}
+	return result ^ 0xffffffff;
+}
+
+static uint32_t adler32(const uint8_t *data, size_t size)
+{
+	uint32_t a = 1, b = 0;
+	for (size_t i = 0; i < size; i++) {
+		a = (a + data[i]) % 65521;
+		b = (b + a) % 65521;
+	}
+	return b << 16 | a;
+}
+
+struct bit_reader {
+	const uint8_t *data;
+	size_t size;
+	size_t position;
+	bool overrun;
+};
+
+static uint read_bits(struct bit_reader *br, uint count)
+{
+	uint result = 0;
+	for (uint i = 0; i < count; i++, br->position++) {
+		if (br->position >= 8 * br->size) {
+			br->overrun = true;
+			return 0;
+		}
+		result |= ((br->data[br->position / 8] >> (br->position % 8)) & 1) << i;
+	}
+	return result;
+}
+
+/* Huffman codes are packed starting with their most significant bit. */
+static uint read_code(struct bit_reader *br, uint code, uint count)
+{
+	for (uint i = 0; i < count; i++) {
+		code = (code << 1) | read_bits(br, 1);
+	}
+	return code;
+}
+
+/* Decodes a symbol of the fixed literal/length code of deflate. */
+static uint read_symbol(struct bit_reader *br)
+{
+	uint code = read_code(br, 0, 7);
+	if (code < 0x18) {
+		return 256 + code;
+	}
+	code = read_code(br, code, 1);
+	if (code >= 0x30 && code < 0xc0) {
+		return code - 0x30;
+	}
+	if (code >= 0xc0 && code < 0xc8) {
+		return 280 + code - 0xc0;
+	}
+	return 144 + read_code(br, code, 1) - 0x190;
+}
+
+/* Inflates a deflate stream made of blocks with fixed Huffman codes, the
+ * only kind the encoder writes, into at most capacity bytes. Returns the
+ * number of bytes, or 0 if the stream is invalid. */
+static size_t inflate_fixed(const uint8_t *data, size_t size, uint8_t *out, size_t capacity)
+{
+	static const uint16_t length_bases[29] = {
+		3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+		35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+	};
+	static const uint8_t length_extra_bits[29] = {
+		0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+		3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+	};
+	static const uint16_t distance_bases[30] = {
+		1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+		257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+	};
+	static const uint8_t distance_extra_bits[30] = {
+		0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+		7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+	};
+
+	struct bit_reader br = { .data = data, .size = size };
+	size_t n = 0;
+	bool last = false;
+	while (!last) {
+		last = read_bits(&br, 1);
+		if (read_bits(&br, 2) != 1) {
+			return 0;
+		}
+		for (;;) {
+			uint symbol = read_symbol(&br);
+			if (br.overrun || symbol > 285) {
+				return 0;
+			}
+			if (symbol < 256) {
+				if (n == capacity) {
+					return 0;
+				}
+				out[n++] = symbol;
+				continue;
+			}
+			if (symbol == 256) {
+				break;
+			}
+			uint length = length_bases[symbol - 257]
+				+ read_bits(&br, length_extra_bits[symbol - 257]);
+			uint distance_code = read_code(&br, 0, 5);
+			if (distance_code >= 30) {
+				return 0;
+			}
+			size_t distance = distance_bases[distance_code]
+				+ read_bits(&br, distance_extra_bits[distance_code]);
+			if (br.overrun || distance > n || n + length > capacity) {
+				return 0;
+			}
+			for (uint i = 0; i < length; i++, n++) {
+				out[n] = out[n - distance];
+			}
+		}
+	}
+	return n;
+}
+
+/* Checks every chunk of a PNG file of 8 bit palette indices, then
+ * inflates and unfilters its image data into width * height indices. */
+static bool png_decode(const uint8_t *png, size_t length, const struct color_map_rgb *palette,
+		       uint width, uint height, uint8_t *indices)
+{
+	static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	static const uint8_t header[13] = { 0, 0, 0, 0, 0, 0, 0, 0, 8, 3, 0, 0, 0 };
+	static uint8_t zlib[1 << 16], lines[1 << 16];
+	size_t zlib_size = 0;
+	bool has_header = false, has_palette = false;
+
+	if (length < sizeof signature || memcmp(png, signature, sizeof signature)) {
+		return false;
+	}
+	size_t position = sizeof signature;
+	for (;;) {
+		if (position + 12 > length) {
+			return false;
+		}
+		uint32_t chunk_size = read_u32_be(png + position);
+		const uint8_t *type = png + position + 4;
+		const uint8_t *chunk = png + position + 8;
+		if (chunk_size > length - position - 12
+		    || read_u32_be(chunk + chunk_size) != crc32(type, chunk_size + 4)) {
+			return false;
+		}
+		position += chunk_size + 12;
+
+		if (!memcmp(type, "IHDR", 4)) {
+			has_header = chunk_size == sizeof header && read_u32_be(chunk) == width
+				&& read_u32_be(chunk + 4) == height && !memcmp(chunk + 8, header + 8, 5);
+		}
+		else if (!memcmp(type, "PLTE", 4)) {
+			has_palette = chunk_size == 3 * COLOR_MAP_PALETTE_SIZE;
+			for (uint i = 0; has_palette && i < COLOR_MAP_PALETTE_SIZE; i++) {
+				has_palette = chunk[3 * i] == palette[i].r && chunk[3 * i + 1] == palette[i].g
+					&& chunk[3 * i + 2] == palette[i].b;
+			}
+		}
+		else if (!memcmp(type, "IDAT", 4)) {
+			if (zlib_size + chunk_size > sizeof zlib) {
+				return false;
+			}
+			memcpy(zlib + zlib_size, chunk, chunk_size);
+			zlib_size += chunk_size;
+		}
+		else if (!memcmp(type, "IEND", 4)) {
+			break;
+		}
+	}
+	if (!has_header || !has_palette || position != length) {
+		return false;
+	}
+
+	/* deflate with no preset dictionary, then the Adler-32 of the data */
+	size_t line_size = (size_t)width + 1;
+	if (zlib_size < 6 || (zlib[0] & 0x0f) != 8 || (zlib[0] << 8 | zlib[1]) % 31 || (zlib[1] & 0x20)
+	    || line_size * height > sizeof lines) {
+		return false;
+	}
+	size_t size = inflate_fixed(zlib + 2, zlib_size - 6, lines, sizeof lines);
+	if (size != line_size * height || read_u32_be(zlib + zlib_size - 4) != adler32(lines, size)) {
+		return false;
+	}
+
+	for (uint y = 0; y < height; y++) {
+		const uint8_t *line = lines + y * line_size;
+		uint8_t *row = indices + (size_t)y * width;
+		if (line[0] == 0) {
+			memcpy(row, line + 1, width);
+		}
+		else if (line[0] == 2) {
+			for (uint x = 0; x < width; x++) {
+				row[x] = line[1 + x] + (y ? indices[(size_t)(y - 1) * width + x] : 0);
+			}
+		}
+		else {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool test_image_sequence_ppm_png(void)
+{
+	size_t previous_allocations = current_number_of_allocations();
+
+	enum { width = 3, height = 2, scale = 2, frame_count = 20 };
+	struct color_map_rgb palette[COLOR_MAP_PALETTE_SIZE];
+	make_palette(palette);
+	struct image_sequence_options options = { .format = IMAGE_FORMAT_PPM, .scale = scale, .thread_count = 3 };
+
+	image_sequence is = image_sequence_create(image_sequence_test_prefix, width, height, palette, &options);
+	bool test_1 = is != NULL;
+	for (uint f = 0; test_1 && f < frame_count; f++) {
+		uint8_t *indices = image_sequence_acquire(is);
+		test_1 = indices != NULL;
+		if (indices) {
+			make_frame(indices, width * height, f);
+			image_sequence_submit(is);
+		}
+	}
+	bool test_2 = test_1 && image_sequence_destroy(&is);
+
+	/* every frame in its own file, each cell a square of scale by scale pixels */
+	bool test_3 = true;
+	char filename[64];
+	for (uint f = 0; test_2 && f < frame_count; f++) {
+		uint8_t expected[width * height], bytes[128];
+		const char *header = "P6\n6 4\n255\n";
+		size_t header_length = strlen(header);
+		make_frame(expected, width * height, f);
+		snprintf(filename, sizeof filename, "%s_%06u.ppm", image_sequence_test_prefix, f);
+		size_t length = read_file(filename, bytes, sizeof bytes);
+		test_3 = test_3 && length == header_length + 3 * width * height * scale * scale
+			&& !memcmp(bytes, header, header_length);
+		for (uint y = 0; test_3 && y < height * scale; y++) {
+			for (uint x = 0; x < width * scale; x++) {
+				const uint8_t *pixel = bytes + header_length + 3 * (y * width * scale + x);
+				const struct color_map_rgb *color = &palette[expected[(y / scale) * width + x / scale]];
+				test_3 = test_3 && pixel[0] == color->r && pixel[1] == color->g && pixel[2] == color->b;
+			}
+		}
+		remove(filename);
+	}
+
+	/* PNG frames decoding back to their cells, large enough for runs
+	 * longer than a single deflate match */
+	enum { png_width = 40, png_height = 30, png_scale = 4, png_frame_count = 3 };
+	enum { png_pixel_count = png_width * png_height * png_scale * png_scale };
+	options.format = IMAGE_FORMAT_PNG;
+	options.scale = png_scale;
+	is = image_sequence_create(image_sequence_test_prefix, png_width, png_height, palette, &options);
+	for (uint f = 0; is && f < png_frame_count; f++) {
+		make_frame(image_sequence_acquire(is), png_width * png_height, f);
+		image_sequence_submit(is);
+	}
+	bool test_4 = is && image_sequence_destroy(&is);
+
+	bool test_5 = test_4;
+	static uint8_t png[1 << 16], pixels[png_pixel_count];
+	for (uint f = 0; test_5 && f < png_frame_count; f++) {
+		snprintf(filename, sizeof filename, "%s_%06u.png", image_sequence_test_prefix, f);
+		size_t length = read_file(filename, png, sizeof png);
+		remove(filename);
+		test_5 = length < sizeof png && png_decode(png, length, palette, png_width * png_scale,
+							   png_height * png_scale, pixels);
+
+		uint8_t expected[png_width * png_height];
+		make_frame(expected, png_width * png_height, f);
+		for (uint i = 0; test_5 && i < png_pixel_count; i++) {
+			uint x = i % (png_width * png_scale), y = i / (png_width * png_scale);
+			test_5 = pixels[i] == expected[(y / png_scale) * png_width + x / png_scale];
+		}
+	}
+
+	bool test_6 = previous_allocations == current_number_of_allocations();
+
+	return test_1 && test_2 && test_3 && test_4 && test_5 && test_6;
+}
+
+/* Decodes the LZW data of a GIF frame with 8 bit pixels into count
+ * pixels. Returns false unless the data holds exactly that many. */
+static bool lzw_decode(const uint8_t *data, size_t size, uint8_t *out, size_t count)
+{
+	static uint16_t prefix[4096];
+	static uint8_t suffix[4096], stack[4096];
+	uint code_size = 9, next = 258;
+	int previous = -1;
+	uint8_t first = 0;
+	uint64_t bits = 0;
+	uint bit_count = 0;
+	size_t position = 0, n = 0;
+
+	for (;;) {
+		while (bit_count < code_size) {
+			if (position == size) {
+				return false;
+			}
+			bits |= (uint64_t)data[position++] << bit_count;
+			bit_count += 8;
+		}
+		uint code = bits & ((1u << code_size) - 1);
+		bits >>= code_size;
+		bit_count -= code_size;
+
+		if (code == 256) {
+			code_size = 9;
+			next = 258;
+			previous = -1;
+			continue;
+		}
+		if (code == 257) {
+			return n == count;
+		}
+		if (code > next || (code == next && previous < 0)) {
+			return false;
+		}
+
+		uint c = code, depth = 0;
+		if (code == next) {
+			stack[depth++] = first;
+			c = previous;
+		}
+		while (c >= 258) {
+			stack[depth++] = suffix[c];
+			c = prefix[c];
+		}
+		stack[depth++] = c;
+		first = c;
+		if (n + depth > count) {
+			return false;
+		}
+		while (depth) {
+			out[n++] = stack[--depth];
+		}
+
+		if (previous >= 0 && next < 4096) {
+			prefix[next] = previous;
+			suffix[next] = first;
+			next++;
+			if (next == 1u << code_size && code_size < 12) {
+				code_size++;
+			}
+		}
+		previous = code;
+	}
+}
+
+bool test_image_sequence_gif(void)
+{
+	size_t previous_allocations = current_number_of_allocations();
+
+	/* enough distinct pixels for the dictionary to fill up and start over */
+	enum { width = 70, height = 50, scale = 2, frame_count = 6 };
+	enum { pixel_count = width * height * scale * scale };
+	struct color_map_rgb palette[COLOR_MAP_PALETTE_SIZE];
+	make_palette(palette);
+	struct image_sequence_options options = {
+		.format = IMAGE_FORMAT_GIF, .scale = scale, .thread_count = 4, .frame_delay = 4
+	};
+
+	image_sequence is = image_sequence_create(image_sequence_test_prefix, width, height, palette, &options);
+	bool test_1 = is != NULL;
+	for (uint f = 0; test_1 && f < frame_count; f++) {
+		make_frame(image_sequence_acquire(is), width * height, f);
+		image_sequence_submit(is);
+	}
+	bool test_2 = test_1 && image_sequence_get_frame_count(is) <= frame_count && image_sequence_destroy(&is);
+
+	char filename[64];
+	snprintf(filename, sizeof filename, "%s.gif", image_sequence_test_prefix);
+	static uint8_t gif[1 << 18];
+	size_t length = read_file(filename, gif, sizeof gif);
+	remove(filename);
+
+	/* the header, the global palette, and the loop extension */
+	bool test_3 = length > 800 && !memcmp(gif, "GIF89a", 6)
+		&& gif[6] == (width * scale) % 256 && gif[7] == (width * scale) / 256
+		&& gif[8] == (height * scale) % 256 && gif[10] == 0xf7
+		&& gif[13 + 3 * 200] == 200 && gif[13 + 3 * 200 + 1] == 55
+		&& !memcmp(gif + 781, "\x21\xff\x0bNETSCAPE2.0", 14);
+
+	/* the frames, in order, each decoding back to its cells */
+	bool test_4 = test_3;
+	size_t position = 800;
+	static uint8_t data[1 << 17], pixels[pixel_count];
+	for (uint f = 0; test_4 && f < frame_count; f++) {
+		test_4 = position + 19 < length && gif[position] == 0x21 && gif[position + 1] == 0xf9
+			&& gif[position + 4] == 4 && gif[position + 8] == 0x2c && gif[position + 18] == 8;
+		position += 19;
+		size_t size = 0;
+		while (test_4 && position < length && gif[position]) {
+			memcpy(data + size, gif + position + 1, gif[position]);
+			size += gif[position];
+			position += gif[position] + 1;
+		}
+		position++;
+		test_4 = test_4 && lzw_decode(data, size, pixels, pixel_count);
+
+		uint8_t expected[width * height];
+		make_frame(expected, width * height, f);
+		for (uint i = 0; test_4 && i < pixel_count; i++) {
+			uint x = i % (width * scale), y = i / (width * scale);
+			test_4 = pixels[i] == expected[(y / scale) * width + x / scale];
+		}
+	}
+	bool test_5 = test_4 && position + 1 == length && gif[position] == 0x3b;
+
+	bool test_6 = previous_allocations == current_number_of_allocations();
+
+	return test_1 && test_2 && test_3 && test_4 && test_5 && test_6;
+}
@@ -0,0 +1,67 @@
+#include "headers/test_output_writer.h"
+#include "../headers/output_writer.h"
+#include "headers/test_utils.h"
+
+struct ordered_context {
+	uint expected;
+	bool in_order;
+};
+
+static bool ordered_write(void *context, const void *frame)
+{
+	struct ordered_context *ctx = context;
+	ctx->in_order = ctx->in_order && *(const uint *)frame == ctx->expected;
+	ctx->expected++;
+	return true;
+}
+
+static bool failing_write(void *context, const void *frame)
+{
+	return *(const uint *)frame < 3;
+}
+
+bool test_output_writer_order(void)
+{
+	size_t previous_allocations = current_number_of_allocations();
+	struct ordered_context ctx = { .expected = 0, .in_order = true };
+
+	output_writer ow = output_writer_create(2, sizeof (uint), &ordered_write, &ctx);
+	bool test_1 = ow != NULL;
+	for (uint i = 0; i < 1000; i++) {
+		uint *frame = output_writer_acquire(ow);
+		*frame = i;
+		output_writer_submit(ow);
+	}
+	output_writer_flush(ow);
+
+	struct output_writer_stats stats;
+	output_writer_get_stats(ow, &stats);
+	bool test_2 = stats.frames_written == 1000 && stats.max_queued <= 2 && stats.slot_count == 2;
+	bool test_3 = output_writer_destroy(&ow) && ow == NULL;
+	bool test_4 = ctx.in_order && ctx.expected == 1000;
+	bool test_5 = previous_allocations == current_number_of_allocations();
+
+	return test_1 && test_2 && test_3 && test_4 && test_5;
+}
+
+bool test_output_writer_failure(void)
+{
+	output_writer ow = output_writer_create(4, sizeof (uint), &failing_write, NULL);
+
+	bool acquired_after_failure = true;
+	for (uint i = 0; i < 100 && acquired_after_failure; i++) {
+		uint *frame = output_writer_acquire(ow);
+		if (!frame) {
+			acquired_after_failure = false;
+			break;
+		}
+		*frame = i;
+		output_writer_submit(ow);
+		output_writer_flush(ow);
+	}
+
+	bool test_1 = !acquired_after_failure;
+	bool test_2 = !output_writer_destroy(&ow);
+
+	return test_1 && test_2;
+}
@@ -0,0 +1,128 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "headers/test_run_reader.h"
+#include "headers/test_frame_layout.h"
+#include "../headers/run_reader.h"
+#include "../headers/spike_file.h"
+#include "headers/test_utils.h"
+
+static const char *run_reader_test_dirname = "test_run";
+
+/* Writes 100 frames of six systems with two variables, sampled every
+ * ten steps, where variable v of system i at frame f is f * 10 + i + v / 2. */
+static bool write_frames(uint value_size)
+{
+	struct frame_file_layout layout = test_frame_layout(3, 2, 2, value_size);
+
+	frame_file ff = frame_file_create("test_run/frames.bin", &layout);
+	bool result = ff != NULL;
+	double values[12];
+	for (uint frame = 0; result && frame < 100; frame++) {
+		for (uint i = 0; i < 12; i++) {
+			values[i] = frame * 10 + i / 2 + (i % 2) * 0.5;
+		}
+		/* the clock adds up time steps, so sample times are slightly off */
+		result = frame_file_write(ff, frame + (frame % 3 ? 1e-12 : -1e-12), values);
+	}
+	return ff && frame_file_destroy(&ff) && result;
+}
+
+bool test_run_reader_frames(void)
+{
+	size_t previous_allocations = current_number_of_allocations();
+
+	mkdir(run_reader_test_dirname, 0755);
+	bool result = true;
+	for (uint value_size = sizeof (float); value_size <= sizeof (double); value_size += sizeof (float)) {
+		if (!write_frames(value_size)) {
+			return false;
+		}
+		run_reader rr = run_reader_open(run_reader_test_dirname);
+		if (!rr) {
+			return false;
+		}
+
+		uint64_t frame;
+		double frame_time;
+		struct run_view view, times;
+		result = result && run_reader_has_frames(rr) && !run_reader_has_spikes(rr)
+			&& run_reader_get_frame_count(rr) == 100
+			&& run_reader_find_frame(rr, 42.0, &frame) && frame == 42
+			&& run_reader_find_frame(rr, 0.0, &frame) && frame == 0
+			&& !run_reader_find_frame(rr, 42.5, &frame)
+			&& !run_reader_find_frame(rr, 100.0, &frame);
+
+		result = result && run_reader_get_frame(rr, 17.0, 1, &frame_time, &view)
+			&& view.count == 6 && frame_time > 16.9 && frame_time < 17.1
+			&& run_view_get(&view, 0) == 170.5 && run_view_get(&view, 5) == 175.5;
+
+		result = result && run_reader_get_trace(rr, 4, 0, 10.0, 20.0, &times, &view)
+			&& times.count == 11 && view.count == 11
+			&& run_view_get(&times, 0) > 9.9 && run_view_get(&times, 10) < 20.1
+			&& run_view_get(&view, 0) == 104.0 && run_view_get(&view, 10) == 204.0
+			&& run_reader_get_trace(rr, 0, 1, -5.0, 1e9, NULL, &view)
+			&& view.count == 100 && run_view_get(&view, 99) == 990.5
+			&& !run_reader_get_trace(rr, 0, 0, 10.2, 10.8, NULL, &view);
+
+		run_reader_close(&rr);
+		result = result && !rr;
+	}
+	remove("test_run/frames.bin");
+	rmdir(run_reader_test_dirname);
+
+	result = result && !run_reader_open(run_reader_test_dirname);
+
+	return result && previous_allocations == current_number_of_allocations();
+}
+
+bool test_run_reader_spikes(void)
+{
+	size_t previous_allocations = current_number_of_allocations();
+
+	mkdir(run_reader_test_dirname, 0755);
+	struct spike_file_layout layout = {
+		.system_size = 100,
+		.time_step = 0.1,
+		.time_format = SPIKE_TIME_STEP,
+		.delta = true
+	};
+	/* spike s is fired by neuron s % 100 at step s / 4, so over two blocks,
+	 * followed by a burst of 1000 spikes at step 400 that fills one bucket */
+	spike_file sf = spike_file_create("test_run/spikes.aer", &layout, 1000);
+	bool result = sf != NULL;
+	for (uint spike = 0; result && spike < 1500; spike++) {
+		result = spike_file_write(sf, (spike / 4) * 0.1, spike % 100);
+	}
+	for (uint spike = 1500; result && spike < 2500; spike++) {
+		result = spike_file_write(sf, 400 * 0.1, spike % 100);
+	}
+	result = sf && spike_file_destroy(&sf) && result;
+
+	run_reader rr = run_reader_open(run_reader_test_dirname);
+	if (!rr) {
+		remove("test_run/spikes.aer");
+		rmdir(run_reader_test_dirname);
+		return false;
+	}
+
+	const double *times;
+	const uint32_t *neurons;
+	result = result && !run_reader_has_frames(rr) && run_reader_has_spikes(rr)
+		&& run_reader_get_spike_count(rr) == 2500
+		&& run_reader_get_spikes(rr, 10.0, 10.5, &times, &neurons) == 24
+		&& neurons[0] == 0 && neurons[23] == 23 && times[0] > 9.9 && times[23] < 10.6
+		&& run_reader_get_spikes(rr, 0.0, 1e9, &times, &neurons) == 2500 && neurons[1499] == 99
+		&& run_reader_get_spikes(rr, 40.0, 40.0, &times, &neurons) == 1000 && neurons[0] == 0
+		&& run_reader_get_spikes(rr, 37.5, 39.9, &times, &neurons) == 0
+		&& run_reader_get_spikes(rr, -1.0, -0.1, &times, &neurons) == 0
+		&& run_reader_get_spikes(rr, 500.0, 600.0, &times, &neurons) == 0;
+
+	run_reader_close(&rr);
+	remove("test_run/spikes.aer");
+	rmdir(run_reader_test_dirname);
+
+	return result && previous_allocations == current_number_of_allocations();
+}
@@ -0,0 +1,83 @@
+#include <string.h>
+#include "headers/test_selection.h"
+#include "../headers/selection.h"
+#include "headers/test_utils.h"
+
+static const char *test_variable_names[] = { "V", "n", "m", "h" };
+
+/* Checks that spec selects exactly the expected neurons of a 6 by 4 grid. */
+static bool selects(const char *spec, const uint *expected, uint expected_count)
+{
+	selection s = selection_create(spec, NULL, 24, 6, 4, 4, test_variable_names);
+	if (!s) {
+		return false;
+	}
+
+	bool result = selection_get_neuron_count(s) == expected_count
+		&& !memcmp(selection_get_neurons(s), expected, (sizeof *expected) * expected_count)
+		&& selection_get_variable_count(s) == 4;
+	selection_destroy(&s);
+	return result;
+}
+
+static bool rejects(const char *neuron_spec, const char *variable_spec)
+{
+	return selection_create(neuron_spec, variable_spec, 24, 6, 4, 4, test_variable_names) == NULL;
+}
+
+bool test_selection_parse(void)
+{
+	size_t previous_allocations = current_number_of_allocations();
+
+	bool test_1 = selects("3", (uint[]){ 3 }, 1)
+		&& selects("5,1-3,2", (uint[]){ 1, 2, 3, 5 }, 4)
+		&& selects("0-10/4", (uint[]){ 0, 4, 8 }, 3)
+		&& selects("*/10", (uint[]){ 0, 10, 20 }, 3);
+	/* columns 1 to 2 of rows 2 to 3, and every other row and column */
+	bool test_2 = selects("1:2-2:3", (uint[]){ 13, 14, 19, 20 }, 4)
+		&& selects("0:0-5:3/2", (uint[]){ 0, 2, 4, 12, 14, 16 }, 6)
+		&& selects("5:3", (uint[]){ 23 }, 1);
+	bool test_3 = rejects("24", NULL) && rejects("3-1", NULL) && rejects("0:0-6:0", NULL)
+		&& rejects("1:1-3", NULL) && rejects("3/2", NULL) && rejects("1,", NULL)
+		&& rejects("0-4/0", NULL) && rejects("a", NULL) && rejects("", NULL);
+
+	selection s = selection_create(NULL, "h,0,n", 24, 6, 4, 4, test_variable_names);
+	bool test_4 = s && selection_get_neuron_count(s) == 24 && selection_get_variable_count(s) == 3
+		&& !memcmp(selection_get_variables(s), (uint[]){ 0, 1, 3 }, 3 * sizeof (uint));
+	if (s) {
+		selection_destroy(&s);
+	}
+	bool test_5 = rejects(NULL, "x") && rejects(NULL, "4") && rejects(NULL, "V,");
+	/* cells of a grid that is larger than the network */
+	bool test_6 = selection_create("9:9", NULL, 4, 10, 10, 4, test_variable_names) == NULL
+		&& selection_create("0:0-4:0", NULL, 4, 10, 10, 4, test_variable_names) == NULL;
+	s = selection_create("0:0-1:0", NULL, 4, 10, 10, 4, test_variable_names);
+	bool test_7 = s && selection_get_neuron_count(s) == 2;
+	if (s) {
+		selection_destroy(&s);
+	}
+
+	bool test_8 = previous_allocations == current_number_of_allocations();
+
+	return test_1 && test_2 && test_3 && test_4 && test_5 && test_6 && test_7 && test_8;
+}
+
+bool test_selection_gather(void)
+{
+	size_t previous_allocations = current_number_of_allocations();
+
+	double values[24 * 4];
+	for (uint i = 0; i < 24 * 4; i++) {
+		values[i] = i;
+	}
+
+	selection s = selection_create("7,2", "V,m", 24, 6, 4, 4, test_variable_names);
+	double out[4];
+	selection_gather(s, values, out);
+	bool test_1 = out[0] == 8.0 && out[1] == 10.0 && out[2] == 28.0 && out[3] == 30.0;
+	selection_destroy(&s);
+
+	bool test_2 = previous_allocations == current_number_of_allocations();
+
+	return test_1 && test_2;
+}
@@ -0,0 +1,118 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "headers/test_shm_ring.h"
+#include "../headers/shm_ring.h"
+#include "headers/test_utils.h"
+
+static const struct shm_ring_layout test_layout = {
+	.system_size = 6,
+	.grid_width = 3,
+	.grid_height = 2,
+	.variable_count = 2,
+	.slot_count = 4,
+	.time_step = 0.1,
+	.print_time = 0.5
+};
+
+static void fill_frame(double *values, uint frame)
+{
+	for (uint i = 0; i < 12; i++) {
+		values[i] = frame * 100.0 + i;
+	}
+}
+
+bool test_shm_ring_publish_read(void)
+{
+	size_t previous_allocations = current_number_of_allocations();
+
+	char name[64];
+	snprintf(name, sizeof name, "/neuralnet_test_%ld", (long)getpid());
+	shm_ring ring = shm_ring_create(name, &test_layout);
+	shm_reader reader = ring ? shm_reader_open(name) : NULL;
+	if (!reader) {
+		if (ring) {
+			shm_ring_destroy(&ring);
+		}
+		return false;
+	}
+
+	struct shm_ring_layout layout;
+	shm_reader_get_layout(reader, &layout);
+	bool test_1 = layout.system_size == 6 && layout.grid_width == 3 && layout.grid_height == 2
+		&& layout.variable_count == 2 && layout.slot_count == 4
+		&& layout.time_step == 0.1 && layout.print_time == 0.5
+		&& shm_reader_get_published(reader) == 0 && !shm_reader_is_closed(reader);
+
+	double values[12], read_values[12], time;
+	bool test_2 = !shm_reader_read(reader, 0, &time, read_values);
+
+	fill_frame(values, 0);
+	shm_ring_publish(ring, 0.0, values);
+	fill_frame(values, 1);
+	shm_ring_publish(ring, 0.5, values);
+
+	bool test_3 = shm_reader_get_published(reader) == 2
+		&& shm_reader_read(reader, 1, &time, read_values)
+		&& time == 0.5 && !memcmp(read_values, values, sizeof values);
+
+	uint64_t sequence;
+	const double *peeked = shm_reader_peek(reader, 0, &time, &sequence);
+	fill_frame(values, 0);
+	bool test_4 = peeked && time == 0.0 && !memcmp(peeked, values, sizeof values)
+		&& shm_reader_validate(reader, 0, sequence);
+
+	shm_ring_destroy(&ring);
+	bool test_5 = !ring && shm_reader_is_closed(reader) && !shm_reader_open(name);
+	shm_reader_close(&reader);
+	bool test_6 = !reader;
+
+	bool test_7 = previous_allocations == current_number_of_allocations();
+
+	return test_1 && test_2 && test_3 && test_4 && test_5 && test_6 && test_7;
+}
+
+bool test_shm_ring_overwrite(void)
+{
+	size_t previous_allocations = current_number_of_allocations();
+
+	char name[64];
+	snprintf(name, sizeof name, "/neuralnet_test_%ld", (long)getpid());
+	shm_ring ring = shm_ring_create(name, &test_layout);
+	shm_reader reader = ring ? shm_reader_open(name) : NULL;
+	if (!reader) {
+		if (ring) {
+			shm_ring_destroy(&ring);
+		}
+		return false;
+	}
+
+	/* a frame peeked at before the writer laps the ring is invalidated */
+	double values[12], read_values[12], time;
+	fill_frame(values, 0);
+	shm_ring_publish(ring, 0.0, values);
+	uint64_t sequence;
+	bool test_1 = shm_reader_peek(reader, 0, &time, &sequence) != NULL;
+	for (uint frame = 1; frame < 6; frame++) {
+		fill_frame(values, frame);
+		shm_ring_publish(ring, frame * 0.5, values);
+	}
+	bool test_2 = !shm_reader_validate(reader, 0, sequence);
+
+	/* only the last slot_count frames can still be read */
+	bool test_3 = !shm_reader_read(reader, 1, &time, read_values)
+		&& !shm_reader_peek(reader, 1, &time, &sequence)
+		&& shm_reader_read(reader, 2, &time, read_values) && time == 1.0
+		&& shm_reader_read(reader, 5, &time, read_values) && time == 2.5
+		&& !memcmp(read_values, values, sizeof values)
+		&& !shm_reader_read(reader, 6, &time, read_values);
+
+	shm_ring_destroy(&ring);
+	shm_reader_close(&reader);
+
+	bool test_4 = previous_allocations == current_number_of_allocations();
+
+	return test_1 && test_2 && test_3 && test_4;
+}
@@ -0,0 +1,88 @@
+#include <pthread.h>
+#include "headers/test_snapshot_buffer.h"
+#include "../headers/snapshot_buffer.h"
+#include "../headers/deftypes.h"
+#include "headers/test_utils.h"
+
+#define VALUE_COUNT 64
+#define SNAPSHOT_COUNT 20000
+
+static void publish(snapshot_buffer sb, double value)
+{
+	double *values = snapshot_buffer_begin(sb);
+	for (uint i = 0; i < VALUE_COUNT; i++) {
+		values[i] = value;
+	}
+	snapshot_buffer_publish(sb, value);
+}
+
+bool test_snapshot_buffer_latest(void)
+{
+	size_t previous_allocations = current_number_of_allocations();
+
+	snapshot_buffer sb = snapshot_buffer_create(VALUE_COUNT);
+	double time = -1.0;
+	bool test_1 = !snapshot_buffer_take(sb, &time) && time == -1.0;
+
+	/* only the latest of several snapshots is taken */
+	publish(sb, 1.0);
+	publish(sb, 2.0);
+	publish(sb, 3.0);
+	const double *values = snapshot_buffer_take(sb, &time);
+	bool test_2 = values && time == 3.0 && values[0] == 3.0 && values[VALUE_COUNT - 1] == 3.0;
+
+	/* without anything new, the same snapshot is taken again */
+	const double *again = snapshot_buffer_take(sb, &time);
+	bool test_3 = again == values && time == 3.0;
+
+	publish(sb, 4.0);
+	values = snapshot_buffer_take(sb, &time);
+	bool test_4 = time == 4.0 && values[0] == 4.0;
+
+	snapshot_buffer_destroy(&sb);
+	bool test_5 = previous_allocations == current_number_of_allocations();
+
+	return test_1 && test_2 && test_3 && test_4 && test_5;
+}
+
+static void *write_snapshots(void *data)
+{
+	snapshot_buffer sb = data;
+	for (uint i = 1; i <= SNAPSHOT_COUNT; i++) {
+		publish(sb, i);
+	}
+	return NULL;
+}
+
+bool test_snapshot_buffer_threads(void)
+{
+	size_t previous_allocations = current_number_of_allocations();
+
+	snapshot_buffer sb = snapshot_buffer_create(VALUE_COUNT);
+	pthread_t writer;
+	bool test_1 = !pthread_create(&writer, NULL, &write_snapshots, sb);
+
+	/* every snapshot taken is whole, and they only move forward */
+	bool whole = true, ordered = true;
+	double last_time = 0.0, time;
+	while (test_1 && last_time < SNAPSHOT_COUNT) {
+		const double *values = snapshot_buffer_take(sb, &time);
+		if (!values) {
+			continue;
+		}
+		for (uint i = 0; i < VALUE_COUNT; i++) {
+			whole = whole && values[i] == time;
+		}
+		ordered = ordered && time >= last_time;
+		last_time = time;
+	}
+	if (test_1) {
+		pthread_join(writer, NULL);
+	}
+	bool test_2 = whole && ordered;
+
+	snapshot_buffer_destroy(&sb);
+	bool test_3 = previous_allocations == current_number_of_allocations();
+
+	return test_1 && test_2 && test_3;
+}
@@ -0,0 +1,89 @@
+#include <stdlib.h>
+#include <math.h>
+#include "headers/test_spectrum.h"
+#include "../headers/spectrum.h"
+#include "headers/test_utils.h"
+
+#define TWO_PI 6.28318530717958647692
+
+/* Returns the bin with the most power. */
+static uint peak(const double *density, uint bin_count)
+{
+	uint result = 0;
+	for (uint k = 1; k < bin_count; k++) {
+		if (density[k] > density[result]) {
+			result = k;
+		}
+	}
+	return result;
+}
+
+/* Integrates the density over the frequencies. */
+static double total_power(const double *density, uint bin_count, double bin_width)
+{
+	double result = 0.0;
+	for (uint k = 0; k < bin_count; k++) {
+		result += density[k] * bin_width;
+	}
+	return result;
+}
+
+bool test_spectrum_sines(void)
+{
+	size_t previous_allocations = current_number_of_allocations();
+
+	/* at 1000 Hz with 256 samples, bin k is at 3.90625 k Hz */
+	struct spectrum_options options = { .window_length = 256, .overlap = 0.5 };
+	spectrum sp = spectrum_create(3, 1.0, &options);
+	for (uint i = 0; i < 256 + 128 * 9; i++) {
+		double samples[3] = {
+			3.0 + sin(TWO_PI * 62.5 * i / 1000.0),
+			2.0 * sin(TWO_PI * 156.25 * i / 1000.0),
+			-60.0
+		};
+		spectrum_add(sp, samples);
+	}
+
+	uint bin_count = spectrum_get_bin_count(sp);
+	double bin_width = spectrum_get_frequency(sp, 1);
+	double *density = malloc((sizeof *density) * bin_count);
+	bool test_1 = spectrum_get_segment_count(sp) == 10 && bin_count == 129 && bin_width == 3.90625;
+
+	/* the power of a sine of amplitude A is A^2 / 2 */
+	bool test_2 = spectrum_get_density(sp, 0, density) && peak(density, bin_count) == 16
+		&& fabs(total_power(density, bin_count, bin_width) - 0.5) < 1e-9;
+	bool test_3 = spectrum_get_density(sp, 1, density) && peak(density, bin_count) == 40
+		&& fabs(total_power(density, bin_count, bin_width) - 2.0) < 1e-9;
+	bool test_4 = spectrum_get_density(sp, 2, density) && total_power(density, bin_count, bin_width) < 1e-20;
+
+	free(density);
+	spectrum_destroy(&sp);
+	bool test_5 = previous_allocations == current_number_of_allocations();
+
+	return test_1 && test_2 && test_3 && test_4 && test_5;
+}
+
+bool test_spectrum_segments(void)
+{
+	size_t previous_allocations = current_number_of_allocations();
+
+	struct spectrum_options options = { .window_length = 64, .overlap = 0.0 };
+	spectrum sp = spectrum_create(1, 0.1, &options);
+	double density[33];
+	double sample = 0.0;
+	for (uint i = 0; i < 63; i++) {
+		spectrum_add(sp, &sample);
+	}
+	bool test_1 = spectrum_get_segment_count(sp) == 0 && !spectrum_get_density(sp, 0, density);
+
+	for (uint i = 0; i < 64 * 3 + 1; i++) {
+		spectrum_add(sp, &sample);
+	}
+	bool test_2 = spectrum_get_segment_count(sp) == 4;
+	bool test_3 = spectrum_get_frequency(sp, 32) == 5000.0;
+
+	spectrum_destroy(&sp);
+	bool test_4 = previous_allocations == current_number_of_allocations();
+
+	return test_1 && test_2 && test_3 && test_4;
+}
@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include "headers/test_spike_file.h"
+#include "../headers/spike_file.h"
+#include "headers/test_utils.h"
+
+static const char *spike_file_test_filename = "test_spikes.aer";
+
+static struct spike_file_layout test_layout(enum spike_time_format time_format, bool delta)
+{
+	return (struct spike_file_layout) {
+		.system_size = 5,
+		.time_step = 0.1,
+		.time_format = time_format,
+		.delta = delta
+	};
+}
+
+/* Three spikes per sample, with samples every ten steps. */
+static double test_time(uint spike)
+{
+	return (spike / 3) * 10 * 0.1;
+}
+
+static uint test_neuron(uint spike)
+{
+	return (spike * 2) % 5;
+}
+
+/* Reads every spike back and compares it against test_time and test_neuron. */
+static bool read_and_check(enum spike_time_format time_format, bool delta, uint expected_spikes)
+{
+	spike_reader sr = spike_reader_open(spike_file_test_filename);
+	if (!sr) {
+		return false;
+	}
+
+	struct spike_file_layout layout;
+	spike_reader_get_layout(sr, &layout);
+	bool result = layout.system_size == 5 && layout.time_format == time_format && layout.delta == delta;
+
+	uint spikes = 0;
+	uint block_spikes;
+	while ((block_spikes = spike_reader_next_block(sr))) {
+		for (uint spike = 0; spike < block_spikes; spike++, spikes++) {
+			double time = spike_reader_get_time(sr, spike);
+			double expected = time_format == SPIKE_TIME_STEP ? (spikes / 3) * 10 * layout.time_step
+				: test_time(spikes);
+			result = result && time == expected && spike_reader_get_neuron(sr, spike) == test_neuron(spikes);
+		}
+	}
+
+	spike_reader_close(&sr);
+	return result && spikes == expected_spikes;
+}
+
+static bool write_and_check(enum spike_time_format time_format, bool delta)
+{
+	struct spike_file_layout layout = test_layout(time_format, delta);
+
+	/* ten spikes in blocks of four leave a partial last block */
+	spike_file sf = spike_file_create(spike_file_test_filename, &layout, 4);
+	bool result = sf != NULL;
+	for (uint spike = 0; result && spike < 10; spike++) {
+		result = spike_file_write(sf, test_time(spike), test_neuron(spike));
+	}
+	result = result && spike_file_get_spike_count(sf) == 10;
+	result = spike_file_destroy(&sf) && result;
+
+	result = result && read_and_check(time_format, delta, 10);
+	remove(spike_file_test_filename);
+
+	return result;
+}
+
+bool test_spike_file_write_read(void)
+{
+	size_t previous_allocations = current_number_of_allocations();
+
+	bool test_1 = write_and_check(SPIKE_TIME_FLOAT, false);
+	bool test_2 = write_and_check(SPIKE_TIME_FLOAT, true);
+	bool test_3 = write_and_check(SPIKE_TIME_STEP, false);
+	bool test_4 = write_and_check(SPIKE_TIME_STEP, true);
+
+	struct spike_file_layout layout = test_layout(SPIKE_TIME_FLOAT, false);
+	spike_file sf = spike_file_create(spike_file_test_filename, &layout, 4);
+	bool test_5 = is_assert_invoked(spike_file_write(sf, 0.0, 5));
+	spike_file_destroy(&sf);
+	remove(spike_file_test_filename);
+
+	bool test_6 = previous_allocations == current_number_of_allocations();
+
+	return test_1 && test_2 && test_3 && test_4 && test_5 && test_6;
+}
@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include <math.h>
+#include "headers/test_spike_stats.h"
+#include "../headers/spike_stats.h"
+#include "headers/test_utils.h"
+
+static const struct spike_stats_options test_options = {
+	.threshold = 0.0,
+	.burst_isi = 5.0,
+	.bin_count = 4,
+	.bin_width = 10.0
+};
+
+/* Steps two neurons of two variables through time in steps of one
+ * millisecond, firing each at the steps given in spikes. The voltage rises
+ * from -1 to 1 across a spike step, so that it crosses halfway. */
+static void run(spike_stats ss, const uint *spikes, uint spike_count, uint steps)
+{
+	double values[4] = { -1.0, 0.0, -1.0, 0.0 };
+	for (uint step = 1, next = 0; step <= steps; step++) {
+		bool fire = next < spike_count && spikes[next] == step;
+		next += fire;
+		values[0] = fire ? 1.0 : -1.0;
+		spike_stats_add(ss, step, values);
+	}
+}
+
+bool test_spike_stats_intervals(void)
+{
+	size_t previous_allocations = current_number_of_allocations();
+
+	const double initial[4] = { -1.0, 0.0, -1.0, 0.0 };
+	spike_stats ss = spike_stats_create(2, 2, 0.0, initial, &test_options);
+	/* intervals of 10, 20 and 45 ms */
+	const uint spikes[] = { 10, 20, 40, 85 };
+	run(ss, spikes, 4, 100);
+
+	struct spike_stats_summary summary;
+	spike_stats_get_summary(ss, 0, 100.0, &summary);
+	double sd = sqrt(((10 - 25.0) * (10 - 25.0) + (20 - 25.0) * (20 - 25.0) + (45 - 25.0) * (45 - 25.0)) / 2);
+	bool test_1 = summary.spike_count == 4 && summary.rate == 40.0 && summary.isi_count == 3
+		&& fabs(summary.isi_mean - 25.0) < 1e-9 && fabs(summary.isi_sd - sd) < 1e-9
+		&& fabs(summary.isi_cv - sd / 25.0) < 1e-9
+		&& fabs(summary.isi_min - 10.0) < 1e-9 && fabs(summary.isi_max - 45.0) < 1e-9;
+
+	/* the last bin also takes the interval of 45 ms */
+	const uint32_t *histogram = spike_stats_get_histogram(ss, 0);
+	bool test_2 = histogram[0] == 0 && histogram[1] == 1 && histogram[2] == 1 && histogram[3] == 1;
+
+	spike_stats_get_summary(ss, 1, 100.0, &summary);
+	bool test_3 = summary.spike_count == 0 && summary.rate == 0.0 && isnan(summary.isi_mean)
+		&& summary.burst_count == 0;
+
+	bool test_4 = spike_stats_write(ss, "test_spike_stats.dat", false, 100.0, 6);
+	FILE *fh = fopen("test_spike_stats.dat", "r");
+	uint neuron;
+	unsigned long long spike_count;
+	bool test_5 = fh && fscanf(fh, "%*[^\n]\n%*[^\n]\n%u %llu", &neuron, &spike_count) == 2
+		&& neuron == 0 && spike_count == 4;
+	if (fh) {
+		fclose(fh);
+	}
+	remove("test_spike_stats.dat");
+
+	spike_stats_destroy(&ss);
+	bool test_6 = !ss && previous_allocations == current_number_of_allocations();
+
+	return test_1 && test_2 && test_3 && test_4 && test_5 && test_6;
+}
+
+bool test_spike_stats_bursts(void)
+{
+	size_t previous_allocations = current_number_of_allocations();
+
+	const double initial[4] = { -1.0, 0.0, -1.0, 0.0 };
+	spike_stats ss = spike_stats_create(2, 2, 0.0, initial, &test_options);
+	/* a burst of three, a lone spike, then a burst of two still going on */
+	const uint spikes[] = { 10, 12, 14, 30, 50, 53 };
+	run(ss, spikes, 6, 60);
+
+	struct spike_stats_summary summary;
+	spike_stats_get_summary(ss, 0, 60.0, &summary);
+	bool test_1 = summary.spike_count == 6 && summary.burst_count == 2 && summary.burst_spikes == 5
+		&& summary.burst_mean_spikes == 2.5;
+
+	/* interpolated crossing half way through the step */
+	bool test_2 = fabs(summary.isi_min - 2.0) < 1e-9;
+
+	spike_stats_destroy(&ss);
+	bool test_3 = previous_allocations == current_number_of_allocations();
+
+	return test_1 && test_2 && test_3;
+}
@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <string.h>
+#include "headers/test_state_cache.h"
+#include "../headers/state_cache.h"
+#include "../headers/math_utils.h"
+#include "headers/test_utils.h"
+
+bool test_state_cache_key(void)
+{
+	struct checkpoint_info info = {
+		.model_name = "huber-braun",
+		.parameter_callback_name = "huber-braun-single-center",
+		.coupling_callback_name = "lattice",
+		.initial_values_callback_name = "zero",
+		.time_step = 0.1,
+		.coupling_constant_is_random = false,
+		.coupling_constant = 0.1
+	};
+
+	uint64_t key = state_cache_key(&info, 225, 15, 15, 500.0);
+	bool test_1 = key == state_cache_key(&info, 225, 15, 15, 500.0);
+	bool test_2 = key != state_cache_key(&info, 225, 15, 15, 400.0);
+	bool test_3 = key != state_cache_key(&info, 225, 25, 9, 500.0);
+
+	info.time_step = 0.05;
+	bool test_4 = key != state_cache_key(&info, 225, 15, 15, 500.0);
+	info.time_step = 0.1;
+	info.coupling_callback_name = "lattice-nowrap";
+	bool test_5 = key != state_cache_key(&info, 225, 15, 15, 500.0);
+	info.coupling_callback_name = "lattice";
+
+	/* the unused random interval must not change the key */
+	info.lowest_random_value = 0.3;
+	bool test_6 = key == state_cache_key(&info, 225, 15, 15, 500.0);
+
+	size_t allocs = current_number_of_allocations();
+	char *filename = state_cache_filename("cache", 0x1234);
+	bool test_7 = !strcmp(filename, "cache/0000000000001234.bin");
+	free(filename);
+	bool test_8 = allocs == current_number_of_allocations();
+
+	return test_1 && test_2 && test_3 && test_4 && test_5 && test_6 && test_7 && test_8;
+}
+
+static double unit_parameter = 1.0;
+static void *unit_parameter_callback(dynamical_system ds, uint index)
+{
+	return &unit_parameter;
+}
+static uint no_coupling_callback(dynamical_system ds, uint first_index)
+{
+	return 0;
+}
+static void counting_initial_values_callback(uint index, uint size, double *system_values)
+{
+	for (uint i = 0; i < size; i++) {
+		system_values[i] = index * size + i;
+	}
+}
+static void zero_initial_values_callback(uint index, uint size, double *system_values)
+{
+	for (uint i = 0; i < size; i++) {
+		system_values[i] = 0.0;
+	}
+}
+static double unit_derivative(dynamical_system ds, uint index)
+{
+	return 1.0;
+}
+
+bool test_state_cache_restore(void)
+{
+	double (*derivatives[])(dynamical_system, uint) = { &unit_derivative };
+	struct checkpoint_info info = {
+		.model_name = "model",
+		.parameter_callback_name = "parameters",
+		.coupling_callback_name = "random",
+		.initial_values_callback_name = "initial",
+		.time_step = 0.1,
+		.coupling_constant_is_random = true,
+		.lowest_random_value = 0.1,
+		.highest_random_value = 0.5
+	};
+	uint64_t key = state_cache_key(&info, 4, 2, 2, 10.0);
+
+	size_t previous_allocations = current_number_of_allocations();
+	dynamical_system settled = dynamical_system_create(4, 1, 2, 2,
+							   unit_parameter_callback,
+							   no_coupling_callback,
+							   counting_initial_values_callback,
+							   derivatives);
+	dynamical_system_set_time(settled, 10.0);
+	math_utils_random_state_set(42);
+	bool test_1 = state_cache_store(".", key, settled, &info);
+
+	/* a later run with a different generator state hits the cache */
+	math_utils_random_state_set(7);
+	dynamical_system fresh = dynamical_system_create(4, 1, 2, 2,
+							 unit_parameter_callback,
+							 no_coupling_callback,
+							 zero_initial_values_callback,
+							 derivatives);
+	bool test_2 = state_cache_restore(".", key, fresh);
+	bool test_3 = !memcmp(dynamical_system_get_values(fresh), dynamical_system_get_values(settled),
+			      sizeof (double) * 4)
+		&& dynamical_system_get_time(fresh) == 10.0;
+	bool test_4 = math_utils_random_state_get() == 7;
+	bool test_5 = !state_cache_restore(".", key + 1, fresh);
+
+	char *filename = state_cache_filename(".", key);
+	remove(filename);
+	free(filename);
+	dynamical_system_destroy(&settled);
+	dynamical_system_destroy(&fresh);
+	bool test_6 = previous_allocations == current_number_of_allocations();
+
+	return test_1 && test_2 && test_3 && test_4 && test_5 && test_6;
+}
@@ -0,0 +1,77 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+#include <unistd.h>
+#include "headers/test_stream_sink.h"
+#include "../headers/stream_sink.h"
+#include "headers/test_utils.h"
+
+bool test_stream_sink_send(void)
+{
+	size_t previous_allocations = current_number_of_allocations();
+
+	int fds[2];
+	if (pipe(fds) < 0) {
+		return false;
+	}
+
+	stream_sink ss = stream_sink_create(fds[1], 1024);
+	const double frame[] = { 0.5, 1.0, 2.0 };
+	bool test_1 = stream_sink_send(ss, STREAM_MESSAGE_FRAME, frame, sizeof frame)
+		&& stream_sink_send_raw(ss, "text\n", 5);
+
+	struct stream_sink_stats stats;
+	stream_sink_get_stats(ss, &stats);
+	bool test_2 = stats.messages_sent == 2 && stats.messages_dropped == 0
+		&& stats.bytes_sent == sizeof (struct stream_message_header) + sizeof frame + 5;
+	bool test_3 = stream_sink_close(&ss) && !ss;
+
+	struct stream_message_header header;
+	double values[3];
+	char text[5];
+	bool test_4 = read(fds[0], &header, sizeof header) == sizeof header
+		&& header.magic == STREAM_SINK_MAGIC && header.type == STREAM_MESSAGE_FRAME
+		&& header.size == sizeof frame && header.sequence == 0;
+	bool test_5 = read(fds[0], values, sizeof values) == sizeof values
+		&& !memcmp(values, frame, sizeof frame);
+	bool test_6 = read(fds[0], text, sizeof text) == sizeof text && !memcmp(text, "text\n", 5)
+		&& read(fds[0], text, sizeof text) == 0;
+	close(fds[0]);
+
+	bool test_7 = previous_allocations == current_number_of_allocations();
+
+	return test_1 && test_2 && test_3 && test_4 && test_5 && test_6 && test_7;
+}
+
+bool test_stream_sink_drop(void)
+{
+	size_t previous_allocations = current_number_of_allocations();
+
+	int fds[2];
+	if (pipe(fds) < 0) {
+		return false;
+	}
+
+	/* nobody reads until the pipe and the queue are full, so that messages
+	 * are dropped whole while the sequence numbers keep counting */
+	stream_sink ss = stream_sink_create(fds[1], 4096);
+	char message[1000];
+	memset(message, 'x', sizeof message);
+	uint messages = 0;
+	struct stream_sink_stats stats = {0};
+	while (stats.messages_dropped == 0 && messages < 100000) {
+		stream_sink_send(ss, STREAM_MESSAGE_FRAME, message, sizeof message);
+		stream_sink_get_stats(ss, &stats);
+		messages++;
+	}
+	bool test_1 = stats.messages_dropped == 1 && stats.messages_sent == messages - 1;
+
+	/* the consumer goes away */
+	close(fds[0]);
+	bool test_2 = !stream_sink_send(ss, STREAM_MESSAGE_FRAME, message, sizeof message);
+	bool test_3 = !stream_sink_close(&ss);
+
+	bool test_4 = previous_allocations == current_number_of_allocations();
+
+	return test_1 && test_2 && test_3 && test_4;
+}
@@ -0,0 +1,172 @@
+#include <math.h>
+#include "headers/test_synchrony.h"
+#include "../headers/synchrony.h"
+#include "../headers/dynamical_system.h"
+#include "../headers/math_utils.h"
+#include "../headers/temp_memory.h"
+#include "headers/test_utils.h"
+
+static double unit_parameter = 1.0;
+static void *unit_parameter_callback(dynamical_system ds, uint index)
+{
+	return &unit_parameter;
+}
+/* A ring, where every neuron is coupled to both of its neighbours. */
+static uint ring_coupling_callback(dynamical_system ds, uint first_index)
+{
+	uint system_size = dynamical_system_get_system_size(ds);
+	struct edge *edge_pool = dynamical_system_get_edge_pool(ds);
+	edge_pool[0].index = (first_index + 1) % system_size;
+	edge_pool[1].index = (first_index + system_size - 1) % system_size;
+	edge_pool[0].value = edge_pool[1].value = 0.5;
+	return 2;
+}
+static void zero_initial_values_callback(uint index, uint size, double *system_values)
+{
+	for (uint i = 0; i < size; i++) {
+		system_values[i] = 0.0;
+	}
+}
+static double zero_derivative(dynamical_system ds, uint index)
+{
+	return 0.0;
+}
+
+/* Feeds 100 ms of sine waves with a period of 10 ms to four neurons, the
+ * odd ones shifted by the given phase, and takes one window. */
+static bool run(double shift, struct synchrony_sample *sample, uint *edge_count)
+{
+	double (*derivatives[])(dynamical_system, uint) = { &zero_derivative, &zero_derivative };
+	dynamical_system ds = dynamical_system_create(4, 4, 1, 2, unit_parameter_callback, ring_coupling_callback,
+						      zero_initial_values_callback, derivatives);
+	if (!ds) {
+		return false;
+	}
+	dynamical_system_set_value(ds, 0, 0, -1e-9);
+	dynamical_system_set_value(ds, 2, 0, -1e-9);
+	dynamical_system_set_value(ds, 1, 0, sin(-shift) - 1e-9);
+	dynamical_system_set_value(ds, 3, 0, sin(-shift) - 1e-9);
+
+	synchrony sy = synchrony_create(ds, SYNCHRONY_PHASE | SYNCHRONY_CHI | SYNCHRONY_CORRELATION);
+	*edge_count = synchrony_get_edge_count(sy);
+	double values[8] = { 0.0 };
+	for (uint step = 1; step <= 1000; step++) {
+		double time = step * 0.1;
+		for (uint i = 0; i < 4; i++) {
+			values[i * 2] = sin(2 * 3.14159265358979323846 * time / 10.0 - (i % 2) * shift);
+		}
+		synchrony_add(sy, time, values);
+	}
+	synchrony_take(sy, sample);
+
+	synchrony_destroy(&sy);
+	dynamical_system_destroy(&ds);
+	return true;
+}
+
+bool test_synchrony_in_phase(void)
+{
+	size_t previous_allocations = current_number_of_allocations();
+
+	struct synchrony_sample sample;
+	uint edge_count;
+	bool test_1 = run(0.0, &sample, &edge_count) && edge_count == 4;
+	bool test_2 = fabs(sample.phase_global - 1.0) < 1e-6 && fabs(sample.phase_local - 1.0) < 1e-6;
+	bool test_3 = fabs(sample.chi_global - 1.0) < 1e-6 && fabs(sample.chi_local - 1.0) < 1e-6;
+	bool test_4 = fabs(sample.correlation - 1.0) < 1e-6;
+
+	bool test_5 = previous_allocations == current_number_of_allocations();
+
+	return test_1 && test_2 && test_3 && test_4 && test_5;
+}
+
+bool test_synchrony_anti_phase(void)
+{
+	size_t previous_allocations = current_number_of_allocations();
+
+	/* every coupled pair is in anti-phase, so the mean voltage is flat */
+	struct synchrony_sample sample;
+	uint edge_count;
+	bool test_1 = run(3.14159265358979323846, &sample, &edge_count);
+	bool test_2 = sample.phase_global < 1e-6;
+	bool test_3 = sample.chi_global < 1e-6;
+	bool test_4 = fabs(sample.correlation + 1.0) < 1e-6;
+
+	bool test_5 = previous_allocations == current_number_of_allocations();
+
+	return test_1 && test_2 && test_3 && test_4 && test_5;
+}
+
+/* A ring with weights drawn anew on every evaluation, as with
+ * --random-coupling. */
+static uint random_coupling_callback(dynamical_system ds, uint first_index)
+{
+	uint edge_count = ring_coupling_callback(ds, first_index);
+	struct edge *edge_pool = dynamical_system_get_edge_pool(ds);
+	for (uint e = 0; e < edge_count; e++) {
+		edge_pool[e].value = math_utils_random_number(0.1, 0.5);
+	}
+	return edge_count;
+}
+static double coupled_derivative(dynamical_system ds, uint index)
+{
+	double own = dynamical_system_get_value(ds, index, 0);
+	uint edge_count = dynamical_system_get_coupling(ds, index);
+	const struct edge *edges = dynamical_system_get_edge_pool(ds);
+	double result = 1.0;
+	for (uint e = 0; e < edge_count; e++) {
+		result += edges[e].value * (dynamical_system_get_value(ds, edges[e].index, 0) - own);
+	}
+	return result;
+}
+
+/* Integrates a randomly coupled ring from a fixed generator state, with or
+ * without measuring its synchrony, and keeps the final voltages. */
+static bool integrate(bool measure, double *voltages)
+{
+	double (*derivatives[])(dynamical_system, uint) = { &coupled_derivative, &zero_derivative };
+	math_utils_random_state_set(12345);
+	dynamical_system ds = dynamical_system_create(4, 4, 1, 2, unit_parameter_callback, random_coupling_callback,
+						      zero_initial_values_callback, derivatives);
+	if (!ds) {
+		return false;
+	}
+	for (uint i = 0; i < 4; i++) {
+		dynamical_system_set_value(ds, i, 0, 0.1 * i);
+	}
+
+	synchrony sy = measure ? synchrony_create(ds, SYNCHRONY_CHI) : NULL;
+	for (uint step = 0; step < 50; step++) {
+		math_utils_rk4_integrate(ds, 0.1);
+		if (sy) {
+			synchrony_add(sy, dynamical_system_get_time(ds), dynamical_system_get_values(ds));
+		}
+	}
+	for (uint i = 0; i < 4; i++) {
+		voltages[i] = dynamical_system_get_value(ds, i, 0);
+	}
+
+	if (sy) {
+		synchrony_destroy(&sy);
+	}
+	dynamical_system_destroy(&ds);
+	temp_free();
+	return true;
+}
+
+bool test_synchrony_random_coupling(void)
+{
+	size_t previous_allocations = current_number_of_allocations();
+
+	/* reading the coupling graph leaves the random weights of the run alone */
+	double without[4], with[4];
+	bool test_1 = integrate(false, without) && integrate(true, with);
+	bool test_2 = test_1;
+	for (uint i = 0; i < 4; i++) {
+		test_2 = test_2 && without[i] == with[i];
+	}
+
+	bool test_3 = previous_allocations == current_number_of_allocations();
+
+	return test_1 && test_2 && test_3;
+}
@@ -0,0 +1,75 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "headers/test_text_format.h"
+#include "../headers/text_format.h"
+#include "headers/test_utils.h"
+
+static bool same_as_printf(double value, uint precision)
+{
+	char expected[TEXT_FORMAT_NUMBER_SIZE + 1], actual[TEXT_FORMAT_NUMBER_SIZE + 1];
+
+	snprintf(expected, sizeof expected, "%.*e", (int)precision, value);
+	actual[text_format_exponent(actual, value, precision)] = '\0';
+	bool result = !strcmp(expected, actual);
+
+	snprintf(expected, sizeof expected, "%.*f", (int)precision, value);
+	actual[text_format_fixed(actual, value, precision)] = '\0';
+	return !strcmp(expected, actual) && result;
+}
+
+bool test_text_format_matches_printf(void)
+{
+	const double values[] = {
+		0.0, -0.0, 1.0, -65.0, 0.5, 2.5, 1e-5, 9.9999999999e-1, 9.99999999995, 0.125,
+		1e22, 1e23, 123456789.123456789, 5e-324, 1.7976931348623157e308,
+		INFINITY, -INFINITY, NAN
+	};
+	bool test_1 = true;
+	for (uint i = 0; i < sizeof values / sizeof *values; i++) {
+		for (uint precision = 0; precision <= TEXT_FORMAT_MAX_PRECISION + 1; precision++) {
+			test_1 = same_as_printf(values[i], precision) && test_1;
+		}
+	}
+
+	bool test_2 = true;
+	srand(1);
+	for (uint i = 0; i < 10000; i++) {
+		double value = ldexp((double)rand() / RAND_MAX - 0.5, rand() % 200 - 100);
+		test_2 = same_as_printf(value, i % (TEXT_FORMAT_MAX_PRECISION + 1)) && test_2;
+		test_2 = same_as_printf(-80.0 + 110.0 * rand() / RAND_MAX, 10) && test_2;
+	}
+
+	char digits[20];
+	bool test_3 = text_format_uint(digits, 0) == 1 && digits[0] == '0'
+		&& text_format_uint(digits, 18446744073709551615ull) == 20 && !memcmp(digits, "18446744073709551615", 20);
+
+	return test_1 && test_2 && test_3;
+}
+
+bool test_text_buffer_append(void)
+{
+	size_t previous_allocations = current_number_of_allocations();
+
+	/* start small so that the buffer has to grow */
+	text_buffer tb = text_buffer_create(1);
+	for (uint i = 0; i < 100; i++) {
+		text_buffer_exponent(tb, -65.0, 10);
+		text_buffer_char(tb, ' ');
+	}
+	bool test_1 = text_buffer_get_size(tb) == 100 * strlen("-6.5000000000e+01 ")
+		&& !memcmp(text_buffer_get_data(tb), "-6.5000000000e+01 -6.5", 22);
+
+	text_buffer_clear(tb);
+	text_buffer_string(tb, "t = ");
+	text_buffer_fixed(tb, 2.5, 6);
+	text_buffer_char(tb, '\t');
+	text_buffer_uint(tb, 42);
+	bool test_2 = text_buffer_get_size(tb) == 15 && !memcmp(text_buffer_get_data(tb), "t = 2.500000\t42", 15);
+
+	text_buffer_destroy(&tb);
+	bool test_3 = previous_allocations == current_number_of_allocations();
+
+	return test_1 && test_2 && test_3;
+}
@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include "headers/test_trace_file.h"
+#include "headers/test_frame_layout.h"
+#include "../headers/trace_file.h"
+#include "headers/test_utils.h"
+
+static const char *trace_file_test_frame_filename = "test_trace_frames.bin";
+static const char *trace_file_test_filename = "test_traces.bin";
+
+static bool transpose_and_check(uint value_size)
+{
+	/* 20 systems with three variables, so that columns span two tiles */
+	struct frame_file_layout layout = test_frame_layout(5, 4, 3, value_size);
+	frame_file ff = frame_file_create(trace_file_test_frame_filename, &layout);
+	if (!ff) {
+		return false;
+	}
+
+	double values[60];
+	bool result = true;
+	for (uint frame = 0; frame < 45; frame++) {
+		test_frame_values(&layout, frame, values);
+		result = result && frame_file_write(ff, frame * 0.5, values);
+	}
+	result = frame_file_destroy(&ff) && result;
+
+	/* a budget of about 17 frames leaves a partial block at the end */
+	size_t budget = 17 * (2 * 60 * value_size + sizeof (double));
+	result = result && trace_file_transpose(trace_file_test_frame_filename, trace_file_test_filename, budget);
+
+	trace_reader tr = trace_reader_open(trace_file_test_filename);
+	result = result && tr != NULL;
+	if (tr) {
+		struct frame_file_layout read_layout;
+		trace_reader_get_layout(tr, &read_layout);
+		result = result && test_frame_layout_matches(&read_layout, &layout)
+			&& trace_reader_get_frame_count(tr) == 45;
+
+		const double *times = trace_reader_get_times(tr);
+		for (uint frame = 0; frame < 45; frame++) {
+			result = result && times[frame] == frame * 0.5;
+		}
+		for (uint system = 0; system < 20; system++) {
+			for (uint variable = 0; variable < 3; variable++) {
+				const void *trace = trace_reader_get_trace(tr, system, variable);
+				for (uint frame = 0; frame < 45; frame++) {
+					double value = value_size == sizeof (double) ? ((const double *)trace)[frame]
+						: ((const float *)trace)[frame];
+					result = result && value == test_frame_stored_value(&layout, frame, system, variable);
+				}
+			}
+		}
+		trace_reader_close(&tr);
+	}
+
+	remove(trace_file_test_frame_filename);
+	remove(trace_file_test_filename);
+	return result;
+}
+
+bool test_trace_file_transpose(void)
+{
+	size_t previous_allocations = current_number_of_allocations();
+
+	bool test_1 = transpose_and_check(sizeof (double));
+	bool test_2 = transpose_and_check(sizeof (float));
+	bool test_3 = !trace_file_transpose("test_missing_frames.bin", trace_file_test_filename, 1 << 20);
+
+	bool test_4 = previous_allocations == current_number_of_allocations();
+
+	return test_1 && test_2 && test_3 && test_4;
+}
+
+bool test_trace_file_capacity(void)
+{
+	size_t previous_allocations = current_number_of_allocations();
+
+	/* columns as a frame file stores them: x of every system, then y, then z */
+	struct frame_file_layout layout = test_frame_layout(5, 4, 3, sizeof (double));
+	double columns[60];
+	for (uint i = 0; i < 60; i++) {
+		columns[i] = i;
+	}
+
+	trace_file tf = trace_file_create(trace_file_test_filename, &layout, 10, 1 << 20);
+	bool test_1 = tf != NULL;
+	if (!tf) {
+		return false;
+	}
+	bool test_2 = trace_file_write(tf, 0.0, columns) && trace_file_write(tf, 1.0, columns)
+		&& trace_file_write(tf, 2.0, columns) && trace_file_get_frame_count(tf) == 3;
+	bool test_3 = trace_file_destroy(&tf) && !tf;
+
+	/* only the frames written are counted, within a file sized for ten */
+	trace_reader tr = trace_reader_open(trace_file_test_filename);
+	bool test_4 = tr && trace_reader_get_frame_count(tr) == 3
+		&& trace_reader_get_times(tr)[2] == 2.0
+		&& ((const double *)trace_reader_get_trace(tr, 7, 2))[1] == 47.0;
+	if (tr) {
+		trace_reader_close(&tr);
+	}
+
+	tf = trace_file_create(trace_file_test_filename, &layout, 2, 1 << 20);
+	bool test_5 = tf && trace_file_write(tf, 0.0, columns) && trace_file_write(tf, 1.0, columns)
+		&& !trace_file_write(tf, 2.0, columns);
+	bool test_6 = tf && trace_file_destroy(&tf);
+	remove(trace_file_test_filename);
+
+	bool test_7 = previous_allocations == current_number_of_allocations();
+
+	return test_1 && test_2 && test_3 && test_4 && test_5 && test_6 && test_7;
+}
@@ -0,0 +1,96 @@
+#include <math.h>
+#include "headers/test_wavefront.h"
+#include "../headers/wavefront.h"
+#include "headers/test_utils.h"
+
+#define WIDTH 8
+#define HEIGHT 8
+
+static const struct wavefront_options options = {
+	.threshold = 0.0,
+	.track_radius = 2.0
+};
+
+/* A wave that crosses every column 0.5 ms after the previous one. */
+static void plane_wave(double time, double *values)
+{
+	for (uint i = 0; i < WIDTH * HEIGHT; i++) {
+		values[i * 2] = time - 1.0 - 0.5 * (i % WIDTH);
+	}
+}
+
+/* A wave with a period of 10 ms rotating around the centre of the grid. */
+static void spiral_wave(double time, double *values)
+{
+	for (uint i = 0; i < WIDTH * HEIGHT; i++) {
+		double angle = atan2(i / WIDTH - 3.5, i % WIDTH - 3.5);
+		values[i * 2] = sin(2 * 3.14159265358979323846 * time / 10.0 - angle);
+	}
+}
+
+static void run(wavefront wf, void (*wave)(double, double *), uint first_step, uint last_step,
+		struct wavefront_sample *sample)
+{
+	double values[WIDTH * HEIGHT * 2] = { 0.0 };
+	for (uint step = first_step; step <= last_step; step++) {
+		wave(step * 0.1, values);
+		wavefront_add(wf, step * 0.1, values);
+	}
+	wavefront_take(wf, sample);
+}
+
+bool test_wavefront_plane_wave(void)
+{
+	size_t previous_allocations = current_number_of_allocations();
+
+	double values[WIDTH * HEIGHT * 2] = { 0.0 };
+	plane_wave(0.0, values);
+	wavefront wf = wavefront_create(WIDTH, HEIGHT, 2, 0.0, values, &options);
+	struct wavefront_sample sample;
+	run(wf, &plane_wave, 1, 100, &sample);
+
+	bool test_1 = sample.activated == WIDTH * HEIGHT;
+	bool test_2 = fabs(sample.centroid_x - 3.5) < 1e-9 && fabs(sample.centroid_y - 3.5) < 1e-9;
+	bool test_3 = fabs(sample.speed - 2.0) < 1e-6;
+	bool test_4 = sample.singularity_count == 0 && sample.born == 0 && sample.died == 0;
+	const double *map = wavefront_get_activation_map(wf);
+	bool test_5 = fabs(map[WIDTH - 1] - (1.0 + 0.5 * (WIDTH - 1))) < 1e-9;
+
+	/* nothing activates in the next window */
+	run(wf, &plane_wave, 101, 200, &sample);
+	bool test_6 = sample.activated == 0 && isnan(sample.centroid_x) && isnan(sample.speed);
+
+	wavefront_destroy(&wf);
+	bool test_7 = previous_allocations == current_number_of_allocations();
+
+	return test_1 && test_2 && test_3 && test_4 && test_5 && test_6 && test_7;
+}
+
+bool test_wavefront_spiral(void)
+{
+	size_t previous_allocations = current_number_of_allocations();
+
+	double values[WIDTH * HEIGHT * 2] = { 0.0 };
+	spiral_wave(0.0, values);
+	wavefront wf = wavefront_create(WIDTH, HEIGHT, 2, 0.0, values, &options);
+	struct wavefront_sample sample;
+	uint count;
+
+	run(wf, &spiral_wave, 1, 300, &sample);
+	const struct wavefront_singularity *singularities = wavefront_get_singularities(wf, &count);
+	bool test_1 = sample.singularity_count == 1 && sample.born == 1 && sample.died == 0 && count == 1;
+	/* the phase decreases counterclockwise around the core */
+	bool test_2 = singularities[0].x == 3.5 && singularities[0].y == 3.5 && singularities[0].charge == -1;
+	uint id = singularities[0].id;
+
+	run(wf, &spiral_wave, 301, 400, &sample);
+	singularities = wavefront_get_singularities(wf, &count);
+	bool test_3 = sample.singularity_count == 1 && sample.born == 0 && sample.died == 0;
+	bool test_4 = count == 1 && singularities[0].id == id && singularities[0].birth == 30.0;
+	bool test_5 = sample.activated == WIDTH * HEIGHT;
+
+	wavefront_destroy(&wf);
+	bool test_6 = previous_allocations == current_number_of_allocations();
+
+	return test_1 && test_2 && test_3 && test_4 && test_5 && test_6;
+}
@@ -0,0 +1,360 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <stdbool.h>
+#include "headers/text_format.h"
+
+#include "tests/headers/test_utils.h"
+
+/* Formats doubles exactly as printf does with "%.*e" and "%.*f", without
+ * going through the generic printf machinery.
+ *
+ * A finite double is M * 2^E for integers M and E. The digits printed for
+ * a precision p are round(|value| * 10^k) for a k that depends on the
+ * format, which is the fraction
+ *
+ *   M * 2^max(E, 0) * 10^max(k, 0)  /  (2^max(-E, 0) * 10^max(-k, 0))
+ *
+ * rounded half to even. Whenever numerator and denominator fit in 128 bit
+ * integers, which covers every value a simulation usually prints, this is
+ * computed exactly with one division, and the result is the same as that
+ * of printf. Other values, infinities and NaNs are left to snprintf.
+ */
+
+typedef unsigned __int128 uint128;
+
+static const uint64_t powers_of_ten[20] = {
+	1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull,
+	100000000ull, 1000000000ull, 10000000000ull, 100000000000ull, 1000000000000ull,
+	10000000000000ull, 100000000000000ull, 1000000000000000ull, 10000000000000000ull,
+	100000000000000000ull, 1000000000000000000ull, 10000000000000000000ull
+};
+
+/* 10^-30 to 10^30, used to refine the first guess of a decimal exponent */
+static const double decimal_powers[61] = {
+	1e-30, 1e-29, 1e-28, 1e-27, 1e-26, 1e-25, 1e-24, 1e-23,
+	1e-22, 1e-21, 1e-20, 1e-19, 1e-18, 1e-17, 1e-16, 1e-15,
+	1e-14, 1e-13, 1e-12, 1e-11, 1e-10, 1e-9, 1e-8, 1e-7,
+	1e-6, 1e-5, 1e-4, 1e-3, 1e-2, 1e-1, 1e0, 1e1,
+	1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+	1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+	1e18, 1e19, 1e20, 1e21, 1e22, 1e23, 1e24, 1e25,
+	1e26, 1e27, 1e28, 1e29, 1e30
+};
+
+static uint bit_length(uint128 x)
+{
+	uint64_t high = x >> 64;
+	if (high) {
+		return 128 - __builtin_clzll(high);
+	}
+	return (uint64_t)x ? 64 - __builtin_clzll((uint64_t)x) : 0;
+}
+
+static uint128 power_of_ten(uint k)
+{
+	if (k < 20) {
+		return powers_of_ten[k];
+	}
+	return (uint128)powers_of_ten[19] * powers_of_ten[k - 19];
+}
+
+/* Splits a finite nonzero value into |value| = m * 2^exponent. */
+static uint64_t decompose(double value, int *exponent)
+{
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof bits);
+	int biased = (bits >> 52) & 0x7ff;
+	uint64_t m = bits & ((1ull << 52) - 1);
+	if (biased) {
+		m |= 1ull << 52;
+		*exponent = biased - 1075;
+	}
+	else {
+		*exponent = -1074;
+	}
+	return m;
+}
+
+/* Sets result to round(|value| * 10^k), rounding half to even, and
+ * truncated to floor(|value| * 10^k). Returns false if that cannot be
+ * computed within 128 bits or does not fit in 64. */
+static bool scaled_round(double value, int k, uint64_t *result, uint64_t *truncated)
+{
+	int exponent;
+	uint64_t m = value != 0.0 ? decompose(value, &exponent) : 0;
+
+	if (m == 0) {
+		*result = *truncated = 0;
+		return true;
+	}
+	/* drop trailing zero bits to widen the range that fits */
+	uint zeros = __builtin_ctzll(m);
+	m >>= zeros;
+	exponent += zeros;
+
+	if (k > 38 || k < -38) {
+		return false;
+	}
+
+	uint128 numerator = m;
+	uint128 denominator = 1;
+	if (k >= 0) {
+		uint128 scale = power_of_ten(k);
+		if (bit_length(numerator) + bit_length(scale) > 127) {
+			return false;
+		}
+		numerator *= scale;
+	}
+	else {
+		denominator = power_of_ten(-k);
+	}
+
+	if (exponent >= 0) {
+		if (bit_length(numerator) + exponent > 127) {
+			return false;
+		}
+		numerator <<= exponent;
+	}
+	else {
+		if (bit_length(denominator) + -exponent > 126) {
+			return false;
+		}
+		denominator <<= -exponent;
+	}
+
+	uint128 quotient, remainder;
+	if (k >= 0 && exponent < 0) {
+		/* the common case, where the denominator is a power of two */
+		quotient = numerator >> -exponent;
+		remainder = numerator & (denominator - 1);
+	}
+	else {
+		quotient = numerator / denominator;
+		remainder = numerator % denominator;
+	}
+	*truncated = (uint64_t)quotient;
+	if (2 * remainder > denominator || (2 * remainder == denominator && (quotient & 1))) {
+		quotient++;
+	}
+	if (quotient >> 64) {
+		return false;
+	}
+
+	*result = (uint64_t)quotient;
+	return true;
+}
+
+/* Writes the digits of value, padded with zeros to width digits, and
+ * returns the number of digits written. */
+static size_t write_digits(char *out, uint64_t value, uint width)
+{
+	static const char pairs[] =
+		"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+		"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+		"8081828384858687888990919293949596979899";
+	char digits[20];
+	uint count = 0;
+	while (value >= 100) {
+		uint pair = value % 100;
+		value /= 100;
+		digits[count++] = pairs[2 * pair + 1];
+		digits[count++] = pairs[2 * pair];
+	}
+	if (value >= 10) {
+		digits[count++] = pairs[2 * value + 1];
+		digits[count++] = pairs[2 * value];
+	}
+	else {
+		digits[count++] = '0' + value;
+	}
+	while (count < width) {
+		digits[count++] = '0';
+	}
+	for (uint i = 0; i < count; i++) {
+		out[i] = digits[count - 1 - i];
+	}
+	return count;
+}
+
+size_t text_format_uint(char *out, uint64_t value)
+{
+	return write_digits(out, value, 0);
+}
+
+/* Formats value as "%.*e" would, returning the length of the text written
+ * to out, which must hold TEXT_FORMAT_NUMBER_SIZE bytes. The text is not
+ * null terminated. */
+size_t text_format_exponent(char *out, double value, uint precision)
+{
+	if (!isfinite(value) || precision > TEXT_FORMAT_MAX_PRECISION) {
+		return snprintf(out, TEXT_FORMAT_NUMBER_SIZE, "%.*e", (int)precision, value);
+	}
+
+	uint64_t digits = 0, truncated;
+	int decimal_exponent = 0;
+	if (value != 0.0) {
+		/* a guess from the binary exponent, corrected below if it is off by one */
+		int exponent;
+		uint64_t m = decompose(value, &exponent);
+		decimal_exponent = (int)floor((exponent + 63 - __builtin_clzll(m)) * 0.30102999566398120);
+		if (decimal_exponent >= -30 && decimal_exponent < 30
+		    && fabs(value) >= decimal_powers[decimal_exponent + 31]) {
+			decimal_exponent++;
+		}
+		for (;;) {
+			if (!scaled_round(value, (int)precision - decimal_exponent, &digits, &truncated)) {
+				return snprintf(out, TEXT_FORMAT_NUMBER_SIZE, "%.*e", (int)precision, value);
+			}
+			/* the exponent is right when the value itself has precision + 1 digits */
+			if (truncated >= powers_of_ten[precision + 1]) {
+				decimal_exponent++;
+			}
+			else if (truncated < powers_of_ten[precision]) {
+				decimal_exponent--;
+			}
+			else {
+				break;
+			}
+		}
+		if (digits == powers_of_ten[precision + 1]) {
+			/* rounding carried into a new digit, as in 9.99...e+00 to 1.00...e+01 */
+			digits = powers_of_ten[precision];
+			decimal_exponent++;
+		}
+	}
+
+	char *p = out;
+	if (signbit(value)) {
+		*p++ = '-';
+	}
+
+	char mantissa[TEXT_FORMAT_MAX_PRECISION + 1];
+	write_digits(mantissa, digits, precision + 1);
+	*p++ = mantissa[0];
+	if (precision) {
+		*p++ = '.';
+		memcpy(p, mantissa + 1, precision);
+		p += precision;
+	}
+
+	*p++ = 'e';
+	*p++ = decimal_exponent < 0 ? '-' : '+';
+	p += write_digits(p, abs(decimal_exponent), 2);
+
+	return p - out;
+}
+
+/* Formats value as "%.*f" would, with the same requirements as
+ * text_format_exponent. */
+size_t text_format_fixed(char *out, double value, uint precision)
+{
+	uint64_t digits, truncated;
+	if (!isfinite(value) || precision > TEXT_FORMAT_MAX_PRECISION
+	    || !scaled_round(value, precision, &digits, &truncated)) {
+		return snprintf(out, TEXT_FORMAT_NUMBER_SIZE, "%.*f", (int)precision, value);
+	}
+
+	char *p = out;
+	if (signbit(value)) {
+		*p++ = '-';
+	}
+
+	p += write_digits(p, digits / powers_of_ten[precision], 1);
+	if (precision) {
+		*p++ = '.';
+		p += write_digits(p, digits % powers_of_ten[precision], precision);
+	}
+
+	return p - out;
+}
+
+/* A growing buffer of text, used to format many numbers and hand them to
+ * the C library in a single write. */
+struct text_buffer {
+	char *data;
+	size_t size;
+	size_t capacity;
+};
+
+text_buffer text_buffer_create(size_t capacity)
+{
+	text_buffer result = malloc(sizeof *result);
+	result->capacity = capacity > TEXT_FORMAT_NUMBER_SIZE ? capacity : TEXT_FORMAT_NUMBER_SIZE;
+	result->data = malloc(result->capacity);
+	result->size = 0;
+	return result;
+}
+
+static char *reserve(text_buffer tb, size_t size)
+{
+	if (tb->size + size > tb->capacity) {
+		while (tb->size + size > tb->capacity) {
+			tb->capacity *= 2;
+		}
+		tb->data = realloc(tb->data, tb->capacity);
+	}
+	return tb->data + tb->size;
+}
+
+void text_buffer_exponent(text_buffer tb, double value, uint precision)
+{
+	assert(tb);
+	tb->size += text_format_exponent(reserve(tb, TEXT_FORMAT_NUMBER_SIZE), value, precision);
+}
+
+void text_buffer_fixed(text_buffer tb, double value, uint precision)
+{
+	assert(tb);
+	tb->size += text_format_fixed(reserve(tb, TEXT_FORMAT_NUMBER_SIZE), value, precision);
+}
+
+void text_buffer_uint(text_buffer tb, uint64_t value)
+{
+	assert(tb);
+	tb->size += text_format_uint(reserve(tb, 20), value);
+}
+
+void text_buffer_string(text_buffer tb, const char *string)
+{
+	assert(tb);
+	assert(string);
+
+	size_t length = strlen(string);
+	memcpy(reserve(tb, length), string, length);
+	tb->size += length;
+}
+
+void text_buffer_char(text_buffer tb, char c)
+{
+	assert(tb);
+	*reserve(tb, 1) = c;
+	tb->size++;
+}
+
+const char *text_buffer_get_data(text_buffer tb)
+{
+	return tb->data;
+}
+
+size_t text_buffer_get_size(text_buffer tb)
+{
+	return tb->size;
+}
+
+void text_buffer_clear(text_buffer tb)
+{
+	tb->size = 0;
+}
+
+void text_buffer_destroy(text_buffer *tb)
+{
+	assert(tb);
+	assert(*tb);
+
+	free((*tb)->data);
+	free(*tb);
+	*tb = NULL;
+}
@@ -0,0 +1,204 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include "../headers/deftypes.h"
+#include "../headers/frame_file.h"
+#include "../headers/compressed_file.h"
+#include "../headers/container.h"
+#include "../headers/spike_file.h"
+#include "../headers/trace_file.h"
+#include "../headers/file_table.h"
+
+/* Regenerates the text data files that --output-data writes in the text
+ * output format from a binary, compressed or container frame file, or the
+ * raster plot from a spike file. */
+
+#define usage_statement \
+	"Usage: neuralnet_convert FRAME_FILE OUTPUT_DIR [BEGIN_TIME END_TIME]\n" \
+	"Writes one N.dat file per neuron, holding the time followed by every\n" \
+	"dynamical variable, and voltage_matrix.dat into OUTPUT_DIR. FRAME_FILE\n" \
+	"may be frames.bin, frames.nnz or frames.nnc. Given a time range, only\n" \
+	"the frames within it are written; from frames.nnc, only the chunks\n" \
+	"holding them are read. FRAME_FILE may also be spikes.aer, from which\n" \
+	"raster_plot.dat is written instead.\n" \
+	"\n" \
+	"Usage: neuralnet_convert --transpose FRAME_FILE TRACE_FILE\n" \
+	"Rewrites frames.bin into a trace file, where the whole trace of every\n" \
+	"variable of every neuron is contiguous."
+
+/* Prints one frame, given in the row-major layout of the dynamical system. */
+static void print_frame(file_table fs, const struct frame_file_layout *layout, double time, const double *values)
+{
+	uint variable_count = layout->variable_count;
+
+	for (uint i = 0; i < layout->system_size; i++) {
+		file_table_index_print(fs, i, "%.10e", time);
+		for (uint variable = 0; variable < variable_count; variable++) {
+			file_table_index_print(fs, i, " %.10e", values[i * variable_count + variable]);
+		}
+		file_table_index_print(fs, i, "\n");
+	}
+
+	file_table_handle voltage_matrix_file = file_table_special_handle(fs, "voltage_matrix.dat");
+	file_table_special_print(fs, "voltage_matrix.dat", "#aside time = %f ms\n", time);
+	file_table_write_matrix(fs, voltage_matrix_file, values, layout->grid_height, layout->grid_width,
+				variable_count, 10);
+	file_table_write(fs, voltage_matrix_file, "\n", 1);
+}
+
+/* Writes the spikes within the time range into raster_plot.dat. */
+static int convert_spikes(spike_reader sr, const char *output_dir, double begin_time, double end_time)
+{
+	file_table fs = file_table_create(output_dir, 0, 1, "raster_plot.dat");
+	if (!fs) {
+		puts("Fatal error: Could not create the file table.");
+		spike_reader_close(&sr);
+		return 1;
+	}
+
+	uint spike_count;
+	while ((spike_count = spike_reader_next_block(sr))) {
+		for (uint spike = 0; spike < spike_count; spike++) {
+			double time = spike_reader_get_time(sr, spike);
+			if (time >= begin_time && time <= end_time) {
+				file_table_special_print(fs, "raster_plot.dat", "%f\t%d\n",
+							 time, spike_reader_get_neuron(sr, spike));
+			}
+		}
+	}
+
+	spike_reader_close(&sr);
+	file_table_destroy(&fs);
+	return 0;
+}
+
+int main(int argc, const char **argv)
+{
+	if (argc == 4 && !strcmp(argv[1], "--transpose")) {
+		if (!trace_file_transpose(argv[2], argv[3], TRACE_FILE_MEMORY_BUDGET)) {
+			printf("Unable to transpose the frame file [%s] into [%s].\n", argv[2], argv[3]);
+			return 1;
+		}
+		return 0;
+	}
+
+	if (argc != 3 && argc != 5) {
+		puts(usage_statement);
+		return 1;
+	}
+
+	double begin_time = -INFINITY, end_time = INFINITY;
+	if (argc == 5) {
+		char *begin_end, *end_end;
+		begin_time = strtod(argv[3], &begin_end);
+		end_time = strtod(argv[4], &end_end);
+		if (*begin_end != '\0' || *end_end != '\0' || begin_time > end_time) {
+			puts(usage_statement);
+			return 1;
+		}
+	}
+
+	spike_reader sr = spike_reader_open(argv[1]);
+	if (sr) {
+		return convert_spikes(sr, argv[2], begin_time, end_time);
+	}
+
+	frame_reader fr = frame_reader_open(argv[1]);
+	compressed_reader cr = fr ? NULL : compressed_reader_open(argv[1]);
+	container_reader nr = fr || cr ? NULL : container_reader_open(argv[1]);
+	if (!fr && !cr && !nr) {
+		printf("Unable to read the frame file [%s].\n", argv[1]);
+		return 1;
+	}
+
+	struct frame_file_layout layout;
+	if (fr) {
+		frame_reader_get_layout(fr, &layout);
+	}
+	else if (cr) {
+		compressed_reader_get_layout(cr, &layout);
+	}
+	else {
+		container_reader_get_layout(nr, &layout);
+	}
+
+	file_table fs = file_table_create(argv[2], layout.system_size, 1, "voltage_matrix.dat");
+	if (!fs) {
+		puts("Fatal error: Could not create the file table.");
+		if (fr) {
+			frame_reader_close(&fr);
+		}
+		else if (cr) {
+			compressed_reader_close(&cr);
+		}
+		else {
+			container_reader_close(&nr);
+		}
+		return 1;
+	}
+
+	double *values = malloc((sizeof *values) * layout.system_size * layout.variable_count);
+	if (fr) {
+		uint64_t frame_count = frame_reader_get_frame_count(fr);
+		for (uint64_t frame = 0; frame < frame_count; frame++) {
+			double time = frame_reader_get_time(fr, frame);
+			if (time < begin_time || time > end_time) {
+				continue;
+			}
+			for (uint i = 0; i < layout.system_size; i++) {
+				for (uint variable = 0; variable < layout.variable_count; variable++) {
+					values[i * layout.variable_count + variable] =
+						frame_reader_get_value(fr, frame, variable, i);
+				}
+			}
+			print_frame(fs, &layout, time, values);
+		}
+		frame_reader_close(&fr);
+	}
+	else if (cr) {
+		uint frame_count;
+		while ((frame_count = compressed_reader_next_chunk(cr))) {
+			for (uint frame = 0; frame < frame_count; frame++) {
+				double time = compressed_reader_get_time(cr, frame);
+				if (time >= begin_time && time <= end_time) {
+					print_frame(fs, &layout, time, compressed_reader_get_values(cr, frame));
+				}
+			}
+		}
+		compressed_reader_close(&cr);
+	}
+	else {
+		/* every variable has its own chunks, covering the same frames */
+		uint64_t chunk_count = container_reader_get_chunk_count(nr, 0);
+		for (uint64_t chunk = container_reader_find_chunk(nr, 0, begin_time); chunk < chunk_count; chunk++) {
+			struct container_chunk_info info;
+			container_reader_get_chunk(nr, 0, chunk, &info);
+			if (info.first_time > end_time) {
+				break;
+			}
+			for (uint frame = 0; frame < info.frame_count; frame++) {
+				double time = container_reader_get_time(nr, 0, chunk, frame);
+				if (time < begin_time || time > end_time) {
+					continue;
+				}
+				for (uint i = 0; i < layout.system_size; i++) {
+					for (uint variable = 0; variable < layout.variable_count; variable++) {
+						values[i * layout.variable_count + variable] =
+							container_reader_get_value(nr, variable, chunk, frame, i);
+					}
+				}
+				print_frame(fs, &layout, time, values);
+			}
+		}
+		container_reader_close(&nr);
+	}
+	free(values);
+
+	if (!file_table_destroy(&fs)) {
+		puts("Fatal error: Could not write to the output files.");
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,109 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../headers/deftypes.h"
+#include "../headers/shm_ring.h"
+
+/* Follows the shared memory ring that --shm-export publishes to, printing
+ * a line per sample until the simulation ends. */
+
+#define usage_statement \
+	"Usage: neuralnet_monitor NAME [NEURON...]\n" \
+	"Prints the time and the voltage of every given neuron for each sample\n" \
+	"published into the shared memory ring NAME, or the mean, lowest and\n" \
+	"highest voltage of the system when no neuron is given. Samples that\n" \
+	"are overwritten before they are read are skipped and counted."
+
+/* how long to sleep when there is no new sample */
+#define POLL_INTERVAL_NS 1000000
+
+static void print_sample(const struct shm_ring_layout *layout, double time, const double *values,
+			 const uint *neurons, uint neuron_count)
+{
+	printf("%.6f", time);
+	if (neuron_count) {
+		for (uint i = 0; i < neuron_count; i++) {
+			printf(" %.10e", values[(size_t)neurons[i] * layout->variable_count]);
+		}
+	}
+	else {
+		double sum = 0.0, lowest = values[0], highest = values[0];
+		for (uint i = 0; i < layout->system_size; i++) {
+			double voltage = values[(size_t)i * layout->variable_count];
+			sum += voltage;
+			lowest = voltage < lowest ? voltage : lowest;
+			highest = voltage > highest ? voltage : highest;
+		}
+		printf(" %.10e %.10e %.10e", sum / layout->system_size, lowest, highest);
+	}
+	putchar('\n');
+}
+
+int main(int argc, const char **argv)
+{
+	if (argc < 2) {
+		puts(usage_statement);
+		return 1;
+	}
+
+	shm_reader reader = shm_reader_open(argv[1]);
+	if (!reader) {
+		printf("Fatal error: Could not open the shared memory ring [%s].\n", argv[1]);
+		return 1;
+	}
+	struct shm_ring_layout layout;
+	shm_reader_get_layout(reader, &layout);
+
+	uint neuron_count = argc - 2;
+	uint *neurons = malloc((sizeof *neurons) * (neuron_count ? neuron_count : 1));
+	for (uint i = 0; i < neuron_count; i++) {
+		char *end;
+		long neuron = strtol(argv[i + 2], &end, 10);
+		if (*end != '\0' || neuron < 0 || neuron >= layout.system_size) {
+			puts(usage_statement);
+			free(neurons);
+			shm_reader_close(&reader);
+			return 1;
+		}
+		neurons[i] = (uint)neuron;
+	}
+
+	double *values = malloc((sizeof *values) * layout.system_size * layout.variable_count);
+	const struct timespec poll_interval = { .tv_sec = 0, .tv_nsec = POLL_INTERVAL_NS };
+	uint64_t frame = 0, skipped = 0;
+	for (;;) {
+		/* closed is read first, so that no sample published before it is missed */
+		bool closed = shm_reader_is_closed(reader);
+		uint64_t published = shm_reader_get_published(reader);
+		if (frame == published) {
+			if (closed) {
+				break;
+			}
+			nanosleep(&poll_interval, NULL);
+			continue;
+		}
+
+		if (published - frame > layout.slot_count) {
+			skipped += published - layout.slot_count - frame;
+			frame = published - layout.slot_count;
+		}
+		double time;
+		if (shm_reader_read(reader, frame, &time, values)) {
+			print_sample(&layout, time, values, neurons, neuron_count);
+		}
+		else {
+			skipped++;
+		}
+		frame++;
+	}
+	fflush(stdout);
+	fprintf(stderr, "Monitor: %llu samples read, %llu skipped.\n",
+		(unsigned long long)(frame - skipped), (unsigned long long)skipped);
+
+	free(values);
+	free(neurons);
+	shm_reader_close(&reader);
+	return 0;
+}
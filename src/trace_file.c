@@ -0,0 +1,380 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "headers/trace_file.h"
+
+#include "tests/headers/test_utils.h"
+
+/* A trace file holds the same samples as a frame file, transposed so that
+ * the whole trace of every variable of every system is contiguous.
+ *
+ * It is the header below, then the times of frame_capacity frames, then one
+ * row of frame_capacity values per system and variable, in the order of the
+ * row-major layout of the dynamical system: every variable of system 0,
+ * then of system 1 and so on. Values are stored as floats or doubles
+ * according to value_size, and only the first frame_count of every row are
+ * written.
+ *
+ * Frames are buffered in blocks of as many as fit into the memory budget.
+ * A full block is transposed in square tiles, so that both the frames read
+ * and the rows written stay in cache, and every row of the block is then
+ * written with a single pwrite at its place in the file. Only a block is
+ * ever held in memory, however long the run.
+ */
+struct trace_file_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t header_size;
+	uint32_t system_size;
+	uint32_t grid_width;
+	uint32_t grid_height;
+	uint32_t variable_count;
+	uint32_t value_size;
+	uint32_t reserved;
+	uint64_t frame_capacity;
+	uint64_t frame_count;
+	double time_step;
+	double print_time;
+	char model_name[FRAME_FILE_NAME_LENGTH];
+	char variable_names[FRAME_FILE_MAX_VARIABLES][FRAME_FILE_VARIABLE_NAME_LENGTH];
+};
+
+static const char trace_file_magic[8] = "NNTRACE";
+
+/* frames and columns transposed at once, sized to keep a tile in L1 */
+#define TILE_SIZE 16
+
+struct trace_file {
+	int fd;
+	struct trace_file_header header;
+	uint row_count;
+	size_t column_size;
+	uint64_t block_frames;
+	uint64_t block_count;
+	double *times;
+	unsigned char *block;
+	unsigned char *rows;
+	bool failed;
+};
+
+struct trace_reader {
+	void *mapping;
+	size_t mapping_size;
+	const struct trace_file_header *header;
+	const char *variable_names[FRAME_FILE_MAX_VARIABLES];
+};
+
+static uint64_t file_size_for(const struct trace_file_header *header)
+{
+	uint64_t row_count = (uint64_t)header->system_size * header->variable_count;
+	return sizeof *header + header->frame_capacity * (sizeof (double) + row_count * header->value_size);
+}
+
+static bool write_all(int fd, const void *data, size_t size, uint64_t offset)
+{
+	const unsigned char *bytes = data;
+	while (size) {
+		ssize_t written = pwrite(fd, bytes, size, offset);
+		if (written <= 0 && !(written < 0 && errno == EINTR)) {
+			return false;
+		}
+		if (written > 0) {
+			bytes += written;
+			size -= written;
+			offset += written;
+		}
+	}
+	return true;
+}
+
+/* Creates a trace file with room for frame_capacity frames, buffering as
+ * many frames as fit into memory_budget bytes between writes. */
+trace_file trace_file_create(const char *filename, const struct frame_file_layout *layout,
+			     uint64_t frame_capacity, size_t memory_budget)
+{
+	assert(filename);
+	assert(layout);
+	assert("Values must be stored as floats or doubles."
+	       && (layout->value_size == sizeof (float) || layout->value_size == sizeof (double)));
+
+	if (layout->variable_count > FRAME_FILE_MAX_VARIABLES) {
+		return NULL;
+	}
+
+	struct trace_file_header header;
+	memset(&header, 0, sizeof header);
+	memcpy(header.magic, trace_file_magic, sizeof header.magic);
+	header.version = TRACE_FILE_VERSION;
+	header.header_size = sizeof header;
+	header.system_size = layout->system_size;
+	header.grid_width = layout->grid_width;
+	header.grid_height = layout->grid_height;
+	header.variable_count = layout->variable_count;
+	header.value_size = layout->value_size;
+	header.frame_capacity = frame_capacity;
+	header.time_step = layout->time_step;
+	header.print_time = layout->print_time;
+	if (layout->model_name) {
+		strncpy(header.model_name, layout->model_name, FRAME_FILE_NAME_LENGTH - 1);
+	}
+	for (uint i = 0; i < layout->variable_count; i++) {
+		strncpy(header.variable_names[i], layout->variable_names[i], FRAME_FILE_VARIABLE_NAME_LENGTH - 1);
+	}
+
+	int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		return NULL;
+	}
+	if (!write_all(fd, &header, sizeof header, 0) || ftruncate(fd, file_size_for(&header))) {
+		close(fd);
+		return NULL;
+	}
+
+	trace_file result = malloc(sizeof *result);
+	result->fd = fd;
+	result->header = header;
+	result->row_count = layout->system_size * layout->variable_count;
+	result->column_size = (size_t)result->row_count * layout->value_size;
+	/* the block of frames and its transposed rows share the budget */
+	result->block_frames = memory_budget / (2 * result->column_size + sizeof (double));
+	if (result->block_frames > frame_capacity) {
+		result->block_frames = frame_capacity;
+	}
+	if (result->block_frames == 0) {
+		result->block_frames = 1;
+	}
+	result->block_count = 0;
+	result->times = malloc((sizeof *result->times) * result->block_frames);
+	result->block = malloc(result->column_size * result->block_frames);
+	result->rows = malloc(result->column_size * result->block_frames);
+	result->failed = false;
+	return result;
+}
+
+/* Moves value c of frame k of the block to place k of row r, where column c
+ * holds variable c / system_size of system c % system_size. Called with a
+ * constant value size, so that the copies become plain loads and stores. */
+static void transpose_tiles(trace_file tf, size_t value_size)
+{
+	uint system_size = tf->header.system_size;
+	uint variable_count = tf->header.variable_count;
+	uint64_t frames = tf->block_count;
+
+	for (uint c0 = 0; c0 < tf->row_count; c0 += TILE_SIZE) {
+		uint c1 = c0 + TILE_SIZE < tf->row_count ? c0 + TILE_SIZE : tf->row_count;
+		for (uint64_t k0 = 0; k0 < frames; k0 += TILE_SIZE) {
+			uint64_t k1 = k0 + TILE_SIZE < frames ? k0 + TILE_SIZE : frames;
+			for (uint c = c0; c < c1; c++) {
+				uint64_t r = (uint64_t)(c % system_size) * variable_count + c / system_size;
+				for (uint64_t k = k0; k < k1; k++) {
+					memcpy(tf->rows + (r * frames + k) * value_size,
+					       tf->block + (k * tf->row_count + c) * value_size, value_size);
+				}
+			}
+		}
+	}
+}
+
+static bool flush_block(trace_file tf)
+{
+	if (!tf->block_count) {
+		return !tf->failed;
+	}
+
+	if (tf->header.value_size == sizeof (double)) {
+		transpose_tiles(tf, sizeof (double));
+	}
+	else {
+		transpose_tiles(tf, sizeof (float));
+	}
+
+	uint value_size = tf->header.value_size;
+	uint64_t capacity = tf->header.frame_capacity;
+	uint64_t first = tf->header.frame_count;
+	uint64_t rows_offset = sizeof tf->header + capacity * sizeof (double);
+	bool success = write_all(tf->fd, tf->times, (sizeof *tf->times) * tf->block_count,
+				 sizeof tf->header + first * sizeof (double));
+	for (uint64_t r = 0; success && r < tf->row_count; r++) {
+		success = write_all(tf->fd, tf->rows + r * tf->block_count * value_size, tf->block_count * value_size,
+				    rows_offset + (r * capacity + first) * value_size);
+	}
+
+	tf->header.frame_count += tf->block_count;
+	tf->block_count = 0;
+	tf->failed = tf->failed || !success;
+	return !tf->failed;
+}
+
+/* Takes a frame in the layout of a frame file: one column per variable,
+ * holding that variable for every system as a float or a double. Returns
+ * false if the file is full or could not be written. */
+bool trace_file_write(trace_file tf, double time, const void *columns)
+{
+	assert(tf);
+	assert(columns);
+
+	if (tf->header.frame_count + tf->block_count >= tf->header.frame_capacity) {
+		return false;
+	}
+
+	tf->times[tf->block_count] = time;
+	memcpy(tf->block + tf->block_count * tf->column_size, columns, tf->column_size);
+	if (++tf->block_count == tf->block_frames) {
+		return flush_block(tf);
+	}
+	return !tf->failed;
+}
+
+uint64_t trace_file_get_frame_count(trace_file tf)
+{
+	assert(tf);
+	return tf->header.frame_count + tf->block_count;
+}
+
+/* Writes the last frames and the final frame count. Returns false if any
+ * write failed. */
+bool trace_file_destroy(trace_file *tf)
+{
+	assert(tf);
+	assert(*tf);
+
+	bool success = flush_block(*tf);
+	success = success && write_all((*tf)->fd, &(*tf)->header, sizeof (*tf)->header, 0);
+	success = !close((*tf)->fd) && success;
+	free((*tf)->times);
+	free((*tf)->block);
+	free((*tf)->rows);
+	free(*tf);
+	*tf = NULL;
+	return success;
+}
+
+/* Transposes the whole of a frame file into a new trace file. */
+bool trace_file_transpose(const char *frame_filename, const char *trace_filename, size_t memory_budget)
+{
+	assert(frame_filename);
+	assert(trace_filename);
+
+	frame_reader fr = frame_reader_open(frame_filename);
+	if (!fr) {
+		return false;
+	}
+
+	struct frame_file_layout layout;
+	frame_reader_get_layout(fr, &layout);
+	uint64_t frame_count = frame_reader_get_frame_count(fr);
+	trace_file tf = trace_file_create(trace_filename, &layout, frame_count, memory_budget);
+	bool success = tf != NULL;
+	for (uint64_t frame = 0; success && frame < frame_count; frame++) {
+		success = trace_file_write(tf, frame_reader_get_time(fr, frame), frame_reader_get_column(fr, frame, 0));
+	}
+
+	if (tf) {
+		success = trace_file_destroy(&tf) && success;
+	}
+	frame_reader_close(&fr);
+	return success;
+}
+
+trace_reader trace_reader_open(const char *filename)
+{
+	assert(filename);
+
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		return NULL;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) || st.st_size < (off_t)sizeof (struct trace_file_header)) {
+		close(fd);
+		return NULL;
+	}
+
+	void *mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED) {
+		return NULL;
+	}
+
+	const struct trace_file_header *header = mapping;
+	if (memcmp(header->magic, trace_file_magic, sizeof header->magic)
+	    || header->version != TRACE_FILE_VERSION
+	    || header->header_size != sizeof *header
+	    || header->variable_count > FRAME_FILE_MAX_VARIABLES
+	    || (header->value_size != sizeof (float) && header->value_size != sizeof (double))
+	    || header->frame_count > header->frame_capacity
+	    || file_size_for(header) > (uint64_t)st.st_size) {
+		munmap(mapping, st.st_size);
+		return NULL;
+	}
+
+	trace_reader result = malloc(sizeof *result);
+	result->mapping = mapping;
+	result->mapping_size = st.st_size;
+	result->header = header;
+	for (uint i = 0; i < FRAME_FILE_MAX_VARIABLES; i++) {
+		result->variable_names[i] = header->variable_names[i];
+	}
+	return result;
+}
+
+void trace_reader_get_layout(trace_reader tr, struct frame_file_layout *layout)
+{
+	assert(tr);
+	assert(layout);
+
+	layout->model_name = tr->header->model_name;
+	layout->system_size = tr->header->system_size;
+	layout->grid_width = tr->header->grid_width;
+	layout->grid_height = tr->header->grid_height;
+	layout->variable_count = tr->header->variable_count;
+	layout->variable_names = tr->variable_names;
+	layout->value_size = tr->header->value_size;
+	layout->time_step = tr->header->time_step;
+	layout->print_time = tr->header->print_time;
+}
+
+uint64_t trace_reader_get_frame_count(trace_reader tr)
+{
+	assert(tr);
+	return tr->header->frame_count;
+}
+
+/* Returns the times of the frames, frame_count doubles. */
+const double *trace_reader_get_times(trace_reader tr)
+{
+	assert(tr);
+	return (const double *)((const unsigned char *)tr->mapping + tr->header->header_size);
+}
+
+/* Returns the trace of one variable of one system, frame_count floats or
+ * doubles depending on the value size. */
+const void *trace_reader_get_trace(trace_reader tr, uint system, uint variable)
+{
+	assert(tr);
+	assert("Given an invalid system." && system < tr->header->system_size);
+	assert("Given an invalid variable." && variable < tr->header->variable_count);
+
+	uint64_t capacity = tr->header->frame_capacity;
+	uint64_t row = (uint64_t)system * tr->header->variable_count + variable;
+	return (const unsigned char *)tr->mapping + tr->header->header_size + capacity * sizeof (double)
+		+ row * capacity * tr->header->value_size;
+}
+
+void trace_reader_close(trace_reader *tr)
+{
+	assert(tr);
+	assert(*tr);
+
+	munmap((*tr)->mapping, (*tr)->mapping_size);
+	free(*tr);
+	*tr = NULL;
+}
@@ -0,0 +1,330 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include "headers/wavefront.h"
+
+#include "tests/headers/test_utils.h"
+
+#define TWO_PI 6.28318530717958647692
+#define PI 3.14159265358979323846
+
+/* Follows activation waves over the first grid_width * grid_height neurons
+ * of the system, laid out as the rows of the grid, while the system is
+ * integrated, and keeps only compact features of them.
+ *
+ * Every step, the upward crossings of threshold are found, and the time of
+ * each is interpolated between both steps into the activation time map,
+ * which holds the last activation of every cell. The cells activated
+ * during the current window are listed as they come, so that the front of
+ * a window costs nothing when the network is quiet.
+ *
+ * At the end of a window, the conduction speed of every activated cell is
+ * the inverse of the gradient of the activation times, taken from the
+ * neighbours on the grid that activated during the same window. Every cell
+ * that activated at least twice has a phase, going from 0 to 2 pi over the
+ * length of its last interval. A phase singularity is a square of four
+ * cells around which the phase winds by a multiple of 2 pi, and is tracked
+ * from window to window by matching it to the nearest one of the previous
+ * window. The grid does not wrap around.
+ */
+struct wavefront {
+	uint width;
+	uint height;
+	uint element_size;
+	struct wavefront_options options;
+	double time;
+	double window_start;
+	double *previous_voltages;
+	double *activation;
+	double *interval;
+	double *phases;
+	uint *activated;
+	uint activated_count;
+	struct wavefront_singularity *singularities;
+	uint singularity_count;
+	uint singularity_capacity;
+	struct wavefront_singularity *previous;
+	uint previous_count;
+	uint next_id;
+};
+
+/* Starts from the given values and time. Cells that have not activated
+ * yet have an activation time of NAN. */
+wavefront wavefront_create(uint grid_width, uint grid_height, uint element_size, double start_time,
+			   const double *values, const struct wavefront_options *options)
+{
+	assert(grid_width > 0);
+	assert(grid_height > 0);
+	assert(element_size > 0);
+	assert(values);
+	assert(options);
+
+	wavefront result = malloc(sizeof *result);
+	size_t n = (size_t)grid_width * grid_height;
+	result->width = grid_width;
+	result->height = grid_height;
+	result->element_size = element_size;
+	result->options = *options;
+	result->time = result->window_start = start_time;
+	result->previous_voltages = malloc((sizeof *result->previous_voltages) * n);
+	result->activation = malloc((sizeof *result->activation) * n);
+	result->interval = calloc(n, sizeof *result->interval);
+	result->phases = malloc((sizeof *result->phases) * n);
+	result->activated = malloc((sizeof *result->activated) * n);
+	result->activated_count = 0;
+	for (size_t i = 0; i < n; i++) {
+		result->previous_voltages[i] = values[i * element_size];
+		result->activation[i] = NAN;
+	}
+	result->singularity_capacity = 16;
+	result->singularities = malloc((sizeof *result->singularities) * result->singularity_capacity);
+	result->previous = malloc((sizeof *result->previous) * result->singularity_capacity);
+	result->singularity_count = result->previous_count = 0;
+	result->next_id = 0;
+
+	return result;
+}
+
+/* Takes the values of the dynamical system after a step, in their
+ * row-major layout, at the given time. */
+void wavefront_add(wavefront wf, double time, const double *values)
+{
+	assert(wf);
+	assert(values);
+
+	uint n = wf->width * wf->height;
+	double threshold = wf->options.threshold;
+	double step = time - wf->time;
+	for (uint i = 0; i < n; i++) {
+		double previous = wf->previous_voltages[i];
+		double current = values[(size_t)i * wf->element_size];
+		wf->previous_voltages[i] = current;
+		if (current < threshold || previous >= threshold) {
+			continue;
+		}
+
+		double activation = wf->time + step * (threshold - previous) / (current - previous);
+		double last = wf->activation[i];
+		wf->interval[i] = isnan(last) ? 0.0 : activation - last;
+		wf->activation[i] = activation;
+		/* a cell activating twice in a window is listed once */
+		if (isnan(last) || last <= wf->window_start) {
+			wf->activated[wf->activated_count++] = i;
+		}
+	}
+	wf->time = time;
+}
+
+/* Returns the activation time of the neighbour at the given offset if it
+ * activated during the current window, or NAN. */
+static double window_activation(wavefront wf, uint x, uint y, int dx, int dy)
+{
+	long nx = (long)x + dx, ny = (long)y + dy;
+	if (nx < 0 || ny < 0 || nx >= wf->width || ny >= wf->height) {
+		return NAN;
+	}
+	double activation = wf->activation[ny * wf->width + nx];
+	return activation > wf->window_start ? activation : NAN;
+}
+
+/* The derivative of the activation time along one axis, from both
+ * neighbours if possible. Returns false if neither activated. */
+static bool activation_derivative(double before, double here, double after, double *derivative)
+{
+	if (!isnan(before) && !isnan(after)) {
+		*derivative = (after - before) / 2.0;
+	}
+	else if (!isnan(after)) {
+		*derivative = after - here;
+	}
+	else if (!isnan(before)) {
+		*derivative = here - before;
+	}
+	else {
+		return false;
+	}
+	return true;
+}
+
+static void take_front(wavefront wf, struct wavefront_sample *sample)
+{
+	double sum_x = 0.0, sum_y = 0.0, speed_sum = 0.0;
+	uint speed_count = 0;
+
+	for (uint k = 0; k < wf->activated_count; k++) {
+		uint i = wf->activated[k];
+		uint x = i % wf->width, y = i / wf->width;
+		sum_x += x;
+		sum_y += y;
+
+		double here = wf->activation[i];
+		double dx = 0.0, dy = 0.0;
+		bool has_x = activation_derivative(window_activation(wf, x, y, -1, 0), here,
+						   window_activation(wf, x, y, 1, 0), &dx);
+		bool has_y = activation_derivative(window_activation(wf, x, y, 0, -1), here,
+						   window_activation(wf, x, y, 0, 1), &dy);
+		double gradient = hypot(dx, dy);
+		if ((has_x || has_y) && gradient > 0.0) {
+			speed_sum += 1.0 / gradient;
+			speed_count++;
+		}
+	}
+
+	sample->activated = wf->activated_count;
+	sample->centroid_x = wf->activated_count ? sum_x / wf->activated_count : NAN;
+	sample->centroid_y = wf->activated_count ? sum_y / wf->activated_count : NAN;
+	sample->speed = speed_count ? speed_sum / speed_count : NAN;
+}
+
+/* The difference between two phases, brought into (-pi, pi]. */
+static double phase_difference(double from, double to)
+{
+	double difference = to - from;
+	if (difference > PI) {
+		difference -= TWO_PI;
+	}
+	else if (difference <= -PI) {
+		difference += TWO_PI;
+	}
+	return difference;
+}
+
+static void find_singularities(wavefront wf)
+{
+	uint width = wf->width, n = wf->width * wf->height;
+	double *phases = wf->phases;
+	for (uint i = 0; i < n; i++) {
+		if (wf->interval[i] > 0.0) {
+			double fraction = (wf->time - wf->activation[i]) / wf->interval[i];
+			phases[i] = TWO_PI * (fraction < 1.0 ? fraction : 1.0);
+		}
+		else {
+			phases[i] = NAN;
+		}
+	}
+
+	wf->singularity_count = 0;
+	for (uint y = 0; y + 1 < wf->height; y++) {
+		for (uint x = 0; x + 1 < width; x++) {
+			/* counterclockwise around the square */
+			double a = phases[y * width + x];
+			double b = phases[y * width + x + 1];
+			double c = phases[(y + 1) * width + x + 1];
+			double d = phases[(y + 1) * width + x];
+			if (isnan(a) || isnan(b) || isnan(c) || isnan(d)) {
+				continue;
+			}
+			double winding = phase_difference(a, b) + phase_difference(b, c)
+				+ phase_difference(c, d) + phase_difference(d, a);
+			int charge = (int)lround(winding / TWO_PI);
+			if (!charge) {
+				continue;
+			}
+
+			if (wf->singularity_count == wf->singularity_capacity) {
+				wf->singularity_capacity *= 2;
+				wf->singularities = realloc(wf->singularities,
+							    (sizeof *wf->singularities) * wf->singularity_capacity);
+				wf->previous = realloc(wf->previous, (sizeof *wf->previous) * wf->singularity_capacity);
+			}
+			wf->singularities[wf->singularity_count++] = (struct wavefront_singularity){
+				.charge = charge,
+				.x = x + 0.5,
+				.y = y + 0.5
+			};
+		}
+	}
+}
+
+/* Matches every singularity to the nearest unmatched one of the previous
+ * window, and counts the births and deaths. */
+static void track_singularities(wavefront wf, struct wavefront_sample *sample)
+{
+	double radius = wf->options.track_radius;
+	uint matched = 0;
+	sample->born = 0;
+
+	for (uint s = 0; s < wf->singularity_count; s++) {
+		struct wavefront_singularity *current = &wf->singularities[s];
+		struct wavefront_singularity *nearest = NULL;
+		double nearest_distance = radius;
+		for (uint p = 0; p < wf->previous_count; p++) {
+			struct wavefront_singularity *previous = &wf->previous[p];
+			double distance = hypot(current->x - previous->x, current->y - previous->y);
+			if (previous->charge == current->charge && distance <= nearest_distance) {
+				nearest = previous;
+				nearest_distance = distance;
+			}
+		}
+
+		if (nearest) {
+			current->id = nearest->id;
+			current->birth = nearest->birth;
+			/* each one of the previous window is matched at most once */
+			nearest->charge = 0;
+			matched++;
+		}
+		else {
+			current->id = wf->next_id++;
+			current->birth = wf->time;
+			sample->born++;
+		}
+	}
+
+	sample->singularity_count = wf->singularity_count;
+	sample->died = wf->previous_count - matched;
+}
+
+/* Summarizes the front over the steps added since the last call, finds
+ * and tracks the phase singularities at the last step, and starts a new
+ * window. */
+void wavefront_take(wavefront wf, struct wavefront_sample *sample)
+{
+	assert(wf);
+	assert(sample);
+
+	take_front(wf, sample);
+	find_singularities(wf);
+	track_singularities(wf, sample);
+
+	memcpy(wf->previous, wf->singularities, (sizeof *wf->singularities) * wf->singularity_count);
+	wf->previous_count = wf->singularity_count;
+	wf->activated_count = 0;
+	wf->window_start = wf->time;
+}
+
+/* Returns the singularities found by the last wavefront_take. */
+const struct wavefront_singularity *wavefront_get_singularities(wavefront wf, uint *count)
+{
+	assert(wf);
+	assert(count);
+
+	*count = wf->singularity_count;
+	return wf->singularities;
+}
+
+/* Returns the last activation time of every cell, in the row-major layout
+ * of the grid. */
+const double *wavefront_get_activation_map(wavefront wf)
+{
+	assert(wf);
+	return wf->activation;
+}
+
+void wavefront_destroy(wavefront *wf)
+{
+	assert(wf);
+	assert(*wf);
+
+	free((*wf)->previous_voltages);
+	free((*wf)->activation);
+	free((*wf)->interval);
+	free((*wf)->phases);
+	free((*wf)->activated);
+	free((*wf)->singularities);
+	free((*wf)->previous);
+	free(*wf);
+	*wf = NULL;
+}